@@ -0,0 +1,98 @@
+#ifndef AGENT_H
+#define AGENT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// ============================================================================
+// Remote Agent
+// ----------------------------------------------------------------------------
+// `pac_rf_exec --agent` stays resident on the device and runs commands sent
+// over a persistent connection instead of one SSH session + process per
+// command. Every request is executed in a forked child of the (already
+// initialized) agent; its output comes back as typed frames.
+//
+// Frame (little-endian):
+//   [ type: u8 ][ flags: u8 ][ reserved: u16 ][ length: u32 ][ payload ]
+//
+// Client → agent:  AGENT_REQ  payload = argv strings, each NUL-terminated
+// Agent → client:  AGENT_TERM / AGENT_LOG / AGENT_IMG  one output line, the
+//                  "TERM: " / "LOG: " / "IMG: " prefix and newline stripped
+//                  AGENT_TEXT  any other output line (e.g. "[INFO] ...")
+//                  AGENT_DATA  binary samples (a --sink stdout stream)
+//                  AGENT_END   i32 status: 0 once the command ran (handlers
+//                              report failures as "... ERROR" TERM lines),
+//                              2 for a malformed or over-long request,
+//                              127 if it could not start, 128+signal if killed
+//
+// Requests on one connection run one after another; open more connections
+// for concurrency. Closing the connection kills a running request.
+//
+// Listen / connect specs:
+//   unix:<path>        Unix socket (default AGENT_DEFAULT_SOCKET, mode 0600)
+//   tcp:<host>:<port>  TCP; tcp:<port> binds 127.0.0.1. The agent has no
+//                      authentication, so non-loopback hosts (and "*") are
+//                      refused unless the server is started with allow_remote
+//   stdio              serve one connection on stdin/stdout, e.g. as
+//                      `ssh pacrf pac_rf_exec --agent --listen stdio`;
+//                      frames start after the AGENT_GREETING line (anything
+//                      printed before it, like the startup log, is not
+//                      protocol) and all later text goes to stderr
+// ============================================================================
+
+#define AGENT_DEFAULT_SOCKET "/tmp/pacrf_agent.sock"
+#define AGENT_HEADER_BYTES   8
+#define AGENT_MAX_PAYLOAD    (1024u * 1024u)
+#define AGENT_GREETING       "PACRF-AGENT 1\n"
+
+enum {
+    AGENT_REQ  = 1,
+    AGENT_TERM = 2,
+    AGENT_LOG  = 3,
+    AGENT_IMG  = 4,
+    AGENT_DATA = 5,
+    AGENT_TEXT = 6,
+    AGENT_END  = 7
+};
+
+// Name of a frame type ("TERM", "DATA", ...); "?" if unknown
+const char *agent_frame_name(uint8_t type);
+
+// Writes one frame to `fd`. Returns 0, or -1 on a transport error.
+int agent_write_frame(int fd, uint8_t type, const void *payload, uint32_t len);
+
+// Reads one frame into `buf` (at least AGENT_MAX_PAYLOAD bytes).
+// Returns 1 on a frame, 0 on clean EOF, -1 on error / bad frame.
+int agent_read_frame(int fd, uint8_t *type, uint8_t *buf, uint32_t *len);
+
+// ----------------------------------------------------------------------------
+// Server
+// ----------------------------------------------------------------------------
+
+// Serves requests on `spec` until SIGTERM/SIGINT (stdio: until EOF).
+// `allow_remote` lets a tcp: spec bind a non-loopback address.
+// Returns 0 on a clean shutdown, -1 if it could not listen.
+int agent_serve(const char *spec, int allow_remote);
+
+// ----------------------------------------------------------------------------
+// Client
+// ----------------------------------------------------------------------------
+
+// Connects to a "unix:<path>" / "tcp:<host>:<port>" agent. Returns fd or -1.
+int agent_connect(const char *spec);
+
+// stdio transport: skips output up to and including AGENT_GREETING,
+// waiting at most `timeout_ms`. Returns 0 once the frames begin, -1 otherwise.
+int agent_await_greeting(int fd, int timeout_ms);
+
+// Called for every frame of a response except AGENT_END
+typedef void (*agent_frame_cb)(uint8_t type, const uint8_t *payload, uint32_t len, void *user);
+
+/**
+ * Sends `argv` as one request on `fd` and delivers the response frames to
+ * `on_frame` until AGENT_END. Returns the command's status, or -1 if the
+ * connection failed (the caller should close `fd`).
+ */
+int agent_request(int fd, int argc, char *const *argv, agent_frame_cb on_frame, void *user);
+
+#endif // AGENT_H
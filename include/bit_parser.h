@@ -46,4 +46,23 @@ void bit_parser_skip(BitParser *parser, size_t num_bits);
  */
 void bit_parser_reset(BitParser *parser);
 
+/**
+ * Returns the number of unread bits left in the stream.
+ */
+size_t bit_parser_remaining(const BitParser *parser);
+
+/**
+ * Bulk-reads up to `count` samples of `width` bits each into `out`.
+ * Uses a 64-bit bit reservoir (one refill per ~7 bytes) instead of one
+ * loop iteration per bit, with byte-aligned fast paths for 4/8/16-bit.
+ * No per-sample logging; the cursor advances by `width` per sample read.
+ *
+ * @param parser      Pointer to BitParser struct (used as the cursor)
+ * @param width       Bits per sample (1-16)
+ * @param out         Destination array, at least `count` entries
+ * @param count       Maximum number of samples to read
+ * @return            Number of samples actually read (short at end of data)
+ */
+size_t bit_parser_read_many(BitParser *parser, size_t width, uint16_t *out, size_t count);
+
 #endif // BIT_PARSER_H
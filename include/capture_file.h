@@ -0,0 +1,153 @@
+#ifndef CAPTURE_FILE_H
+#define CAPTURE_FILE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "nmea.h"
+
+// ============================================================================
+// Capture File Format (little-endian)
+// ----------------------------------------------------------------------------
+//   [ header: 4 KiB ]
+//   [ chunk 0 ][ chunk 1 ] ... [ chunk N-1 ]      each exactly chunk_bytes
+//   [ index: N x CaptureIndexEntry ][ pad ][ CaptureFooter ]   (4 KiB aligned)
+//
+// Every chunk starts with a CaptureChunkHeader followed by int16 samples.
+// All sizes are multiples of 4 KiB, so the writer can use O_DIRECT and
+// chunk i is always at header_bytes + i * chunk_bytes.
+//
+// The trailing index repeats each chunk's first sample and timestamp in
+// one compact array; readers mmap the file and binary-search it, so any
+// time range is found in O(log n). A file whose writer died before the
+// index was written is still readable: the reader binary-searches the
+// chunk headers themselves.
+// ============================================================================
+
+#define CAPTURE_MAGIC          "PACRFCAP"
+#define CAPTURE_INDEX_MAGIC    "PACRFIDX"
+#define CAPTURE_CHUNK_MAGIC    0x4B4E4843u      // "CHNK"
+#define CAPTURE_VERSION        1u
+#define CAPTURE_ALIGN          4096u
+#define CAPTURE_HEADER_BYTES   CAPTURE_ALIGN
+#define CAPTURE_DEFAULT_CHUNK  (1024u * 1024u)
+
+#define CAPTURE_FMT_INT16      1u               // native int16 samples
+
+#define CAPTURE_HDR_GPS        0x0001u          // gps block is valid
+#define CAPTURE_HDR_COMPLETE   0x0002u          // index + footer written
+
+#define CAPTURE_CHUNK_GAP      0x0001u          // samples were lost before this chunk
+
+// GPS state when the capture started (from nmea_info_t)
+typedef struct {
+    int32_t  lat_e7, lon_e7;     // 1e-7 degrees
+    int64_t  utc_epoch_ms;       // fix time (date + time of day), 0 if unknown
+    float    hdop;
+    uint8_t  fix_quality;        // GGA quality
+    uint8_t  fix_type;           // GSA 1/2/3
+    uint8_t  sats;               // satellites in use
+    uint8_t  has_fix;
+} CaptureGps;
+
+typedef struct {
+    char     magic[8];           // CAPTURE_MAGIC
+    uint32_t version;
+    uint32_t header_bytes;       // CAPTURE_HEADER_BYTES
+    uint32_t chunk_bytes;        // multiple of CAPTURE_ALIGN
+    uint16_t bit_width;          // source sample width
+    uint16_t sample_format;      // CAPTURE_FMT_*
+    uint64_t sample_rate_hz;     // 0 if unknown
+    int64_t  start_utc_ns;       // host CLOCK_REALTIME at start
+    uint32_t flags;              // CAPTURE_HDR_*
+    uint32_t reserved;
+    CaptureGps gps;
+    // Filled in when the capture is closed
+    uint64_t chunk_count;
+    uint64_t total_samples;
+    uint64_t index_offset;       // 0 until complete
+} CaptureHeader;
+
+typedef struct {
+    uint32_t magic;              // CAPTURE_CHUNK_MAGIC
+    uint32_t flags;              // CAPTURE_CHUNK_*
+    uint64_t seq;                // chunk number
+    uint64_t first_sample;       // absolute index of the first sample
+    int64_t  t_ns;               // time of the first sample since start
+    uint32_t nsamples;           // valid samples in this chunk
+    uint32_t reserved;
+} CaptureChunkHeader;            // 40 bytes; samples follow at CAPTURE_CHUNK_DATA
+
+#define CAPTURE_CHUNK_DATA 64    // offset of the samples inside a chunk
+
+typedef struct {
+    uint64_t first_sample;
+    int64_t  t_ns;
+} CaptureIndexEntry;
+
+typedef struct {
+    char     magic[8];           // CAPTURE_INDEX_MAGIC
+    uint64_t count;              // index entries
+    uint64_t index_offset;
+    uint64_t total_samples;
+} CaptureFooter;                 // last bytes of the file
+
+// ----------------------------------------------------------------------------
+// Writer
+// ----------------------------------------------------------------------------
+typedef struct CaptureWriter CaptureWriter;
+
+typedef struct {
+    const char *path;
+    unsigned    bit_width;
+    uint64_t    sample_rate_hz;
+    size_t      chunk_bytes;     // 0 = CAPTURE_DEFAULT_CHUNK (rounded to CAPTURE_ALIGN)
+    bool        direct;          // try O_DIRECT (falls back if the FS refuses)
+    const nmea_info_t *gps;      // optional fix to stamp into the header
+} CaptureWriterConfig;
+
+// Creates the file and writes a provisional header. NULL on failure.
+CaptureWriter *capture_writer_open(const CaptureWriterConfig *cfg);
+
+// Appends `count` samples; `t_ns` is the time of the first one since the
+// capture started, `gap` marks lost data before them. Returns 0 or -1.
+int capture_writer_append(CaptureWriter *w, const int16_t *samples, size_t count,
+                          int64_t t_ns, bool gap);
+
+// Flushes the last chunk, writes index + footer, finalizes the header
+// and frees `w`. Returns 0 on success.
+int capture_writer_close(CaptureWriter *w);
+
+// Samples written so far
+uint64_t capture_writer_samples(const CaptureWriter *w);
+
+// ----------------------------------------------------------------------------
+// Reader (mmap)
+// ----------------------------------------------------------------------------
+typedef struct {
+    const uint8_t           *map;
+    size_t                   map_len;
+    const CaptureHeader     *hdr;
+    const CaptureIndexEntry *index;   // NULL if the file was never finalized
+    uint64_t                 chunks;
+    uint64_t                 total_samples;
+} CaptureReader;
+
+// Maps and validates `path`. Returns 0 on success.
+int  capture_reader_open(CaptureReader *r, const char *path);
+void capture_reader_close(CaptureReader *r);
+
+// Chunk containing time `t_ns` / sample `sample` (clamped to the file)
+uint64_t capture_reader_find_time(const CaptureReader *r, int64_t t_ns);
+uint64_t capture_reader_find_sample(const CaptureReader *r, uint64_t sample);
+
+// Header and samples of chunk `i` (pointers into the mapping); NULL if `i` is
+// out of range or the chunk is corrupt (bad magic, nsamples past its end)
+const CaptureChunkHeader *capture_reader_chunk(const CaptureReader *r, uint64_t i,
+                                               const int16_t **samples);
+
+// Registers the "capture:<path>[,chunk=<bytes>][,direct]" stream sink and the
+// "replay:<path>[,speed=<x>][,loop=<n>]" source that plays captures back
+void capture_stream_register(void);
+
+#endif // CAPTURE_FILE_H
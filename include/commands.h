@@ -2,6 +2,7 @@
 #define COMMANDS_H
 
 #include <stddef.h>      // For size_t
+#include <stdio.h>       // For FILE
 #include "handlers.h"    // Command handler prototypes
 #include "logger.h"      // For logging
 
@@ -34,6 +35,16 @@ extern Command commands[];
  */
 extern int num_commands;
 
+/**
+ * command_lookup
+ * ----------------------
+ * Finds a command by name through a hash index built on first use.
+ *
+ * @param name  The command string (e.g., "--gps")
+ * @return      Its table entry, or NULL if there is none
+ */
+const Command *command_lookup(const char *name);
+
 /**
  * dispatch_command
  * ----------------------
@@ -45,6 +56,17 @@ extern int num_commands;
  */
 void dispatch_command(const char *cmd, int argc, char **argv);
 
+/**
+ * dispatch_batch
+ * ----------------------
+ * Runs every command read from `in` (';' or newline separated) in this
+ * process, each framed by "BATCH: BEGIN n ..." / "BATCH: END n <ms>ms".
+ *
+ * @param in  Command source (file or stdin)
+ * @return    Number of commands run
+ */
+int dispatch_batch(FILE *in);
+
 /**
  * print_usage
  * ----------------------
@@ -3,4 +3,15 @@
 
 #define DEFAULT_BITWIDTH 8
 
+// Main queue depth; override with PACRF_QUEUE_CAPACITY. Check the HWM and
+// Drops fields of queue_log_status before changing it.
+#define DEFAULT_QUEUE_CAPACITY 10
+
+// Startup memory pools (mempool.h); override with PACRF_POOL_BLOCK_BYTES,
+// PACRF_POOL_BLOCKS and PACRF_ARENA_BYTES. Mappings are lazily backed unless
+// huge pages are reserved, so unused capacity costs address space only.
+#define DEFAULT_POOL_BLOCK_BYTES (64 * 1024)
+#define DEFAULT_POOL_BLOCKS      64
+#define DEFAULT_ARENA_BYTES      (4 * 1024 * 1024)
+
 #endif
@@ -0,0 +1,75 @@
+#ifndef GPS_CACHE_H
+#define GPS_CACHE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <sys/types.h>   // pid_t
+#include "nmea.h"
+
+// ============================================================================
+// GPS Shared-Memory Cache
+// ----------------------------------------------------------------------------
+// The GPS daemon (--gps-daemon) keeps the UART open, parses continuously and
+// publishes the latest nmea_info_t into a POSIX shared-memory segment. Any
+// process can then read a fix in microseconds instead of doing a cold read.
+//
+// One writer, any number of readers, no locks: the record is guarded by a
+// sequence counter that is odd while an update is in progress. Readers copy
+// the record and retry if the counter moved underneath them.
+//
+// The segment name defaults to GPS_CACHE_NAME; PACRF_GPS_SHM overrides it.
+// ============================================================================
+
+#define GPS_CACHE_NAME    "/pacrf_gps"
+#define GPS_CACHE_MAGIC   0x53504750u   // "PGPS"
+#define GPS_CACHE_VERSION 1u
+
+// A consistent copy of the published state
+typedef struct {
+    pid_t       pid;              // daemon process id
+    int         baud;             // UART rate in use
+    int64_t     updated_mono_ms;  // CLOCK_MONOTONIC of the last valid sentence
+    int64_t     heartbeat_mono_ms;// CLOCK_MONOTONIC of the daemon's last loop
+    uint64_t    sentences_ok;     // parser counters since the daemon started
+    uint64_t    bad_checksum;
+    nmea_info_t info;             // cumulative receiver state
+} gps_cache_snapshot_t;
+
+// Handle for either side; `shm` is NULL when closed
+typedef struct {
+    struct gps_cache_shm *shm;
+    bool                  writer;
+} gps_cache_t;
+
+// Creates (or takes over) the segment for publishing. Returns 0 on success.
+int  gps_cache_open_writer(gps_cache_t *c, int baud);
+
+// Maps an existing segment read-only. Returns 0 on success, -1 if no
+// daemon has created it.
+int  gps_cache_open_reader(gps_cache_t *c);
+
+// Writer: publishes `info` and the parser counters; stamps updated + heartbeat
+void gps_cache_publish(gps_cache_t *c, const nmea_info_t *info,
+                       uint64_t sentences_ok, uint64_t bad_checksum);
+
+// Writer: stamps only the heartbeat (no new data, daemon still alive)
+void gps_cache_heartbeat(gps_cache_t *c);
+
+// Reader: copies a consistent snapshot. Returns false if the segment is
+// closed, from another version, or still being written after many retries.
+bool gps_cache_read(const gps_cache_t *c, gps_cache_snapshot_t *out);
+
+// Unmaps; a writer also removes the segment name
+void gps_cache_close(gps_cache_t *c);
+
+/**
+ * Convenience for one-shot callers (--gps, capture): opens, reads and closes.
+ * Succeeds only if the daemon is alive and its last valid sentence is at
+ * most `max_age_ms` old. `age_ms` (optional) receives that age.
+ */
+bool gps_cache_fetch(gps_cache_snapshot_t *out, long max_age_ms, long *age_ms);
+
+// Current CLOCK_MONOTONIC time in ms (the cache's time base)
+int64_t gps_cache_now_ms(void);
+
+#endif // GPS_CACHE_H
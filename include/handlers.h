@@ -14,15 +14,42 @@
  *  - Current handlers are stubbed to simulate functionality.
  */
 
+/** Handle agent command: stays resident and serves framed requests (agent.h). */
+void handle_agent(int argc, char **argv);
+
+/** Handle batch command: runs a list of commands from a file or stdin in-process. */
+void handle_batch(int argc, char **argv);
+
 /** Handle capture command: Simulates a device capture operation. */
 void handle_capture(int argc, char **argv);
 
+/** Handle fetch command: copies a device file to stdout / the agent's DATA channel. */
+void handle_fetch(int argc, char **argv);
+
 /** Handle GPS command: Simulates retrieving GPS coordinates. */
 void handle_gps(int argc, char **argv);
 
-/** Handle stream start command: Simulates initializing a data stream. */
+/** Handle GPS daemon command: keeps the UART open and publishes fixes to shm. */
+void handle_gps_daemon(int argc, char **argv);
+
+/** Handle metrics command: prints METRICS: snapshots of the process-wide counters. */
+void handle_metrics(int argc, char **argv);
+
+/** Handle replay command: plays a capture or NMEA log through the live paths, reports latency. */
+void handle_replay(int argc, char **argv);
+
+/** Handle spectrum start command: streams SPEC: power-spectrum frames. */
+void handle_spectrum_start(int argc, char **argv);
+
+/** Handle spectrum stop command: signals the running --spectrum-start process. */
+void handle_spectrum_stop(int argc, char **argv);
+
+/** Handle stream start command: runs the source → unpack → sink pipeline. */
 void handle_stream_start(int argc, char **argv);
 
+/** Handle stream stop command: signals the running --stream-start process. */
+void handle_stream_stop(int argc, char **argv);
+
 /** Handle tone send command: Simulates sending a tone to the device. */
 void handle_tone_send(int argc, char **argv);
 
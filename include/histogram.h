@@ -0,0 +1,49 @@
+#ifndef HISTOGRAM_H
+#define HISTOGRAM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// ============================================================================
+// Latency Histogram
+// ----------------------------------------------------------------------------
+// HDR-style log-linear buckets: values below HISTOGRAM_SUB are exact, every
+// power of two above is split into HISTOGRAM_SUB equal steps, so any
+// recorded value is reported within 1/HISTOGRAM_SUB (6.25%) of itself over
+// the whole uint64 range. Recording is a bucket lookup and four stores.
+//
+// Each histogram has ONE writer thread (like StreamStageStats); other
+// threads may read it at any time with histogram_merge(), which is how
+// per-thread histograms are combined into one snapshot. Units are up to
+// the caller (the pipeline records nanoseconds).
+// ============================================================================
+
+#define HISTOGRAM_SUB_BITS 4
+#define HISTOGRAM_SUB      (1u << HISTOGRAM_SUB_BITS)
+#define HISTOGRAM_BUCKETS  ((64 - HISTOGRAM_SUB_BITS + 1) * HISTOGRAM_SUB)
+
+typedef struct {
+    uint64_t count;
+    uint64_t sum;
+    uint64_t min;          // UINT64_MAX while empty
+    uint64_t max;
+    uint64_t buckets[HISTOGRAM_BUCKETS];
+} Histogram;
+
+// Empties `h`
+void histogram_init(Histogram *h);
+
+// Writer thread only: adds one value
+void histogram_record(Histogram *h, uint64_t value);
+
+// Adds `src` (any thread may be writing it) into `dst` (owned by the caller)
+void histogram_merge(Histogram *dst, const Histogram *src);
+
+// Value at percentile `p` (0-100], e.g. 99.9; 0 if empty. Reported as the
+// highest value of its bucket, clamped to [min, max].
+uint64_t histogram_percentile(const Histogram *h, double p);
+
+// Mean of the recorded values (0 if empty)
+double histogram_mean(const Histogram *h);
+
+#endif // HISTOGRAM_H
@@ -1,6 +1,12 @@
 #ifndef INTERFACE_H
 #define INTERFACE_H
 
+#include <stddef.h>
+
+// With PACRF_AGENT set, commands go to a resident `pac_rf_exec --agent`
+// over kept-open connections (see interface.c / agent.h); otherwise each
+// call runs its own ssh session.
+
 // Stream a PAC-RF command like "--gps" and print lines to stdout.
 // Good for CLI runs.
 int run_pacrf_cmd(const char *args);
@@ -12,4 +18,50 @@ int run_pacrf_cmd(const char *args);
 typedef void (*pacrf_line_cb)(const char *line, void *user);
 int run_pacrf_cmd_cb(const char *args, pacrf_line_cb on_line, void *user);
 
+// Like run_pacrf_cmd_cb(), plus the binary samples of a `--sink stdout`
+// stream. Data arrives only through the agent (PACRF_AGENT); over plain
+// ssh it would be mixed into the text lines.
+typedef void (*pacrf_data_cb)(const void *data, size_t len, void *user);
+int run_pacrf_cmd_data(const char *args, pacrf_line_cb on_line, pacrf_data_cb on_data, void *user);
+
+// Cancellation: a token passed to run_pacrf_cmd_cancellable() can be
+// triggered from any thread. It kills the command's ssh process group, or
+// shuts its agent connection down (the agent then kills the request), and
+// the call returns PACRF_CMD_CANCELLED. Cancelling before the call starts
+// makes it return at once.
+#define PACRF_CMD_CANCELLED (-3)
+typedef struct pacrf_cancel pacrf_cancel_t;
+pacrf_cancel_t *pacrf_cancel_new(void);
+void pacrf_cancel(pacrf_cancel_t *c);
+int  pacrf_is_cancelled(pacrf_cancel_t *c);
+void pacrf_cancel_free(pacrf_cancel_t *c);
+
+int run_pacrf_cmd_cancellable(const char *args, pacrf_line_cb on_line, pacrf_data_cb on_data,
+                              void *user, pacrf_cancel_t *cancel);
+
+// Copies `remote_path` on the device to `local_path`: DATA frames of
+// `--fetch` through the agent, or `cat` over ssh. Returns 0 (and the size
+// in *bytes_out), -1 on failure (no partial file is left behind).
+int pacrf_fetch_file(const char *remote_path, const char *local_path, size_t *bytes_out);
+
+// SSH connection reuse (see interface.c): one ControlMaster connection per
+// session, every command multiplexed over it.
+typedef struct {
+    int      enabled;           // 0 when PACRF_SSH_CONTROL=0
+    int      up;                // master answered its last check
+    unsigned connects;          // masters established this session
+    unsigned connect_failures;
+    unsigned checks;            // `ssh -O check` probes
+    unsigned reuses;            // commands that went over an existing master
+    long     last_connect_ms;   // handshake time of the current master
+} pacrf_ssh_stats_t;
+
+// Establishes the master now (e.g. at GUI start) so the first command is
+// fast. Returns the connect time in ms, -1 if disabled or it failed.
+int  pacrf_ssh_connect(void);
+void pacrf_ssh_get_stats(pacrf_ssh_stats_t *out);
+
+// Closes the master (`ssh -O exit`); ControlPersist ends it otherwise.
+void pacrf_ssh_close(void);
+
 #endif
@@ -10,18 +10,90 @@
 // Provides simple, formatted logging functions for informational messages
 // and warnings. All functions support printf-style formatting using
 // variable argument lists.
+//
+// Filtering happens in two places:
+//   - PACRF_LOG_MIN_LEVEL (compile time): calls below it compile to nothing
+//   - log_set_level() / PACRF_LOG_LEVEL env (runtime): calls below the
+//     threshold cost one compare and never evaluate or format their args
 // ============================================================================
 
+// Log levels (plain integers so they also work in #if)
+#define LOG_LEVEL_DEBUG    0
+#define LOG_LEVEL_INFO     1
+#define LOG_LEVEL_WARNING  2
+#define LOG_LEVEL_ERROR    3
+#define LOG_LEVEL_NONE     4
+
+// Compile-time floor (CMake: -DPACRF_LOG_MIN_LEVEL=INFO, etc.)
+#ifndef PACRF_LOG_MIN_LEVEL
+#define PACRF_LOG_MIN_LEVEL LOG_LEVEL_DEBUG
+#endif
+
+#if defined(__GNUC__)
+#define LOG_PRINTF_FMT __attribute__((format(printf, 1, 2)))
+#else
+#define LOG_PRINTF_FMT
+#endif
+
+// Current runtime threshold; read through LOG_ENABLED(), set via log_set_level()
+extern int g_log_level;
+
+// True if a message at `level` would be emitted
+#define LOG_ENABLED(level) \
+    ((level) >= PACRF_LOG_MIN_LEVEL && (level) >= g_log_level)
+
+// Sets / gets the runtime threshold (LOG_LEVEL_*)
+void log_set_level(int level);
+int  log_get_level(void);
+
+// Parses "debug", "info", "warning", "error" or "none"; returns -1 if unknown
+int log_level_from_string(const char *name);
+
+// Applies PACRF_LOG_LEVEL from the environment, if set. PACRF_LOG_ASYNC=1
+// also starts the async backend (to PACRF_LOG_FILE, or stdout).
+void log_init_from_env(void);
+
+// ---------------------------------------------------------------------------
+// Async backend
+// ---------------------------------------------------------------------------
+// While active, log_* calls copy their raw arguments into a lock-free MPSC
+// ring and return; a background thread formats and writes them in batches.
+// Messages are dropped (and counted) rather than blocking when the ring is
+// full. The log_* front end is unchanged.
+
+// Starts async mode writing to `path` (NULL = stdout). `capacity` is the
+// ring size in records (0 = default). Returns 0 on success.
+int  log_async_start(const char *path, size_t capacity);
+
+// Blocks until everything logged so far has been written
+void log_async_flush(void);
+
+// Drains the ring, stops the writer thread and returns to sync output
+void log_async_stop(void);
+
+// True while the async backend is running
+int  log_async_active(void);
+
+// Logs a debug message for per-operation tracing (printf-style)
+void log_debug(const char *fmt, ...) LOG_PRINTF_FMT;
+
 // Logs an informational message (printf-style)
-void log_info(const char *fmt, ...);
+void log_info(const char *fmt, ...) LOG_PRINTF_FMT;
 
 // Logs a warning message (printf-style)
-void log_warning(const char *fmt, ...);
+void log_warning(const char *fmt, ...) LOG_PRINTF_FMT;
 
 // Logs an error message (printf-style)
-void log_error(const char *fmt, ...);
+void log_error(const char *fmt, ...) LOG_PRINTF_FMT;
 
 // Utility to print output directly to a "terminal" (simulated console output)
 void term_output(const char *message);
 
+// Level-gated front ends: same call syntax as the functions above, but the
+// arguments are only evaluated when the level is enabled.
+#define log_debug(...)   do { if (LOG_ENABLED(LOG_LEVEL_DEBUG))   (log_debug)(__VA_ARGS__);   } while (0)
+#define log_info(...)    do { if (LOG_ENABLED(LOG_LEVEL_INFO))    (log_info)(__VA_ARGS__);    } while (0)
+#define log_warning(...) do { if (LOG_ENABLED(LOG_LEVEL_WARNING)) (log_warning)(__VA_ARGS__); } while (0)
+#define log_error(...)   do { if (LOG_ENABLED(LOG_LEVEL_ERROR))   (log_error)(__VA_ARGS__);   } while (0)
+
 #endif // LOGGER_H
@@ -0,0 +1,134 @@
+#ifndef MEMPOOL_H
+#define MEMPOOL_H
+
+#include <stddef.h>     // For size_t
+#include <stdint.h>     // For uint64_t
+#include <stdbool.h>    // For bool type
+#include "pacrf_atomic.h"
+
+// ============================================================
+// Memory Pools
+// ------------------------------------------------------------
+// Buffers for the queue / stream / capture / USB paths are
+// carved out of memory reserved at startup instead of going
+// through malloc on every use:
+//
+//  - BufferPool: fixed-size blocks, lock-free free list
+//    (any thread may allocate or free). Exhaustion is counted,
+//    never blocks.
+//  - Arena: bump allocator for per-command scratch. Nothing
+//    is freed individually; the whole arena is reset when the
+//    command finishes (dispatch_command does this).
+//
+// Regions are mapped with MAP_HUGETLB when the system has huge
+// pages reserved, otherwise with normal pages plus a
+// transparent-huge-page hint.
+//
+// mempool_alloc()/mempool_free() are the entry points the rest
+// of the tree uses: a block from the global pool when the size
+// fits, a dedicated (huge-page) mapping for large buffers, and
+// the heap for anything else.
+// ============================================================
+
+// Startup sizing (config.h defaults, env overrides):
+//   PACRF_POOL_BLOCK_BYTES, PACRF_POOL_BLOCKS, PACRF_ARENA_BYTES
+
+// Fixed-block pool ------------------------------------------------------------
+typedef struct {
+    size_t   block_bytes;
+    size_t   blocks;
+    size_t   in_use;        // blocks handed out right now
+    size_t   high_water;    // most blocks ever in use at once
+    uint64_t allocs;        // successful allocations
+    uint64_t frees;
+    uint64_t exhausted;     // allocations refused: pool empty
+    bool     huge_pages;    // region is MAP_HUGETLB backed
+} BufferPoolStats;
+
+typedef struct {
+    uint8_t  *base;         // blocks * block_bytes, page aligned
+    size_t    map_bytes;    // length of the mapping
+    uint32_t *next;         // free-list links (block index + 1, 0 = end)
+    size_t    block_bytes;
+    size_t    blocks;
+    bool      huge_pages;
+
+    PACRF_CACHE_ALIGNED uint64_t head;    // (tag << 32) | (index + 1)
+    PACRF_CACHE_ALIGNED size_t in_use;
+    size_t   high_water;
+    uint64_t allocs, frees, exhausted;
+} BufferPool;
+
+// Maps `blocks` blocks of `block_bytes` (rounded up to a cache line).
+bool  buffer_pool_init(BufferPool *pool, size_t block_bytes, size_t blocks);
+void  buffer_pool_destroy(BufferPool *pool);
+
+// Returns a block or NULL when the pool is empty (counted as exhausted)
+void *buffer_pool_alloc(BufferPool *pool);
+void  buffer_pool_free(BufferPool *pool, void *block);
+
+// True if `p` points into the pool's region
+bool  buffer_pool_owns(const BufferPool *pool, const void *p);
+
+void  buffer_pool_get_stats(const BufferPool *pool, BufferPoolStats *out);
+
+// Bump arena -----------------------------------------------------------------
+typedef struct {
+    size_t   capacity;
+    size_t   used;
+    size_t   peak;          // most bytes ever in use
+    uint64_t allocs;
+    uint64_t failed;        // allocations that did not fit
+    bool     huge_pages;
+} ArenaStats;
+
+typedef struct {
+    uint8_t *base;
+    size_t   capacity;
+    size_t   used;
+    size_t   peak;
+    uint64_t allocs, failed;
+    bool     huge_pages;
+} Arena;
+
+bool  arena_init(Arena *a, size_t capacity);
+void  arena_destroy(Arena *a);
+
+// `align` must be a power of two (0 = 16). NULL when the arena is full.
+// Single-threaded: an arena belongs to the command that is running.
+void *arena_alloc(Arena *a, size_t bytes, size_t align);
+
+// Rewinds to a previous arena_mark(); arena_reset() rewinds to empty
+size_t arena_mark(const Arena *a);
+void   arena_reset_to(Arena *a, size_t mark);
+void   arena_reset(Arena *a);
+
+void  arena_get_stats(const Arena *a, ArenaStats *out);
+
+// Process-wide pools ---------------------------------------------------------
+
+// Sizes and maps the global block pool and scratch arena (idempotent)
+bool  mempool_startup(void);
+void  mempool_shutdown(void);
+
+// NULL before mempool_startup() (callers then fall back to the heap)
+BufferPool *mempool_buffers(void);
+Arena      *mempool_arena(void);
+
+/**
+ * Allocates `bytes`: a global pool block when it fits, a dedicated mapping
+ * (huge pages if possible) when `bytes` >= MEMPOOL_MAP_THRESHOLD, the heap
+ * otherwise. At least cache-line aligned; page aligned from 4 KiB up.
+ * Pass the same `bytes` to mempool_free().
+ */
+#define MEMPOOL_MAP_THRESHOLD (512u * 1024u)
+void *mempool_alloc(size_t bytes);
+void  mempool_free(void *p, size_t bytes);
+
+// Per-command scratch from the global arena (heap-free; reset after each command)
+void *mempool_scratch(size_t bytes);
+
+// Logs pool + arena occupancy, exhaustion and fallback counts
+void  mempool_log_stats(void);
+
+#endif // MEMPOOL_H
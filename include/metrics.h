@@ -0,0 +1,98 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "histogram.h"
+
+// ============================================================================
+// Hot-Path Metrics
+// ----------------------------------------------------------------------------
+// Process-wide counters, gauges and latency histograms for the data path.
+// Every thread adds into its own shard (found through a __thread pointer),
+// so an update is a couple of plain stores: no locks, no shared cache line.
+// metrics_snapshot() sums all shards on read. Shards of exited threads are
+// kept, with their counts, and handed to the next new thread.
+//
+// The ids are a fixed table; add new ones before the closing count entry
+// and give them a name in metrics.c. Snapshots go out as one line,
+//
+//   METRICS: t=12.0 threads=4 stream_bytes=... raw_queue_bytes=cur/max
+//            lat_unpack_us=p50/p99/p999/max/n ...
+//
+// from --metrics and every PACRF_METRICS_MS (default 1000, 0 = off) from
+// long-running commands (--stream-start, --capture, --spectrum-start,
+// --replay, --gps-daemon).
+// ============================================================================
+
+typedef enum {
+    METRIC_STREAM_BYTES = 0,     // bytes read from stream sources
+    METRIC_STREAM_BLOCKS,        // raw blocks read by stream sources
+    METRIC_STREAM_DROPS,         // raw blocks dropped by the reader (pipeline full)
+    METRIC_SINK_ERRORS,          // sink write() failures
+    METRIC_USB_BYTES,            // bytes from completed USB bulk transfers
+    METRIC_GPS_UART_BYTES,       // bytes read from the GPS UART
+    METRIC_NMEA_OK,              // sentences with a valid checksum
+    METRIC_NMEA_BAD_CHECKSUM,    // sentences with a bad or missing checksum
+    METRIC_NMEA_OVERFLOWS,       // sentences longer than NMEA_MAX_SENTENCE
+    METRIC_QUEUE_DROPS,          // Queue/SpscQueue items rejected when full
+    METRIC_QUEUE_OVERWRITES,     // oldest items retired (OVERWRITE_OLDEST)
+    METRIC_COMMANDS,             // commands dispatched
+    METRIC_COUNTERS
+} MetricCounter;
+
+typedef enum {
+    METRIC_GAUGE_RAW_QUEUE_BYTES = 0,    // stream source → unpack ring in use
+    METRIC_GAUGE_SAMPLE_QUEUE_BYTES,     // unpack → sink ring in use
+    METRIC_GAUGES
+} MetricGauge;
+
+// Nanoseconds. The stream entries follow StreamLatencyStage.
+typedef enum {
+    METRIC_LAT_RAW_QUEUE = 0,
+    METRIC_LAT_UNPACK,
+    METRIC_LAT_SAMPLE_QUEUE,
+    METRIC_LAT_SINK,
+    METRIC_LAT_STREAM_TOTAL,
+    METRIC_LAT_COMMAND,          // one command handler, dispatch to return
+    METRIC_HISTOGRAMS
+} MetricHistogram;
+
+typedef struct {
+    int64_t  t_ns;                          // since the first update or snapshot
+    unsigned threads;                       // shards (threads that ever recorded)
+    uint64_t counter[METRIC_COUNTERS];
+    uint64_t gauge[METRIC_GAUGES];
+    uint64_t gauge_max[METRIC_GAUGES];
+    Histogram hist[METRIC_HISTOGRAMS];
+} MetricsSnapshot;                          // large (~50 KiB): keep it off the stack
+
+// Any thread: adds `v` to a counter
+void metrics_add(MetricCounter id, uint64_t v);
+
+// Any thread: records one latency value
+void metrics_record(MetricHistogram id, uint64_t ns);
+
+// Any thread: sets a gauge (last write wins) and raises its high-water mark
+void metrics_gauge_set(MetricGauge id, uint64_t v);
+
+// Sums every shard into `out` (safe while other threads record)
+void metrics_snapshot(MetricsSnapshot *out);
+
+// Short names used in the METRICS: line ("stream_bytes", "raw_queue_bytes", "unpack")
+const char *metrics_counter_name(MetricCounter id);
+const char *metrics_gauge_name(MetricGauge id);
+const char *metrics_histogram_name(MetricHistogram id);
+
+// Formats `s` as one "METRICS: ..." line (newline included); returns its length
+size_t metrics_format(const MetricsSnapshot *s, char *buf, size_t cap);
+
+// Takes a snapshot and writes its METRICS: line to `out`. Returns 0, or -1
+// if the snapshot could not be allocated.
+int  metrics_print(FILE *out);
+
+// Snapshot period for long-running commands: PACRF_METRICS_MS, default 1000, 0 = off
+long metrics_interval_ms(void);
+
+#endif // METRICS_H
@@ -2,6 +2,19 @@
 #define NMEA_H
 
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define NMEA_MAX_SATS 64   // GSV entries kept across all constellations
+
+// One satellite from GSV
+typedef struct {
+    char     talker[2];  // "GP", "GL", "GA", "GB", ...
+    uint16_t prn;
+    int8_t   elev_deg;   // -1 if not reported
+    int8_t   snr_db;     // C/N0 dB-Hz, -1 if not tracking
+    uint16_t az_deg;
+} nmea_sat_t;
 
 typedef struct {
     bool   has_fix;      // true if fix valid (RMC:A or GGA quality>0)
@@ -9,13 +22,83 @@ typedef struct {
     int    sats;         // satellites in use (from GGA)
     double lat_deg;      // decimal degrees (+N/-S)
     double lon_deg;      // decimal degrees (+E/-W)
+    int32_t lat_e7;      // same position in fixed point (1e-7 degrees)
+    int32_t lon_e7;
     char   time_utc[16]; // "HHMMSS.sss" if present
+
+    int32_t utc_ms;      // time of day in ms (GGA/RMC/ZDA), -1 if unknown
+    uint16_t year;       // UTC date (ZDA, or RMC), 0 if unknown
+    uint8_t  month, day;
+
+    int    fix_type;     // GSA: 1=none, 2=2D, 3=3D (0 = not seen)
+    float  pdop, hdop, vdop;
+
+    float  speed_knots;  // VTG/RMC speed over ground
+    float  speed_kmh;    // VTG
+    float  course_deg;   // VTG/RMC true course
+
+    int        sats_in_view;          // entries in sat[]
+    nmea_sat_t sat[NMEA_MAX_SATS];    // GSV, replaced per talker on message 1
 } nmea_info_t;
 
+// Clears `info` and marks time/date unknown
+void nmea_info_init(nmea_info_t *info);
+
+// UTC date+time as milliseconds since the Unix epoch, or -1 if either the
+// date (ZDA/RMC) or the time of day is unknown
+int64_t nmea_utc_epoch_ms(const nmea_info_t *info);
+
 /**
  * Parse a single NMEA sentence (e.g., "$GPGGA,...*CS").
  * Returns true if checksum is OK; fills fields opportunistically.
+ * GGA, RMC, GSA, GSV, VTG and ZDA are decoded from any talker.
  */
 bool nmea_parse_line(const char *line, nmea_info_t *out);
 
+/* ============================================================================
+ *  Streaming parser
+ * ----------------------------------------------------------------------------
+ *  Fed raw bytes straight from a UART read(); frames sentences on '$',
+ *  folds the XOR checksum and records field boundaries as each byte
+ *  arrives, then decodes the sentence when the two checksum digits are in.
+ *  All state lives in nmea_stream_t (no statics, no strtok), so one stream
+ *  per device can run on its own thread.
+ * ==========================================================================*/
+
+// NMEA 0183 caps sentences at 82 chars; leave room for proprietary ones
+#define NMEA_MAX_SENTENCE 128
+#define NMEA_MAX_FIELDS   32
+
+// Per-sentence framing state (shared by the stream and nmea_parse_line)
+typedef struct {
+    uint8_t  state;                       // idle / body / checksum digits
+    uint8_t  cs;                          // running XOR of the body
+    uint8_t  cs_rx;                       // checksum received after '*'
+    uint8_t  nfields;                     // fields seen so far
+    uint16_t len;                         // bytes of the current sentence
+    uint16_t field_off[NMEA_MAX_FIELDS + 1]; // field i = [off[i], off[i+1]-1)
+} nmea_scan_t;
+
+typedef struct {
+    nmea_scan_t scan;
+    char        buf[NMEA_MAX_SENTENCE + 1];  // current sentence, NUL-terminated when complete
+    uint32_t    ok;                          // sentences with a valid checksum
+    uint32_t    bad_checksum;                // framed but checksum mismatch/missing
+    uint32_t    overflows;                   // longer than NMEA_MAX_SENTENCE
+} nmea_stream_t;
+
+// Called once per framed sentence; `line` is the raw "$...*HH" text
+typedef void (*nmea_sentence_cb)(const char *line, size_t len, bool ok, void *user);
+
+// Resets the stream (counters included)
+void nmea_stream_init(nmea_stream_t *s);
+
+/**
+ * Feeds `n` raw bytes. Valid sentences update `info` (may be NULL); every
+ * framed sentence is reported to `cb` (may be NULL). Partial sentences
+ * are kept for the next call. Returns the number of valid sentences.
+ */
+size_t nmea_stream_feed(nmea_stream_t *s, const char *data, size_t n,
+                        nmea_info_t *info, nmea_sentence_cb cb, void *user);
+
 #endif
@@ -0,0 +1,49 @@
+#ifndef PACRF_ATOMIC_H
+#define PACRF_ATOMIC_H
+
+// ============================================================
+// Atomics & Cache Helpers
+// ------------------------------------------------------------
+// Thin wrappers over the GCC/Clang __atomic builtins. We build as
+// gnu99 for the target's GCC 4.8, which has no <stdatomic.h>, but
+// does support these builtins with the C11 memory orders.
+// ============================================================
+
+#define PACRF_CACHELINE      64
+#define PACRF_CACHE_ALIGNED  __attribute__((aligned(PACRF_CACHELINE)))
+
+#define PACRF_LIKELY(x)      __builtin_expect(!!(x), 1)
+#define PACRF_UNLIKELY(x)    __builtin_expect(!!(x), 0)
+
+// Loads / stores
+#define pacrf_load_relaxed(p)        __atomic_load_n((p), __ATOMIC_RELAXED)
+#define pacrf_load_acquire(p)        __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define pacrf_store_relaxed(p, v)    __atomic_store_n((p), (v), __ATOMIC_RELAXED)
+#define pacrf_store_release(p, v)    __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+
+// Read-modify-write (return the previous value)
+#define pacrf_fetch_add(p, v)        __atomic_fetch_add((p), (v), __ATOMIC_RELAXED)
+#define pacrf_fetch_sub(p, v)        __atomic_fetch_sub((p), (v), __ATOMIC_RELAXED)
+#define pacrf_exchange(p, v)         __atomic_exchange_n((p), (v), __ATOMIC_ACQ_REL)
+
+// Weak CAS; on failure *expected is refreshed with the current value
+#define pacrf_cas_weak(p, expected, desired) \
+    __atomic_compare_exchange_n((p), (expected), (desired), 1, \
+                                __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)
+
+#define pacrf_fence_acquire()        __atomic_thread_fence(__ATOMIC_ACQUIRE)
+#define pacrf_fence_release()        __atomic_thread_fence(__ATOMIC_RELEASE)
+#define pacrf_fence_seq_cst()        __atomic_thread_fence(__ATOMIC_SEQ_CST)
+
+// Spin-wait hint for busy loops
+static inline void pacrf_cpu_relax(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__) || (defined(__arm__) && defined(__ARM_ARCH) && __ARM_ARCH >= 7)
+    __asm__ __volatile__("yield" ::: "memory");
+#else
+    __asm__ __volatile__("" ::: "memory");
+#endif
+}
+
+#endif // PACRF_ATOMIC_H
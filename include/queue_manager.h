@@ -2,8 +2,11 @@
 #define QUEUE_MANAGER_H
 
 #include <stddef.h>     // For size_t
+#include <stdint.h>     // For uint8_t
 #include <stdbool.h>    // For bool type
+#include <pthread.h>    // For the blocking-wait condvars
 #include "logger.h"     // For logging queue status
+#include "pacrf_atomic.h" // Cache-line alignment for the SPSC variant
 
 // ============================================================
 // Queue Manager
@@ -19,6 +22,22 @@ typedef struct {
     size_t length;      // Length of the payload
 } QueueItem;
 
+// What enqueue does when the queue is full
+typedef enum {
+    QUEUE_OVERFLOW_REJECT = 0,        // Fail the enqueue and count a drop (default)
+    QUEUE_OVERFLOW_OVERWRITE_OLDEST,  // Discard the oldest item to make room
+    QUEUE_OVERFLOW_BLOCK              // Wait for the consumer (threaded queues only)
+} QueueOverflowPolicy;
+
+// Occupancy / loss accounting (updated atomically; read with *_get_stats)
+typedef struct {
+    size_t   high_water;   // Most items ever queued at once
+    uint64_t enqueued;     // Items accepted
+    uint64_t dequeued;     // Items removed by the consumer
+    uint64_t drops;        // Items rejected because the queue was full
+    uint64_t overwrites;   // Oldest items discarded by OVERWRITE_OLDEST
+} QueueStats;
+
 // Queue structure
 typedef struct {
     QueueItem *items;   // Dynamic array of queue items
@@ -26,6 +45,8 @@ typedef struct {
     size_t head;        // Read pointer
     size_t tail;        // Write pointer
     size_t count;       // Current number of items
+    QueueOverflowPolicy policy;   // Full-queue behavior (default REJECT)
+    QueueStats stats;             // Drop / overwrite / high-water counters
 } Queue;
 
 // -------------------- Public API --------------------
@@ -42,6 +63,19 @@ bool queue_enqueue(Queue *q, const QueueItem *item);
 // Removes an item from the queue (returns false if empty)
 bool queue_dequeue(Queue *q, QueueItem *out_item);
 
+// Adds up to `n` items with one index update; returns how many fit
+size_t queue_enqueue_bulk(Queue *q, const QueueItem *items, size_t n);
+
+// Removes up to `max` items with one index update; returns how many
+size_t queue_dequeue_bulk(Queue *q, QueueItem *out_items, size_t max);
+
+// Selects the full-queue behavior. BLOCK needs a second thread to make
+// room, so the single-threaded Queue rejects it (returns false).
+bool queue_set_overflow_policy(Queue *q, QueueOverflowPolicy policy);
+
+// Copies the current counters into `out`
+void queue_get_stats(const Queue *q, QueueStats *out);
+
 // Checks if the queue is full
 bool queue_is_full(const Queue *q);
 
@@ -51,4 +85,181 @@ bool queue_is_empty(const Queue *q);
 // Logs the current status of the queue
 void queue_log_status(const Queue *q);
 
+// ============================================================
+// Queue Waiter
+// ------------------------------------------------------------
+// Lets a consumer sleep until data arrives (or a producer until
+// space frees up) instead of polling. The fast path stays lock-
+// free: the side that makes progress only takes the mutex when
+// `waiters` says someone is actually asleep. Timeouts are in ms
+// (<0 = wait forever, 0 = don't wait).
+// ============================================================
+typedef struct {
+    pthread_mutex_t lock;
+    pthread_cond_t  cond;
+    int             waiters;     // Threads currently sleeping (atomic)
+} QueueWaiter;
+
+// ============================================================
+// SPSC Queue (lock-free)
+// ------------------------------------------------------------
+// Single-producer / single-consumer ring for handing QueueItems
+// between exactly two threads (e.g. UART/USB reader → processing)
+// without a mutex. Head and tail are free-running atomic counters
+// on separate cache lines; capacity is rounded up to a power of
+// two so slots are found with a mask instead of `%`. The producer
+// publishes with a release store of `tail`, the consumer frees
+// slots with a release store of `head`; each side keeps a cached
+// copy of the other's index to avoid touching its cache line on
+// every call.
+// ============================================================
+typedef struct {
+    // Read-mostly configuration
+    QueueItem *items;   // Ring storage (capacity slots)
+    size_t capacity;    // Number of slots (power of two)
+    size_t mask;        // capacity - 1
+
+    QueueOverflowPolicy policy;   // Full-queue behavior (set before use)
+    int block_timeout_ms;         // BLOCK: max wait before counting a drop
+
+    // Producer cache line
+    PACRF_CACHE_ALIGNED size_t tail;   // Next slot to write (free-running)
+    size_t head_cache;                 // Producer's last view of head
+    size_t high_water;                 // Stats written by the producer
+    uint64_t enqueued, drops, overwrites;
+
+    // Consumer cache line
+    PACRF_CACHE_ALIGNED size_t head;   // Next slot to read (free-running)
+    size_t tail_cache;                 // Consumer's last view of tail
+    uint64_t dequeued;                 // Stats written by the consumer
+
+    // Sleepers (touched only when a side has to wait)
+    PACRF_CACHE_ALIGNED QueueWaiter not_empty;   // Consumer waits for data
+    QueueWaiter not_full;                        // Producer waits for space
+} PACRF_CACHE_ALIGNED SpscQueue;
+
+// Initializes the queue; capacity is rounded up to a power of two
+bool spsc_queue_init(SpscQueue *q, size_t capacity);
+
+// Frees any memory associated with the queue (no threads may be using it)
+void spsc_queue_destroy(SpscQueue *q);
+
+// Selects the full-queue behavior (call before the threads start).
+// OVERWRITE_OLDEST lets the producer retire the oldest slot; the consumer
+// then claims slots with a CAS and retries if one was overwritten under it.
+// BLOCK makes spsc_queue_enqueue wait up to `block_timeout_ms` (<0 = forever)
+// before counting a drop.
+void spsc_queue_set_overflow_policy(SpscQueue *q, QueueOverflowPolicy policy, int block_timeout_ms);
+
+// Copies the current counters into `out` (safe from any thread)
+void spsc_queue_get_stats(const SpscQueue *q, QueueStats *out);
+
+// Producer thread only: adds an item, applying the overflow policy when
+// full (returns false if the item was dropped)
+bool spsc_queue_enqueue(SpscQueue *q, const QueueItem *item);
+
+// Consumer thread only: removes an item (returns false if empty)
+bool spsc_queue_dequeue(SpscQueue *q, QueueItem *out_item);
+
+// Producer: adds up to `n` items with a single tail publish; returns count.
+// Never blocks; items that don't fit are counted as drops under REJECT and
+// BLOCK, or make room by retiring the oldest under OVERWRITE_OLDEST.
+size_t spsc_queue_enqueue_bulk(SpscQueue *q, const QueueItem *items, size_t n);
+
+// Consumer: removes up to `max` items with a single head publish; returns count
+size_t spsc_queue_dequeue_bulk(SpscQueue *q, QueueItem *out_items, size_t max);
+
+// Producer: like spsc_queue_enqueue, but sleeps up to `timeout_ms` for space
+bool spsc_queue_enqueue_wait(SpscQueue *q, const QueueItem *item, int timeout_ms);
+
+// Consumer: like spsc_queue_dequeue, but sleeps up to `timeout_ms` for data
+bool spsc_queue_dequeue_wait(SpscQueue *q, QueueItem *out_item, int timeout_ms);
+
+// Consumer: waits up to `timeout_ms` for at least one item, then drains up
+// to `max` in one batch; returns count (0 on timeout)
+size_t spsc_queue_dequeue_bulk_wait(SpscQueue *q, QueueItem *out_items, size_t max, int timeout_ms);
+
+// Approximate number of queued items (exact when called by either side
+// while the other is idle)
+size_t spsc_queue_size(const SpscQueue *q);
+
+// Approximate emptiness check (safe from any thread)
+bool spsc_queue_is_empty(const SpscQueue *q);
+
+// Logs the current status of the SPSC queue
+void spsc_queue_log_status(const SpscQueue *q);
+
+// ============================================================
+// Record Queue (zero-copy, variable-length, SPSC)
+// ------------------------------------------------------------
+// A byte ring carrying variable-size records for one producer and
+// one consumer thread. Instead of copying QueueItems in and out,
+// the producer reserves space inside the ring, fills it directly
+// (read(), DMA, a parser's output...) and commits the bytes it
+// used; the consumer peeks at the next record in place and releases
+// it when done. Records are 8-byte aligned, prefixed by a small
+// header, and never straddle the end of the ring (a wrap marker
+// skips the tail gap). Largest record: record_queue_max_record().
+// ============================================================
+typedef struct {
+    // Read-mostly configuration
+    uint8_t *buf;       // Ring storage (capacity bytes)
+    size_t capacity;    // Bytes (power of two)
+    size_t mask;        // capacity - 1
+
+    // Producer cache line
+    PACRF_CACHE_ALIGNED size_t tail;   // Bytes published (free-running)
+    size_t head_cache;                 // Producer's last view of head
+    size_t resv_pad;                   // Wrap gap in front of the open reservation
+    size_t resv_len;                   // Payload bytes reserved (0 = none open)
+
+    // Consumer cache line
+    PACRF_CACHE_ALIGNED size_t head;   // Bytes released (free-running)
+    size_t tail_cache;                 // Consumer's last view of tail
+    size_t peek_size;                  // Ring bytes of the peeked record (0 = none)
+
+    // Sleepers (touched only when a side has to wait)
+    PACRF_CACHE_ALIGNED QueueWaiter not_empty;   // Consumer waits for records
+    QueueWaiter not_full;                        // Producer waits for space
+} PACRF_CACHE_ALIGNED RecordQueue;
+
+// Initializes the ring; capacity (bytes) is rounded up to a power of two
+bool record_queue_init(RecordQueue *q, size_t capacity);
+
+// Frees the ring storage (no threads may be using it)
+void record_queue_destroy(RecordQueue *q);
+
+// Largest payload a single record may carry
+size_t record_queue_max_record(const RecordQueue *q);
+
+// Producer: reserves room for up to `max_len` payload bytes and returns a
+// pointer into the ring to write them to (NULL if there is no room yet)
+void *record_queue_reserve(RecordQueue *q, size_t max_len);
+
+// Producer: publishes the open reservation with `len` (<= reserved) bytes
+void record_queue_commit(RecordQueue *q, size_t len);
+
+// Consumer: returns the next record in place (NULL if empty) and its length.
+// The pointer stays valid until record_queue_release().
+const void *record_queue_peek(RecordQueue *q, size_t *len);
+
+// Consumer: frees the record returned by the last record_queue_peek()
+void record_queue_release(RecordQueue *q);
+
+// Producer: like record_queue_reserve, but sleeps up to `timeout_ms` for room
+void *record_queue_reserve_wait(RecordQueue *q, size_t max_len, int timeout_ms);
+
+// Consumer: like record_queue_peek, but sleeps up to `timeout_ms` for a record
+const void *record_queue_peek_wait(RecordQueue *q, size_t *len, int timeout_ms);
+
+// Convenience copy-in / copy-out wrappers around reserve/commit and peek/release
+bool record_queue_push(RecordQueue *q, const void *data, size_t len);
+size_t record_queue_pop(RecordQueue *q, void *out, size_t out_cap);
+
+// Bytes currently in use (approximate; safe from any thread)
+size_t record_queue_used(const RecordQueue *q);
+
+// Logs the current status of the record queue
+void record_queue_log_status(const RecordQueue *q);
+
 #endif // QUEUE_MANAGER_H
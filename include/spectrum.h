@@ -0,0 +1,92 @@
+#ifndef SPECTRUM_H
+#define SPECTRUM_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+// ============================================================================
+// Spectrum Engine
+// ----------------------------------------------------------------------------
+// A stream sink ("spectrum[:opts]") that turns the unpacked int16 samples
+// of the pipeline into power spectra on the device:
+//
+//   samples → Hann window → real FFT (N/2-point complex FFT + split)
+//           → |X|² → average or max-hold over `avg` FFTs
+//           → peak-decimate to `bins` → 8-bit dB → one frame
+//
+// Only `rate` frames per second are produced; samples between them are
+// skipped, so the FFT load is rate * avg transforms per second whatever
+// the sample rate. A frame is a SpectrumFrameHeader followed by `bins`
+// bytes, printed as one "SPEC: <base64>" line (~750 chars for 512 bins).
+//
+// The plan (window, bit-reversal table, per-stage twiddles, work arrays)
+// is built once per run. Butterflies work on split real/imag arrays with
+// SSE (x86-64) or NEON (AArch64) when available, scalar otherwise.
+//
+// Sink options (comma separated): fft=N (power of two, default 1024),
+// avg=N (default 8), mode=avg|max, rate=frames/s (default 10), bins=B
+// (power of two <= min(fft/2, SPECTRUM_MAX_BINS), default 512).
+// ============================================================================
+
+#define SPECTRUM_MAGIC       "SPEC"
+#define SPECTRUM_VERSION     1u
+#define SPECTRUM_MIN_FFT     16u
+#define SPECTRUM_MAX_FFT     65536u
+#define SPECTRUM_MAX_BINS    2048u   // keeps a SPEC: line under 4 KiB
+
+#define SPECTRUM_MODE_AVG    0u
+#define SPECTRUM_MODE_MAX    1u
+
+// Bin value v means SPECTRUM_DB_FLOOR + v * SPECTRUM_DB_STEP dBFS
+#define SPECTRUM_DB_FLOOR    (-127.5f)
+#define SPECTRUM_DB_STEP     0.5f
+
+typedef struct {
+    char     magic[4];        // SPECTRUM_MAGIC (no NUL)
+    uint16_t version;         // SPECTRUM_VERSION
+    uint16_t bins;            // bytes that follow
+    uint32_t seq;             // frame counter
+    uint32_t fft_size;
+    uint32_t averaged;        // FFTs combined into this frame
+    uint16_t mode;            // SPECTRUM_MODE_*
+    uint16_t reserved;
+    uint64_t sample_rate_hz;  // 0 if unknown; bin b spans rate/2 * [b, b+1) / bins
+    int64_t  t_ns;            // stream time of the newest sample used
+    float    db_floor;        // bin value v → db_floor + v * db_step
+    float    db_step;
+} SpectrumFrameHeader;        // 48 bytes, little-endian on every PAC-RF target
+
+// Reusable real-FFT plan; all arrays live in one caller-provided block
+typedef struct {
+    size_t    n;              // real input length
+    size_t    half;           // n / 2: complex FFT size and power bins
+    float    *window;         // n Hann coefficients
+    uint32_t *rev;            // half bit-reversal indices
+    float    *tw_re, *tw_im;  // stage twiddles, stage h at offset h - 1
+    float    *post_re, *post_im; // e^{-2πik/n}, k < half (real split)
+    float    *re, *im;        // work arrays (half each)
+    float     gain;           // sum(window) / 2: full-scale sine amplitude
+} SpectrumPlan;
+
+// Bytes spectrum_plan_init() needs for an `n`-point plan
+size_t spectrum_plan_bytes(size_t n);
+
+// Lays the plan out in `mem` (spectrum_plan_bytes(n), 16-byte aligned).
+// `n` must be a power of two in [SPECTRUM_MIN_FFT, SPECTRUM_MAX_FFT].
+bool spectrum_plan_init(SpectrumPlan *p, size_t n, void *mem);
+
+/**
+ * Windows `x` (n samples), transforms it and writes half power bins to
+ * `power`, normalized so a sine of amplitude `full_scale` reads 1.0 in
+ * its bin (0 dBFS).
+ */
+void spectrum_power(SpectrumPlan *p, const int16_t *x, float *power, float full_scale);
+
+// Butterfly implementation compiled in: "sse", "neon" or "scalar"
+const char *spectrum_kernel_name(void);
+
+// Registers the "spectrum" stream sink
+void spectrum_stream_register(void);
+
+#endif // SPECTRUM_H
@@ -0,0 +1,198 @@
+#ifndef STREAM_H
+#define STREAM_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <sys/types.h>   // ssize_t
+#include "histogram.h"
+
+// ============================================================================
+// Streaming Pipeline
+// ----------------------------------------------------------------------------
+// Three threads connected by lock-free SPSC RecordQueues:
+//
+//   source ──raw blocks──▶ unpack (BitParser → int16) ──sample blocks──▶ sink
+//
+// Each record is a StreamBlock header followed by its payload. Raw blocks
+// either carry the bytes inline (the source reads straight into the queue)
+// or reference an external buffer the source owns (zero-copy, e.g. USB
+// transfers), which the unpack stage releases once it has consumed it.
+//
+// Sources and sinks are small ops tables selected by a "name[:arg]" spec,
+// e.g. --source sim, --source file:/data/raw.bin, --sink tcp:10.0.0.2:5000.
+// Built-ins: sources sim, file; sinks null, stdout, file, tcp, unix.
+// Other modules add more with stream_register_source()/_sink().
+// ============================================================================
+
+// Block flags
+#define STREAM_BLOCK_REF  0x0001u   // payload is external (StreamBlock.ref)
+#define STREAM_BLOCK_EOS  0x0002u   // end of stream marker, no payload
+#define STREAM_BLOCK_GAP  0x0004u   // data was lost just before this block
+
+// Source read() results besides a byte count
+#define STREAM_EOF     0
+#define STREAM_ERROR  (-1)
+#define STREAM_AGAIN  (-2)   // nothing yet (timeout); call again
+
+typedef struct {
+    uint64_t seq;          // per-stream block counter
+    int64_t  t_mono_ns;    // CLOCK_MONOTONIC when the source produced it
+    int64_t  t_stage_ns;   // CLOCK_MONOTONIC when the previous stage queued it
+    uint32_t len;          // payload bytes (raw) or samples*2 (sample blocks)
+    uint16_t flags;        // STREAM_BLOCK_*
+    uint16_t width;        // sample bit width of the raw payload
+    const void *ref;       // STREAM_BLOCK_REF: external payload
+    void (*release)(void *ctx, const void *ref);   // returns a REF payload
+    void *release_ctx;
+} StreamBlock;             // 8-byte multiple; payload follows when inline
+
+// ----------------------------------------------------------------------------
+// Stage scheduling
+// ----------------------------------------------------------------------------
+// Each stage thread can be pinned to one CPU, run under SCHED_FIFO, and
+// either sleep on its queues (default) or busy-poll them. Pinning the
+// reader and unpack stages to one core keeps each raw block in that core's
+// cache between the two; the sink usually gets a core of its own. A
+// SCHED_FIFO stage may only busy-poll on a pinned CPU it has to itself
+// (a spinning FIFO thread never yields to its neighbour); otherwise it
+// falls back to blocking.
+//
+// Spec (--sched, PACRF_STREAM_SCHED): ';'-separated items, each `mlock` or
+// `<stage>:<opt>[,<opt>...]` with stage reader|unpack|sink and options
+// cpu=N, prio=1-99 (SCHED_FIFO), poll|block, queue=BYTES (the stage's
+// input ring; the reader has none), e.g.
+//
+//   mlock;reader:cpu=1,prio=80;unpack:cpu=1,prio=79;sink:cpu=2,prio=70,poll
+//
+// Settings that cannot be applied (no CAP_SYS_NICE, missing CPU) are
+// logged and the stage runs without them.
+// ----------------------------------------------------------------------------
+typedef enum {
+    STREAM_STAGE_READER = 0,
+    STREAM_STAGE_UNPACK,
+    STREAM_STAGE_SINK,
+    STREAM_STAGES
+} StreamStage;
+
+typedef struct {
+    int    cpu;            // CPU to pin to, -1 = any (default)
+    int    rt_priority;    // SCHED_FIFO priority 1-99, 0 = normal scheduling
+    int    busy_poll;      // 1: spin on the queues instead of sleeping
+    size_t queue_bytes;    // input ring (unpack: raw, sink: sample); 0 = StreamConfig.queue_bytes
+} StreamStageSched;
+
+typedef struct {
+    const char *source;    // "sim", "file:<path>", ... (default "sim")
+    const char *sink;      // "null", "stdout", "file:<path>", "tcp:<host>:<port>", "unix:<path>"
+    unsigned    width;     // sample bit width, 1-16 (default DEFAULT_BITWIDTH)
+    uint32_t    rate_hz;   // sim source sample rate, 0 = unpaced (default 1 MHz)
+    size_t      block_bytes;  // raw bytes per block (default 16 KiB)
+    size_t      queue_bytes;  // ring size of each queue (default 1 MiB)
+    int         block_on_full;// 1: reader waits for room; 0: drop + mark GAP
+    StreamStageSched stage[STREAM_STAGES];   // per-stage CPU, priority, polling
+    int         lock_memory;  // mlockall() before the threads start
+} StreamConfig;
+
+// Zero-copy hand-off from a source: a filled buffer it owns
+typedef struct {
+    const void *data;
+    size_t      len;
+    void      (*release)(void *ctx, const void *data);
+    void       *ctx;
+} StreamRef;
+
+typedef struct StreamSource StreamSource;
+typedef struct StreamSink   StreamSink;
+
+typedef struct {
+    const char *name;      // spec prefix, e.g. "file"
+    int     (*open)(StreamSource *s, const char *arg, const StreamConfig *cfg);
+    // Inline read into `buf` (cap is a whole number of samples): bytes,
+    // STREAM_EOF, STREAM_ERROR or STREAM_AGAIN
+    ssize_t (*read)(StreamSource *s, void *buf, size_t cap);
+    // Optional zero-copy read; same return codes, fills *ref on success
+    ssize_t (*read_ref)(StreamSource *s, StreamRef *ref, int timeout_ms);
+    void    (*close)(StreamSource *s);
+} StreamSourceOps;
+
+typedef struct {
+    const char *name;
+    int  (*open)(StreamSink *k, const char *arg, const StreamConfig *cfg);
+    // Consumes `count` samples; returns 0, or -1 to stop the pipeline
+    int  (*write)(StreamSink *k, const StreamBlock *blk, const int16_t *samples, size_t count);
+    void (*close)(StreamSink *k);
+} StreamSinkOps;
+
+struct StreamSource { const StreamSourceOps *ops; void *priv; };
+struct StreamSink   { const StreamSinkOps   *ops; void *priv; };
+
+// Registers an extra source/sink type (call before starting a pipeline)
+bool stream_register_source(const StreamSourceOps *ops);
+bool stream_register_sink(const StreamSinkOps *ops);
+
+// Per-stage throughput counters (each written by its own thread only)
+typedef struct {
+    uint64_t blocks;       // blocks handled
+    uint64_t bytes;        // payload bytes handled
+    uint64_t samples;      // samples produced/consumed
+    uint64_t stalls;       // waits on a full (or empty) queue
+    uint64_t drops;        // blocks dropped (reader, queue full)
+    uint64_t errors;
+} StreamStageStats;
+
+typedef struct {
+    StreamStageStats reader, unpack, sink;
+    size_t   raw_queue_used, sample_queue_used;   // bytes in flight
+    int64_t  elapsed_ns;
+    bool     running;
+} StreamStats;
+
+// Per-stage latency (ns), one histogram per stage, merged on read
+typedef enum {
+    STREAM_LAT_RAW_QUEUE = 0,   // source produced → unpack picked it up
+    STREAM_LAT_UNPACK,          // unpacking one raw block
+    STREAM_LAT_SAMPLE_QUEUE,    // unpack queued → sink picked it up
+    STREAM_LAT_SINK,            // sink write()
+    STREAM_LAT_TOTAL,           // source produced → sink write() returned
+    STREAM_LAT_STAGES
+} StreamLatencyStage;
+
+typedef struct {
+    Histogram stage[STREAM_LAT_STAGES];
+} StreamLatency;
+
+typedef struct StreamPipeline StreamPipeline;
+
+// Fills `cfg` with defaults, then applies PACRF_STREAM_SCHED if set
+void stream_config_init(StreamConfig *cfg);
+
+// Applies a scheduling spec (see above) on top of `cfg`. Returns false if
+// any item was malformed; the others are still applied.
+bool stream_config_set_sched(StreamConfig *cfg, const char *spec);
+
+// Short name of a stage ("reader", "unpack", "sink")
+const char *stream_stage_name(StreamStage stage);
+
+// Opens the source and sink and starts the three threads. Returns 0 on success.
+int  stream_pipeline_start(StreamPipeline **out, const StreamConfig *cfg);
+
+// Asks the source to stop; the pipeline drains and the threads exit
+void stream_pipeline_request_stop(StreamPipeline *p);
+
+// Waits up to `timeout_ms` (<0 = forever) for the sink to finish; true if done
+bool stream_pipeline_wait(StreamPipeline *p, int timeout_ms);
+
+// Snapshot of the stage counters (safe while running)
+void stream_pipeline_get_stats(const StreamPipeline *p, StreamStats *out);
+
+// Snapshot of the per-stage latency histograms (safe while running)
+void stream_pipeline_get_latency(const StreamPipeline *p, StreamLatency *out);
+
+// Short name of a latency stage ("raw_queue", "unpack", ...)
+const char *stream_latency_stage_name(StreamLatencyStage stage);
+
+// Stops (if needed), joins the threads, closes source/sink and frees `p`
+void stream_pipeline_destroy(StreamPipeline *p);
+
+#endif // STREAM_H
@@ -0,0 +1,49 @@
+#ifndef UNPACK_H
+#define UNPACK_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "bit_parser.h"
+
+// ============================================================
+// Sample Unpacker
+// ------------------------------------------------------------
+// Converts packed MSB-first two's-complement samples (4/8/16-bit,
+// the widths --bitwidth advertises) into widened int16/int32/float
+// arrays. A vector kernel (SSE2/AVX2/NEON) is picked once at runtime
+// by CPU feature; anything it cannot handle (unaligned cursor, odd
+// widths, no SIMD) falls back to the scalar BitParser path.
+//
+// Set PACRF_UNPACK_KERNEL=scalar|sse2|avx2|neon to force a kernel.
+// ============================================================
+
+typedef enum {
+    UNPACK_KERNEL_SCALAR = 0,
+    UNPACK_KERNEL_SSE2,
+    UNPACK_KERNEL_AVX2,
+    UNPACK_KERNEL_NEON
+} UnpackKernel;
+
+// -------------------- Public API --------------------
+
+// Returns the kernel currently used for unpacking
+UnpackKernel unpack_active_kernel(void);
+
+// Short name of a kernel ("scalar", "sse2", "avx2", "neon")
+const char *unpack_kernel_name(UnpackKernel kernel);
+
+// Forces a kernel (returns false if this CPU/build cannot run it)
+bool unpack_set_kernel(UnpackKernel kernel);
+
+// Unpacks up to `count` samples of `width` bits from the parser cursor,
+// sign-extended to int16. Returns samples written (short at end of data).
+size_t unpack_samples_i16(BitParser *parser, size_t width, int16_t *out, size_t count);
+
+// Same as unpack_samples_i16, widened to int32
+size_t unpack_samples_i32(BitParser *parser, size_t width, int32_t *out, size_t count);
+
+// Same as unpack_samples_i16, scaled to float in [-1.0, 1.0)
+size_t unpack_samples_f32(BitParser *parser, size_t width, float *out, size_t count);
+
+#endif // UNPACK_H
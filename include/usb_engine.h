@@ -0,0 +1,91 @@
+#ifndef USB_ENGINE_H
+#define USB_ENGINE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <sys/types.h>   // ssize_t
+
+// ============================================================================
+// USB Bulk Transfer Engine (libusb, asynchronous)
+// ----------------------------------------------------------------------------
+// Keeps `transfers` bulk-IN transfers queued on the device at all times, so
+// the host controller always has a buffer to fill and the link never idles
+// waiting for a synchronous read to be re-issued.
+//
+// Buffers come from a pool allocated once at open. A completed buffer is
+// handed to the consumer as-is (usb_engine_next) and goes back on the wire
+// when the consumer releases it (usb_engine_release) — no copies. Spare
+// pool buffers beyond `transfers` let the consumer hold a few blocks in a
+// queue without starving the device.
+//
+// Built only when libusb-1.0 is found (HAVE_LIBUSB) and linked into the CLI
+// only; usb_stream_register() exposes it to the streaming pipeline as the
+// "usb" source.
+// ============================================================================
+
+// Defaults; PACRF_USB_* environment variables override them
+#define USB_DEFAULT_VID            0x04B4   // PACRF_USB_VID
+#define USB_DEFAULT_PID            0x00F1   // PACRF_USB_PID
+#define USB_DEFAULT_ENDPOINT       0x81     // PACRF_USB_EP (bulk IN)
+#define USB_DEFAULT_INTERFACE      0
+#define USB_DEFAULT_TRANSFERS      16       // PACRF_USB_XFERS (in flight)
+#define USB_DEFAULT_TRANSFER_BYTES (256 * 1024)  // PACRF_USB_XFER_BYTES
+#define USB_DEFAULT_SPARE          16       // extra pool buffers for consumers
+
+typedef struct {
+    uint16_t vid, pid;
+    uint8_t  endpoint;
+    int      interface;
+    unsigned transfers;        // transfers kept in flight
+    unsigned spare;            // extra buffers the consumer may hold
+    size_t   transfer_bytes;   // per transfer; a multiple of the max packet size
+    unsigned timeout_ms;       // per transfer, 0 = none
+} UsbEngineConfig;
+
+typedef struct {
+    uint64_t completed;        // transfers that returned data
+    uint64_t bytes;
+    uint64_t short_packets;    // completions with less than transfer_bytes
+    uint64_t errors;           // failed transfers (resubmitted)
+    uint64_t starved;          // completions with no free buffer to resubmit
+    unsigned in_flight;        // currently submitted
+    unsigned held;             // buffers with the consumer right now
+} UsbEngineStats;
+
+typedef struct UsbEngine UsbEngine;
+
+// Fills `cfg` with the defaults above, then applies PACRF_USB_* overrides
+void usb_engine_config_init(UsbEngineConfig *cfg);
+
+// Opens and claims the device, allocates the pool. NULL on failure.
+UsbEngine *usb_engine_open(const UsbEngineConfig *cfg);
+
+// Submits the initial transfers and starts the event thread. 0 on success.
+int usb_engine_start(UsbEngine *e);
+
+/**
+ * Waits up to `timeout_ms` for the next completed buffer. On success stores
+ * it in *data and returns its length; the buffer is the caller's until
+ * usb_engine_release(). Returns 0 if the engine stopped (device gone or
+ * usb_engine_stop), -2 on timeout.
+ */
+ssize_t usb_engine_next(UsbEngine *e, const void **data, int timeout_ms);
+
+// Gives a buffer from usb_engine_next() back; it is resubmitted directly
+void usb_engine_release(UsbEngine *e, const void *data);
+
+// Cancels outstanding transfers and joins the event thread
+void usb_engine_stop(UsbEngine *e);
+
+// Snapshot of the counters (safe while running)
+void usb_engine_get_stats(const UsbEngine *e, UsbEngineStats *out);
+
+// Stops if needed, releases the device and frees the pool. If transfers
+// did not cancel within the drain time, the engine is leaked instead.
+void usb_engine_close(UsbEngine *e);
+
+// Registers the "usb[:VID:PID]" source with the streaming pipeline
+void usb_stream_register(void);
+
+#endif // USB_ENGINE_H
@@ -0,0 +1,449 @@
+// src/bench/pacrf_bench.c
+//
+// Microbenchmarks for the core modules: sample unpacking, queues, NMEA
+// parsing and the logger. Results go to stdout as CSV (default) or JSON,
+// one row per case, so runs on x86 dev boxes and the ARM target can be
+// collected and compared by a script.
+//
+//   pacrf_bench [--json|--csv] [--filter <substr>] [--min-ms <n>] [--corpus <file>]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/utsname.h>
+#include "bit_parser.h"
+#include "unpack.h"
+#include "queue_manager.h"
+#include "nmea.h"
+#include "logger.h"
+#include "pacrf_atomic.h"
+
+#ifndef PACRF_BENCH_CORPUS
+#define PACRF_BENCH_CORPUS "resources/nmea_corpus.nmea"
+#endif
+#ifndef PACRF_BENCH_BUILD_TYPE
+#define PACRF_BENCH_BUILD_TYPE "unknown"
+#endif
+#ifndef PACRF_BENCH_CFLAGS
+#define PACRF_BENCH_CFLAGS ""
+#endif
+
+#ifdef __OPTIMIZE__
+#define BENCH_OPTIMIZED 1
+#else
+#define BENCH_OPTIMIZED 0
+#endif
+
+#define BENCH_SAMPLES      (64 * 1024)   // samples per unpack pass
+#define BENCH_QUEUE_CAP    1024
+#define BENCH_QUEUE_BATCH  32
+#define BENCH_MAX_ROWS     256
+
+typedef struct {
+    char     bench[24];
+    char     variant[24];
+    unsigned param;        // bit width, batch size... (0 = n/a)
+    uint64_t ops;          // samples, items, sentences or calls
+    double   ns_per_op;
+    double   mops;         // million ops per second
+    double   mbytes;       // MB/s of input consumed (0 = n/a)
+} BenchRow;
+
+static BenchRow    g_rows[BENCH_MAX_ROWS];
+static int         g_nrows;
+static const char *g_filter;
+static double      g_min_ns = 200e6;
+static FILE       *g_out;              // results (stdout, kept apart from the logger)
+
+static uint64_t volatile g_sink;       // defeats dead-code elimination
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static int bench_wanted(const char *bench, const char *variant) {
+    if (!g_filter) return 1;
+    char name[64];
+    snprintf(name, sizeof(name), "%s/%s", bench, variant);
+    return strstr(name, g_filter) != NULL;
+}
+
+static void bench_report(const char *bench, const char *variant, unsigned param,
+                         uint64_t ops, uint64_t ns, double bytes_per_op) {
+    if (g_nrows == BENCH_MAX_ROWS || ops == 0 || ns == 0) return;
+    BenchRow *r = &g_rows[g_nrows++];
+    snprintf(r->bench, sizeof(r->bench), "%s", bench);
+    snprintf(r->variant, sizeof(r->variant), "%s", variant);
+    r->param = param;
+    r->ops = ops;
+    r->ns_per_op = (double)ns / (double)ops;
+    r->mops = (double)ops * 1e3 / (double)ns;
+    r->mbytes = bytes_per_op > 0 ? r->mops * bytes_per_op : 0.0;
+}
+
+// ==============================
+// Unpack: bit_parser_read vs bulk reader vs SIMD kernels
+// ==============================
+typedef enum { UNPACK_BY_READ, UNPACK_BY_READ_MANY, UNPACK_BY_KERNEL } UnpackMode;
+
+static uint64_t unpack_pass(const uint8_t *data, size_t bits, unsigned width, UnpackMode mode,
+                            uint16_t *u16, int16_t *i16) {
+    BitParser p;
+    bit_parser_init(&p, data, bits);
+    uint64_t acc = 0;
+    size_t n = 0;
+    switch (mode) {
+    case UNPACK_BY_READ:
+        for (n = 0; n < BENCH_SAMPLES; n++) acc += bit_parser_read(&p, width);
+        break;
+    case UNPACK_BY_READ_MANY:
+        n = bit_parser_read_many(&p, width, u16, BENCH_SAMPLES);
+        acc = u16[n - 1];
+        break;
+    case UNPACK_BY_KERNEL:
+        n = unpack_samples_i16(&p, width, i16, BENCH_SAMPLES);
+        acc = (uint16_t)i16[n - 1];
+        break;
+    }
+    return acc + n;
+}
+
+static void bench_unpack_case(const uint8_t *data, unsigned width, UnpackMode mode,
+                              const char *variant, uint16_t *u16, int16_t *i16) {
+    if (!bench_wanted("unpack", variant)) return;
+    size_t bits = (size_t)BENCH_SAMPLES * width;
+    uint64_t acc = 0, passes = 0, t0 = now_ns(), t;
+    do {
+        acc += unpack_pass(data, bits, width, mode, u16, i16);
+        passes++;
+    } while ((t = now_ns() - t0) < g_min_ns);
+    g_sink += acc;
+    bench_report("unpack", variant, width, passes * BENCH_SAMPLES, t, width / 8.0);
+}
+
+static void bench_unpack(void) {
+    static const UnpackKernel kernels[] = {
+        UNPACK_KERNEL_SCALAR, UNPACK_KERNEL_SSE2, UNPACK_KERNEL_AVX2, UNPACK_KERNEL_NEON
+    };
+    uint8_t  *data = malloc((size_t)BENCH_SAMPLES * 2);
+    uint16_t *u16 = malloc(BENCH_SAMPLES * sizeof(*u16));
+    int16_t  *i16 = malloc(BENCH_SAMPLES * sizeof(*i16));
+    if (!data || !u16 || !i16) {
+        fprintf(stderr, "pacrf_bench: out of memory\n");
+        exit(1);
+    }
+    uint32_t x = 0x12345678u;
+    for (size_t i = 0; i < (size_t)BENCH_SAMPLES * 2; i++) {
+        x = x * 1664525u + 1013904223u;
+        data[i] = (uint8_t)(x >> 24);
+    }
+
+    UnpackKernel saved = unpack_active_kernel();
+    for (unsigned width = 1; width <= 16; width++) {   // every width BitParser supports
+        bench_unpack_case(data, width, UNPACK_BY_READ, "bit_parser_read", u16, i16);
+        bench_unpack_case(data, width, UNPACK_BY_READ_MANY, "read_many", u16, i16);
+        for (size_t k = 0; k < sizeof(kernels) / sizeof(kernels[0]); k++) {
+            if (!unpack_set_kernel(kernels[k])) continue;   // not on this CPU/build
+            char variant[24];
+            snprintf(variant, sizeof(variant), "i16_%s", unpack_kernel_name(kernels[k]));
+            bench_unpack_case(data, width, UNPACK_BY_KERNEL, variant, u16, i16);
+        }
+        unpack_set_kernel(saved);
+    }
+    free(data);
+    free(u16);
+    free(i16);
+}
+
+// ==============================
+// Queues: single-threaded Queue, two-thread SpscQueue
+// ==============================
+static void bench_queue_single(unsigned batch) {
+    const char *variant = batch > 1 ? "queue_bulk" : "queue";
+    if (!bench_wanted("queue", variant)) return;
+    Queue q;
+    if (!queue_init(&q, BENCH_QUEUE_CAP)) return;
+    QueueItem items[BENCH_QUEUE_BATCH];
+    memset(items, 0, sizeof(items));
+    for (unsigned i = 0; i < BENCH_QUEUE_BATCH; i++) items[i].length = 64;
+
+    uint64_t ops = 0, t0 = now_ns(), t;
+    do {
+        for (int r = 0; r < 1024; r++) {
+            if (batch > 1) {
+                queue_enqueue_bulk(&q, items, batch);
+                ops += queue_dequeue_bulk(&q, items, batch);
+            } else {
+                queue_enqueue(&q, &items[0]);
+                ops += queue_dequeue(&q, &items[0]);
+            }
+        }
+    } while ((t = now_ns() - t0) < g_min_ns);
+    queue_destroy(&q);
+    bench_report("queue", variant, batch, ops, t, sizeof(QueueItem));
+}
+
+typedef struct {
+    SpscQueue *q;
+    unsigned   batch;
+    int        stop;       // set by the consumer once the run is long enough
+} SpscArgs;
+
+static void *spsc_producer(void *arg) {
+    SpscArgs *a = (SpscArgs *)arg;
+    QueueItem items[BENCH_QUEUE_BATCH];
+    memset(items, 0, sizeof(items));
+    while (!pacrf_load_relaxed(&a->stop)) {
+        if (a->batch > 1) {
+            if (spsc_queue_enqueue_bulk(a->q, items, a->batch) == 0) sched_yield();
+        } else {
+            spsc_queue_enqueue_wait(a->q, &items[0], 10);
+        }
+    }
+    return NULL;
+}
+
+static void bench_queue_spsc(unsigned batch) {
+    const char *variant = batch > 1 ? "spsc_bulk_2t" : "spsc_2t";
+    if (!bench_wanted("queue", variant)) return;
+    SpscQueue *q = malloc(sizeof(*q));
+    if (!q || !spsc_queue_init(q, BENCH_QUEUE_CAP)) {
+        free(q);
+        return;
+    }
+    // The single-item producer sleeps while the ring is full; bulk never
+    // blocks and yields instead. Only dequeued items are counted.
+    spsc_queue_set_overflow_policy(q, QUEUE_OVERFLOW_BLOCK, -1);
+
+    SpscArgs a = { q, batch, 0 };
+    QueueItem out[BENCH_QUEUE_BATCH];
+    uint64_t got = 0, t0 = now_ns(), t;
+    pthread_t th;
+    if (pthread_create(&th, NULL, spsc_producer, &a) != 0) {
+        spsc_queue_destroy(q);
+        free(q);
+        return;
+    }
+    do {
+        for (int r = 0; r < 256; r++) {
+            got += batch > 1 ? spsc_queue_dequeue_bulk_wait(q, out, batch, 10)
+                             : (uint64_t)spsc_queue_dequeue_wait(q, &out[0], 10);
+        }
+    } while ((t = now_ns() - t0) < g_min_ns);
+    pacrf_store_relaxed(&a.stop, 1);
+    pthread_join(th, NULL);
+    spsc_queue_destroy(q);
+    free(q);
+    bench_report("queue", variant, batch, got, t, sizeof(QueueItem));
+}
+
+static void bench_queue(void) {
+    bench_queue_single(1);
+    bench_queue_single(BENCH_QUEUE_BATCH);
+    bench_queue_spsc(1);
+    bench_queue_spsc(BENCH_QUEUE_BATCH);
+}
+
+// ==============================
+// NMEA: nmea_parse_line and the byte-stream framer on a recorded corpus
+// ==============================
+static char *load_file(const char *path, size_t *len) {
+    FILE *f = fopen(path, "rb");
+    if (!f) return NULL;
+    fseek(f, 0, SEEK_END);
+    long n = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    char *buf = n > 0 ? malloc((size_t)n + 1) : NULL;
+    if (buf && fread(buf, 1, (size_t)n, f) != (size_t)n) {
+        free(buf);
+        buf = NULL;
+    }
+    fclose(f);
+    if (!buf) return NULL;
+    buf[n] = '\0';
+    *len = (size_t)n;
+    return buf;
+}
+
+static void bench_nmea(const char *corpus) {
+    if (!bench_wanted("nmea", "parse_line") && !bench_wanted("nmea", "stream_feed")) return;
+    size_t len = 0;
+    char *text = load_file(corpus, &len);
+    if (!text) {
+        fprintf(stderr, "pacrf_bench: cannot read NMEA corpus %s (use --corpus)\n", corpus);
+        return;
+    }
+
+    // Split a private copy into lines for nmea_parse_line
+    char *copy = malloc(len + 1);
+    size_t nlines = 0, cap = 1024;
+    char **lines = malloc(cap * sizeof(*lines));
+    memcpy(copy, text, len + 1);
+    for (char *save = NULL, *l = strtok_r(copy, "\r\n", &save); l; l = strtok_r(NULL, "\r\n", &save)) {
+        if (nlines == cap) lines = realloc(lines, (cap *= 2) * sizeof(*lines));
+        lines[nlines++] = l;
+    }
+
+    nmea_info_t info;
+    if (nlines && bench_wanted("nmea", "parse_line")) {
+        nmea_info_init(&info);
+        uint64_t ops = 0, good = 0, t0 = now_ns(), t;
+        do {
+            for (size_t i = 0; i < nlines; i++) good += nmea_parse_line(lines[i], &info);
+            ops += nlines;
+        } while ((t = now_ns() - t0) < g_min_ns);
+        g_sink += good;
+        bench_report("nmea", "parse_line", 0, ops, t, (double)len / (double)nlines);
+    }
+    if (nlines && bench_wanted("nmea", "stream_feed")) {
+        nmea_stream_t s;
+        nmea_stream_init(&s);
+        nmea_info_init(&info);
+        uint64_t passes = 0, t0 = now_ns(), t;
+        do {
+            for (size_t off = 0; off < len; off += 512) {   // UART-sized reads
+                size_t n = len - off < 512 ? len - off : 512;
+                nmea_stream_feed(&s, text + off, n, &info, NULL, NULL);
+            }
+            passes++;
+        } while ((t = now_ns() - t0) < g_min_ns);
+        g_sink += s.ok;
+        bench_report("nmea", "stream_feed", 0, passes * nlines, t, (double)len / (double)nlines);
+    }
+    free(lines);
+    free(copy);
+    free(text);
+}
+
+// ==============================
+// Logger: filtered out, sync to /dev/null, async to /dev/null
+// ==============================
+static void bench_log_case(const char *variant, int level) {
+    if (!bench_wanted("log", variant)) return;
+    int saved = log_get_level();
+    log_set_level(level);
+    uint64_t ops = 0, t0 = now_ns(), t;
+    do {
+        for (int i = 0; i < 256; i++) log_info("bench %d of %s: %.3f", i, variant, i * 0.5);
+        ops += 256;
+    } while ((t = now_ns() - t0) < g_min_ns);
+    if (log_async_active()) log_async_flush();
+    t = now_ns() - t0;
+    log_set_level(saved);
+    bench_report("log", variant, 0, ops, t, 0);
+}
+
+static void bench_log(void) {
+    // The sync logger writes to stdout: point it at /dev/null meanwhile
+    fflush(stdout);
+    int keep = dup(STDOUT_FILENO);
+    int null_fd = open("/dev/null", O_WRONLY);
+    if (keep < 0 || null_fd < 0) return;
+    dup2(null_fd, STDOUT_FILENO);
+    close(null_fd);
+
+    bench_log_case("disabled", LOG_LEVEL_ERROR);
+    bench_log_case("sync", LOG_LEVEL_INFO);
+    fflush(stdout);
+    if (log_async_start("/dev/null", 0) == 0) {
+        bench_log_case("async", LOG_LEVEL_INFO);
+        log_async_stop();
+    }
+
+    fflush(stdout);
+    dup2(keep, STDOUT_FILENO);
+    close(keep);
+}
+
+// ==============================
+// Output
+// ==============================
+static void print_csv(void) {
+    fprintf(g_out, "bench,variant,param,ops,ns_per_op,mops_per_s,mb_per_s\n");
+    for (int i = 0; i < g_nrows; i++) {
+        const BenchRow *r = &g_rows[i];
+        fprintf(g_out, "%s,%s,%u,%llu,%.3f,%.3f,%.3f\n", r->bench, r->variant, r->param,
+                (unsigned long long)r->ops, r->ns_per_op, r->mops, r->mbytes);
+    }
+}
+
+static void print_json(void) {
+    struct utsname u;
+    if (uname(&u) != 0) strcpy(u.machine, "unknown");
+    fprintf(g_out, "{\n  \"machine\": \"%s\",\n  \"unpack_kernel\": \"%s\",\n"
+                   "  \"compiler\": \"%s\",\n  \"build_type\": \"%s\",\n  \"cflags\": \"%s\",\n"
+                   "  \"optimized\": %s,\n  \"min_ms\": %.0f,\n  \"results\": [\n",
+            u.machine, unpack_kernel_name(unpack_active_kernel()), __VERSION__,
+            PACRF_BENCH_BUILD_TYPE, PACRF_BENCH_CFLAGS, BENCH_OPTIMIZED ? "true" : "false",
+            g_min_ns / 1e6);
+    for (int i = 0; i < g_nrows; i++) {
+        const BenchRow *r = &g_rows[i];
+        fprintf(g_out, "    {\"bench\": \"%s\", \"variant\": \"%s\", \"param\": %u, \"ops\": %llu, "
+                       "\"ns_per_op\": %.3f, \"mops_per_s\": %.3f, \"mb_per_s\": %.3f}%s\n",
+                r->bench, r->variant, r->param, (unsigned long long)r->ops, r->ns_per_op,
+                r->mops, r->mbytes, i + 1 < g_nrows ? "," : "");
+    }
+    fprintf(g_out, "  ]\n}\n");
+}
+
+static void usage(void) {
+    fprintf(stderr,
+            "Usage: pacrf_bench [--json|--csv] [--filter <substr>] [--min-ms <n>] [--corpus <file>]\n"
+            "  --filter   run only cases whose \"bench/variant\" contains <substr>\n"
+            "  --min-ms   minimum run time per case (default 200)\n"
+            "  --corpus   NMEA log for the nmea cases (default %s)\n",
+            PACRF_BENCH_CORPUS);
+}
+
+int main(int argc, char **argv) {
+    int json = 0;
+    const char *corpus = getenv("PACRF_BENCH_CORPUS");
+    if (!corpus || !*corpus) corpus = PACRF_BENCH_CORPUS;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--json") == 0) {
+            json = 1;
+        } else if (strcmp(argv[i], "--csv") == 0) {
+            json = 0;
+        } else if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+            g_filter = argv[++i];
+        } else if (strcmp(argv[i], "--min-ms") == 0 && i + 1 < argc) {
+            int ms = atoi(argv[++i]);
+            if (ms <= 0) {
+                usage();
+                return 1;
+            }
+            g_min_ns = ms * 1e6;
+        } else if (strcmp(argv[i], "--corpus") == 0 && i + 1 < argc) {
+            corpus = argv[++i];
+        } else {
+            usage();
+            return strcmp(argv[i], "--help") == 0 ? 0 : 1;
+        }
+    }
+
+    // Results must not mix with log output, which also goes to stdout
+    g_out = fdopen(dup(STDOUT_FILENO), "w");
+    if (!g_out) g_out = stdout;
+    log_set_level(LOG_LEVEL_ERROR);   // debug tracing in hot paths would swamp the numbers
+    if (!BENCH_OPTIMIZED) {
+        fprintf(stderr, "pacrf_bench: built without optimisation (build type %s); "
+                        "numbers are not comparable\n", PACRF_BENCH_BUILD_TYPE);
+    }
+
+    bench_unpack();
+    bench_queue();
+    bench_nmea(corpus);
+    bench_log();
+
+    if (json) print_json(); else print_csv();
+    fflush(g_out);
+    return 0;
+}
@@ -7,6 +7,13 @@
 #include "queue_manager.h" // Queue management
 #include "bit_parser.h"    // Bit parsing utilities
 #include "interface.h"     // Unified command interface
+#include "config.h"        // Default queue sizing
+#include "mempool.h"       // Startup buffer pool + scratch arena
+#include "capture_file.h"  // "capture" stream sink
+#include "spectrum.h"      // "spectrum" stream sink
+#ifdef HAVE_LIBUSB
+#include "usb_engine.h"    // "usb" stream source
+#endif
 
 // ============================================================
 //  Main Application Entry Point
@@ -24,13 +31,27 @@ int main(int argc, char *argv[]) {
     // -------------------------------
     // 1. Initialize Logger
     // -------------------------------
+    log_init_from_env();   // PACRF_LOG_LEVEL=debug|info|warning|error|none
     log_info("PAC-RF Application Starting...");
 
+    capture_stream_register();   // --capture, --sink capture:<path>, --source replay:<path>
+    spectrum_stream_register();  // --spectrum-start, --stream-start --sink spectrum[:opts]
+#ifdef HAVE_LIBUSB
+    usb_stream_register();   // --stream-start --source usb[:vid:pid]
+#endif
+
     // -------------------------------
-    // 2. Initialize Queue System
+    // 2. Initialize Memory Pools + Queue System
     // -------------------------------
-    if (!queue_init(&main_queue, 10)) {
+    mempool_startup();     // PACRF_POOL_BLOCK_BYTES / PACRF_POOL_BLOCKS / PACRF_ARENA_BYTES
+
+    size_t queue_capacity = DEFAULT_QUEUE_CAPACITY;
+    const char *cap_env = getenv("PACRF_QUEUE_CAPACITY");
+    if (cap_env && atoi(cap_env) > 0) queue_capacity = (size_t)atoi(cap_env);
+
+    if (!queue_init(&main_queue, queue_capacity)) {
         log_error("Failed to initialize queue. Exiting.");
+        mempool_shutdown();
         return EXIT_FAILURE;
     }
 
@@ -41,6 +62,7 @@ int main(int argc, char *argv[]) {
         log_warning("No command provided.");
         print_usage();  // ✅ Global dynamic usage from commands.c
         queue_destroy(&main_queue);
+        mempool_shutdown();
         return EXIT_FAILURE;
     }
 
@@ -70,6 +92,8 @@ int main(int argc, char *argv[]) {
     // 6. Cleanup Before Exit
     // -------------------------------
     queue_destroy(&main_queue);
+    mempool_log_stats();
+    mempool_shutdown();
     log_info("PAC-RF Application Exiting Cleanly.");
     return EXIT_SUCCESS;
 }
@@ -0,0 +1,634 @@
+// src/common/agent.c
+//
+// Resident command agent: framed protocol, fork-per-request server and the
+// client side used by interface.c (see agent.h).
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE            // POLLRDHUP
+#endif
+
+#include "agent.h"
+#include "commands.h"
+#include "logger.h"
+#include "mempool.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#define AGENT_MAX_ARGS     64
+#define AGENT_MAX_CONNS    32
+#define AGENT_LINE_MAX     4096
+#define AGENT_DATA_CHUNK   (64 * 1024)
+
+const char *agent_frame_name(uint8_t type) {
+    switch (type) {
+        case AGENT_REQ:  return "REQ";
+        case AGENT_TERM: return "TERM";
+        case AGENT_LOG:  return "LOG";
+        case AGENT_IMG:  return "IMG";
+        case AGENT_DATA: return "DATA";
+        case AGENT_TEXT: return "TEXT";
+        case AGENT_END:  return "END";
+        default:         return "?";
+    }
+}
+
+/* ============================================================================
+ *  Framing
+ * ==========================================================================*/
+static void agent_put_u32(uint8_t *p, uint32_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+static uint32_t agent_get_u32(const uint8_t *p) {
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+int agent_write_frame(int fd, uint8_t type, const void *payload, uint32_t len) {
+    if (len > AGENT_MAX_PAYLOAD) return -1;
+
+    uint8_t hdr[AGENT_HEADER_BYTES] = { type, 0, 0, 0 };
+    agent_put_u32(hdr + 4, len);
+
+    struct iovec iov[2] = {
+        { hdr, sizeof(hdr) },
+        { (void *)payload, len }
+    };
+    struct iovec *v = iov;
+    int cnt = len ? 2 : 1;
+    int is_socket = 1;
+
+    // One syscall per frame; sendmsg keeps a vanished peer from raising SIGPIPE
+    while (cnt > 0) {
+        ssize_t n;
+        if (is_socket) {
+            struct msghdr msg;
+            memset(&msg, 0, sizeof(msg));
+            msg.msg_iov = v;
+            msg.msg_iovlen = (size_t)cnt;
+            n = sendmsg(fd, &msg, MSG_NOSIGNAL);
+            if (n < 0 && errno == ENOTSOCK) {   // stdio transport: a pipe
+                is_socket = 0;
+                continue;
+            }
+        } else {
+            n = writev(fd, v, cnt);
+        }
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return -1;
+
+        // Short write (large DATA frames): advance past what went out
+        size_t done = (size_t)n;
+        while (cnt > 0 && done >= v->iov_len) {
+            done -= v->iov_len;
+            v++;
+            cnt--;
+        }
+        if (cnt > 0) {
+            v->iov_base = (uint8_t *)v->iov_base + done;
+            v->iov_len -= done;
+        }
+    }
+    return 0;
+}
+
+// 1 = filled, 0 = EOF before the first byte, -1 = error / EOF mid-way
+static int agent_read_full(int fd, uint8_t *p, size_t n) {
+    size_t got = 0;
+    while (got < n) {
+        ssize_t r = read(fd, p + got, n - got);
+        if (r < 0 && errno == EINTR) continue;
+        if (r < 0) return -1;
+        if (r == 0) return got ? -1 : 0;
+        got += (size_t)r;
+    }
+    return 1;
+}
+
+int agent_read_frame(int fd, uint8_t *type, uint8_t *buf, uint32_t *len) {
+    uint8_t hdr[AGENT_HEADER_BYTES];
+    int rc = agent_read_full(fd, hdr, sizeof(hdr));
+    if (rc <= 0) return rc;
+
+    uint32_t n = agent_get_u32(hdr + 4);
+    if (hdr[0] < AGENT_REQ || hdr[0] > AGENT_END || n > AGENT_MAX_PAYLOAD) {
+        log_error("agent: bad frame (type=%u length=%u)", hdr[0], n);
+        return -1;
+    }
+    if (n && agent_read_full(fd, buf, n) != 1) return -1;
+
+    *type = hdr[0];
+    *len = n;
+    return 1;
+}
+
+/* ============================================================================
+ *  Server: one forked process per connection, one forked child per request
+ * ==========================================================================*/
+static volatile sig_atomic_t g_agent_stop = 0;
+
+static void agent_on_signal(int sig) {
+    (void)sig;
+    g_agent_stop = 1;
+}
+
+// Sends one output line as a TERM/LOG/IMG/TEXT frame
+static int agent_send_line(int out, char *line, size_t len) {
+    while (len && (line[len - 1] == '\n' || line[len - 1] == '\r')) len--;
+
+    static const struct { const char *prefix; size_t n; uint8_t type; } kinds[] = {
+        { "TERM: ", 6, AGENT_TERM },
+        { "LOG: ",  5, AGENT_LOG  },
+        { "IMG: ",  5, AGENT_IMG  },
+    };
+    for (size_t i = 0; i < sizeof(kinds) / sizeof(kinds[0]); i++) {
+        if (len >= kinds[i].n && memcmp(line, kinds[i].prefix, kinds[i].n) == 0) {
+            return agent_write_frame(out, kinds[i].type, line + kinds[i].n,
+                                     (uint32_t)(len - kinds[i].n));
+        }
+    }
+    return agent_write_frame(out, AGENT_TEXT, line, (uint32_t)len);
+}
+
+// Child side of a request: output → pipes, then the normal dispatch path
+static void agent_exec_child(int argc, char **argv, int text_fd, int data_fd, int in, int out) {
+    signal(SIGTERM, SIG_DFL);
+    signal(SIGINT, SIG_DFL);
+    signal(SIGPIPE, SIG_DFL);
+
+    int devnull = open("/dev/null", O_RDONLY);
+    if (devnull >= 0) {
+        dup2(devnull, STDIN_FILENO);
+        close(devnull);
+    }
+    dup2(text_fd, STDOUT_FILENO);
+    dup2(text_fd, STDERR_FILENO);
+    close(text_fd);
+    // Lines reach the client as they are printed. stdout was already used by
+    // the agent, so glibc only honours a mode change with a fresh buffer.
+    static char line_buf[AGENT_LINE_MAX];
+    setvbuf(stdout, line_buf, _IOLBF, sizeof(line_buf));
+    if (in > STDERR_FILENO) close(in);
+    if (out > STDERR_FILENO && out != in) close(out);
+
+    // --sink stdout writes samples to the DATA channel (see stream.c)
+    char fdbuf[16];
+    snprintf(fdbuf, sizeof(fdbuf), "%d", data_fd);
+    setenv("PACRF_DATA_FD", fdbuf, 1);
+
+    if (strcmp(argv[0], "--agent") == 0) {
+        printf("TERM: Agent ERROR — nested --agent refused\n");
+    } else {
+        dispatch_command(argv[0], argc, argv);
+    }
+    fflush(stdout);
+    fflush(stderr);
+    _exit(0);   // handlers return no status; failures are their TERM lines
+}
+
+/*
+ * Runs one request and relays its output. Returns the wait status mapped
+ * to an exit code, or -1 if the client went away (the child is killed).
+ */
+static int agent_run_request(int in, int out, int argc, char **argv, uint8_t *buf) {
+    int tp[2], dp[2];
+    if (pipe(tp) != 0) return 127;
+    if (pipe(dp) != 0) {
+        close(tp[0]);
+        close(tp[1]);
+        return 127;
+    }
+
+    pid_t pid = fork();
+    if (pid < 0) {
+        log_error("agent: fork failed: %s", strerror(errno));
+        close(tp[0]); close(tp[1]); close(dp[0]); close(dp[1]);
+        return 127;
+    }
+    if (pid == 0) {
+        close(tp[0]);
+        close(dp[0]);
+        agent_exec_child(argc, argv, tp[1], dp[1], in, out);
+    }
+    close(tp[1]);
+    close(dp[1]);
+
+    // argv points into `buf`; the child has its own copy, so reuse it for data
+    char   line[AGENT_LINE_MAX];
+    size_t ll = 0;
+    int    lost = 0;
+    struct pollfd pf[3] = {
+        { tp[0], POLLIN, 0 },
+        { dp[0], POLLIN, 0 },
+        { in,    POLLRDHUP, 0 },   // peer hang-up only; a pipelined request stays unread
+    };
+
+    while (!lost && (pf[0].fd >= 0 || pf[1].fd >= 0)) {
+        if (poll(pf, 3, -1) < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        if (pf[2].revents & (POLLRDHUP | POLLHUP | POLLERR)) {
+            lost = 1;
+            break;
+        }
+
+        if (pf[1].fd >= 0 && (pf[1].revents & (POLLIN | POLLHUP))) {
+            ssize_t n = read(pf[1].fd, buf, AGENT_DATA_CHUNK);
+            if (n > 0) {
+                if (agent_write_frame(out, AGENT_DATA, buf, (uint32_t)n) != 0) lost = 1;
+            } else if (n == 0 || errno != EINTR) {
+                close(pf[1].fd);
+                pf[1].fd = -1;
+            }
+        }
+
+        if (!lost && pf[0].fd >= 0 && (pf[0].revents & (POLLIN | POLLHUP))) {
+            ssize_t n = read(pf[0].fd, line + ll, sizeof(line) - ll);
+            if (n > 0) {
+                ll += (size_t)n;
+                size_t start = 0;
+                for (size_t i = 0; i < ll && !lost; i++) {
+                    if (line[i] != '\n') continue;
+                    if (agent_send_line(out, line + start, i + 1 - start) != 0) lost = 1;
+                    start = i + 1;
+                }
+                memmove(line, line + start, ll - start);
+                ll -= start;
+                if (ll == sizeof(line) && !lost) {   // over-long line: send as is
+                    if (agent_send_line(out, line, ll) != 0) lost = 1;
+                    ll = 0;
+                }
+            } else if (n == 0 || errno != EINTR) {
+                if (ll && agent_send_line(out, line, ll) != 0) lost = 1;
+                ll = 0;
+                close(pf[0].fd);
+                pf[0].fd = -1;
+            }
+        }
+    }
+
+    if (pf[0].fd >= 0) close(pf[0].fd);
+    if (pf[1].fd >= 0) close(pf[1].fd);
+    if (lost) kill(pid, SIGTERM);
+
+    int st = 0;
+    while (waitpid(pid, &st, 0) < 0 && errno == EINTR) {}
+    if (lost) return -1;
+    if (WIFEXITED(st)) return WEXITSTATUS(st);
+    return WIFSIGNALED(st) ? 128 + WTERMSIG(st) : 127;
+}
+
+// Serves REQ frames on one connection until EOF
+static void agent_serve_connection(int in, int out) {
+    uint8_t *buf = (uint8_t *)mempool_alloc(AGENT_MAX_PAYLOAD);
+    if (!buf) return;
+
+    for (;;) {
+        uint8_t  type;
+        uint32_t len;
+        if (agent_read_frame(in, &type, buf, &len) <= 0) break;
+        if (type != AGENT_REQ) {
+            log_warning("agent: unexpected %s frame ignored", agent_frame_name(type));
+            continue;
+        }
+
+        // Payload: NUL-terminated argv strings
+        char *argv[AGENT_MAX_ARGS + 1];
+        int   argc = 0;
+        for (uint32_t i = 0; i < len; ) {
+            if (argc < AGENT_MAX_ARGS) argv[argc] = (char *)buf + i;
+            argc++;
+            while (i < len && buf[i]) i++;
+            i++;
+        }
+
+        int32_t status;
+        if (argc == 0 || buf[len - 1] != '\0') {
+            log_warning("agent: malformed request (%u bytes)", len);
+            status = 2;
+        } else if (argc > AGENT_MAX_ARGS) {
+            // Refuse rather than run a truncated command line
+            static const char msg[] = "Agent ERROR — too many arguments";
+            log_warning("agent: request with %d args refused (max %d)", argc, AGENT_MAX_ARGS);
+            if (agent_write_frame(out, AGENT_TERM, msg, sizeof(msg) - 1) != 0) break;
+            status = 2;
+        } else {
+            argv[argc] = NULL;
+            log_debug("agent: request %s (%d args)", argv[0], argc);
+            status = agent_run_request(in, out, argc, argv, buf);
+            if (status < 0) break;   // client gone
+        }
+
+        uint8_t sbuf[4];
+        agent_put_u32(sbuf, (uint32_t)status);
+        if (agent_write_frame(out, AGENT_END, sbuf, sizeof(sbuf)) != 0) break;
+    }
+    mempool_free(buf, AGENT_MAX_PAYLOAD);
+}
+
+// Splits "host:port" (last colon) into `host`. Returns the port string.
+static const char *agent_split_host(const char *arg, char *host, size_t hostsz) {
+    const char *colon = arg ? strrchr(arg, ':') : NULL;
+    if (!colon || colon == arg || !colon[1]) return NULL;
+    size_t hlen = (size_t)(colon - arg);
+    if (hlen >= hostsz) hlen = hostsz - 1;
+    memcpy(host, arg, hlen);
+    host[hlen] = '\0';
+    return colon + 1;
+}
+
+// 127.0.0.0/8, ::1 and v4-mapped 127.x
+static int agent_addr_is_loopback(const struct sockaddr *sa) {
+    if (sa->sa_family == AF_INET) {
+        const struct sockaddr_in *in4 = (const struct sockaddr_in *)sa;
+        return (ntohl(in4->sin_addr.s_addr) >> 24) == 127;
+    }
+    if (sa->sa_family == AF_INET6) {
+        const struct in6_addr *a = &((const struct sockaddr_in6 *)sa)->sin6_addr;
+        return IN6_IS_ADDR_LOOPBACK(a) || (IN6_IS_ADDR_V4MAPPED(a) && a->s6_addr[12] == 127);
+    }
+    return 0;
+}
+
+static int agent_listen(const char *spec, int allow_remote) {
+    if (strncmp(spec, "unix:", 5) == 0) {
+        const char *path = spec + 5;
+        struct sockaddr_un sa;
+        if (!*path || strlen(path) >= sizeof(sa.sun_path)) {
+            log_error("agent: bad unix socket path '%s'", path);
+            return -1;
+        }
+        memset(&sa, 0, sizeof(sa));
+        sa.sun_family = AF_UNIX;
+        strcpy(sa.sun_path, path);
+
+        int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0) return -1;
+        unlink(path);   // stale socket from an earlier agent
+        mode_t old = umask(077);
+        int rc = bind(fd, (struct sockaddr *)&sa, sizeof(sa));
+        umask(old);
+        if (rc != 0 || listen(fd, 16) != 0) {
+            log_error("agent: cannot listen on %s: %s", path, strerror(errno));
+            close(fd);
+            return -1;
+        }
+        return fd;
+    }
+
+    if (strncmp(spec, "tcp:", 4) == 0) {
+        char host[256];
+        const char *port = agent_split_host(spec + 4, host, sizeof(host));
+        if (!port && spec[4] && strspn(spec + 4, "0123456789") == strlen(spec + 4)) {
+            strcpy(host, "127.0.0.1");     // tcp:<port>
+            port = spec + 4;
+        }
+        if (!port) {
+            log_error("agent: tcp listen needs [host:]port");
+            return -1;
+        }
+        struct addrinfo hints, *res = NULL;
+        memset(&hints, 0, sizeof(hints));
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        hints.ai_flags = AI_PASSIVE;
+        int rc = getaddrinfo(strcmp(host, "*") == 0 ? NULL : host, port, &hints, &res);
+        if (rc != 0) {
+            log_error("agent: cannot resolve %s: %s", spec + 4, gai_strerror(rc));
+            return -1;
+        }
+        // No authentication: anything but loopback needs an explicit opt-in
+        if (!allow_remote) {
+            for (struct addrinfo *ai = res; ai; ai = ai->ai_next) {
+                if (agent_addr_is_loopback(ai->ai_addr)) continue;
+                log_error("agent: %s is not a loopback address; the agent has no authentication "
+                          "(use --allow-remote to listen on it anyway)", spec + 4);
+                freeaddrinfo(res);
+                return -1;
+            }
+        }
+        int fd = -1;
+        for (struct addrinfo *ai = res; ai; ai = ai->ai_next) {
+            fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+            if (fd < 0) continue;
+            int one = 1;
+            setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+            if (bind(fd, ai->ai_addr, ai->ai_addrlen) == 0 && listen(fd, 16) == 0) break;
+            close(fd);
+            fd = -1;
+        }
+        freeaddrinfo(res);
+        if (fd < 0) log_error("agent: cannot listen on %s: %s", spec + 4, strerror(errno));
+        return fd;
+    }
+
+    log_error("agent: unknown listen spec '%s' (unix:<path>, tcp:[<host>:]<port>, stdio)", spec);
+    return -1;
+}
+
+static int agent_serve_stdio(void) {
+    // Frames own the original stdout; everything printed later goes to stderr
+    fflush(stdout);
+    int in = dup(STDIN_FILENO);
+    int out = dup(STDOUT_FILENO);
+    if (in < 0 || out < 0 || dup2(STDERR_FILENO, STDOUT_FILENO) < 0) {
+        log_error("agent: cannot take over stdio: %s", strerror(errno));
+        return -1;
+    }
+    if (write(out, AGENT_GREETING, strlen(AGENT_GREETING)) < 0) return -1;
+
+    agent_serve_connection(in, out);
+    close(in);
+    close(out);
+    return 0;
+}
+
+int agent_serve(const char *spec, int allow_remote) {
+    if (!spec || !*spec) spec = "unix:" AGENT_DEFAULT_SOCKET;
+
+    // Forked children would inherit a ring with no drain thread
+    log_async_stop();
+    signal(SIGPIPE, SIG_IGN);
+
+    if (strcmp(spec, "stdio") == 0) return agent_serve_stdio();
+
+    int lfd = agent_listen(spec, allow_remote);
+    if (lfd < 0) return -1;
+
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = agent_on_signal;   // no SA_RESTART: poll() returns EINTR
+    sigaction(SIGTERM, &sa, NULL);
+    sigaction(SIGINT, &sa, NULL);
+    g_agent_stop = 0;
+
+    printf("TERM: Agent listening on %s (pid=%d)\n", spec, (int)getpid());
+    fflush(stdout);
+
+    pid_t conns[AGENT_MAX_CONNS];
+    int   nconns = 0;
+    while (!g_agent_stop) {
+        // Reap finished connections
+        for (int i = 0; i < nconns; ) {
+            if (waitpid(conns[i], NULL, WNOHANG) == conns[i]) conns[i] = conns[--nconns];
+            else i++;
+        }
+
+        struct pollfd pf = { lfd, POLLIN, 0 };
+        if (poll(&pf, 1, 1000) <= 0) continue;
+        int cfd = accept(lfd, NULL, NULL);
+        if (cfd < 0) continue;
+        if (nconns == AGENT_MAX_CONNS) {
+            log_warning("agent: %d connections open; refusing another", nconns);
+            close(cfd);
+            continue;
+        }
+
+        pid_t pid = fork();
+        if (pid == 0) {
+            close(lfd);
+            signal(SIGTERM, SIG_DFL);
+            signal(SIGINT, SIG_DFL);
+            agent_serve_connection(cfd, cfd);
+            _exit(0);
+        }
+        if (pid > 0) conns[nconns++] = pid;
+        else log_error("agent: fork failed: %s", strerror(errno));
+        close(cfd);
+    }
+
+    for (int i = 0; i < nconns; i++) kill(conns[i], SIGTERM);
+    for (int i = 0; i < nconns; i++) waitpid(conns[i], NULL, 0);
+    close(lfd);
+    if (strncmp(spec, "unix:", 5) == 0) unlink(spec + 5);
+    printf("TERM: Agent stopped\n");
+    return 0;
+}
+
+/* ============================================================================
+ *  Client
+ * ==========================================================================*/
+int agent_connect(const char *spec) {
+    if (!spec) return -1;
+
+    if (strncmp(spec, "unix:", 5) == 0) {
+        struct sockaddr_un sa;
+        const char *path = spec + 5;
+        if (!*path) path = AGENT_DEFAULT_SOCKET;
+        if (strlen(path) >= sizeof(sa.sun_path)) return -1;
+        memset(&sa, 0, sizeof(sa));
+        sa.sun_family = AF_UNIX;
+        strcpy(sa.sun_path, path);
+
+        int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0) return -1;
+        if (connect(fd, (struct sockaddr *)&sa, sizeof(sa)) != 0) {
+            close(fd);
+            return -1;
+        }
+        return fd;
+    }
+
+    if (strncmp(spec, "tcp:", 4) == 0) {
+        char host[256];
+        const char *port = agent_split_host(spec + 4, host, sizeof(host));
+        if (!port) return -1;
+        struct addrinfo hints, *res = NULL;
+        memset(&hints, 0, sizeof(hints));
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        if (getaddrinfo(host, port, &hints, &res) != 0) return -1;
+
+        int fd = -1;
+        for (struct addrinfo *ai = res; ai; ai = ai->ai_next) {
+            fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+            if (fd < 0) continue;
+            if (connect(fd, ai->ai_addr, ai->ai_addrlen) == 0) break;
+            close(fd);
+            fd = -1;
+        }
+        freeaddrinfo(res);
+        return fd;
+    }
+    return -1;
+}
+
+int agent_await_greeting(int fd, int timeout_ms) {
+    const char  *greet = AGENT_GREETING;
+    const size_t glen = strlen(greet);
+    char   line[AGENT_LINE_MAX];
+    size_t ll = 0;
+
+    struct timespec t0;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (;;) {
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        long waited = (long)(now.tv_sec - t0.tv_sec) * 1000 + (now.tv_nsec - t0.tv_nsec) / 1000000;
+        if (waited >= timeout_ms) return -1;
+
+        struct pollfd pf = { fd, POLLIN, 0 };
+        int rc = poll(&pf, 1, (int)(timeout_ms - waited));
+        if (rc < 0 && errno == EINTR) continue;
+        if (rc <= 0) return -1;
+
+        // Byte at a time: nothing after the greeting may be consumed
+        char c;
+        ssize_t n = read(fd, &c, 1);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return -1;
+        if (ll < sizeof(line)) line[ll++] = c;
+        if (c != '\n') continue;
+        if (ll == glen && memcmp(line, greet, glen) == 0) return 0;
+        log_debug("agent: pre-greeting output: %.*s", (int)(ll - 1), line);
+        ll = 0;
+    }
+}
+
+int agent_request(int fd, int argc, char *const *argv, agent_frame_cb on_frame, void *user) {
+    uint8_t *buf = (uint8_t *)mempool_alloc(AGENT_MAX_PAYLOAD);
+    if (!buf) return -1;
+
+    size_t len = 0;
+    for (int i = 0; i < argc; i++) {
+        size_t n = strlen(argv[i]) + 1;
+        if (len + n > AGENT_MAX_PAYLOAD) {
+            mempool_free(buf, AGENT_MAX_PAYLOAD);
+            return -1;
+        }
+        memcpy(buf + len, argv[i], n);
+        len += n;
+    }
+
+    int status = -1;
+    if (agent_write_frame(fd, AGENT_REQ, buf, (uint32_t)len) == 0) {
+        uint8_t  type;
+        uint32_t n;
+        while (agent_read_frame(fd, &type, buf, &n) == 1) {
+            if (type == AGENT_END) {
+                status = n >= 4 ? (int)agent_get_u32(buf) : 0;
+                break;
+            }
+            if (on_frame) on_frame(type, buf, n, user);
+        }
+    }
+    mempool_free(buf, AGENT_MAX_PAYLOAD);
+    return status;
+}
@@ -1,5 +1,5 @@
 #include "bit_parser.h"
-#include "logger.h"   // ✅ For logging warnings and info
+#include "logger.h"   // ✅ For logging warnings and (debug-level) tracing
 #include <string.h>
 #include <stdio.h>
 
@@ -12,7 +12,7 @@ void bit_parser_init(BitParser *parser, const uint8_t *data, size_t bit_length)
     parser->bit_length = bit_length;
     parser->bit_pos = 0;
 
-    log_info("BitParser initialized: %zu bits total", bit_length);
+    log_debug("BitParser initialized: %zu bits total", bit_length);
 }
 
 /**
@@ -49,7 +49,7 @@ uint32_t bit_parser_read(BitParser *parser, size_t num_bits) {
 
     parser->bit_pos += num_bits;
 
-    log_info("bit_parser_read: Read %zu bits -> 0x%X (new pos=%zu)",
+    log_debug("bit_parser_read: Read %zu bits -> 0x%X (new pos=%zu)",
              num_bits, value, parser->bit_pos);
 
     return value;
@@ -62,7 +62,7 @@ uint32_t bit_parser_read(BitParser *parser, size_t num_bits) {
 void bit_parser_skip(BitParser *parser, size_t num_bits) {
     if (parser->bit_pos + num_bits <= parser->bit_length) {
         parser->bit_pos += num_bits;
-        log_info("bit_parser_skip: Skipped %zu bits (new pos=%zu)",
+        log_debug("bit_parser_skip: Skipped %zu bits (new pos=%zu)",
                  num_bits, parser->bit_pos);
     } else {
         log_warning("bit_parser_skip: Attempted to skip past end (pos=%zu, skip=%zu, total=%zu)",
@@ -76,5 +76,122 @@ void bit_parser_skip(BitParser *parser, size_t num_bits) {
  */
 void bit_parser_reset(BitParser *parser) {
     parser->bit_pos = 0;
-    log_info("bit_parser_reset: Position reset to 0");
+    log_debug("bit_parser_reset: Position reset to 0");
+}
+
+/**
+ * Returns the number of unread bits left in the stream.
+ */
+size_t bit_parser_remaining(const BitParser *parser) {
+    return parser->bit_length - parser->bit_pos;
+}
+
+// ============================================================
+// Bulk Extraction (64-bit bit reservoir)
+// ============================================================
+
+/**
+ * Loads 8 bytes as one big-endian word, i.e. in MSB-first stream order.
+ * memcpy keeps the load legal on unaligned addresses; compilers turn it
+ * into a single load (+ bswap on little-endian hosts).
+ */
+static inline uint64_t bp_load_be64(const uint8_t *p) {
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+    v = __builtin_bswap64(v);
+#endif
+    return v;
+}
+
+/**
+ * Tops up the reservoir so that at least 56 bits are valid (or all that
+ * remain near the end of the buffer). Valid bits are kept left-aligned in
+ * `acc`; bits below `have` always hold the next stream bits or zero, so
+ * OR-ing a fresh overlapping load is safe.
+ */
+static inline void bp_refill(uint64_t *acc, unsigned *have,
+                             const uint8_t **src, const uint8_t *end) {
+    if (end - *src >= 8) {
+        unsigned take = (63 - *have) >> 3;   // whole bytes that fit
+        *acc  |= bp_load_be64(*src) >> *have;
+        *src  += take;
+        *have += take * 8;
+    } else {
+        while (*have <= 56 && *src < end) {
+            *acc |= (uint64_t)(*(*src)++) << (56 - *have);
+            *have += 8;
+        }
+    }
+}
+
+/**
+ * Bulk-reads `count` samples of `width` bits (1-16) into `out`.
+ * Byte-aligned 4/8/16-bit reads take a direct byte path; everything else
+ * goes through the reservoir, which costs one refill per ~56 bits rather
+ * than one iteration per bit.
+ *
+ * @param parser    Pointer to active BitParser (advanced past samples read)
+ * @param width     Bits per sample (1-16)
+ * @param out       Destination array for `count` samples
+ * @param count     Maximum number of samples to read
+ * @return          Samples read; short only at the end of the stream
+ */
+size_t bit_parser_read_many(BitParser *parser, size_t width, uint16_t *out, size_t count) {
+    if (!parser || !out || count == 0) return 0;
+    if (width == 0 || width > 16) {
+        log_warning("bit_parser_read_many: Invalid bit width (%zu bits)", width);
+        return 0;
+    }
+
+    size_t avail = (parser->bit_length - parser->bit_pos) / width;
+    if (count > avail) count = avail;
+    if (count == 0) return 0;
+
+    const uint8_t *src = parser->data + (parser->bit_pos >> 3);
+    unsigned phase = (unsigned)(parser->bit_pos & 7);
+    size_t i = 0;
+
+    // Fast paths: byte-aligned cursor at one of the advertised widths
+    if (phase == 0 && width == 8) {
+        for (i = 0; i < count; i++) out[i] = src[i];
+        goto done;
+    }
+    if (phase == 0 && width == 16) {
+        for (i = 0; i < count; i++) {
+            out[i] = (uint16_t)((src[2 * i] << 8) | src[2 * i + 1]);
+        }
+        goto done;
+    }
+    if (phase == 0 && width == 4) {
+        for (i = 0; i + 1 < count; i += 2) {
+            uint8_t b = src[i >> 1];
+            out[i]     = (uint16_t)(b >> 4);
+            out[i + 1] = (uint16_t)(b & 0x0F);
+        }
+        if (i < count) out[i] = (uint16_t)(src[i >> 1] >> 4);
+        goto done;
+    }
+
+    // General path: left-aligned 64-bit reservoir, MSB first
+    {
+        const uint8_t *end = parser->data + ((parser->bit_length + 7) >> 3);
+        uint64_t acc = 0;
+        unsigned have = 0;
+
+        bp_refill(&acc, &have, &src, end);
+        acc  <<= phase;               // drop bits already consumed in first byte
+        have  -= phase;
+
+        for (i = 0; i < count; i++) {
+            if (have < width) bp_refill(&acc, &have, &src, end);
+            out[i] = (uint16_t)(acc >> (64 - width));
+            acc  <<= width;
+            have  -= (unsigned)width;
+        }
+    }
+
+done:
+    parser->bit_pos += count * width;
+    return count;
 }
@@ -0,0 +1,616 @@
+// src/common/capture_file.c
+//
+// Chunked capture files: aligned (optionally O_DIRECT) writer and mmap
+// reader with a trailing time index (see capture_file.h).
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE            // O_DIRECT
+#endif
+
+#include "capture_file.h"
+#include "stream.h"
+#include "gps_cache.h"
+#include "logger.h"
+#include "mempool.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifndef O_DIRECT
+#define O_DIRECT 0
+#endif
+
+// Header and index are fixed at compile time; keep them inside their blocks
+typedef char capture_header_fits[(sizeof(CaptureHeader) <= CAPTURE_HEADER_BYTES) ? 1 : -1];
+typedef char capture_chunk_hdr_fits[(sizeof(CaptureChunkHeader) <= CAPTURE_CHUNK_DATA) ? 1 : -1];
+
+static size_t capture_round_up(size_t n) {
+    return (n + CAPTURE_ALIGN - 1) / CAPTURE_ALIGN * CAPTURE_ALIGN;
+}
+
+// Time of sample `s` at `rate` Hz, without overflowing on long captures
+static int64_t capture_sample_ns(uint64_t s, uint64_t rate) {
+    return (int64_t)((s / rate) * 1000000000ULL + (s % rate) * 1000000000ULL / rate);
+}
+
+// Zeroed, 4 KiB-aligned buffer from the startup pools (pair with mempool_free)
+static void *capture_alloc_aligned(size_t bytes) {
+    void *p = mempool_alloc(bytes);   // page aligned for bytes >= 4 KiB
+    if (p) memset(p, 0, bytes);
+    return p;
+}
+
+static int capture_pwrite_all(int fd, const void *buf, size_t len, off_t off) {
+    const uint8_t *p = (const uint8_t *)buf;
+    while (len) {
+        ssize_t n = pwrite(fd, p, len, off);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return -1;
+        p += n;
+        len -= (size_t)n;
+        off += n;
+    }
+    return 0;
+}
+
+/* ============================================================================
+ *  Writer
+ * ==========================================================================*/
+struct CaptureWriter {
+    int       fd;
+    bool      direct;
+    size_t    chunk_bytes;
+    size_t    chunk_samples;      // capacity of one chunk
+    uint8_t  *chunk;              // aligned staging buffer (one chunk)
+    uint8_t  *header_block;       // aligned copy of the 4 KiB header
+    CaptureHeader *hdr;           // points into header_block
+
+    size_t    fill;               // samples in the staging chunk
+    uint64_t  chunk_first;        // first sample of the staging chunk
+    int64_t   chunk_t_ns;
+    uint32_t  chunk_flags;
+
+    uint64_t  chunks;             // chunks on disk
+    uint64_t  samples;            // samples accepted
+    CaptureIndexEntry *index;
+    size_t    index_cap;
+    bool      failed;
+};
+
+static void capture_fill_gps(CaptureGps *g, const nmea_info_t *info) {
+    memset(g, 0, sizeof(*g));
+    g->lat_e7 = info->lat_e7;
+    g->lon_e7 = info->lon_e7;
+    int64_t epoch = nmea_utc_epoch_ms(info);
+    g->utc_epoch_ms = epoch > 0 ? epoch : 0;
+    g->hdop = info->hdop;
+    g->fix_quality = (uint8_t)info->fix_quality;
+    g->fix_type = (uint8_t)info->fix_type;
+    g->sats = (uint8_t)info->sats;
+    g->has_fix = info->has_fix ? 1 : 0;
+}
+
+CaptureWriter *capture_writer_open(const CaptureWriterConfig *cfg) {
+    if (!cfg || !cfg->path) return NULL;
+
+    CaptureWriter *w = (CaptureWriter *)calloc(1, sizeof(*w));
+    if (!w) return NULL;
+    w->fd = -1;
+    w->chunk_bytes = capture_round_up(cfg->chunk_bytes ? cfg->chunk_bytes : CAPTURE_DEFAULT_CHUNK);
+    w->chunk_samples = (w->chunk_bytes - CAPTURE_CHUNK_DATA) / sizeof(int16_t);
+    w->chunk = (uint8_t *)capture_alloc_aligned(w->chunk_bytes);
+    w->header_block = (uint8_t *)capture_alloc_aligned(CAPTURE_HEADER_BYTES);
+    if (!w->chunk || !w->header_block) goto fail;
+
+    int flags = O_WRONLY | O_CREAT | O_TRUNC;
+    if (cfg->direct && O_DIRECT) {
+        w->fd = open(cfg->path, flags | O_DIRECT, 0644);
+        if (w->fd >= 0) w->direct = true;
+        else log_warning("Capture: O_DIRECT refused for %s (%s); using buffered writes.",
+                         cfg->path, strerror(errno));
+    }
+    if (w->fd < 0) w->fd = open(cfg->path, flags, 0644);
+    if (w->fd < 0) {
+        log_error("Capture: cannot create %s: %s", cfg->path, strerror(errno));
+        goto fail;
+    }
+
+    CaptureHeader *h = (CaptureHeader *)w->header_block;
+    memcpy(h->magic, CAPTURE_MAGIC, sizeof(h->magic));
+    h->version = CAPTURE_VERSION;
+    h->header_bytes = CAPTURE_HEADER_BYTES;
+    h->chunk_bytes = (uint32_t)w->chunk_bytes;
+    h->bit_width = (uint16_t)cfg->bit_width;
+    h->sample_format = CAPTURE_FMT_INT16;
+    h->sample_rate_hz = cfg->sample_rate_hz;
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    h->start_utc_ns = (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+    if (cfg->gps) {
+        capture_fill_gps(&h->gps, cfg->gps);
+        h->flags |= CAPTURE_HDR_GPS;
+    }
+    w->hdr = h;
+
+    // Provisional header now, so a crashed capture is still identifiable
+    if (capture_pwrite_all(w->fd, w->header_block, CAPTURE_HEADER_BYTES, 0) != 0) {
+        log_error("Capture: header write failed: %s", strerror(errno));
+        goto fail;
+    }
+
+    log_info("Capture: writing %s (%zu-byte chunks%s).", cfg->path, w->chunk_bytes,
+             w->direct ? ", O_DIRECT" : "");
+    return w;
+
+fail:
+    if (w->fd >= 0) close(w->fd);
+    mempool_free(w->chunk, w->chunk_bytes);
+    mempool_free(w->header_block, CAPTURE_HEADER_BYTES);
+    free(w);
+    return NULL;
+}
+
+static int capture_flush_chunk(CaptureWriter *w) {
+    CaptureChunkHeader *ch = (CaptureChunkHeader *)w->chunk;
+    memset(ch, 0, CAPTURE_CHUNK_DATA);
+    ch->magic = CAPTURE_CHUNK_MAGIC;
+    ch->flags = w->chunk_flags;
+    ch->seq = w->chunks;
+    ch->first_sample = w->chunk_first;
+    ch->t_ns = w->chunk_t_ns;
+    ch->nsamples = (uint32_t)w->fill;
+
+    // Partial (last) chunk: zero the tail so the file has no stale bytes
+    size_t used = CAPTURE_CHUNK_DATA + w->fill * sizeof(int16_t);
+    if (used < w->chunk_bytes) memset(w->chunk + used, 0, w->chunk_bytes - used);
+
+    off_t off = (off_t)CAPTURE_HEADER_BYTES + (off_t)w->chunks * (off_t)w->chunk_bytes;
+    if (capture_pwrite_all(w->fd, w->chunk, w->chunk_bytes, off) != 0) {
+        log_error("Capture: chunk write failed: %s", strerror(errno));
+        w->failed = true;
+        return -1;
+    }
+
+    if (w->chunks == w->index_cap) {
+        size_t cap = w->index_cap ? w->index_cap * 2 : 1024;
+        CaptureIndexEntry *idx = (CaptureIndexEntry *)realloc(w->index, cap * sizeof(*idx));
+        if (!idx) { w->failed = true; return -1; }
+        w->index = idx;
+        w->index_cap = cap;
+    }
+    w->index[w->chunks].first_sample = w->chunk_first;
+    w->index[w->chunks].t_ns = w->chunk_t_ns;
+
+    w->chunks++;
+    w->fill = 0;
+    w->chunk_flags = 0;
+    return 0;
+}
+
+int capture_writer_append(CaptureWriter *w, const int16_t *samples, size_t count,
+                          int64_t t_ns, bool gap) {
+    if (!w || w->failed) return -1;
+    const uint64_t rate = w->hdr->sample_rate_hz;
+    if (gap) w->chunk_flags |= CAPTURE_CHUNK_GAP;
+
+    size_t done = 0;
+    while (done < count) {
+        if (w->fill == 0) {
+            w->chunk_first = w->samples;
+            // With a known rate the sample clock is exact; otherwise use the
+            // caller's time for the whole batch
+            w->chunk_t_ns = t_ns + (rate ? capture_sample_ns(done, rate) : 0);
+        }
+        size_t room = w->chunk_samples - w->fill;
+        size_t n = count - done < room ? count - done : room;
+        memcpy(w->chunk + CAPTURE_CHUNK_DATA + w->fill * sizeof(int16_t),
+               samples + done, n * sizeof(int16_t));
+        w->fill += n;
+        w->samples += n;
+        done += n;
+        if (w->fill == w->chunk_samples && capture_flush_chunk(w) != 0) return -1;
+    }
+    return 0;
+}
+
+uint64_t capture_writer_samples(const CaptureWriter *w) {
+    return w ? w->samples : 0;
+}
+
+int capture_writer_close(CaptureWriter *w) {
+    if (!w) return -1;
+    int rc = w->failed ? -1 : 0;
+
+    if (rc == 0 && w->fill && capture_flush_chunk(w) != 0) rc = -1;
+
+    if (rc == 0) {
+        // Index + footer in one aligned block run, footer in the last bytes
+        size_t idx_bytes = (size_t)w->chunks * sizeof(CaptureIndexEntry);
+        size_t total = capture_round_up(idx_bytes + sizeof(CaptureFooter));
+        uint8_t *blk = (uint8_t *)capture_alloc_aligned(total);
+        off_t idx_off = (off_t)CAPTURE_HEADER_BYTES + (off_t)w->chunks * (off_t)w->chunk_bytes;
+        if (!blk) {
+            rc = -1;
+        } else {
+            if (idx_bytes) memcpy(blk, w->index, idx_bytes);
+            CaptureFooter *f = (CaptureFooter *)(blk + total - sizeof(CaptureFooter));
+            memcpy(f->magic, CAPTURE_INDEX_MAGIC, sizeof(f->magic));
+            f->count = w->chunks;
+            f->index_offset = (uint64_t)idx_off;
+            f->total_samples = w->samples;
+            if (capture_pwrite_all(w->fd, blk, total, idx_off) != 0) rc = -1;
+            mempool_free(blk, total);
+        }
+
+        if (rc == 0) {
+            w->hdr->chunk_count = w->chunks;
+            w->hdr->total_samples = w->samples;
+            w->hdr->index_offset = (uint64_t)idx_off;
+            w->hdr->flags |= CAPTURE_HDR_COMPLETE;
+            if (capture_pwrite_all(w->fd, w->header_block, CAPTURE_HEADER_BYTES, 0) != 0) rc = -1;
+        }
+        if (rc == 0 && fdatasync(w->fd) != 0) rc = -1;
+        if (rc != 0) log_error("Capture: finalize failed: %s", strerror(errno));
+    }
+
+    close(w->fd);
+    free(w->index);
+    mempool_free(w->chunk, w->chunk_bytes);
+    mempool_free(w->header_block, CAPTURE_HEADER_BYTES);
+    free(w);
+    return rc;
+}
+
+/* ============================================================================
+ *  Reader
+ * ==========================================================================*/
+static const CaptureChunkHeader *capture_chunk_at(const CaptureReader *r, uint64_t i) {
+    size_t off = r->hdr->header_bytes + (size_t)i * r->hdr->chunk_bytes;
+    return (const CaptureChunkHeader *)(r->map + off);
+}
+
+// A chunk is usable only if its header is intact and its samples fit in it
+static bool capture_chunk_valid(const CaptureReader *r, const CaptureChunkHeader *ch) {
+    return ch->magic == CAPTURE_CHUNK_MAGIC &&
+           ch->nsamples <= (r->hdr->chunk_bytes - CAPTURE_CHUNK_DATA) / sizeof(int16_t);
+}
+
+int capture_reader_open(CaptureReader *r, const char *path) {
+    if (!r || !path) return -1;
+    memset(r, 0, sizeof(*r));
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        log_error("Capture: cannot open %s: %s", path, strerror(errno));
+        return -1;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < CAPTURE_HEADER_BYTES) {
+        log_error("Capture: %s is not a capture file.", path);
+        close(fd);
+        return -1;
+    }
+    void *map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        log_error("Capture: mmap failed: %s", strerror(errno));
+        return -1;
+    }
+    r->map = (const uint8_t *)map;
+    r->map_len = (size_t)st.st_size;
+    r->hdr = (const CaptureHeader *)map;
+
+    const CaptureHeader *h = r->hdr;
+    if (memcmp(h->magic, CAPTURE_MAGIC, sizeof(h->magic)) != 0 || h->version != CAPTURE_VERSION ||
+        h->header_bytes < sizeof(CaptureHeader) || h->header_bytes > r->map_len ||
+        h->chunk_bytes <= CAPTURE_CHUNK_DATA) {
+        log_error("Capture: %s has an unknown header.", path);
+        capture_reader_close(r);
+        return -1;
+    }
+
+    // Footer fields come from the file: compare by division, never multiply
+    size_t body = r->map_len - h->header_bytes;
+    const CaptureFooter *f = NULL;
+    if (body >= sizeof(CaptureFooter)) {
+        const size_t index_end = r->map_len - sizeof(CaptureFooter);
+        f = (const CaptureFooter *)(r->map + index_end);
+        if (memcmp(f->magic, CAPTURE_INDEX_MAGIC, sizeof(f->magic)) != 0 ||
+            f->index_offset < h->header_bytes || f->index_offset > index_end ||
+            f->count > (index_end - f->index_offset) / sizeof(CaptureIndexEntry) ||
+            (f->index_offset - h->header_bytes) % h->chunk_bytes != 0 ||
+            (f->index_offset - h->header_bytes) / h->chunk_bytes != f->count) {
+            f = NULL;
+        }
+    }
+
+    if (f) {
+        r->chunks = f->count;
+        r->total_samples = f->total_samples;
+        r->index = (const CaptureIndexEntry *)(r->map + f->index_offset);
+    } else {
+        // Never finalized: trust whole chunks with a valid header
+        r->chunks = body / h->chunk_bytes;
+        while (r->chunks && !capture_chunk_valid(r, capture_chunk_at(r, r->chunks - 1))) r->chunks--;
+        if (r->chunks) {
+            const CaptureChunkHeader *last = capture_chunk_at(r, r->chunks - 1);
+            r->total_samples = last->first_sample + last->nsamples;
+        }
+        log_warning("Capture: %s has no index (writer interrupted); %llu chunks recovered.",
+                    path, (unsigned long long)r->chunks);
+    }
+    return 0;
+}
+
+void capture_reader_close(CaptureReader *r) {
+    if (!r || !r->map) return;
+    munmap((void *)r->map, r->map_len);
+    memset(r, 0, sizeof(*r));
+}
+
+// Key of chunk i: its start time or first sample (index if present, else chunk header)
+static int64_t capture_key(const CaptureReader *r, uint64_t i, bool by_time) {
+    if (r->index) return by_time ? r->index[i].t_ns : (int64_t)r->index[i].first_sample;
+    const CaptureChunkHeader *ch = capture_chunk_at(r, i);
+    return by_time ? ch->t_ns : (int64_t)ch->first_sample;
+}
+
+// Last chunk whose key is <= target (0 if the target precedes them all)
+static uint64_t capture_bsearch(const CaptureReader *r, int64_t target, bool by_time) {
+    if (!r || r->chunks == 0) return 0;
+    uint64_t lo = 0, hi = r->chunks;
+    while (hi - lo > 1) {
+        uint64_t mid = lo + (hi - lo) / 2;
+        if (capture_key(r, mid, by_time) <= target) lo = mid;
+        else hi = mid;
+    }
+    return lo;
+}
+
+uint64_t capture_reader_find_time(const CaptureReader *r, int64_t t_ns) {
+    return capture_bsearch(r, t_ns, true);
+}
+
+uint64_t capture_reader_find_sample(const CaptureReader *r, uint64_t sample) {
+    return capture_bsearch(r, sample > INT64_MAX ? INT64_MAX : (int64_t)sample, false);
+}
+
+const CaptureChunkHeader *capture_reader_chunk(const CaptureReader *r, uint64_t i,
+                                               const int16_t **samples) {
+    if (!r || i >= r->chunks) return NULL;
+    const CaptureChunkHeader *ch = capture_chunk_at(r, i);
+    if (!capture_chunk_valid(r, ch)) {
+        log_warning("Capture: chunk %llu is corrupt (nsamples=%u does not fit %u bytes); skipped.",
+                    (unsigned long long)i, ch->nsamples, r->hdr->chunk_bytes);
+        return NULL;
+    }
+    if (samples) *samples = (const int16_t *)((const uint8_t *)ch + CAPTURE_CHUNK_DATA);
+    return ch;
+}
+
+/* ============================================================================
+ *  Stream sink: capture:<path>[,chunk=<bytes>][,direct]
+ *  Stamps the header with the GPS daemon's fix when one is fresh.
+ * ==========================================================================*/
+#define CAPTURE_GPS_MAX_AGE_MS 2000
+
+typedef struct {
+    CaptureWriter *w;
+    uint64_t       rate;
+    int64_t        t0_ns;          // first block time (rate unknown)
+    bool           started;
+} CaptureSink;
+
+static int capture_sink_open(StreamSink *k, const char *arg, const StreamConfig *cfg) {
+    if (!arg || !*arg) {
+        log_error("stream: capture sink needs a path (capture:<path>)");
+        return -1;
+    }
+    char path[1024];
+    size_t plen = strcspn(arg, ",");
+    if (plen >= sizeof(path)) return -1;
+    memcpy(path, arg, plen);
+    path[plen] = '\0';
+
+    CaptureWriterConfig wc;
+    memset(&wc, 0, sizeof(wc));
+    wc.path = path;
+    wc.bit_width = cfg->width;
+    wc.sample_rate_hz = cfg->rate_hz;
+    for (const char *o = arg + plen; *o == ','; o += strcspn(o + 1, ",") + 1) {
+        if (strncmp(o + 1, "chunk=", 6) == 0) wc.chunk_bytes = (size_t)strtoul(o + 7, NULL, 10);
+        else if (strncmp(o + 1, "direct", 6) == 0 && (o[7] == ',' || o[7] == '\0')) wc.direct = true;
+        else log_warning("stream: capture: ignoring option '%.*s'", (int)strcspn(o + 1, ","), o + 1);
+    }
+
+    CaptureSink *cs = (CaptureSink *)calloc(1, sizeof(*cs));
+    if (!cs) return -1;
+
+    gps_cache_snapshot_t snap;
+    long age = 0;
+    bool have_gps = gps_cache_fetch(&snap, CAPTURE_GPS_MAX_AGE_MS, &age);
+    wc.gps = have_gps ? &snap.info : NULL;
+
+    cs->w = capture_writer_open(&wc);
+    if (!cs->w) {
+        free(cs);
+        return -1;
+    }
+    if (!have_gps) log_info("Capture: no fresh GPS fix from the daemon; header has no position.");
+    cs->rate = cfg->rate_hz;
+    k->priv = cs;
+    return 0;
+}
+
+static int capture_sink_write(StreamSink *k, const StreamBlock *blk, const int16_t *samples, size_t count) {
+    CaptureSink *cs = (CaptureSink *)k->priv;
+    if (!cs->started) {
+        cs->t0_ns = blk->t_mono_ns;
+        cs->started = true;
+    }
+    int64_t t = cs->rate ? capture_sample_ns(capture_writer_samples(cs->w), cs->rate)
+                         : blk->t_mono_ns - cs->t0_ns;
+    return capture_writer_append(cs->w, samples, count, t, (blk->flags & STREAM_BLOCK_GAP) != 0);
+}
+
+static void capture_sink_close(StreamSink *k) {
+    CaptureSink *cs = (CaptureSink *)k->priv;
+    if (!cs) return;
+    if (capture_writer_close(cs->w) != 0) log_error("Capture: file is incomplete (no index written).");
+    free(cs);
+    k->priv = NULL;
+}
+
+static const StreamSinkOps capture_stream_sink = {
+    "capture", capture_sink_open, capture_sink_write, capture_sink_close
+};
+
+/* ============================================================================
+ *  Stream source: replay:<path>[,speed=<x>][,loop=<n>]
+ *  Plays a capture file back through the pipeline in place of the device:
+ *  samples are re-packed MSB-first at the pipeline width (as the hardware
+ *  delivers them) and paced to the recorded sample rate times `speed`
+ *  (default 1; 0 = as fast as possible). `loop` plays it n times.
+ * ==========================================================================*/
+typedef struct {
+    CaptureReader r;
+    unsigned      width;
+    uint64_t      rate;        // pacing rate (header, or the pipeline's)
+    double        speed;
+    int           loops_left;
+    uint64_t      chunk;       // read position: chunk and sample inside it
+    uint32_t      off;
+    uint64_t      sent;        // samples produced so far (all loops)
+    int64_t       t_start_ns;
+} ReplaySource;
+
+static int64_t replay_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static int replay_src_open(StreamSource *s, const char *arg, const StreamConfig *cfg) {
+    if (!arg || !*arg) {
+        log_error("stream: replay source needs a capture file (replay:<path>)");
+        return -1;
+    }
+    char path[1024];
+    size_t plen = strcspn(arg, ",");
+    if (plen >= sizeof(path)) return -1;
+    memcpy(path, arg, plen);
+    path[plen] = '\0';
+
+    ReplaySource *rs = (ReplaySource *)calloc(1, sizeof(*rs));
+    if (!rs) return -1;
+    rs->speed = 1.0;
+    rs->loops_left = 1;
+    for (const char *o = arg + plen; *o == ','; o += strcspn(o + 1, ",") + 1) {
+        if (strncmp(o + 1, "speed=", 6) == 0) rs->speed = atof(o + 7);
+        else if (strncmp(o + 1, "loop=", 5) == 0) rs->loops_left = atoi(o + 6);
+        else log_warning("stream: replay: ignoring option '%.*s'", (int)strcspn(o + 1, ","), o + 1);
+    }
+    if (rs->speed < 0) rs->speed = 0;
+    if (rs->loops_left < 1) rs->loops_left = 1;
+
+    if (capture_reader_open(&rs->r, path) != 0) {
+        free(rs);
+        return -1;
+    }
+    if (rs->r.chunks == 0) {
+        log_error("stream: replay: %s has no samples", path);
+        capture_reader_close(&rs->r);
+        free(rs);
+        return -1;
+    }
+    if (cfg->width < rs->r.hdr->bit_width) {
+        log_warning("stream: replay: %u-bit capture played at %u bits (samples are truncated)",
+                    rs->r.hdr->bit_width, cfg->width);
+    }
+    rs->width = cfg->width;
+    rs->rate = rs->r.hdr->sample_rate_hz ? rs->r.hdr->sample_rate_hz : cfg->rate_hz;
+    if (!rs->rate && rs->speed > 0) {
+        log_warning("stream: replay: %s has no sample rate; playing unpaced", path);
+        rs->speed = 0;
+    }
+    rs->t_start_ns = replay_now_ns();
+    s->priv = rs;
+    return 0;
+}
+
+static ssize_t replay_src_read(StreamSource *s, void *buf, size_t cap) {
+    ReplaySource *rs = (ReplaySource *)s->priv;
+    const unsigned w = rs->width;
+    const uint32_t mask = (1u << w) - 1;
+    size_t want = cap * 8 / w;
+
+    uint8_t *out = (uint8_t *)buf;
+    uint64_t acc = 0;
+    unsigned bits = 0;
+    size_t pos = 0, n = 0;
+    while (n < want) {
+        const int16_t *smp;
+        const CaptureChunkHeader *ch = capture_reader_chunk(&rs->r, rs->chunk, &smp);
+        if (!ch || rs->off >= ch->nsamples) {
+            // Next chunk, next loop, or the end of a truncated file
+            if (ch && rs->chunk + 1 < rs->r.chunks) {
+                rs->chunk++;
+            } else if (--rs->loops_left > 0) {
+                rs->chunk = 0;
+            } else {
+                break;
+            }
+            rs->off = 0;
+            continue;
+        }
+        size_t take = ch->nsamples - rs->off;
+        if (take > want - n) take = want - n;
+        for (size_t i = 0; i < take; i++) {
+            acc = (acc << w) | ((uint32_t)(int32_t)smp[rs->off + i] & mask);
+            bits += w;
+            while (bits >= 8) {
+                bits -= 8;
+                out[pos++] = (uint8_t)(acc >> bits);
+            }
+        }
+        rs->off += (uint32_t)take;
+        n += take;
+    }
+    // Whole bytes only: a final partial sample is dropped
+    rs->sent += (uint64_t)pos * 8 / w;
+    if (pos == 0) return STREAM_EOF;
+
+    if (rs->speed > 0) {
+        // Sleep until the last sample of this block was recorded, scaled by speed
+        int64_t due = rs->t_start_ns + (int64_t)((double)capture_sample_ns(rs->sent, rs->rate) / rs->speed);
+        int64_t now = replay_now_ns();
+        if (due > now) {
+            struct timespec ts = { (time_t)(due / 1000000000LL), (long)(due % 1000000000LL) };
+            while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR) { }
+        }
+    }
+    return (ssize_t)pos;
+}
+
+static void replay_src_close(StreamSource *s) {
+    ReplaySource *rs = (ReplaySource *)s->priv;
+    if (!rs) return;
+    capture_reader_close(&rs->r);
+    free(rs);
+    s->priv = NULL;
+}
+
+static const StreamSourceOps replay_stream_source = {
+    "replay", replay_src_open, replay_src_read, NULL, replay_src_close
+};
+
+void capture_stream_register(void) {
+    stream_register_sink(&capture_stream_sink);
+    stream_register_source(&replay_stream_source);
+}
@@ -1,8 +1,15 @@
 #include <stdio.h>
 #include <string.h>       // For strcmp
+#include <ctype.h>        // For isspace
+#include <stdbool.h>
+#include <time.h>         // For clock_gettime
+#include <stdint.h>
+#include <pthread.h>      // pthread_once for the lookup index
 #include "commands.h"
 #include "handlers.h"
 #include "logger.h"
+#include "mempool.h"      // Per-command scratch arena
+#include "metrics.h"      // Dispatch count and handler latency
 
 /**
  * Global command table
@@ -12,11 +19,20 @@
  * ✅ Each command has a description for the dynamic help menu.
  */
 Command commands[] = {
-    { "--capture",      handle_capture,      "Simulate or trigger a capture sequence" },
-    { "--gps",          handle_gps,          "Retrieve GPS coordinates" },
-    { "--stream-start", handle_stream_start, "Start simulated streaming" },
-    { "--tone-send",    handle_tone_send,    "Send a test tone" },
-    { "--help",         NULL,                "Show this help menu" }  // ✅ Built-in help command
+    { "--agent",          handle_agent,          "Serve requests over a persistent connection (--listen spec)" },
+    { "--batch",          handle_batch,          "Run ';'/newline-separated commands from a file or stdin (-)" },
+    { "--capture",        handle_capture,        "Capture to an indexed file (--out, --duration; --read to slice)" },
+    { "--fetch",          handle_fetch,          "Copy a device file to stdout (--fetch <path>)" },
+    { "--gps",            handle_gps,            "Retrieve GPS coordinates" },
+    { "--gps-daemon",     handle_gps_daemon,     "Run the GPS cache daemon ('stop' to end it)" },
+    { "--metrics",        handle_metrics,        "Print METRICS: snapshots of counters and latency (--interval, --count)" },
+    { "--replay",         handle_replay,         "Replay a capture or NMEA log with latency stats (--speed, --loop)" },
+    { "--spectrum-start", handle_spectrum_start, "Stream power spectra as SPEC: frames (--fft, --avg, --fps, --bins)" },
+    { "--spectrum-stop",  handle_spectrum_stop,  "Stop the running spectrum" },
+    { "--stream-start",   handle_stream_start,   "Stream samples: --source S --sink K [--duration ms]" },
+    { "--stream-stop",    handle_stream_stop,    "Stop the running stream" },
+    { "--tone-send",      handle_tone_send,      "Send a test tone" },
+    { "--help",           NULL,                  "Show this help menu" }  // ✅ Built-in help command
 };
 
 /**
@@ -24,39 +40,205 @@ Command commands[] = {
  */
 int num_commands = sizeof(commands) / sizeof(Command);
 
+/**
+ * Command lookup
+ * ----------------------
+ * commands[] is indexed once into an open-addressing table keyed by the
+ * FNV-1a hash of each name, so finding a command costs one hash and
+ * (nearly always) one strcmp however large the table grows. Batch and
+ * agent mode dispatch once per message.
+ */
+#define COMMAND_INDEX_SIZE 64   // power of two, at least twice the table
+
+typedef char command_index_fits[(sizeof(commands) / sizeof(commands[0]) * 2 <= COMMAND_INDEX_SIZE) ? 1 : -1];
+
+static const Command *command_index[COMMAND_INDEX_SIZE];
+static pthread_once_t command_index_once = PTHREAD_ONCE_INIT;
+
+static uint32_t command_hash(const char *s) {
+    uint32_t h = 2166136261u;
+    while (*s) {
+        h ^= (unsigned char)*s++;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static void command_index_build(void) {
+    for (int i = 0; i < num_commands; i++) {
+        uint32_t slot = command_hash(commands[i].name) & (COMMAND_INDEX_SIZE - 1);
+        while (command_index[slot]) slot = (slot + 1) & (COMMAND_INDEX_SIZE - 1);
+        command_index[slot] = &commands[i];
+    }
+}
+
+const Command *command_lookup(const char *name) {
+    if (!name) return NULL;
+    pthread_once(&command_index_once, command_index_build);
+    uint32_t slot = command_hash(name) & (COMMAND_INDEX_SIZE - 1);
+    for (const Command *c; (c = command_index[slot]) != NULL; slot = (slot + 1) & (COMMAND_INDEX_SIZE - 1)) {
+        if (strcmp(c->name, name) == 0) return c;
+    }
+    return NULL;
+}
+
+static int64_t command_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
 /**
  * dispatch_command
  * ----------------------
  * Finds and executes a command from the table.
  * - Logs the dispatch activity
- * - Calls the command handler (if any)
- * - Handles the built-in --help command
+ * - Calls the command handler (if any); scratch from
+ *   mempool_scratch() is released when it returns, and its run time
+ *   goes to the METRIC_LAT_COMMAND histogram
+ * - Handles the built-in --help command (the entry without a handler)
  * - Shows usage if the command is unknown
  */
 void dispatch_command(const char *cmd, int argc, char **argv) {
-    if (!cmd || strlen(cmd) == 0) {
+    if (!cmd || !*cmd) {
         log_warning("No command provided.");
         print_usage();
         return;
     }
 
-    for (int i = 0; i < num_commands; i++) {
-        if (strcmp(cmd, commands[i].name) == 0) {
-            // ✅ Handle the built-in --help command
-            if (strcmp(cmd, "--help") == 0) {
-                print_usage();
-                return;
-            }
+    const Command *c = command_lookup(cmd);
+    if (!c) {
+        // ❌ Unknown command
+        log_warning("Unknown command received: %s", cmd);
+        print_usage();
+        return;
+    }
+
+    // ✅ Handle the built-in --help command
+    if (!c->execute) {
+        print_usage();
+        return;
+    }
+
+    log_info("Dispatching command: %s", cmd);
+    Arena *scratch = mempool_arena();
+    size_t mark = arena_mark(scratch);
+    metrics_add(METRIC_COMMANDS, 1);
+    int64_t t0 = command_now_ns();
+    c->execute(argc, argv);
+    metrics_record(METRIC_LAT_COMMAND, (uint64_t)(command_now_ns() - t0));
+    arena_reset_to(scratch, mark);
+}
+
+/* Batch mode -------------------------------------------------------------- */
+#define BATCH_LINE_MAX 4096
+#define BATCH_ARGS_MAX 64
+
+static long long batch_now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000LL + ts.tv_nsec / 1000000LL;
+}
+
+// Runs one parsed command between BEGIN/END delimiter lines
+static void batch_run_command(int argc, char **argv, int seq) {
+    printf("BATCH: BEGIN %d", seq);
+    for (int i = 0; i < argc; i++) printf(" %s", argv[i]);
+    printf("\n");
+    fflush(stdout);
+
+    long long t0 = batch_now_ms();
+    if (strcmp(argv[0], "--batch") == 0) {
+        log_warning("Batch: nested --batch ignored.");
+    } else {
+        dispatch_command(argv[0], argc, argv);
+    }
+
+    log_async_flush();   // handler output lands before its END line
+    fflush(stderr);
+    printf("BATCH: END %d %lldms\n", seq, batch_now_ms() - t0);
+    fflush(stdout);
+}
+
+/*
+ * Splits `line` in place into ';'-separated commands and runs each one.
+ * Words are separated by whitespace; '...' and "..." quote a word
+ * (including ';'). A command with an unterminated quote or more than
+ * BATCH_ARGS_MAX words is skipped.
+ */
+static void batch_run_line(char *line, int *seq) {
+    char *argv[BATCH_ARGS_MAX + 1];
+    int   argc = 0;
+    bool  in_word = false, overflow = false;
+    char  quote = 0;
+    char *w = line;
 
-            log_info("Dispatching command: %s", cmd);
-            commands[i].execute(argc, argv);
-            return;
+    for (const char *r = line; ; r++) {
+        char c = *r;
+        if (quote && c != '\0') {
+            if (c == quote) quote = 0;
+            else *w++ = c;
+            continue;
         }
+        if (c == '\0' || c == ';') {
+            if (in_word) *w++ = '\0';
+            in_word = false;
+            if (quote) {
+                log_warning("Batch: unterminated quote; command skipped.");
+            } else if (overflow) {
+                log_warning("Batch: more than %d words; command skipped.", BATCH_ARGS_MAX);
+            } else if (argc > 0) {
+                argv[argc] = NULL;
+                batch_run_command(argc, argv, ++*seq);
+            }
+            argc = 0;
+            overflow = false;
+            quote = 0;
+            if (c == '\0') return;
+            continue;
+        }
+        if (isspace((unsigned char)c)) {
+            if (in_word) *w++ = '\0';
+            in_word = false;
+            continue;
+        }
+        if (!in_word) {
+            in_word = true;
+            if (argc < BATCH_ARGS_MAX) argv[argc++] = w;
+            else overflow = true;
+        }
+        if (c == '\'' || c == '"') quote = c;
+        else *w++ = c;
     }
+}
 
-    // ❌ Unknown command
-    log_warning("Unknown command received: %s", cmd);
-    print_usage();
+/**
+ * dispatch_batch
+ * ----------------------
+ * Reads commands from `in` until EOF and runs each one through
+ * dispatch_command() in this process, framed by delimiter lines.
+ * Returns the number of commands run.
+ */
+int dispatch_batch(FILE *in) {
+    char line[BATCH_LINE_MAX];
+    int  seq = 0;
+
+    while (fgets(line, sizeof(line), in)) {
+        size_t len = strlen(line);
+        if (len == sizeof(line) - 1 && line[len - 1] != '\n') {
+            log_warning("Batch: line longer than %d bytes skipped.", BATCH_LINE_MAX - 1);
+            int ch;
+            while ((ch = fgetc(in)) != EOF && ch != '\n') {}
+            continue;
+        }
+
+        const char *p = line;
+        while (isspace((unsigned char)*p)) p++;
+        if (*p == '#') continue;   // comment line
+
+        batch_run_line(line, &seq);
+    }
+    return seq;
 }
 
 /**
@@ -76,5 +258,11 @@ void print_usage(void) {
 
     printf("\nExamples:\n");
     printf("  ./pac_rf_exec --gps\n");
-    printf("  ./pac_rf_exec --capture --bitwidth 8\n\n");
+    printf("  ./pac_rf_exec --gps --timeout 1500\n");
+    printf("  ./pac_rf_exec --stream-start --source sim --sink tcp:127.0.0.1:5000 --bitwidth 12\n");
+    printf("  ./pac_rf_exec --capture --bitwidth 8\n");
+    printf("  ./pac_rf_exec --spectrum-start --fft 4096 --max-hold --fps 20\n");
+    printf("  ./pac_rf_exec --replay /tmp/pacrf_capture.cap --speed 4 --sink unix:/tmp/rx.sock\n");
+    printf("  PACRF_METRICS_MS=5000 ./pac_rf_exec --stream-start --duration 20000\n");
+    printf("  echo '--gps; --capture --bitwidth 8' | ./pac_rf_exec --batch -\n\n");
 }
@@ -0,0 +1,196 @@
+// src/common/gps_cache.c
+//
+// Seqlock-protected shared-memory cache of the latest GPS state.
+// See gps_cache.h for the protocol.
+
+#include "gps_cache.h"
+#include "logger.h"
+#include "pacrf_atomic.h"
+#include <errno.h>      // errno
+#include <fcntl.h>      // O_* flags
+#include <signal.h>     // kill(pid, 0)
+#include <stdlib.h>     // getenv
+#include <string.h>     // memcpy, strerror
+#include <sys/mman.h>   // shm_open, mmap
+#include <sys/stat.h>   // fchmod
+#include <time.h>       // clock_gettime
+#include <unistd.h>     // ftruncate, close, getpid
+
+// Reader gives up after this many torn copies (writer stuck mid-update)
+#define GPS_CACHE_READ_RETRIES 1024
+
+// Daemon counts as dead if its heartbeat is older than this
+#define GPS_CACHE_HEARTBEAT_MS 3000
+
+struct gps_cache_shm {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t seq;                    // odd while the writer is updating
+    uint32_t reserved;
+    gps_cache_snapshot_t data;
+};
+
+static const char *gps_cache_name(void) {
+    const char *name = getenv("PACRF_GPS_SHM");
+    return (name && *name == '/') ? name : GPS_CACHE_NAME;
+}
+
+int64_t gps_cache_now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/* ============================================================================
+ *  Open / Close
+ * ==========================================================================*/
+int gps_cache_open_writer(gps_cache_t *c, int baud) {
+    if (!c) return -1;
+    c->shm = NULL;
+    c->writer = true;
+
+    int fd = shm_open(gps_cache_name(), O_RDWR | O_CREAT, 0644);
+    if (fd < 0) {
+        log_error("GPS cache: shm_open(%s) failed: %s", gps_cache_name(), strerror(errno));
+        return -1;
+    }
+    fchmod(fd, 0644);   // readable by non-root clients regardless of umask
+    if (ftruncate(fd, sizeof(struct gps_cache_shm)) != 0) {
+        log_error("GPS cache: ftruncate failed: %s", strerror(errno));
+        close(fd);
+        return -1;
+    }
+
+    void *mem = mmap(NULL, sizeof(struct gps_cache_shm), PROT_READ | PROT_WRITE,
+                     MAP_SHARED, fd, 0);
+    close(fd);
+    if (mem == MAP_FAILED) {
+        log_error("GPS cache: mmap failed: %s", strerror(errno));
+        return -1;
+    }
+
+    struct gps_cache_shm *shm = (struct gps_cache_shm *)mem;
+    if (shm->magic == GPS_CACHE_MAGIC && shm->data.pid > 0 && shm->data.pid != getpid() &&
+        kill(shm->data.pid, 0) == 0) {
+        log_error("GPS cache: daemon already running (pid=%d).", (int)shm->data.pid);
+        munmap(mem, sizeof(struct gps_cache_shm));
+        return -1;
+    }
+
+    uint32_t seq = pacrf_load_relaxed(&shm->seq) | 1u;   // keep readers retrying
+    pacrf_store_relaxed(&shm->seq, seq);
+    pacrf_fence_release();
+
+    shm->magic = GPS_CACHE_MAGIC;
+    shm->version = GPS_CACHE_VERSION;
+    memset(&shm->data, 0, sizeof(shm->data));
+    nmea_info_init(&shm->data.info);
+    shm->data.pid = getpid();
+    shm->data.baud = baud;
+    shm->data.heartbeat_mono_ms = gps_cache_now_ms();
+
+    pacrf_store_release(&shm->seq, seq + 1);
+    c->shm = shm;
+
+    log_info("GPS cache published at %s (pid=%d).", gps_cache_name(), (int)getpid());
+    return 0;
+}
+
+int gps_cache_open_reader(gps_cache_t *c) {
+    if (!c) return -1;
+    c->shm = NULL;
+    c->writer = false;
+
+    int fd = shm_open(gps_cache_name(), O_RDONLY, 0);
+    if (fd < 0) return -1;
+
+    void *mem = mmap(NULL, sizeof(struct gps_cache_shm), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mem == MAP_FAILED) return -1;
+
+    c->shm = (struct gps_cache_shm *)mem;
+    return 0;
+}
+
+void gps_cache_close(gps_cache_t *c) {
+    if (!c || !c->shm) return;
+    munmap(c->shm, sizeof(struct gps_cache_shm));
+    c->shm = NULL;
+    if (c->writer) shm_unlink(gps_cache_name());
+}
+
+/* ============================================================================
+ *  Writer
+ * ==========================================================================*/
+static inline uint32_t gps_cache_begin(struct gps_cache_shm *shm) {
+    uint32_t seq = shm->seq;              // only the writer stores seq
+    pacrf_store_relaxed(&shm->seq, seq + 1);
+    pacrf_fence_release();                // odd seq visible before the data
+    return seq + 1;
+}
+
+static inline void gps_cache_end(struct gps_cache_shm *shm, uint32_t seq) {
+    pacrf_store_release(&shm->seq, seq + 1);
+}
+
+void gps_cache_publish(gps_cache_t *c, const nmea_info_t *info,
+                       uint64_t sentences_ok, uint64_t bad_checksum) {
+    if (!c || !c->shm || !c->writer || !info) return;
+    struct gps_cache_shm *shm = c->shm;
+    int64_t now = gps_cache_now_ms();
+
+    uint32_t seq = gps_cache_begin(shm);
+    memcpy(&shm->data.info, info, sizeof(*info));
+    shm->data.sentences_ok = sentences_ok;
+    shm->data.bad_checksum = bad_checksum;
+    shm->data.updated_mono_ms = now;
+    shm->data.heartbeat_mono_ms = now;
+    gps_cache_end(shm, seq);
+}
+
+void gps_cache_heartbeat(gps_cache_t *c) {
+    if (!c || !c->shm || !c->writer) return;
+    struct gps_cache_shm *shm = c->shm;
+
+    uint32_t seq = gps_cache_begin(shm);
+    shm->data.heartbeat_mono_ms = gps_cache_now_ms();
+    gps_cache_end(shm, seq);
+}
+
+/* ============================================================================
+ *  Reader
+ * ==========================================================================*/
+bool gps_cache_read(const gps_cache_t *c, gps_cache_snapshot_t *out) {
+    if (!c || !c->shm || !out) return false;
+    const struct gps_cache_shm *shm = c->shm;
+    if (shm->magic != GPS_CACHE_MAGIC || shm->version != GPS_CACHE_VERSION) return false;
+
+    for (int tries = 0; tries < GPS_CACHE_READ_RETRIES; tries++) {
+        uint32_t s1 = pacrf_load_acquire(&shm->seq);
+        if (s1 & 1u) { pacrf_cpu_relax(); continue; }   // update in progress
+
+        memcpy(out, &shm->data, sizeof(*out));
+        pacrf_fence_acquire();                          // copy done before re-check
+
+        if (pacrf_load_relaxed(&shm->seq) == s1) return true;
+    }
+    return false;
+}
+
+bool gps_cache_fetch(gps_cache_snapshot_t *out, long max_age_ms, long *age_ms) {
+    gps_cache_t c;
+    if (gps_cache_open_reader(&c) != 0) return false;
+
+    bool ok = gps_cache_read(&c, out);
+    gps_cache_close(&c);
+    if (!ok) return false;
+
+    int64_t now = gps_cache_now_ms();
+    if (now - out->heartbeat_mono_ms > GPS_CACHE_HEARTBEAT_MS) return false;
+    if (out->pid <= 0 || (kill(out->pid, 0) != 0 && errno == ESRCH)) return false;
+    if (out->updated_mono_ms == 0) return false;          // nothing parsed yet
+
+    long age = (long)(now - out->updated_mono_ms);
+    if (age_ms) *age_ms = age;
+    return age <= max_age_ms;
+}
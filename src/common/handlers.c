@@ -3,7 +3,13 @@
 // NOTE: This file preserves your original style/signatures and adds:
 // - Real GPS handler (UART on /dev/ttyPS1, NMEA parse, TERM/LOG output)
 // - Small UART helper (file-local)
-// - Minimal stubs for stream/spectrum so the command table links cleanly
+// - Streaming pipeline front-end (--stream-start / --stream-stop)
+// - Batch mode (--batch) running many commands in one process
+// - Resident agent (--agent) serving framed requests
+// - File fetch (--fetch) for pulling device files to the host
+// - Spectrum engine front-end (--spectrum-start / --spectrum-stop)
+// - Replay of captures and NMEA logs with a latency report (--replay)
+// - Process-wide METRICS: snapshots (--metrics, and periodic in long runs)
 //
 // Contracts kept:
 // - Handlers use: void handle_xxx(int argc, char **argv)
@@ -12,13 +18,25 @@
 #include "handlers.h"
 #include "logger.h"   // log_info(...)
 #include "nmea.h"     // NMEA parsing (header in include/)
+#include "gps_cache.h" // shared-memory fix cache (--gps-daemon)
+#include "stream.h"   // --stream-start pipeline
+#include "capture_file.h" // --capture file format
+#include "commands.h" // dispatch_batch for --batch
+#include "agent.h"    // --agent server
+#include "histogram.h" // --replay / stream latency report
+#include "metrics.h"  // METRICS: snapshots
 #include <stdio.h>    // printf
 #include <string.h>   // strncpy, strerror
 #include <errno.h>    // errno
 #include <fcntl.h>    // open
-#include <unistd.h>   // read, close, usleep
+#include <unistd.h>   // read, close
 #include <termios.h>  // UART config
-#include <time.h>     // time
+#include <time.h>     // clock_gettime
+#include <poll.h>     // poll
+#include <stdlib.h>   // atol, getenv
+#include <signal.h>   // sigaction, kill
+#include <stdint.h>   // INT64_MAX, UINT64_MAX
+#include <sys/stat.h> // fchmod
 
 /* ============================================================================
  *  Utility: set UART into raw mode at a given baud
@@ -36,6 +54,12 @@ static int hs_set_uart_raw(int fd, int baud) {
         case 38400:  spd = B38400;  break;
         case 57600:  spd = B57600;  break;
         case 115200: spd = B115200; break;
+#ifdef B230400
+        case 230400: spd = B230400; break;
+#endif
+#ifdef B460800
+        case 460800: spd = B460800; break;
+#endif
         default:     spd = B9600;   break;
     }
 
@@ -43,125 +67,584 @@ static int hs_set_uart_raw(int fd, int baud) {
     cfsetospeed(&tio, spd);
     tio.c_cflag |= (CLOCAL | CREAD);
 
-    // Non-blocking-ish: short timeout even if no bytes available
+    // Pure non-blocking reads; poll() does the waiting
     tio.c_cc[VMIN]  = 0;
-    tio.c_cc[VTIME] = 2; // deciseconds (0.2s)
+    tio.c_cc[VTIME] = 0;
 
     return tcsetattr(fd, TCSANOW, &tio);
 }
 
 /* ============================================================================
- *  GPS (REAL): UART on /dev/ttyPS1 → NMEA → TERM/LOG
- *  - Tries 9600 then 115200 baud
- *  - Reads ~2s non-blocking
- *  - Parses minimal GGA/RMC for summary
+ *  GPS helper: keep the last few raw sentences for the LOG tail
  * ==========================================================================*/
-void handle_gps(int argc, char **argv) {
-    (void)argc; (void)argv;
+#define GPS_TAIL_LINES 5
 
-    const char *dev = "/dev/ttyPS1";
-    const int   baud_try[2] = {9600, 115200};
-    const long  READ_MS = 2000; // total read window
+typedef struct {
+    char lines[GPS_TAIL_LINES][128];
+    int  next, count;
+} gps_tail_t;
 
-    log_info("GPS command received (device=%s).", dev);
+static void gps_tail_push(const char *line, size_t len, bool ok, void *user) {
+    (void)ok;
+    gps_tail_t *t = (gps_tail_t *)user;
+    if (len >= sizeof(t->lines[0])) len = sizeof(t->lines[0]) - 1;
+    memcpy(t->lines[t->next], line, len);
+    t->lines[t->next][len] = '\0';
+    t->next = (t->next + 1) % GPS_TAIL_LINES;
+    if (t->count < GPS_TAIL_LINES) t->count++;
+}
 
-    // Open UART
-    int fd = open(dev, O_RDONLY | O_NONBLOCK);
-    if (fd < 0) {
-        log_info("GPS open failed: dev=%s errno=%d (%s)", dev, errno, strerror(errno));
-        printf("TERM: GPS ERROR — open failed (%s)\n", strerror(errno));
-        return;
-    }
+/* ============================================================================
+ *  GPS helper: event-driven read window
+ *  - Sleeps in poll() until bytes arrive or the monotonic deadline passes
+ *  - With first_fix, returns as soon as a valid GGA/RMC fix is parsed
+ *  Returns 1 if a fix was seen, 0 on timeout, -1 on a read/poll error or
+ *  hangup (logged here, where the cause is known).
+ * ==========================================================================*/
+static long long hs_now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static int gps_read_window(int fd, long window_ms, int first_fix, nmea_stream_t *nmea,
+                           nmea_info_t *info, nmea_sentence_cb cb, void *user) {
+    char rbuf[512];
+    const long long deadline = hs_now_ms() + window_ms;
+    struct pollfd pfd = { .fd = fd, .events = POLLIN };
 
-    // Configure UART (9600 then 115200)
-    int configured = 0;
-    int use_baud = baud_try[0];
-    for (int i = 0; i < 2; i++) {
-        if (hs_set_uart_raw(fd, baud_try[i]) == 0) {
-            use_baud = baud_try[i];
-            configured = 1;
+    for (;;) {
+        long long left = deadline - hs_now_ms();
+        if (left <= 0) break;
+
+        int pr = poll(&pfd, 1, (int)left);
+        if (pr < 0) {
+            if (errno == EINTR) continue;
+            log_warning("GPS poll failed: %s", strerror(errno));
+            return -1;
+        }
+        if (pr == 0) break;                                   // deadline
+        if (pfd.revents & (POLLERR | POLLHUP | POLLNVAL)) {
+            // poll() itself succeeded: errno says nothing about the device
+            log_warning("GPS UART %s", (pfd.revents & POLLHUP) ? "hung up (device unplugged?)"
+                                     : (pfd.revents & POLLNVAL) ? "fd is not open" : "reported an error");
+            return -1;
+        }
+
+        // Drain everything the driver has buffered before sleeping again
+        for (;;) {
+            ssize_t n = read(fd, rbuf, sizeof(rbuf));
+            if (n > 0) {
+                metrics_add(METRIC_GPS_UART_BYTES, (uint64_t)n);
+                nmea_stream_feed(nmea, rbuf, (size_t)n, info, cb, user);
+                if ((size_t)n < sizeof(rbuf)) break;
+                continue;
+            }
+            if (n < 0 && errno == EINTR) continue;
+            if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+                log_warning("GPS read failed: %s", strerror(errno));
+                return -1;
+            }
             break;
         }
+
+        if (first_fix && info->has_fix) return 1;
+    }
+    return info->has_fix ? 1 : 0;
+}
+
+/* ============================================================================
+ *  GPS helper: TERM/LOG summary of a parsed state
+ *  `source` (optional) is appended to the first TERM line, e.g. " source=cache"
+ * ==========================================================================*/
+static void gps_print_summary(const nmea_info_t *info, int baud, const char *source) {
+    // TERM: concise human summary for GUI
+    if (info->has_fix || info->fix_quality > 0) {
+        printf("TERM: GPS ok baud=%d fix=%s quality=%d sats=%d time=%s lat=%.6f lon=%.6f%s\n",
+               baud, "VALID", info->fix_quality, info->sats,
+               info->time_utc[0] ? info->time_utc : "unknown",
+               info->lat_deg, info->lon_deg, source ? source : "");
+        if (info->fix_type || info->hdop > 0.0f) {
+            printf("TERM: GPS fix_type=%d pdop=%.1f hdop=%.1f vdop=%.1f speed=%.1fkn course=%.1f\n",
+                   info->fix_type, info->pdop, info->hdop, info->vdop,
+                   info->speed_knots, info->course_deg);
+        }
+    } else {
+        printf("TERM: GPS no-fix baud=%d quality=%d sats=%d time=%s (likely indoors)%s\n",
+               baud, info->fix_quality, info->sats,
+               info->time_utc[0] ? info->time_utc : "unknown", source ? source : "");
+    }
+
+    if (info->year) {
+        printf("TERM: GPS date=%04u-%02u-%02u epoch_ms=%lld\n",
+               info->year, info->month, info->day, (long long)nmea_utc_epoch_ms(info));
+    }
+    for (int i = 0; i < info->sats_in_view; i++) {
+        const nmea_sat_t *st = &info->sat[i];
+        printf("LOG: SAT %.2s prn=%u elev=%d az=%u snr=%d\n",
+               st->talker, st->prn, st->elev_deg, st->az_deg, st->snr_db);
+    }
+}
+
+/* ============================================================================
+ *  GPS helper: open + configure the UART
+ *  Returns the fd (baud in *out_baud), or -1 after printing a TERM error.
+ * ==========================================================================*/
+static const char *gps_device(void) {
+    const char *dev = getenv("PACRF_GPS_DEV");   // override for bench/USB receivers
+    return (dev && *dev) ? dev : "/dev/ttyPS1";
+}
+
+/* ============================================================================
+ *  GPS helper: auto-baud
+ *  - Each candidate rate is sampled for up to GPS_BAUD_PROBE_MS and scored by
+ *    checksum-valid sentences; GPS_BAUD_ACCEPT of them accept it at once,
+ *    GPS_BAUD_GARBAGE bytes with none valid reject it early
+ *  - The default rate (9600) is tried first. A rate that sees no bytes at
+ *    all means the receiver is silent, so no other rate is tried; all
+ *    probing stops after GPS_BAUD_BUDGET_MS
+ *  - Results are cached per device in PACRF_BAUD_CACHE (default
+ *    /tmp/pacrf_baud.cache): "<device> <baud>" for the winner, which later
+ *    runs use with no probing and forget if it yields no valid NMEA, or
+ *    "<device> 0 <unix time>" when no rate worked, which skips probing for
+ *    GPS_BAUD_RETRY_S
+ * ==========================================================================*/
+#define GPS_BAUD_PROBE_MS  1100   // > one 1 Hz update period
+#define GPS_BAUD_BUDGET_MS 3500   // all candidates together
+#define GPS_BAUD_RETRY_S   60     // after a probe found nothing
+#define GPS_BAUD_ACCEPT    2
+#define GPS_BAUD_GARBAGE   256
+
+static const int gps_baud_candidates[] = {
+    9600, 115200, 38400,
+#ifdef B230400
+    230400,
+#endif
+#ifdef B460800
+    460800,
+#endif
+    57600, 19200
+};
+#define GPS_BAUD_COUNT ((int)(sizeof(gps_baud_candidates) / sizeof(gps_baud_candidates[0])))
+
+static const char *gps_baud_cache_path(void) {
+    const char *path = getenv("PACRF_BAUD_CACHE");
+    return (path && *path) ? path : "/tmp/pacrf_baud.cache";
+}
+
+// Returns the cached rate for `dev`, or 0. A failed probe is returned as 0
+// with its time in *failed_at (otherwise 0).
+static int gps_baud_cache_load(const char *dev, long long *failed_at) {
+    *failed_at = 0;
+    FILE *f = fopen(gps_baud_cache_path(), "r");
+    if (!f) return 0;
+
+    char line[320], name[256];
+    int baud = 0, found = 0;
+    long long t;
+    while (fgets(line, sizeof(line), f)) {
+        int n = sscanf(line, "%255s %d %lld", name, &baud, &t);
+        if (n < 2 || strcmp(name, dev) != 0) continue;
+        found = baud > 0 ? baud : 0;
+        *failed_at = (baud == 0 && n == 3) ? t : 0;
+    }
+    fclose(f);
+    return found;
+}
+
+// baud > 0 caches a good rate; 0 with failed_at records a failed probe;
+// 0 without forgets the device
+static void gps_baud_cache_store(const char *dev, int baud, long long failed_at) {
+    const char *path = gps_baud_cache_path();
+    char tmp[512];
+    int n = snprintf(tmp, sizeof(tmp), "%s.XXXXXX", path);
+    if (n < 0 || (size_t)n >= sizeof(tmp)) return;
+
+    // The default path lives in /tmp and we usually run as root: never
+    // open a name another user could have planted a symlink at
+    int fd = mkstemp(tmp);
+    if (fd < 0) {
+        log_warning("GPS baud cache write failed (%s): %s", tmp, strerror(errno));
+        return;
     }
-    if (!configured) {
-        log_info("GPS UART config failed for %s", dev);
-        printf("TERM: GPS ERROR — UART config failed\n");
+    fchmod(fd, 0644);   // mkstemp creates 0600; the cache is shared
+    FILE *out = fdopen(fd, "w");
+    if (!out) {
         close(fd);
+        unlink(tmp);
         return;
     }
 
-    // Read loop (~2s), parse NMEA, keep tail for LOG
-    char rbuf[512];
-    char line[256]; size_t llen = 0;
+    // Keep other devices' entries, replace ours
+    FILE *in = fopen(path, "r");
+    if (in) {
+        char line[320], name[256];
+        while (fgets(line, sizeof(line), in)) {
+            if (sscanf(line, "%255s", name) == 1 && strcmp(name, dev) != 0) fputs(line, out);
+        }
+        fclose(in);
+    }
+    if (baud > 0) fprintf(out, "%s %d\n", dev, baud);
+    else if (failed_at > 0) fprintf(out, "%s 0 %lld\n", dev, failed_at);
 
-    nmea_info_t info;                  // zero-initialize
-    memset(&info, 0, sizeof(info));
+    if (fclose(out) != 0 || rename(tmp, path) != 0) {
+        unlink(tmp);
+        log_warning("GPS baud cache write failed (%s): %s", path, strerror(errno));
+    }
+}
+
+// Samples `baud` on fd for at most `max_ms`; returns the number of
+// checksum-valid sentences and the bytes seen in *out_bytes
+static int gps_baud_score(int fd, int baud, long long max_ms, size_t *out_bytes) {
+    *out_bytes = 0;
+    if (hs_set_uart_raw(fd, baud) != 0) return -1;
+    tcflush(fd, TCIFLUSH);   // drop bytes received at the previous rate
+
+    nmea_stream_t nmea;
+    nmea_stream_init(&nmea);
+    char rbuf[256];
+    size_t bytes = 0;
+    struct pollfd pfd = { .fd = fd, .events = POLLIN };
+    const long long deadline = hs_now_ms() + (max_ms < GPS_BAUD_PROBE_MS ? max_ms : GPS_BAUD_PROBE_MS);
 
-    char last[5][128];                 // ring buffer of recent lines
-    int last_idx = 0, last_cnt = 0;
+    for (;;) {
+        long long left = deadline - hs_now_ms();
+        if (left <= 0) break;
+        int pr = poll(&pfd, 1, (int)left);
+        if (pr < 0 && errno == EINTR) continue;
+        if (pr <= 0) break;
 
-    time_t t0 = time(NULL);
-    while ((time(NULL) - t0) * 1000 < READ_MS) {
         ssize_t n = read(fd, rbuf, sizeof(rbuf));
-        if (n <= 0) { usleep(50 * 1000); continue; } // 50ms
+        if (n < 0 && (errno == EAGAIN || errno == EINTR)) continue;
+        if (n <= 0) break;
 
-        for (ssize_t i = 0; i < n; i++) {
-            char c = rbuf[i];
-            if (c == '\r') continue;
+        bytes += (size_t)n;
+        nmea_stream_feed(&nmea, rbuf, (size_t)n, NULL, NULL, NULL);
+        if (nmea.ok >= GPS_BAUD_ACCEPT) break;
+        if (nmea.ok == 0 && bytes >= GPS_BAUD_GARBAGE) break;   // wrong rate
+    }
 
-            if (c == '\n') {
-                if (llen > 0) {
-                    line[llen] = '\0';
+    log_debug("GPS baud probe %d: %u valid, %u bad, %zu bytes",
+              baud, nmea.ok, nmea.bad_checksum, bytes);
+    *out_bytes = bytes;
+    return (int)nmea.ok;
+}
 
-                    // Store into ring buffer for LOG
-                    strncpy(last[last_idx], line, sizeof(last[0]) - 1);
-                    last[last_idx][sizeof(last[0]) - 1] = '\0';
-                    last_idx = (last_idx + 1) % 5;
-                    if (last_cnt < 5) last_cnt++;
+// Picks the UART rate: the cached rate as-is, else every candidate by score.
+// Returns the rate left configured on fd, or 0 if tcsetattr never worked.
+static int gps_autobaud(int fd, const char *dev, int use_cache) {
+    long long failed_at = 0;
+    int cached = use_cache ? gps_baud_cache_load(dev, &failed_at) : 0;
+    if (cached > 0 && hs_set_uart_raw(fd, cached) == 0) {
+        log_info("GPS baud %d (cached) for %s.", cached, dev);
+        return cached;     // callers drop the entry if it yields no NMEA
+    }
+    time_t now = time(NULL);
+    if (failed_at > 0 && now >= failed_at && now - failed_at < GPS_BAUD_RETRY_S &&
+        hs_set_uart_raw(fd, gps_baud_candidates[0]) == 0) {
+        log_info("GPS: no NMEA on %s %llds ago; using %d without probing.",
+                 dev, (long long)(now - failed_at), gps_baud_candidates[0]);
+        return gps_baud_candidates[0];
+    }
 
-                    // Parse one sentence into info (best-effort, checksum-guarded)
-                    nmea_parse_line(line, &info);
+    int best = 0, best_score = 0, first_ok = 0;
+    const long long deadline = hs_now_ms() + GPS_BAUD_BUDGET_MS;
+    for (int i = 0; i < GPS_BAUD_COUNT; i++) {
+        long long left = deadline - hs_now_ms();
+        if (left <= 0) {
+            log_debug("GPS baud probe budget (%d ms) spent.", GPS_BAUD_BUDGET_MS);
+            break;
+        }
+        int baud = gps_baud_candidates[i];
+        size_t bytes;
+        int score = gps_baud_score(fd, baud, left, &bytes);
+        if (score < 0) continue;
+        if (!first_ok) first_ok = baud;
+        if (score > best_score) { best = baud; best_score = score; }
+        if (score >= GPS_BAUD_ACCEPT) break;
+        if (bytes == 0) break;   // silent line: no rate will do better
+    }
 
-                    llen = 0;
-                }
-            } else if (llen + 1 < sizeof(line)) {
-                line[llen++] = c;
-            } else {
-                // Overflow guard: reset line to keep parser stable
-                llen = 0;
-            }
+    if (best) {
+        hs_set_uart_raw(fd, best);
+        gps_baud_cache_store(dev, best, 0);
+        log_info("GPS baud %d detected for %s (%d valid sentences).", best, dev, best_score);
+        return best;
+    }
+
+    // No NMEA at any rate (antenna/receiver off?): fall back to the default
+    int fallback = first_ok ? gps_baud_candidates[0] : 0;
+    if (fallback && hs_set_uart_raw(fd, fallback) != 0) fallback = 0;
+    if (fallback) gps_baud_cache_store(dev, 0, (long long)now);
+    log_warning("GPS auto-baud found no valid NMEA on %s; using %d.", dev, fallback);
+    return fallback;
+}
+
+/* Batch mode (--batch) keeps the UART open between commands */
+static int g_hold_devices = 0;
+static struct {
+    int  fd;
+    int  baud;
+    char dev[128];
+} g_gps_uart = { -1, 0, "" };
+
+static int gps_open_uart(const char *dev, int *out_baud) {
+    // Held from an earlier command in this batch: drop stale input and reuse
+    if (g_gps_uart.fd >= 0 && strcmp(g_gps_uart.dev, dev) == 0) {
+        tcflush(g_gps_uart.fd, TCIFLUSH);
+        *out_baud = g_gps_uart.baud;
+        log_debug("GPS: reusing open UART %s (baud %d).", dev, g_gps_uart.baud);
+        return g_gps_uart.fd;
+    }
+
+    // Open UART
+    int fd = open(dev, O_RDONLY | O_NONBLOCK);
+    if (fd < 0) {
+        log_info("GPS open failed: dev=%s errno=%d (%s)", dev, errno, strerror(errno));
+        printf("TERM: GPS ERROR — open failed (%s)\n", strerror(errno));
+        return -1;
+    }
+
+    // Configure UART (cached rate, else probe the candidates)
+    int baud = gps_autobaud(fd, dev, 1);
+    if (baud > 0) {
+        *out_baud = baud;
+        if (g_hold_devices && g_gps_uart.fd < 0 && strlen(dev) < sizeof(g_gps_uart.dev)) {
+            strcpy(g_gps_uart.dev, dev);
+            g_gps_uart.fd = fd;
+            g_gps_uart.baud = baud;
         }
+        return fd;
     }
 
+    log_info("GPS UART config failed for %s", dev);
+    printf("TERM: GPS ERROR — UART config failed\n");
     close(fd);
+    return -1;
+}
 
-    // TERM: concise human summary for GUI
-    if (info.has_fix || info.fix_quality > 0) {
-        printf("TERM: GPS ok baud=%d fix=%s quality=%d sats=%d time=%s lat=%.6f lon=%.6f\n",
-               use_baud, "VALID", info.fix_quality, info.sats,
-               info.time_utc[0] ? info.time_utc : "unknown",
-               info.lat_deg, info.lon_deg);
-    } else {
-        printf("TERM: GPS no-fix baud=%d quality=%d sats=%d time=%s (likely indoors)\n",
-               use_baud, info.fix_quality, info.sats,
-               info.time_utc[0] ? info.time_utc : "unknown");
+// Closes `fd` unless batch mode holds it; `drop` releases a held handle too
+static void gps_close_uart(int fd, int drop) {
+    if (fd == g_gps_uart.fd) {
+        if (!drop) return;
+        g_gps_uart.fd = -1;
+    }
+    close(fd);
+}
+
+// Starts/ends holding device handles across commands (used by --batch)
+static void handlers_hold_devices(int hold) {
+    g_hold_devices = hold;
+    if (!hold && g_gps_uart.fd >= 0) gps_close_uart(g_gps_uart.fd, 1);
+}
+
+/* ============================================================================
+ *  GPS (REAL): UART on /dev/ttyPS1 → NMEA → TERM/LOG
+ *  - Answers from the --gps-daemon shared-memory cache when it is fresh
+ *    (last sentence ≤ --max-age ms, default 2000); --cold forces a UART read
+ *  - Auto-detects the baud rate (cached per device after the first run)
+ *  - Reads up to --timeout ms (default 2000), woken by poll() on data, and
+ *    returns on the first valid GGA/RMC fix; --full-window always reads
+ *    the whole --timeout (--first-fix is the default, kept for scripts)
+ *  - PACRF_GPS_DEV overrides the device path
+ *  - Streams bytes through the NMEA parser (GGA/RMC summary)
+ * ==========================================================================*/
+void handle_gps(int argc, char **argv) {
+    const char *dev = gps_device();
+    long        read_ms = 2000;   // total read window
+    long        max_age_ms = 2000;
+    int         first_fix = 1;
+    int         cold = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--first-fix") == 0) {
+            first_fix = 1;
+        } else if (strcmp(argv[i], "--full-window") == 0) {
+            first_fix = 0;
+        } else if (strcmp(argv[i], "--cold") == 0) {
+            cold = 1;
+        } else if (strcmp(argv[i], "--timeout") == 0 && i + 1 < argc) {
+            long v = atol(argv[++i]);
+            if (v > 0) read_ms = v;
+        } else if (strcmp(argv[i], "--max-age") == 0 && i + 1 < argc) {
+            long v = atol(argv[++i]);
+            if (v > 0) max_age_ms = v;
+        } else {
+            log_warning("GPS: ignoring unknown option '%s'", argv[i]);
+        }
     }
 
+    log_info("GPS command received (device=%s).", dev);
+
+    // Warm path: the daemon already has the UART open and parsed
+    if (!cold) {
+        gps_cache_snapshot_t snap;
+        long age = 0;
+        if (gps_cache_fetch(&snap, max_age_ms, &age)) {
+            char source[48];
+            snprintf(source, sizeof(source), " source=cache age=%ldms", age);
+            gps_print_summary(&snap.info, snap.baud, source);
+            printf("LOG: GPS cache pid=%d sentences ok=%llu bad_checksum=%llu\n",
+                   (int)snap.pid, (unsigned long long)snap.sentences_ok,
+                   (unsigned long long)snap.bad_checksum);
+            return;
+        }
+        log_debug("GPS cache unavailable or stale; reading UART.");
+    }
+
+    int use_baud = 0;
+    int fd = gps_open_uart(dev, &use_baud);
+    if (fd < 0) return;
+
+    // Read window: raw bytes go straight into the streaming parser
+    nmea_info_t info;                  // zero-initialize
+    nmea_info_init(&info);
+
+    nmea_stream_t nmea;
+    nmea_stream_init(&nmea);
+
+    gps_tail_t tail;                   // ring buffer of recent lines
+    memset(&tail, 0, sizeof(tail));
+
+    long long t0 = hs_now_ms();
+    if (gps_read_window(fd, read_ms, first_fix, &nmea, &info, gps_tail_push, &tail) < 0) {
+        log_warning("GPS read window on %s ended early.", dev);
+    }
+    log_info("GPS read window closed after %lld ms.", hs_now_ms() - t0);
+    int wrong_rate = nmea.ok == 0 && (nmea.bad_checksum || nmea.overflows);
+    if (wrong_rate) {
+        gps_baud_cache_store(dev, 0, 0);   // bytes but no NMEA: rate is wrong
+        log_warning("GPS: no valid NMEA at %d baud; cached rate dropped.", use_baud);
+    } else if (nmea.ok > 0) {
+        long long failed_at;
+        if (gps_baud_cache_load(dev, &failed_at) != use_baud) {
+            gps_baud_cache_store(dev, use_baud, 0);   // receiver back after a failed probe
+        }
+    }
+
+    gps_close_uart(fd, wrong_rate);   // a held UART is re-probed next time
+
+    gps_print_summary(&info, use_baud, NULL);
+
     // LOG: tail of raw NMEA for debugging/traceability
-    for (int i = 0; i < last_cnt; i++) {
-        int idx = (last_idx + i) % 5;
-        printf("LOG: %s\n", last[idx]);
+    for (int i = 0; i < tail.count; i++) {
+        int idx = (tail.next + GPS_TAIL_LINES - tail.count + i) % GPS_TAIL_LINES;
+        printf("LOG: %s\n", tail.lines[idx]);
     }
+    printf("LOG: NMEA sentences ok=%u bad_checksum=%u overflow=%u\n",
+           nmea.ok, nmea.bad_checksum, nmea.overflows);
 }
 
 /* ============================================================================
- *  Capture (stub for now) — keeps GUI contract
+ *  GPS daemon: keep the UART open, parse continuously, publish to shm
+ *  - `--gps-daemon`       runs in the foreground until SIGTERM/SIGINT
+ *  - `--gps-daemon stop`  signals the running daemon (pid from the cache)
+ *  Every valid sentence is published; idle windows refresh the heartbeat.
  * ==========================================================================*/
-void handle_capture(int argc, char **argv) {
-    (void)argc; (void)argv;
-    log_info("Capture command received (stub).");
-    printf("LOG: Capture request received (stub)\n");
-    printf("TERM: Simulated capture complete. (stub)\n");
+static volatile sig_atomic_t g_gps_daemon_stop = 0;
+
+static void gps_daemon_on_signal(int sig) {
+    (void)sig;
+    g_gps_daemon_stop = 1;
+}
+
+typedef struct {
+    gps_cache_t         *cache;
+    const nmea_stream_t *nmea;
+    const nmea_info_t   *info;
+} gps_daemon_ctx_t;
+
+static void gps_daemon_on_sentence(const char *line, size_t len, bool ok, void *user) {
+    (void)line; (void)len;
+    if (!ok) return;
+    gps_daemon_ctx_t *ctx = (gps_daemon_ctx_t *)user;
+    gps_cache_publish(ctx->cache, ctx->info, ctx->nmea->ok, ctx->nmea->bad_checksum);
+}
+
+static void gps_daemon_stop(void) {
+    gps_cache_t c;
+    gps_cache_snapshot_t snap;
+    if (gps_cache_open_reader(&c) != 0 || !gps_cache_read(&c, &snap) || snap.pid <= 0) {
+        gps_cache_close(&c);
+        printf("TERM: GPS daemon not running\n");
+        return;
+    }
+    gps_cache_close(&c);
+
+    if (kill(snap.pid, SIGTERM) != 0) {
+        printf("TERM: GPS daemon stop failed (pid=%d: %s)\n", (int)snap.pid, strerror(errno));
+        return;
+    }
+    printf("TERM: GPS daemon stop requested (pid=%d)\n", (int)snap.pid);
+}
+
+void handle_gps_daemon(int argc, char **argv) {
+    if (argc > 1 && strcmp(argv[1], "stop") == 0) {
+        gps_daemon_stop();
+        return;
+    }
+
+    const char *dev = gps_device();
+    int use_baud = 0;
+    int fd = gps_open_uart(dev, &use_baud);
+    if (fd < 0) return;
+
+    gps_cache_t cache;
+    if (gps_cache_open_writer(&cache, use_baud) != 0) {
+        printf("TERM: GPS daemon ERROR — cannot publish cache\n");
+        gps_close_uart(fd, 0);
+        return;
+    }
+
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = gps_daemon_on_signal;   // no SA_RESTART: poll() returns EINTR
+    sigaction(SIGTERM, &sa, NULL);
+    sigaction(SIGINT, &sa, NULL);
+    g_gps_daemon_stop = 0;
+
+    nmea_info_t info;
+    nmea_info_init(&info);
+    nmea_stream_t nmea;
+    nmea_stream_init(&nmea);
+    gps_daemon_ctx_t ctx = { &cache, &nmea, &info };
+
+    printf("TERM: GPS daemon running (device=%s baud=%d pid=%d)\n", dev, use_baud, (int)getpid());
+    fflush(stdout);
+    log_info("GPS daemon started on %s.", dev);
+
+    int idle_windows = 0;   // consecutive windows with bytes but no valid NMEA
+    const long metrics_ms = metrics_interval_ms();
+    long long t_metrics = hs_now_ms() + metrics_ms;
+    while (!g_gps_daemon_stop) {
+        uint32_t ok0 = nmea.ok, junk0 = nmea.bad_checksum + nmea.overflows;
+        if (gps_read_window(fd, 1000, 0, &nmea, &info, gps_daemon_on_sentence, &ctx) < 0) {
+            if (g_gps_daemon_stop) break;
+            log_warning("GPS daemon read error on %s; retrying.", dev);
+            struct timespec backoff = { 0, 200 * 1000 * 1000 };
+            nanosleep(&backoff, NULL);
+        }
+        gps_cache_heartbeat(&cache);
+        if (metrics_ms > 0 && hs_now_ms() >= t_metrics) {
+            metrics_print(stdout);
+            t_metrics = hs_now_ms() + metrics_ms;
+        }
+
+        // Receiver reconfigured (or bad cached rate): probe again
+        idle_windows = (nmea.ok == ok0 && nmea.bad_checksum + nmea.overflows != junk0)
+                     ? idle_windows + 1 : 0;
+        if (idle_windows >= 3 && !g_gps_daemon_stop) {
+            int baud = gps_autobaud(fd, dev, 0);
+            if (baud > 0) use_baud = baud;
+            if (fd == g_gps_uart.fd) g_gps_uart.baud = use_baud;
+            idle_windows = 0;
+        }
+    }
+
+    gps_cache_close(&cache);
+    gps_close_uart(fd, 0);
+    log_info("GPS daemon stopped (sentences ok=%u bad_checksum=%u).", nmea.ok, nmea.bad_checksum);
+    printf("TERM: GPS daemon stopped\n");
 }
 
 /* ============================================================================
@@ -175,33 +658,851 @@ void handle_tone_send(int argc, char **argv) {
 }
 
 /* ============================================================================
- *  Stream / Spectrum stubs — satisfy command table & GUI today
- *  (Replace with real implementations in Step 2.3)
+ *  Stream: source → unpack → sink pipeline (see stream.h)
+ *  - --source sim|file:<path>        (default sim)
+ *  - --sink null|stdout|file:<path>|tcp:<host>:<port>|unix:<path>
+ *  - --bitwidth N, --rate Hz (sim), --block bytes, --queue bytes
+ *  - --drop drops blocks instead of waiting when the pipeline is full
+ *  - --sched SPEC pins/prioritizes the stage threads, --mlock locks memory
+ *    (stream.h; PACRF_STREAM_SCHED sets a default for every pipeline)
+ *  - --duration ms stops on its own; otherwise runs until --stream-stop
+ *  - Prints one LOG: STREAM line per second; a TERM: summary at the end
+ *  - With --sink stdout the samples own stdout, so TERM/LOG go to stderr
  * ==========================================================================*/
+
+static volatile sig_atomic_t g_stream_stop = 0;
+
+static void stream_on_signal(int sig) {
+    (void)sig;
+    g_stream_stop = 1;
+}
+
+// Each pipeline command has its own pidfile, /tmp/pacrf_<what>.pid
+// (Stream: PACRF_STREAM_PIDFILE), so its stop command finds only it
+static const char *stream_pidfile(const char *what, char *buf, size_t bufsz) {
+    const char *path = getenv("PACRF_STREAM_PIDFILE");
+    if (strcmp(what, "Stream") == 0 && path && *path) return path;
+
+    size_t n = (size_t)snprintf(buf, bufsz, "/tmp/pacrf_%s.pid", what);
+    for (size_t i = 11; i < n && i < bufsz; i++) {   // past "/tmp/pacrf_"
+        if (buf[i] >= 'A' && buf[i] <= 'Z') buf[i] = (char)(buf[i] - 'A' + 'a');
+    }
+    return buf;
+}
+
+// The live pid recorded in `pidfile` (not ours), else 0
+static int stream_pidfile_owner(const char *pidfile) {
+    FILE *pf = fopen(pidfile, "r");
+    int pid = 0;
+    if (pf) {
+        if (fscanf(pf, "%d", &pid) != 1) pid = 0;
+        fclose(pf);
+    }
+    if (pid <= 0 || pid == (int)getpid() || kill((pid_t)pid, 0) != 0) return 0;
+    return pid;
+}
+
+static void stream_print_stats(FILE *out, const char *prefix, const StreamStats *st) {
+    double secs = st->elapsed_ns > 0 ? (double)st->elapsed_ns / 1e9 : 0.0;
+    double msps = secs > 0 ? (double)st->sink.samples / secs / 1e6 : 0.0;
+    fprintf(out, "%s STREAM samples=%llu blocks=%llu rate=%.3f Msps drops=%llu stalls=%llu/%llu/%llu "
+                 "queued=%zu/%zu errors=%llu t=%.1fs\n",
+            prefix,
+            (unsigned long long)st->sink.samples, (unsigned long long)st->sink.blocks, msps,
+            (unsigned long long)st->reader.drops,
+            (unsigned long long)st->reader.stalls, (unsigned long long)st->unpack.stalls,
+            (unsigned long long)st->sink.stalls,
+            st->raw_queue_used, st->sample_queue_used,
+            (unsigned long long)(st->reader.errors + st->sink.errors), secs);
+    fflush(out);
+}
+
+// One "LOG: <tag> latency stage=..." line; `h` holds nanoseconds
+static void print_latency(FILE *out, const char *tag, const char *stage, const Histogram *h) {
+    if (h->count == 0) return;
+    fprintf(out, "LOG: %s latency stage=%s n=%llu p50=%.1fus p99=%.1fus p999=%.1fus max=%.1fus\n",
+            tag, stage, (unsigned long long)h->count,
+            histogram_percentile(h, 50.0) / 1e3, histogram_percentile(h, 99.0) / 1e3,
+            histogram_percentile(h, 99.9) / 1e3, h->max / 1e3);
+}
+
+/**
+ * Runs a pipeline until it drains, `duration_ms` passes (0 = no limit) or
+ * SIGTERM/--stream-stop arrives. Publishes the pidfile of `what` (refusing
+ * to start while another live process holds it), prints a LOG line
+ * per second (and a METRICS: line every PACRF_METRICS_MS) to `term` and
+ * leaves the final counters in `st`; the per-stage latency goes to `term`
+ * at the end.
+ * Returns -1 if the pipeline could not start.
+ */
+static int stream_run(const StreamConfig *cfg, long duration_ms, const char *what,
+                      FILE *term, StreamStats *st) {
+    char pidbuf[64];
+    const char *pidfile = stream_pidfile(what, pidbuf, sizeof(pidbuf));
+    int owner = stream_pidfile_owner(pidfile);
+    if (owner) {
+        fprintf(term, "TERM: %s ERROR — already running (pid=%d)\n", what, owner);
+        return -1;
+    }
+
+    StreamPipeline *sp = NULL;
+    if (stream_pipeline_start(&sp, cfg) != 0) {
+        fprintf(term, "TERM: %s ERROR — cannot start (source=%s sink=%s)\n", what, cfg->source, cfg->sink);
+        return -1;
+    }
+
+    FILE *pf = fopen(pidfile, "w");
+    if (pf) {
+        fprintf(pf, "%d\n", (int)getpid());
+        fclose(pf);
+    } else {
+        log_warning("Stream: cannot write %s: %s", pidfile, strerror(errno));
+    }
+
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = stream_on_signal;
+    sigaction(SIGTERM, &sa, NULL);
+    sigaction(SIGINT, &sa, NULL);
+    signal(SIGPIPE, SIG_IGN);   // a vanished consumer is a sink error, not a crash
+    g_stream_stop = 0;
+
+    fprintf(term, "TERM: %s started (source=%s sink=%s width=%u pid=%d)\n",
+            what, cfg->source, cfg->sink, cfg->width, (int)getpid());
+    fflush(term);
+
+    // Short waits keep --duration and SIGTERM responsive; stats once a second
+    long long t_end = duration_ms > 0 ? hs_now_ms() + duration_ms : 0;
+    long long t_report = hs_now_ms() + 1000;
+    const long metrics_ms = metrics_interval_ms();
+    long long t_metrics = hs_now_ms() + metrics_ms;
+    bool stopping = false;
+    while (!stream_pipeline_wait(sp, 100)) {
+        long long now = hs_now_ms();
+        if (!stopping && (g_stream_stop || (t_end && now >= t_end))) {
+            stream_pipeline_request_stop(sp);
+            stopping = true;
+        }
+        if (now >= t_report) {
+            stream_pipeline_get_stats(sp, st);
+            stream_print_stats(term, "LOG:", st);
+            t_report += 1000;
+        }
+        if (metrics_ms > 0 && now >= t_metrics) {
+            metrics_print(term);
+            t_metrics += metrics_ms;
+        }
+    }
+
+    stream_pipeline_get_stats(sp, st);
+    StreamLatency *lat = (StreamLatency *)malloc(sizeof(*lat));
+    if (lat) stream_pipeline_get_latency(sp, lat);
+    stream_pipeline_destroy(sp);
+    unlink(pidfile);
+    stream_print_stats(term, "LOG:", st);
+    for (int i = 0; lat && i < STREAM_LAT_STAGES; i++) {
+        print_latency(term, "STREAM", stream_latency_stage_name((StreamLatencyStage)i), &lat->stage[i]);
+    }
+    free(lat);
+    return 0;
+}
+
 void handle_stream_start(int argc, char **argv) {
-    (void)argc; (void)argv;
-    log_info("Stream start (stub).");
-    printf("LOG: Stream start requested (stub)\n");
-    printf("TERM: Stream started (stub)\n");
+    StreamConfig cfg;
+    stream_config_init(&cfg);
+    long duration_ms = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--source") == 0 && i + 1 < argc) {
+            cfg.source = argv[++i];
+        } else if (strcmp(argv[i], "--sink") == 0 && i + 1 < argc) {
+            cfg.sink = argv[++i];
+        } else if (strcmp(argv[i], "--bitwidth") == 0 && i + 1 < argc) {
+            cfg.width = (unsigned)atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--rate") == 0 && i + 1 < argc) {
+            cfg.rate_hz = (uint32_t)strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--block") == 0 && i + 1 < argc) {
+            cfg.block_bytes = (size_t)strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--queue") == 0 && i + 1 < argc) {
+            cfg.queue_bytes = (size_t)strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--duration") == 0 && i + 1 < argc) {
+            duration_ms = atol(argv[++i]);
+        } else if (strcmp(argv[i], "--drop") == 0) {
+            cfg.block_on_full = 0;
+        } else if (strcmp(argv[i], "--sched") == 0 && i + 1 < argc) {
+            stream_config_set_sched(&cfg, argv[++i]);
+        } else if (strcmp(argv[i], "--mlock") == 0) {
+            cfg.lock_memory = 1;
+        } else {
+            log_warning("Stream: ignoring unknown option '%s'", argv[i]);
+        }
+    }
+
+    FILE *term = strcmp(cfg.sink, "stdout") == 0 ? stderr : stdout;
+    StreamStats st;
+    if (stream_run(&cfg, duration_ms, "Stream", term, &st) != 0) return;
+
+    fprintf(term, "TERM: Stream stopped (%llu samples, %llu dropped blocks%s)\n",
+            (unsigned long long)st.sink.samples, (unsigned long long)st.reader.drops,
+            st.sink.errors ? ", sink error" : "");
+    fflush(term);
+}
+
+/**
+ * Sends SIGTERM to the process in the pidfile of `what` (the stream_run
+ * name: "Stream", "Spectrum"), which also names it in TERM.
+ */
+static void stream_signal_stop(const char *what) {
+    char pidbuf[64];
+    const char *pidfile = stream_pidfile(what, pidbuf, sizeof(pidbuf));
+    int pid = stream_pidfile_owner(pidfile);
+    if (pid <= 0) {
+        if (access(pidfile, F_OK) == 0) unlink(pidfile);   // stale
+        printf("TERM: %s not running\n", what);
+        return;
+    }
+
+    if (kill((pid_t)pid, SIGTERM) != 0) {
+        printf("TERM: %s stop failed (pid=%d: %s)\n", what, pid, strerror(errno));
+        return;
+    }
+    printf("TERM: %s stop requested (pid=%d)\n", what, pid);
 }
 
 void handle_stream_stop(int argc, char **argv) {
     (void)argc; (void)argv;
-    log_info("Stream stop (stub).");
-    printf("LOG: Stream stop requested (stub)\n");
-    printf("TERM: Stream stopped (stub)\n");
+    stream_signal_stop("Stream");
+}
+
+/* ============================================================================
+ *  Capture: pipeline into a chunked, indexed capture file (capture_file.h)
+ *  - --out <path> (default /tmp/pacrf_capture.cap), --duration ms (1000)
+ *  - --source S (default sim, or PACRF_CAPTURE_SOURCE), --bitwidth, --rate
+ *  - --chunk bytes, --direct for O_DIRECT writes
+ *  - --sched SPEC, --mlock as for --stream-start
+ *  - The header is stamped with the GPS daemon's fix when it is fresh
+ *  - --read <path> [--from ms] [--to ms] [--out raw]: locates a time range
+ *    via the index (and optionally extracts it as int16)
+ * ==========================================================================*/
+#define CAPTURE_DEFAULT_PATH "/tmp/pacrf_capture.cap"
+
+static void capture_read(const char *path, long from_ms, long to_ms, const char *out_path) {
+    CaptureReader r;
+    if (capture_reader_open(&r, path) != 0) {
+        printf("TERM: Capture ERROR — cannot read %s\n", path);
+        return;
+    }
+    const CaptureHeader *h = r.hdr;
+    double secs = h->sample_rate_hz ? (double)r.total_samples / (double)h->sample_rate_hz : 0.0;
+    printf("LOG: CAPTURE %s width=%u rate=%llu chunks=%llu samples=%llu (%.3fs)%s\n", path,
+           h->bit_width, (unsigned long long)h->sample_rate_hz, (unsigned long long)r.chunks,
+           (unsigned long long)r.total_samples, secs, r.index ? "" : " [no index]");
+    if (h->flags & CAPTURE_HDR_GPS) {
+        printf("LOG: CAPTURE gps fix=%d lat=%.7f lon=%.7f sats=%u utc_ms=%lld\n", h->gps.has_fix,
+               h->gps.lat_e7 / 1e7, h->gps.lon_e7 / 1e7, h->gps.sats, (long long)h->gps.utc_epoch_ms);
+    }
+    if (r.chunks == 0) {
+        printf("TERM: Capture %s is empty\n", path);
+        capture_reader_close(&r);
+        return;
+    }
+
+    int64_t from_ns = from_ms > 0 ? (int64_t)from_ms * 1000000 : 0;
+    int64_t to_ns = to_ms > 0 ? (int64_t)to_ms * 1000000 : INT64_MAX;
+    uint64_t c0 = capture_reader_find_time(&r, from_ns);
+    uint64_t c1 = capture_reader_find_time(&r, to_ns);
+
+    FILE *out = NULL;
+    if (out_path && !(out = fopen(out_path, "wb"))) {
+        printf("TERM: Capture ERROR — cannot create %s: %s\n", out_path, strerror(errno));
+        capture_reader_close(&r);
+        return;
+    }
+
+    // Trim the edge chunks to the exact samples when the rate is known
+    uint64_t first = UINT64_MAX, last = 0;
+    for (uint64_t c = c0; c <= c1; c++) {
+        const int16_t *smp;
+        const CaptureChunkHeader *ch = capture_reader_chunk(&r, c, &smp);
+        if (!ch) break;
+        uint64_t s0 = 0, s1 = ch->nsamples;
+        if (h->sample_rate_hz) {
+            int64_t per = 1000000000LL / (int64_t)h->sample_rate_hz;
+            if (per > 0 && from_ns > ch->t_ns) s0 = (uint64_t)((from_ns - ch->t_ns) / per);
+            if (per > 0 && to_ns != INT64_MAX && to_ns > ch->t_ns) {
+                uint64_t e = (uint64_t)((to_ns - ch->t_ns) / per);
+                if (e < s1) s1 = e;
+            }
+        }
+        if (s0 >= s1) continue;
+        if (first == UINT64_MAX) first = ch->first_sample + s0;
+        last = ch->first_sample + s1;
+        if (out) fwrite(smp + s0, sizeof(int16_t), (size_t)(s1 - s0), out);
+    }
+    if (out) fclose(out);
+
+    if (first == UINT64_MAX) {
+        printf("TERM: Capture %s: no samples in the requested range\n", path);
+    } else {
+        printf("TERM: Capture %s: samples %llu..%llu in chunks %llu..%llu%s%s\n", path,
+               (unsigned long long)first, (unsigned long long)last,
+               (unsigned long long)c0, (unsigned long long)c1,
+               out ? " → " : "", out ? out_path : "");
+    }
+    capture_reader_close(&r);
+}
+
+void handle_capture(int argc, char **argv) {
+    StreamConfig cfg;
+    stream_config_init(&cfg);
+    const char *env_src = getenv("PACRF_CAPTURE_SOURCE");
+    if (env_src && *env_src) cfg.source = env_src;
+
+    const char *out_path = NULL;
+    const char *read_path = NULL;
+    long duration_ms = 1000, from_ms = 0, to_ms = 0;
+    unsigned long chunk = 0;   // 0 = writer default
+    int direct = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--out") == 0 && i + 1 < argc) {
+            out_path = argv[++i];
+        } else if (strcmp(argv[i], "--read") == 0 && i + 1 < argc) {
+            read_path = argv[++i];
+        } else if (strcmp(argv[i], "--from") == 0 && i + 1 < argc) {
+            from_ms = atol(argv[++i]);
+        } else if (strcmp(argv[i], "--to") == 0 && i + 1 < argc) {
+            to_ms = atol(argv[++i]);
+        } else if (strcmp(argv[i], "--source") == 0 && i + 1 < argc) {
+            cfg.source = argv[++i];
+        } else if (strcmp(argv[i], "--bitwidth") == 0 && i + 1 < argc) {
+            cfg.width = (unsigned)atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--rate") == 0 && i + 1 < argc) {
+            cfg.rate_hz = (uint32_t)strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--duration") == 0 && i + 1 < argc) {
+            duration_ms = atol(argv[++i]);
+        } else if (strcmp(argv[i], "--chunk") == 0 && i + 1 < argc) {
+            chunk = strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--direct") == 0) {
+            direct = 1;
+        } else if (strcmp(argv[i], "--sched") == 0 && i + 1 < argc) {
+            stream_config_set_sched(&cfg, argv[++i]);
+        } else if (strcmp(argv[i], "--mlock") == 0) {
+            cfg.lock_memory = 1;
+        } else {
+            log_warning("Capture: ignoring unknown option '%s'", argv[i]);
+        }
+    }
+
+    if (read_path) {
+        capture_read(read_path, from_ms, to_ms, out_path);
+        return;
+    }
+
+    if (!out_path) out_path = CAPTURE_DEFAULT_PATH;
+    // Writer options travel in the sink spec, so nothing outlives this command
+    char opts[48] = "", sink[1100];
+    if (chunk) snprintf(opts, sizeof(opts), ",chunk=%lu", chunk);
+    int sn = snprintf(sink, sizeof(sink), "capture:%s%s%s", out_path, opts, direct ? ",direct" : "");
+    if (sn < 0 || (size_t)sn >= sizeof(sink) || strchr(out_path, ',')) {
+        printf("TERM: Capture ERROR — unusable output path %s\n", out_path);
+        return;
+    }
+    cfg.sink = sink;
+
+    StreamStats st;
+    if (stream_run(&cfg, duration_ms, "Capture", stdout, &st) != 0) return;
+
+    double mb = (double)st.sink.bytes / (1024.0 * 1024.0);
+    printf("TERM: Capture complete: %s (%llu samples, %.1f MiB, %llu dropped blocks%s)\n",
+           out_path, (unsigned long long)st.sink.samples, mb,
+           (unsigned long long)st.reader.drops, st.sink.errors ? ", write error" : "");
+}
+
+/* ============================================================================
+ *  Fetch: copy a device file to the caller (IMG: pulls, capture slices)
+ *  - --fetch <path>: raw bytes on stdout, or on the agent's DATA channel
+ *    (PACRF_DATA_FD) so they arrive as DATA frames
+ *  - With raw stdout, TERM/LOG go to stderr like --sink stdout
+ * ==========================================================================*/
+void handle_fetch(int argc, char **argv) {
+    if (argc < 2) {
+        printf("TERM: Fetch ERROR — usage: --fetch <path>\n");
+        return;
+    }
+    const char *path = argv[1];
+    const char *data_fd = getenv("PACRF_DATA_FD");
+    bool raw = !(data_fd && *data_fd);
+    FILE *term = raw ? stderr : stdout;
+
+    int in = open(path, O_RDONLY);
+    if (in < 0) {
+        fprintf(term, "TERM: Fetch ERROR — cannot open %s: %s\n", path, strerror(errno));
+        return;
+    }
+
+    int out;
+    if (!raw) {
+        out = atoi(data_fd);
+    } else {
+        fflush(stdout);
+        out = dup(STDOUT_FILENO);
+        if (out < 0 || dup2(STDERR_FILENO, STDOUT_FILENO) < 0) {
+            fprintf(term, "TERM: Fetch ERROR — cannot take over stdout: %s\n", strerror(errno));
+            if (out >= 0) close(out);
+            close(in);
+            return;
+        }
+    }
+
+    char buf[64 * 1024];
+    unsigned long long total = 0;
+    int err = 0;
+    for (;;) {
+        ssize_t n = read(in, buf, sizeof(buf));
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) {
+            if (n < 0) err = errno;
+            break;
+        }
+        for (ssize_t off = 0; off < n; ) {
+            ssize_t w = write(out, buf + off, (size_t)(n - off));
+            if (w < 0 && errno == EINTR) continue;
+            if (w <= 0) {
+                err = w < 0 ? errno : EIO;
+                break;
+            }
+            off += w;
+        }
+        if (err) break;
+        total += (unsigned long long)n;
+    }
+    close(in);
+
+    if (raw) {   // give stdout back
+        fflush(stdout);
+        dup2(out, STDOUT_FILENO);
+        close(out);
+    }
+    if (err) {
+        fprintf(term, "TERM: Fetch ERROR — %s after %llu bytes: %s\n", path, total, strerror(err));
+    } else {
+        fprintf(term, "TERM: Fetched %s (%llu bytes)\n", path, total);
+    }
+    fflush(term);
+}
+
+/* ============================================================================
+ *  Agent: stay resident and serve framed requests (see agent.h)
+ *  - --listen unix:<path> | tcp:[<host>:]<port> | stdio
+ *    (default PACRF_AGENT_LISTEN, else unix:/tmp/pacrf_agent.sock)
+ *  - tcp: binds loopback only unless --allow-remote is given: any peer
+ *    that can connect may run any command
+ *  - Each request runs in a forked child of this already-initialized
+ *    process; its TERM/LOG/IMG lines and --sink stdout samples come back
+ *    as typed frames
+ *  - Runs until SIGTERM/SIGINT (stdio: until the client disconnects)
+ * ==========================================================================*/
+void handle_agent(int argc, char **argv) {
+    const char *spec = getenv("PACRF_AGENT_LISTEN");
+    int allow_remote = 0;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--listen") == 0 && i + 1 < argc) {
+            spec = argv[++i];
+        } else if (strcmp(argv[i], "--allow-remote") == 0) {
+            allow_remote = 1;
+        } else {
+            log_warning("Agent: ignoring unknown option '%s'", argv[i]);
+        }
+    }
+
+    if (agent_serve(spec, allow_remote) != 0) {
+        printf("TERM: Agent ERROR — cannot listen on %s\n",
+               spec && *spec ? spec : "unix:" AGENT_DEFAULT_SOCKET);
+    }
 }
 
+/* ============================================================================
+ *  Batch: run many commands in this one process (see dispatch_batch)
+ *  - --batch [file|-]  reads commands from a file or stdin (default),
+ *    separated by ';' or newlines; '#' starts a comment line
+ *  - Logger, queue, memory pools and the GPS UART stay open across
+ *    commands, so a sequence costs one process launch / SSH session
+ *  - Each command is framed by "BATCH: BEGIN n <cmd>" and
+ *    "BATCH: END n <ms>ms" lines
+ * ==========================================================================*/
+void handle_batch(int argc, char **argv) {
+    const char *path = argc > 1 ? argv[1] : "-";
+    FILE *in = stdin;
+    if (strcmp(path, "-") != 0 && !(in = fopen(path, "r"))) {
+        printf("TERM: Batch ERROR — cannot open %s (%s)\n", path, strerror(errno));
+        return;
+    }
+    for (int i = 2; i < argc; i++) log_warning("Batch: ignoring extra argument '%s'", argv[i]);
+
+    log_info("Batch started (%s).", strcmp(path, "-") == 0 ? "stdin" : path);
+    handlers_hold_devices(1);
+    int ran = dispatch_batch(in);
+    handlers_hold_devices(0);
+    if (in != stdin) fclose(in);
+
+    printf("TERM: Batch complete (%d command%s)\n", ran, ran == 1 ? "" : "s");
+}
+
+/* ============================================================================
+ *  Spectrum: pipeline into the "spectrum" sink (spectrum.h)
+ *  - --source S (default sim), --bitwidth, --rate, --duration ms (0 = until
+ *    --spectrum-stop)
+ *  - --fft N (1024), --avg N FFTs per frame (8), --max-hold instead of
+ *    averaging, --fps frames/s (10), --bins B per frame (512)
+ *  - --sched SPEC, --mlock as for --stream-start
+ *  - Each frame is one "SPEC: <base64>" line; LOG/TERM as for --stream-start
+ * ==========================================================================*/
 void handle_spectrum_start(int argc, char **argv) {
-    (void)argc; (void)argv;
-    log_info("Spectrum start (stub).");
-    printf("LOG: Spectrum start requested (stub)\n");
-    printf("TERM: Spectrum started (stub)\n");
+    StreamConfig cfg;
+    stream_config_init(&cfg);
+    long duration_ms = 0;
+    unsigned fft = 1024, avg = 8, fps = 10, bins = 512;
+    bool max_hold = false;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--source") == 0 && i + 1 < argc) {
+            cfg.source = argv[++i];
+        } else if (strcmp(argv[i], "--bitwidth") == 0 && i + 1 < argc) {
+            cfg.width = (unsigned)atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--rate") == 0 && i + 1 < argc) {
+            cfg.rate_hz = (uint32_t)strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--duration") == 0 && i + 1 < argc) {
+            duration_ms = atol(argv[++i]);
+        } else if (strcmp(argv[i], "--fft") == 0 && i + 1 < argc) {
+            fft = (unsigned)strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--avg") == 0 && i + 1 < argc) {
+            avg = (unsigned)strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--fps") == 0 && i + 1 < argc) {
+            fps = (unsigned)strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--bins") == 0 && i + 1 < argc) {
+            bins = (unsigned)strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--max-hold") == 0) {
+            max_hold = true;
+        } else if (strcmp(argv[i], "--sched") == 0 && i + 1 < argc) {
+            stream_config_set_sched(&cfg, argv[++i]);
+        } else if (strcmp(argv[i], "--mlock") == 0) {
+            cfg.lock_memory = 1;
+        } else {
+            log_warning("Spectrum: ignoring unknown option '%s'", argv[i]);
+        }
+    }
+
+    char sink[128];
+    snprintf(sink, sizeof(sink), "spectrum:fft=%u,avg=%u,mode=%s,rate=%u,bins=%u",
+             fft, avg, max_hold ? "max" : "avg", fps, bins);
+    cfg.sink = sink;
+
+    StreamStats st;
+    if (stream_run(&cfg, duration_ms, "Spectrum", stdout, &st) != 0) return;
+
+    printf("TERM: Spectrum stopped (%llu samples, %llu dropped blocks)\n",
+           (unsigned long long)st.sink.samples, (unsigned long long)st.reader.drops);
 }
 
 void handle_spectrum_stop(int argc, char **argv) {
     (void)argc; (void)argv;
-    log_info("Spectrum stop (stub).");
-    printf("LOG: Spectrum stop requested (stub)\n");
-    printf("TERM: Spectrum stopped (stub)\n");
+    stream_signal_stop("Spectrum");
+}
+
+/* ============================================================================
+ *  Replay: recorded data through the live code paths, with a latency report
+ *  - --replay <file>: a capture file goes through the stream pipeline via
+ *    the "replay" source in place of the USB device; any other file is
+ *    read as an NMEA log and fed to the GPS parser in place of /dev/ttyPS1
+ *  - --speed X: 1 = recorded rate (default), 10 = ten times faster,
+ *    0 = as fast as possible; --loop N plays the file N times
+ *  - Capture: --sink K (default null), --bitwidth (default: as recorded),
+ *    --block, --queue, --drop, --sched, --mlock as for --stream-start
+ *  - NMEA: --publish updates the GPS cache like --gps-daemon, --echo
+ *    prints every sentence as a LOG: line
+ *  - Ends with per-stage p50/p99/p999 "LOG: ... latency" lines and a
+ *    TERM: summary with the sustained rate
+ * ==========================================================================*/
+enum {
+    REPLAY_LAT_SCHEDULE = 0,   // epoch handed over late vs the recorded timing
+    REPLAY_LAT_PARSE,          // line handed over → sentence framed and decoded
+    REPLAY_LAT_PUBLISH,        // gps_cache_publish (--publish)
+    REPLAY_LAT_OUTPUT,         // LOG: line written (--echo)
+    REPLAY_LAT_TOTAL,          // line handed over → parser returned
+    REPLAY_LAT_STAGES
+};
+
+static const char *const replay_stage_names[REPLAY_LAT_STAGES] = {
+    "schedule", "parse", "publish", "output", "total"
+};
+
+typedef struct {
+    gps_cache_t       *cache;   // NULL without --publish
+    const nmea_stream_t *nmea;
+    const nmea_info_t *info;
+    int                echo;
+    int64_t            t_line;  // when the current line was handed over
+    Histogram          lat[REPLAY_LAT_STAGES];
+} replay_nmea_ctx_t;
+
+static int64_t replay_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+// Time of day (ms) carried in field 1 of GGA/RMC/ZDA/GNS, or -1
+static long replay_nmea_time_ms(const char *line, size_t len) {
+    if (len < 14 || line[0] != '$' || line[6] != ',') return -1;
+    const char *type = line + 3;
+    if (strncmp(type, "GGA", 3) && strncmp(type, "RMC", 3) &&
+        strncmp(type, "ZDA", 3) && strncmp(type, "GNS", 3)) {
+        return -1;
+    }
+    const char *p = line + 7;
+    for (int i = 0; i < 6; i++) {
+        if (p[i] < '0' || p[i] > '9') return -1;
+    }
+    long ms = (((p[0] - '0') * 10 + (p[1] - '0')) * 3600L +
+               ((p[2] - '0') * 10 + (p[3] - '0')) * 60L +
+               ((p[4] - '0') * 10 + (p[5] - '0'))) * 1000L;
+    if (p[6] == '.') {
+        long scale = 100;
+        for (const char *f = p + 7; *f >= '0' && *f <= '9' && scale; f++, scale /= 10) {
+            ms += (*f - '0') * scale;
+        }
+    }
+    return ms;
+}
+
+static void replay_nmea_on_sentence(const char *line, size_t len, bool ok, void *user) {
+    replay_nmea_ctx_t *ctx = (replay_nmea_ctx_t *)user;
+    int64_t t = replay_now_ns();
+    histogram_record(&ctx->lat[REPLAY_LAT_PARSE], (uint64_t)(t - ctx->t_line));
+
+    if (ok && ctx->cache) {
+        gps_cache_publish(ctx->cache, ctx->info, ctx->nmea->ok, ctx->nmea->bad_checksum);
+        int64_t t2 = replay_now_ns();
+        histogram_record(&ctx->lat[REPLAY_LAT_PUBLISH], (uint64_t)(t2 - t));
+        t = t2;
+    }
+    if (ctx->echo) {
+        printf("LOG: %.*s%s\n", (int)len, line, ok ? "" : " [bad checksum]");
+        histogram_record(&ctx->lat[REPLAY_LAT_OUTPUT], (uint64_t)(replay_now_ns() - t));
+    }
+}
+
+static void replay_nmea(const char *path, double speed, int loops, int publish, int echo) {
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        printf("TERM: Replay ERROR — cannot open %s: %s\n", path, strerror(errno));
+        return;
+    }
+    replay_nmea_ctx_t *ctx = (replay_nmea_ctx_t *)calloc(1, sizeof(*ctx));
+    gps_cache_t cache;
+    if (!ctx) {
+        fclose(f);
+        return;
+    }
+    if (publish) {
+        if (gps_cache_open_writer(&cache, 0) != 0) {
+            printf("TERM: Replay ERROR — cannot publish the GPS cache\n");
+            fclose(f);
+            free(ctx);
+            return;
+        }
+        ctx->cache = &cache;
+    }
+    for (int i = 0; i < REPLAY_LAT_STAGES; i++) histogram_init(&ctx->lat[i]);
+
+    nmea_info_t info;
+    nmea_info_init(&info);
+    nmea_stream_t nmea;
+    nmea_stream_init(&nmea);
+    ctx->nmea = &nmea;
+    ctx->info = &info;
+    ctx->echo = echo;
+
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = stream_on_signal;
+    sigaction(SIGTERM, &sa, NULL);
+    sigaction(SIGINT, &sa, NULL);
+    g_stream_stop = 0;
+
+    printf("TERM: Replay started (%s as NMEA, speed=%g loops=%d)\n", path, speed, loops);
+    fflush(stdout);
+
+    char *line = NULL;
+    size_t line_cap = 0;
+    uint64_t lines = 0, bytes = 0;
+    const int64_t t_start = replay_now_ns();
+    for (int loop = 0; loop < loops && !g_stream_stop; loop++) {
+        long t0_ms = -1, epoch_ms = -1;
+        int64_t wall0 = 0;
+        ssize_t n;
+        while (!g_stream_stop && (n = getline(&line, &line_cap, f)) > 0) {
+            // A new epoch is due when its recorded time, scaled by speed, comes up
+            long t_ms = replay_nmea_time_ms(line, (size_t)n);
+            if (t_ms >= 0 && t_ms != epoch_ms) {
+                epoch_ms = t_ms;
+                if (t0_ms < 0) {
+                    t0_ms = t_ms;
+                    wall0 = replay_now_ns();
+                }
+                if (speed > 0) {
+                    long d = t_ms - t0_ms;
+                    if (d < 0) d += 24L * 3600 * 1000;   // midnight
+                    int64_t due = wall0 + (int64_t)((double)d * 1e6 / speed);
+                    struct timespec ts = { (time_t)(due / 1000000000LL), (long)(due % 1000000000LL) };
+                    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR) {
+                        if (g_stream_stop) break;
+                    }
+                    int64_t late = replay_now_ns() - due;
+                    histogram_record(&ctx->lat[REPLAY_LAT_SCHEDULE], late > 0 ? (uint64_t)late : 0);
+                }
+            }
+
+            ctx->t_line = replay_now_ns();
+            nmea_stream_feed(&nmea, line, (size_t)n, &info, replay_nmea_on_sentence, ctx);
+            histogram_record(&ctx->lat[REPLAY_LAT_TOTAL], (uint64_t)(replay_now_ns() - ctx->t_line));
+            lines++;
+            bytes += (uint64_t)n;
+            if (ctx->cache && (lines & 63) == 0) gps_cache_heartbeat(ctx->cache);
+        }
+        rewind(f);
+    }
+    double secs = (double)(replay_now_ns() - t_start) / 1e9;
+    free(line);
+    fclose(f);
+    if (ctx->cache) gps_cache_close(ctx->cache);
+
+    gps_print_summary(&info, 0, " source=replay");
+    for (int i = 0; i < REPLAY_LAT_STAGES; i++) print_latency(stdout, "REPLAY", replay_stage_names[i], &ctx->lat[i]);
+    printf("TERM: Replay done: %llu lines, ok=%u bad_checksum=%u overflow=%u in %.2fs (%.0f lines/s, %.1f KiB/s)\n",
+           (unsigned long long)lines, nmea.ok, nmea.bad_checksum, nmea.overflows, secs,
+           secs > 0 ? lines / secs : 0.0, secs > 0 ? bytes / 1024.0 / secs : 0.0);
+    free(ctx);
+}
+
+static void replay_capture(const char *path, StreamConfig *cfg, double speed, int loops) {
+    CaptureReader r;
+    if (capture_reader_open(&r, path) != 0) {
+        printf("TERM: Replay ERROR — cannot read %s\n", path);
+        return;
+    }
+    if (!cfg->width) cfg->width = r.hdr->bit_width;
+    if (r.hdr->sample_rate_hz) cfg->rate_hz = (uint32_t)r.hdr->sample_rate_hz;   // for the sinks
+    uint64_t rate = r.hdr->sample_rate_hz;
+    capture_reader_close(&r);
+
+    char source[1100];
+    snprintf(source, sizeof(source), "replay:%s,speed=%g,loop=%d", path, speed, loops);
+    cfg->source = source;
+
+    FILE *term = strcmp(cfg->sink, "stdout") == 0 ? stderr : stdout;
+    StreamStats st;
+    if (stream_run(cfg, 0, "Replay", term, &st) != 0) return;
+
+    double secs = st.elapsed_ns > 0 ? (double)st.elapsed_ns / 1e9 : 0.0;
+    double sps = secs > 0 ? (double)st.sink.samples / secs : 0.0;
+    fprintf(term, "TERM: Replay done: %llu samples in %.2fs (%.3f Msps", (unsigned long long)st.sink.samples,
+            secs, sps / 1e6);
+    if (rate) fprintf(term, ", %.1fx recorded rate", sps / (double)rate);
+    fprintf(term, ", %llu dropped blocks%s)\n", (unsigned long long)st.reader.drops,
+            st.sink.errors ? ", sink error" : "");
+    fflush(term);
+}
+
+void handle_replay(int argc, char **argv) {
+    if (argc < 2 || argv[1][0] == '-') {
+        printf("TERM: Replay ERROR — usage: --replay <capture|nmea file> [--speed X] [--loop N]\n");
+        return;
+    }
+    const char *path = argv[1];
+    StreamConfig cfg;
+    stream_config_init(&cfg);
+    cfg.width = 0;   // default: the recorded width
+    double speed = 1.0;
+    int loops = 1, publish = 0, echo = 0;
+
+    for (int i = 2; i < argc; i++) {
+        if (strcmp(argv[i], "--speed") == 0 && i + 1 < argc) {
+            speed = atof(argv[++i]);
+            if (speed < 0) speed = 0;
+        } else if (strcmp(argv[i], "--loop") == 0 && i + 1 < argc) {
+            loops = atoi(argv[++i]);
+            if (loops < 1) loops = 1;
+        } else if (strcmp(argv[i], "--sink") == 0 && i + 1 < argc) {
+            cfg.sink = argv[++i];
+        } else if (strcmp(argv[i], "--bitwidth") == 0 && i + 1 < argc) {
+            cfg.width = (unsigned)atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--block") == 0 && i + 1 < argc) {
+            cfg.block_bytes = (size_t)strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--queue") == 0 && i + 1 < argc) {
+            cfg.queue_bytes = (size_t)strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--drop") == 0) {
+            cfg.block_on_full = 0;
+        } else if (strcmp(argv[i], "--sched") == 0 && i + 1 < argc) {
+            stream_config_set_sched(&cfg, argv[++i]);
+        } else if (strcmp(argv[i], "--mlock") == 0) {
+            cfg.lock_memory = 1;
+        } else if (strcmp(argv[i], "--publish") == 0) {
+            publish = 1;
+        } else if (strcmp(argv[i], "--echo") == 0) {
+            echo = 1;
+        } else {
+            log_warning("Replay: ignoring unknown option '%s'", argv[i]);
+        }
+    }
+
+    char magic[sizeof(CAPTURE_MAGIC) - 1] = { 0 };
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        printf("TERM: Replay ERROR — cannot open %s: %s\n", path, strerror(errno));
+        return;
+    }
+    size_t got = fread(magic, 1, sizeof(magic), f);
+    fclose(f);
+
+    log_info("Replay command received (%s, speed=%g).", path, speed);
+    if (got == sizeof(magic) && memcmp(magic, CAPTURE_MAGIC, sizeof(magic)) == 0) {
+        replay_capture(path, &cfg, speed, loops);
+    } else {
+        replay_nmea(path, speed, loops, publish, echo);
+    }
+}
+
+/* ============================================================================
+ *  Metrics: process-wide counters and latency histograms (metrics.h)
+ *  - One METRICS: line per snapshot; in a --batch the counts cover every
+ *    command run so far
+ *  - --interval ms --count N prints N snapshots `ms` apart (default one)
+ * ==========================================================================*/
+void handle_metrics(int argc, char **argv) {
+    long interval_ms = 1000;
+    int count = 1;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--interval") == 0 && i + 1 < argc) {
+            interval_ms = atol(argv[++i]);
+            if (interval_ms < 1) interval_ms = 1;
+        } else if (strcmp(argv[i], "--count") == 0 && i + 1 < argc) {
+            count = atoi(argv[++i]);
+            if (count < 1) count = 1;
+        } else {
+            log_warning("Metrics: ignoring unknown option '%s'", argv[i]);
+        }
+    }
+
+    for (int n = 0; n < count; n++) {
+        if (n) {
+            struct timespec ts = { interval_ms / 1000, (interval_ms % 1000) * 1000000L };
+            while (nanosleep(&ts, &ts) != 0 && errno == EINTR) { }
+        }
+        if (metrics_print(stdout) != 0) {
+            printf("TERM: Metrics ERROR — out of memory\n");
+            return;
+        }
+    }
 }
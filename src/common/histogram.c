@@ -0,0 +1,80 @@
+// src/common/histogram.c
+//
+// Log-linear latency histogram (see histogram.h)
+
+#include "histogram.h"
+#include "pacrf_atomic.h"
+#include <string.h>
+
+// Single-writer update (readers use relaxed loads)
+#define HIST_SET(field, v) pacrf_store_relaxed(&(field), (v))
+
+static unsigned histogram_index(uint64_t v) {
+    if (v < HISTOGRAM_SUB) return (unsigned)v;
+    unsigned e = 63u - (unsigned)__builtin_clzll(v);            // >= HISTOGRAM_SUB_BITS
+    unsigned sub = (unsigned)(v >> (e - HISTOGRAM_SUB_BITS)) & (HISTOGRAM_SUB - 1);
+    return (e - HISTOGRAM_SUB_BITS + 1) * HISTOGRAM_SUB + sub;
+}
+
+// Highest value that maps to bucket `i`
+static uint64_t histogram_bucket_high(unsigned i) {
+    if (i < HISTOGRAM_SUB) return i;
+    unsigned g = i / HISTOGRAM_SUB, sub = i % HISTOGRAM_SUB;
+    uint64_t low = (uint64_t)(HISTOGRAM_SUB + sub) << (g - 1);
+    return low + ((1ull << (g - 1)) - 1);
+}
+
+void histogram_init(Histogram *h) {
+    if (!h) return;
+    memset(h, 0, sizeof(*h));
+    h->min = UINT64_MAX;
+}
+
+void histogram_record(Histogram *h, uint64_t value) {
+    unsigned i = histogram_index(value);
+    HIST_SET(h->buckets[i], h->buckets[i] + 1);
+    HIST_SET(h->count, h->count + 1);
+    HIST_SET(h->sum, h->sum + value);
+    if (value < h->min) HIST_SET(h->min, value);
+    if (value > h->max) HIST_SET(h->max, value);
+}
+
+void histogram_merge(Histogram *dst, const Histogram *src) {
+    if (!dst || !src) return;
+    uint64_t n = 0;
+    for (unsigned i = 0; i < HISTOGRAM_BUCKETS; i++) {
+        uint64_t c = pacrf_load_relaxed(&src->buckets[i]);
+        dst->buckets[i] += c;
+        n += c;
+    }
+    // Count from the buckets so a snapshot taken mid-update stays consistent
+    dst->count += n;
+    dst->sum += pacrf_load_relaxed(&src->sum);
+    uint64_t mn = pacrf_load_relaxed(&src->min), mx = pacrf_load_relaxed(&src->max);
+    if (mn < dst->min) dst->min = mn;
+    if (mx > dst->max) dst->max = mx;
+}
+
+uint64_t histogram_percentile(const Histogram *h, double p) {
+    if (!h || h->count == 0) return 0;
+    if (p <= 0.0) return h->min;
+    uint64_t target = (uint64_t)((double)h->count * (p / 100.0) + 0.999999);
+    if (target < 1) target = 1;
+    if (target > h->count) target = h->count;
+
+    uint64_t seen = 0;
+    for (unsigned i = 0; i < HISTOGRAM_BUCKETS; i++) {
+        seen += h->buckets[i];
+        if (seen >= target) {
+            uint64_t v = histogram_bucket_high(i);
+            if (v > h->max) v = h->max;
+            if (v < h->min) v = h->min;
+            return v;
+        }
+    }
+    return h->max;
+}
+
+double histogram_mean(const Histogram *h) {
+    return (h && h->count) ? (double)h->sum / (double)h->count : 0.0;
+}
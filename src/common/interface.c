@@ -13,6 +13,28 @@
  *   2) Resilient SSH options: BatchMode, ConnectTimeout, ServerAlive* to avoid silent hangs.
  *   3) Safe line-by-line streaming with explicit flushing so GUI updates are snappy.
  *
+ * Agent mode (PACRF_AGENT set):
+ *   - Commands go to a resident `pac_rf_exec --agent` over kept-open
+ *     connections as framed requests (agent.h) instead of ssh+popen per call
+ *   - PACRF_AGENT=unix:<path> | tcp:<host>:<port>  connect to a running agent
+ *     (e.g. through `ssh -L`); PACRF_AGENT=ssh  start one over SSH
+ *     (`--agent --listen stdio`) and keep that session open
+ *   - Up to AGENT_POOL_MAX idle connections are kept; concurrent calls
+ *     each take their own. If the agent cannot be reached, the call falls
+ *     back to the ssh+popen path below.
+ *
+ * SSH connection reuse (ControlMaster):
+ *   - One master connection per session (ControlPath/ControlPersist); every
+ *     command then runs as a mux client over it, skipping TCP connect + key
+ *     exchange. A command finds the master dead, or fails with ssh's 255, and
+ *     the master is re-established next time; with no master, ssh just
+ *     connects directly as before.
+ *   - PACRF_SSH_CONTROL   control socket path (default
+ *     /tmp/pacrf-ssh-%u-%r@%h:%p); "0" disables multiplexing
+ *   - PACRF_SSH_PERSIST   seconds the idle master stays up (default 600)
+ *   - Connect time and reuse counts: "LOG: SSH master ..." lines and
+ *     pacrf_ssh_get_stats()
+ *
  * Environment overrides (optional for onboarding):
  *   - PACRF_REMOTE_HOST  (default: "pacrf")
  *   - PACRF_REMOTE_USER  (default: "root")
@@ -25,40 +47,108 @@
  */
 
 #include "interface.h"
+#include "agent.h"
 #include "logger.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <errno.h>
+#include <pthread.h>
+#include <signal.h>
+#include <unistd.h>
+#include <stdarg.h>
+#include <time.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+
+/* ----------------------------------------------------------------------------
+ * Cancellation
+ * A token records what the running command is waiting on: the ssh child's
+ * process group, or the agent connection. pacrf_cancel() kills the former
+ * or shuts the latter down (the agent then kills the request).
+ * --------------------------------------------------------------------------*/
+struct pacrf_cancel {
+    pthread_mutex_t lock;
+    int             cancelled;
+    pid_t           pgid;     /* > 0 while an ssh child runs */
+    int             fd;       /* >= 0 while an agent request runs */
+};
+
+pacrf_cancel_t *pacrf_cancel_new(void) {
+    pacrf_cancel_t *c = (pacrf_cancel_t *)calloc(1, sizeof(*c));
+    if (!c) return NULL;
+    pthread_mutex_init(&c->lock, NULL);
+    c->fd = -1;
+    return c;
+}
+
+void pacrf_cancel_free(pacrf_cancel_t *c) {
+    if (!c) return;
+    pthread_mutex_destroy(&c->lock);
+    free(c);
+}
+
+void pacrf_cancel(pacrf_cancel_t *c) {
+    if (!c) return;
+    pthread_mutex_lock(&c->lock);
+    c->cancelled = 1;
+    if (c->pgid > 0) kill(-c->pgid, SIGTERM);
+    if (c->fd >= 0) shutdown(c->fd, SHUT_RDWR);
+    pthread_mutex_unlock(&c->lock);
+}
+
+int pacrf_is_cancelled(pacrf_cancel_t *c) {
+    if (!c) return 0;
+    pthread_mutex_lock(&c->lock);
+    int v = c->cancelled;
+    pthread_mutex_unlock(&c->lock);
+    return v;
+}
+
+/* Publishes what to interrupt (pgid <= 0 / fd < 0 clears it).
+   Returns -1 if the token was cancelled already. */
+static int cancel_attach(pacrf_cancel_t *c, pid_t pgid, int fd) {
+    if (!c) return 0;
+    pthread_mutex_lock(&c->lock);
+    c->pgid = pgid;
+    c->fd = fd;
+    int v = c->cancelled;
+    pthread_mutex_unlock(&c->lock);
+    return v ? -1 : 0;
+}
 
 /* ----------------------------------------------------------------------------
  * Internal helpers
  * --------------------------------------------------------------------------*/
 
+#define SSH_PREFIX_MAX  1024
+#define SSH_REMOTE_MAX  1024
+#define SSH_CMD_MAX     (SSH_PREFIX_MAX + SSH_REMOTE_MAX + 16)   /* prefix + ' ' quotes + " 2>&1" */
+
+/* Multiplexing role of an ssh invocation */
+typedef enum { SSH_MUX_CLIENT, SSH_MUX_MASTER } ssh_mux_t;
+
+/* Control socket path, or NULL when PACRF_SSH_CONTROL=0 */
+static const char *ssh_control_path(void) {
+    const char *cp = getenv("PACRF_SSH_CONTROL");
+    if (cp && strcmp(cp, "0") == 0) return NULL;
+    return (cp && *cp) ? cp : "/tmp/pacrf-ssh-%u-%r@%h:%p";
+}
+
 /**
- * build_command
- * Compose the SSH command that will run the remote PAC-RF binary with args.
- * We ALWAYS append "2>&1" so stderr is merged into stdout (and visible to GUI).
+ * build_ssh_prefix
+ * "ssh <options> [extra] user@host" — everything but the remote command.
+ * Clients use ControlMaster=no: over the master socket when it exists, a
+ * normal connection when it does not. Returns -1 if it did not fit.
  */
-static void build_command(char *out, size_t outsz, const char *args) {
+static int build_ssh_prefix(char *out, size_t outsz, ssh_mux_t mux, const char *extra) {
     /* Pull overrides from environment if set; otherwise use sane defaults. */
     const char *host = getenv("PACRF_REMOTE_HOST");  /* ~/.ssh/config alias is preferred */
     const char *user = getenv("PACRF_REMOTE_USER");  /* default "root" */
-    const char *path = getenv("PACRF_REMOTE_PATH");  /* remote binary path */
     const char *key  = getenv("PACRF_SSH_KEY");      /* optional explicit key */
 
     if (!host || !*host) host = "pacrf"; /* You already configured this alias via ProxyJump dadvm */
     if (!user || !*user) user = "root";
-    if (!path || !*path) path = "/root/pac_rf_project/bin/pac_rf_exec";
-
-    /* Compose remote program invocation. */
-    char remote_cmd[1024];
-    if (args && *args) {
-        /* NOTE: args should already be safe flags like "--gps" or "--capture ..." */
-        snprintf(remote_cmd, sizeof(remote_cmd), "%s %s", path, args);
-    } else {
-        snprintf(remote_cmd, sizeof(remote_cmd), "%s", path);
-    }
 
     /* SSH options for resilience on flaky networks. */
     const char *ssh_common_opts =
@@ -68,25 +158,207 @@ static void build_command(char *out, size_t outsz, const char *args) {
         "-o ServerAliveCountMax=2 "
         "-o StrictHostKeyChecking=accept-new";
 
+    const char *sep = (extra && *extra) ? " " : "";
+    if (!extra) extra = "";
+
+    /* Connection reuse */
+    char mux_opts[512] = "";
+    const char *cp = ssh_control_path();
+    if (cp) {
+        if (mux == SSH_MUX_MASTER) {
+            const char *persist = getenv("PACRF_SSH_PERSIST");
+            int secs = (persist && atoi(persist) > 0) ? atoi(persist) : 600;
+            snprintf(mux_opts, sizeof(mux_opts),
+                     " -o ControlMaster=yes -o ControlPersist=%d -o ControlPath='%s'", secs, cp);
+        } else {
+            snprintf(mux_opts, sizeof(mux_opts),
+                     " -o ControlMaster=no -o ControlPath='%s'", cp);
+        }
+    }
+
+    int n;
     if (key && *key) {
         /* Explicit identity file path */
-        snprintf(
-            out, outsz,
-            "ssh %s -i '%s' %s@%s '%s' 2>&1",
-            ssh_common_opts, key, user, host, remote_cmd
-        );
+        n = snprintf(out, outsz, "ssh %s%s -i '%s'%s%s %s@%s",
+                     ssh_common_opts, mux_opts, key, sep, extra, user, host);
     } else {
         /* Rely on ~/.ssh/config (recommended) */
-        snprintf(
-            out, outsz,
-            "ssh %s %s@%s '%s' 2>&1",
-            ssh_common_opts, user, host, remote_cmd
-        );
+        n = snprintf(out, outsz, "ssh %s%s%s%s %s@%s", ssh_common_opts, mux_opts, sep, extra, user, host);
     }
+    return (n < 0 || (size_t)n >= outsz) ? -1 : 0;
 }
 
 /**
- * run_cmd_internal
+ * build_command
+ * Compose the SSH command that will run the remote PAC-RF binary with args.
+ * With merge_stderr we append "2>&1" so stderr is merged into stdout (and
+ * visible to GUI); the agent session keeps stdout for frames only.
+ * Returns -1 if the command would be truncated (`out` needs SSH_CMD_MAX).
+ */
+static int build_command(char *out, size_t outsz, const char *args, int merge_stderr) {
+    const char *path = getenv("PACRF_REMOTE_PATH");  /* remote binary path */
+    if (!path || !*path) path = "/root/pac_rf_project/bin/pac_rf_exec";
+
+    /* Compose remote program invocation. */
+    char remote_cmd[SSH_REMOTE_MAX];
+    int n;
+    if (args && *args) {
+        /* NOTE: args should already be safe flags like "--gps" or "--capture ..." */
+        n = snprintf(remote_cmd, sizeof(remote_cmd), "%s %s", path, args);
+    } else {
+        n = snprintf(remote_cmd, sizeof(remote_cmd), "%s", path);
+    }
+    if (n < 0 || (size_t)n >= sizeof(remote_cmd)) return -1;
+
+    char prefix[SSH_PREFIX_MAX];
+    if (build_ssh_prefix(prefix, sizeof(prefix), SSH_MUX_CLIENT, NULL) != 0) return -1;
+    n = snprintf(out, outsz, "%s '%s'%s", prefix, remote_cmd, merge_stderr ? " 2>&1" : "");
+    return (n < 0 || (size_t)n >= outsz) ? -1 : 0;
+}
+
+/* Sends one status line the same way command output goes (CLI and/or GUI). */
+static void report_line(pacrf_line_cb on_line, void *user, int passthrough_stdout,
+                        const char *fmt, ...) {
+    char buf[512];
+    va_list ap;
+    va_start(ap, fmt);
+    vsnprintf(buf, sizeof(buf), fmt, ap);
+    va_end(ap);
+
+    if (passthrough_stdout) {
+        printf("%s\n", buf);
+        fflush(stdout);
+    }
+    if (on_line) {
+        strncat(buf, "\n", sizeof(buf) - strlen(buf) - 1);
+        on_line(buf, user);
+    }
+}
+
+/* ----------------------------------------------------------------------------
+ * SSH connection manager
+ * --------------------------------------------------------------------------*/
+
+#define SSH_CHECK_INTERVAL_MS 2000   /* trust a recent check instead of re-probing */
+
+static pthread_mutex_t   g_ssh_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t    g_ssh_cond = PTHREAD_COND_INITIALIZER;
+static pacrf_ssh_stats_t g_ssh;
+static long long         g_ssh_checked_ms = 0;
+static int               g_ssh_busy = 0;    /* a check/connect runs (without the lock) */
+static unsigned          g_ssh_round = 0;   /* check/connect rounds finished */
+
+static long long ssh_now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000LL + ts.tv_nsec / 1000000LL;
+}
+
+/* "<ssh prefix> >/dev/null 2>&1" for a control command. Returns -1 if it did not fit. */
+static int ssh_ctl_command(char *out, size_t outsz, ssh_mux_t mux, const char *extra) {
+    char prefix[SSH_PREFIX_MAX];
+    if (build_ssh_prefix(prefix, sizeof(prefix), mux, extra) != 0) return -1;
+    int n = snprintf(out, outsz, "%s >/dev/null 2>&1", prefix);
+    return (n < 0 || (size_t)n >= outsz) ? -1 : 0;
+}
+
+/* Runs a control command built by ssh_ctl_command(); -1 if it could not be built */
+static int ssh_ctl_run(ssh_mux_t mux, const char *extra) {
+    char cmd[SSH_PREFIX_MAX + 32];
+    if (ssh_ctl_command(cmd, sizeof(cmd), mux, extra) != 0) {
+        log_warning("SSH: control command too long (PACRF_SSH_CONTROL/PACRF_SSH_KEY?)");
+        return -1;
+    }
+    return system(cmd);
+}
+
+/* Ends a check/connect round; caller holds g_ssh_lock */
+static void ssh_round_done(void) {
+    g_ssh_busy = 0;
+    g_ssh_round++;
+    pthread_cond_broadcast(&g_ssh_cond);
+}
+
+/*
+ * Makes sure the master is up: a cheap `ssh -O check` if the last check is
+ * stale, a new `ssh -M -N -f` if that fails. Returns 1 when commands will
+ * reuse the master, 0 when they connect on their own. Caller holds no lock.
+ * The ssh calls run unlocked; threads arriving meanwhile wait for that one
+ * round and take its result instead of starting their own.
+ */
+static int ssh_master_ensure(pacrf_line_cb on_line, void *user, int passthrough_stdout) {
+    if (!ssh_control_path()) return 0;
+
+    pthread_mutex_lock(&g_ssh_lock);
+    g_ssh.enabled = 1;
+    if (g_ssh_busy) {
+        unsigned round = g_ssh_round;
+        while (g_ssh_busy) pthread_cond_wait(&g_ssh_cond, &g_ssh_lock);
+        if (g_ssh_round != round) {
+            int up = g_ssh.up;
+            if (up) g_ssh.reuses++;
+            pthread_mutex_unlock(&g_ssh_lock);
+            return up;
+        }
+    }
+    long long now = ssh_now_ms();
+    if (g_ssh.up && now - g_ssh_checked_ms < SSH_CHECK_INTERVAL_MS) {
+        g_ssh.reuses++;
+        pthread_mutex_unlock(&g_ssh_lock);
+        return 1;
+    }
+    g_ssh_busy = 1;
+    g_ssh.checks++;
+    int was_up = g_ssh.up;
+    pthread_mutex_unlock(&g_ssh_lock);
+
+    if (ssh_ctl_run(SSH_MUX_CLIENT, "-O check") == 0) {
+        pthread_mutex_lock(&g_ssh_lock);
+        g_ssh.up = 1;
+        g_ssh_checked_ms = ssh_now_ms();
+        g_ssh.reuses++;
+        ssh_round_done();
+        pthread_mutex_unlock(&g_ssh_lock);
+        return 1;
+    }
+
+    /* (Re-)establish: -f returns once the master is authenticated */
+    long long t0 = ssh_now_ms();
+    int rc = ssh_ctl_run(SSH_MUX_MASTER, "-N -f");
+    long ms = (long)(ssh_now_ms() - t0);
+
+    pthread_mutex_lock(&g_ssh_lock);
+    if (rc == 0) {
+        g_ssh.up = 1;
+        g_ssh.connects++;
+        g_ssh.last_connect_ms = ms;
+        g_ssh_checked_ms = ssh_now_ms();
+        unsigned n = g_ssh.connects;
+        ssh_round_done();
+        pthread_mutex_unlock(&g_ssh_lock);
+        report_line(on_line, user, passthrough_stdout,
+                    "LOG: SSH master %s (connect %ld ms, #%u)", was_up ? "re-established" : "up", ms, n);
+        return 1;
+    }
+
+    g_ssh.up = 0;
+    g_ssh.connect_failures++;
+    ssh_round_done();
+    pthread_mutex_unlock(&g_ssh_lock);
+    report_line(on_line, user, passthrough_stdout,
+                "LOG: SSH master failed after %ld ms (status %d); connecting per command", ms, rc);
+    return 0;
+}
+
+/* A command failed at the ssh layer: probe the master before the next one */
+static void ssh_master_suspect(void) {
+    pthread_mutex_lock(&g_ssh_lock);
+    g_ssh_checked_ms = 0;
+    pthread_mutex_unlock(&g_ssh_lock);
+}
+
+/**
+ * run_cmd_popen
  * Execute the composed SSH command and stream output.
  *
  * If passthrough_stdout == 1:
@@ -97,12 +369,60 @@ static void build_command(char *out, size_t outsz, const char *args) {
  *
  * Returns process exit status (0 on success).
  */
-static int run_cmd_internal(const char *args,
-                            pacrf_line_cb on_line,
-                            void *user,
-                            int passthrough_stdout) {
-    char cmd[2048];
-    build_command(cmd, sizeof(cmd), args);
+/* popen() that starts `cmd` in its own process group, so a cancel can kill
+   sh, ssh and anything else it started at once. A non-NULL `arg` is $1 of
+   the shell: data that must not be parsed by it. */
+static FILE *cmd_popen_group(const char *cmd, const char *arg, pid_t *pid_out) {
+    int p[2];
+    if (pipe(p) != 0) return NULL;
+    pid_t pid = fork();
+    if (pid < 0) {
+        close(p[0]);
+        close(p[1]);
+        return NULL;
+    }
+    if (pid == 0) {
+        setpgid(0, 0);
+        dup2(p[1], STDOUT_FILENO);
+        close(p[0]);
+        close(p[1]);
+        execl("/bin/sh", "sh", "-c", cmd, "sh", arg, (char *)NULL);
+        _exit(127);
+    }
+    setpgid(pid, pid);   /* also from here: no window where a kill misses */
+    close(p[1]);
+    FILE *fp = fdopen(p[0], "r");
+    if (!fp) {
+        close(p[0]);
+        kill(pid, SIGKILL);
+        waitpid(pid, NULL, 0);
+        return NULL;
+    }
+    *pid_out = pid;
+    return fp;
+}
+
+static int cmd_pclose_group(FILE *fp, pid_t pid) {
+    fclose(fp);
+    int status;
+    while (waitpid(pid, &status, 0) < 0) {
+        if (errno != EINTR) return -1;
+    }
+    return status;
+}
+
+static int run_cmd_popen(const char *args,
+                         pacrf_line_cb on_line,
+                         void *user,
+                         int passthrough_stdout,
+                         pacrf_cancel_t *cancel) {
+    ssh_master_ensure(on_line, user, passthrough_stdout);
+
+    char cmd[SSH_CMD_MAX];
+    if (build_command(cmd, sizeof(cmd), args, 1) != 0) {
+        report_line(on_line, user, passthrough_stdout, "TERM: ERROR — command too long");
+        return -1;
+    }
 
     /* Optional: surface the command itself for debugging. */
     if (passthrough_stdout) {
@@ -111,7 +431,8 @@ static int run_cmd_internal(const char *args,
         fflush(stdout);
     }
 
-    FILE *fp = popen(cmd, "r");
+    pid_t pid = 0;
+    FILE *fp = cancel ? cmd_popen_group(cmd, NULL, &pid) : popen(cmd, "r");
     if (!fp) {
         const char *msg = strerror(errno);
         if (passthrough_stdout) {
@@ -127,6 +448,8 @@ static int run_cmd_internal(const char *args,
         return -1;
     }
 
+    if (cancel_attach(cancel, pid, -1) != 0) kill(-pid, SIGTERM);   /* cancelled meanwhile */
+
     /* Read stdout (merged with stderr) line by line and forward it. */
     char line[4096];
     while (fgets(line, sizeof(line), fp)) {
@@ -141,7 +464,11 @@ static int run_cmd_internal(const char *args,
         }
     }
 
-    int status = pclose(fp);
+    int status = cancel ? cmd_pclose_group(fp, pid) : pclose(fp);
+    if (cancel) {
+        cancel_attach(cancel, 0, -1);
+        if (pacrf_is_cancelled(cancel)) return PACRF_CMD_CANCELLED;
+    }
     if (status == -1) {
         const char *msg = strerror(errno);
         if (passthrough_stdout) {
@@ -156,6 +483,9 @@ static int run_cmd_internal(const char *args,
         return -1;
     }
 
+    /* 255 is ssh's own failure (connection, mux socket): recheck the master */
+    if (WIFEXITED(status) && WEXITSTATUS(status) == 255) ssh_master_suspect();
+
     /* Non-zero exit code still returns any emitted lines (now visible due to 2>&1). */
     if (status != 0) {
         if (passthrough_stdout) {
@@ -172,16 +502,390 @@ static int run_cmd_internal(const char *args,
     return status;
 }
 
+/* ----------------------------------------------------------------------------
+ * Agent client
+ * --------------------------------------------------------------------------*/
+
+#define AGENT_POOL_MAX      4
+#define AGENT_ARGS_MAX      64
+#define AGENT_GREETING_MS   15000   /* SSH connect + remote startup */
+
+typedef struct {
+    int   fd;
+    pid_t ssh_pid;    /* > 0 when the connection is our own ssh session */
+} agent_conn_t;
+
+static pthread_mutex_t g_agent_lock = PTHREAD_MUTEX_INITIALIZER;
+static agent_conn_t    g_agent_idle[AGENT_POOL_MAX];
+static int             g_agent_idle_n = 0;
+
+/* Starts `ssh ... pac_rf_exec --agent --listen stdio` on one end of a socketpair. */
+static int agent_spawn_ssh(agent_conn_t *c) {
+    ssh_master_ensure(NULL, NULL, 0);
+
+    char cmd[SSH_CMD_MAX];
+    if (build_command(cmd, sizeof(cmd), "--agent --listen stdio", 0) != 0) {
+        log_warning("Agent: ssh command too long (PACRF_REMOTE_PATH?)");
+        return -1;
+    }
+
+    int sv[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) != 0) return -1;
+
+    pid_t pid = fork();
+    if (pid < 0) {
+        close(sv[0]);
+        close(sv[1]);
+        return -1;
+    }
+    if (pid == 0) {
+        dup2(sv[1], STDIN_FILENO);
+        dup2(sv[1], STDOUT_FILENO);
+        close(sv[0]);
+        close(sv[1]);
+        execl("/bin/sh", "sh", "-c", cmd, (char *)NULL);
+        _exit(127);
+    }
+    close(sv[1]);
+
+    if (agent_await_greeting(sv[0], AGENT_GREETING_MS) != 0) {
+        log_warning("Agent: no greeting from '%s'", cmd);
+        close(sv[0]);
+        kill(pid, SIGTERM);
+        waitpid(pid, NULL, 0);
+        return -1;
+    }
+    c->fd = sv[0];
+    c->ssh_pid = pid;
+    return 0;
+}
+
+static int agent_open(const char *spec, agent_conn_t *c) {
+    if (strcmp(spec, "ssh") == 0) return agent_spawn_ssh(c);
+    c->fd = agent_connect(spec);
+    c->ssh_pid = 0;
+    return c->fd >= 0 ? 0 : -1;
+}
+
+static void agent_drop(agent_conn_t *c) {
+    close(c->fd);
+    if (c->ssh_pid > 0) waitpid(c->ssh_pid, NULL, 0);   /* ssh exits on EOF */
+}
+
+/* Takes an idle connection (returns 1) or opens a new one (returns 0); -1 on failure. */
+static int agent_acquire(const char *spec, agent_conn_t *c) {
+    pthread_mutex_lock(&g_agent_lock);
+    if (g_agent_idle_n > 0) {
+        *c = g_agent_idle[--g_agent_idle_n];
+        pthread_mutex_unlock(&g_agent_lock);
+        return 1;
+    }
+    pthread_mutex_unlock(&g_agent_lock);
+    return agent_open(spec, c) == 0 ? 0 : -1;
+}
+
+static void agent_release(agent_conn_t *c) {
+    pthread_mutex_lock(&g_agent_lock);
+    if (g_agent_idle_n < AGENT_POOL_MAX) {
+        g_agent_idle[g_agent_idle_n++] = *c;
+        c = NULL;
+    }
+    pthread_mutex_unlock(&g_agent_lock);
+    if (c) agent_drop(c);
+}
+
+typedef struct {
+    pacrf_line_cb on_line;
+    pacrf_data_cb on_data;
+    void         *user;
+    int           passthrough_stdout;
+    pacrf_cancel_t *cancel;
+} agent_ctx_t;
+
+/* Turns frames back into the prefixed lines the CLI and GUI router expect. */
+static void agent_on_frame(uint8_t type, const uint8_t *payload, uint32_t len, void *user) {
+    agent_ctx_t *ctx = (agent_ctx_t *)user;
+
+    if (type == AGENT_DATA) {
+        if (ctx->passthrough_stdout) fwrite(payload, 1, len, stdout);
+        if (ctx->on_data) ctx->on_data(payload, len, ctx->user);
+        return;
+    }
+
+    const char *prefix = type == AGENT_TERM ? "TERM: "
+                       : type == AGENT_LOG  ? "LOG: "
+                       : type == AGENT_IMG  ? "IMG: " : "";
+    char line[4096];
+    snprintf(line, sizeof(line), "%s%.*s\n", prefix, (int)len, (const char *)payload);
+
+    if (ctx->passthrough_stdout) {
+        fputs(line, stdout);
+        fflush(stdout);
+    }
+    if (ctx->on_line) ctx->on_line(line, ctx->user);
+}
+
+/* Splits `args` on whitespace ('...' / "..." group a word). Returns argc. */
+static int agent_split_args(char *args, char **argv, int max) {
+    int argc = 0;
+    char *r = args, *w = args;
+    while (*r) {
+        while (*r == ' ' || *r == '\t' || *r == '\n') r++;
+        if (!*r) break;
+        if (argc == max) return -1;
+        argv[argc++] = w;
+        char quote = 0;
+        while (*r && (quote || (*r != ' ' && *r != '\t' && *r != '\n'))) {
+            if (quote && *r == quote) quote = 0;
+            else if (!quote && (*r == '\'' || *r == '"')) quote = *r;
+            else *w++ = *r;
+            r++;
+        }
+        if (*r) r++;
+        *w++ = '\0';
+    }
+    return argc;
+}
+
+/*
+ * Runs argv on the agent. Returns the command status, or -2 if no agent
+ * connection could be made (the caller falls back to ssh+popen).
+ */
+static int run_cmd_agent_argv(const char *spec, int argc, char *const *argv, agent_ctx_t *ctx) {
+    /* A pooled connection may have gone stale (agent restarted): retry once fresh */
+    for (int attempt = 0; attempt < 2; attempt++) {
+        agent_conn_t c;
+        int reused = agent_acquire(spec, &c);
+        if (reused < 0) return -2;
+
+        if (cancel_attach(ctx->cancel, 0, c.fd) != 0) {
+            agent_release(&c);
+            return PACRF_CMD_CANCELLED;
+        }
+        int status = agent_request(c.fd, argc, argv, agent_on_frame, ctx);
+        cancel_attach(ctx->cancel, 0, -1);
+        if (pacrf_is_cancelled(ctx->cancel)) {
+            agent_drop(&c);   /* shut down mid-request: not reusable */
+            return PACRF_CMD_CANCELLED;
+        }
+        if (status >= 0) {
+            agent_release(&c);
+            return status;
+        }
+        agent_drop(&c);
+        if (!reused) break;
+    }
+    return -2;
+}
+
+/* run_cmd_agent_argv() for a command line, split like a shell would.
+   An empty line asks for --help, as the binary with no arguments does. */
+static int run_cmd_agent(const char *spec, const char *args, agent_ctx_t *ctx) {
+    if (!args) args = "";
+    char *buf = strdup(args);
+    if (!buf) return -1;
+    char *argv[AGENT_ARGS_MAX];
+    int argc = agent_split_args(buf, argv, AGENT_ARGS_MAX);
+    if (argc < 0) {
+        free(buf);
+        report_line(ctx->on_line, ctx->user, ctx->passthrough_stdout,
+                    "TERM: ERROR — too many arguments (max %d)", AGENT_ARGS_MAX);
+        return 2;   /* as the agent answers an over-long request */
+    }
+    if (argc == 0) {
+        argv[0] = "--help";
+        argc = 1;
+    }
+    int status = run_cmd_agent_argv(spec, argc, argv, ctx);
+    free(buf);
+    return status;
+}
+
+/**
+ * run_cmd_internal
+ * Agent when PACRF_AGENT is set and reachable, otherwise ssh+popen.
+ */
+static int run_cmd_internal(const char *args,
+                            pacrf_line_cb on_line,
+                            pacrf_data_cb on_data,
+                            void *user,
+                            int passthrough_stdout,
+                            pacrf_cancel_t *cancel) {
+    if (pacrf_is_cancelled(cancel)) return PACRF_CMD_CANCELLED;
+
+    const char *spec = getenv("PACRF_AGENT");
+    if (spec && *spec) {
+        agent_ctx_t ctx = { on_line, on_data, user, passthrough_stdout, cancel };
+        int status = run_cmd_agent(spec, args, &ctx);
+        if (status != -2) return status;
+
+        const char *msg = "LOG: Agent unreachable; falling back to ssh";
+        if (passthrough_stdout) {
+            printf("%s (%s)\n", msg, spec);
+            fflush(stdout);
+        }
+        if (on_line) {
+            char buf[256];
+            snprintf(buf, sizeof(buf), "%s (%s)\n", msg, spec);
+            on_line(buf, user);
+        }
+    }
+    return run_cmd_popen(args, on_line, user, passthrough_stdout, cancel);
+}
+
 /* ----------------------------------------------------------------------------
  * Public API
  * --------------------------------------------------------------------------*/
 
 int run_pacrf_cmd(const char *args) {
     /* CLI mode: pass lines straight to stdout (already prefixed) */
-    return run_cmd_internal(args, NULL, NULL, /*passthrough_stdout=*/1);
+    return run_cmd_internal(args, NULL, NULL, NULL, /*passthrough_stdout=*/1, NULL);
 }
 
 int run_pacrf_cmd_cb(const char *args, pacrf_line_cb on_line, void *user) {
     /* GUI mode: route each line back via callback */
-    return run_cmd_internal(args, on_line, user, /*passthrough_stdout=*/0);
+    return run_cmd_internal(args, on_line, NULL, user, /*passthrough_stdout=*/0, NULL);
+}
+
+int run_pacrf_cmd_data(const char *args, pacrf_line_cb on_line, pacrf_data_cb on_data, void *user) {
+    /* GUI mode with binary samples (agent DATA frames) */
+    return run_cmd_internal(args, on_line, on_data, user, /*passthrough_stdout=*/0, NULL);
+}
+
+int run_pacrf_cmd_cancellable(const char *args, pacrf_line_cb on_line, pacrf_data_cb on_data,
+                              void *user, pacrf_cancel_t *cancel) {
+    /* GUI jobs: like run_pacrf_cmd_data(), interruptible through `cancel` */
+    return run_cmd_internal(args, on_line, on_data, user, /*passthrough_stdout=*/0, cancel);
+}
+
+/* --fetch over the agent: DATA frames are the file, a "Fetch ERROR" TERM fails it */
+typedef struct {
+    FILE   *out;
+    size_t  bytes;
+    int     failed;
+} fetch_ctx_t;
+
+static void fetch_on_line(const char *line, void *user) {
+    fetch_ctx_t *f = (fetch_ctx_t *)user;
+    if (strncmp(line, "TERM: Fetch ERROR", 17) == 0) {
+        f->failed = 1;
+        log_warning("%.*s", (int)strcspn(line + 6, "\n"), line + 6);
+    }
+}
+
+static void fetch_on_data(const void *data, size_t len, void *user) {
+    fetch_ctx_t *f = (fetch_ctx_t *)user;
+    if (fwrite(data, 1, len, f->out) != len) f->failed = 1;
+    f->bytes += len;
+}
+
+/* Single-quotes `s` for a POSIX shell ('\'' for each quote). Returns -1 if it does not fit. */
+static int shell_quote(char *out, size_t outsz, const char *s) {
+    size_t w = 0;
+    if (outsz < 3) return -1;
+    out[w++] = '\'';
+    for (; *s; s++) {
+        if (*s == '\'') {
+            if (w + 4 >= outsz) return -1;
+            memcpy(out + w, "'\\''", 4);
+            w += 4;
+        } else {
+            if (w + 1 >= outsz) return -1;
+            out[w++] = *s;
+        }
+    }
+    if (w + 2 > outsz) return -1;
+    out[w++] = '\'';
+    out[w] = '\0';
+    return 0;
+}
+
+int pacrf_fetch_file(const char *remote_path, const char *local_path, size_t *bytes_out) {
+    /* The path comes from device output: no control characters, and it must
+       fit quoted into the remote command */
+    char remote_cmd[SSH_REMOTE_MAX], quoted[SSH_REMOTE_MAX - 8];
+    int bad = !remote_path || !*remote_path;
+    for (const unsigned char *p = (const unsigned char *)remote_path; !bad && *p; p++) {
+        if (*p < 0x20 || *p == 0x7f) bad = 1;
+    }
+    if (bad || shell_quote(quoted, sizeof(quoted), remote_path) != 0) {
+        log_warning("Fetch: refusing path '%s'", remote_path ? remote_path : "");
+        return -1;
+    }
+    snprintf(remote_cmd, sizeof(remote_cmd), "cat -- %s", quoted);
+    FILE *out = fopen(local_path, "wb");
+    if (!out) {
+        log_warning("Fetch: cannot create %s: %s", local_path, strerror(errno));
+        return -1;
+    }
+
+    fetch_ctx_t f = { out, 0, 0 };
+    int status = -2;
+    const char *spec = getenv("PACRF_AGENT");
+    if (spec && *spec) {
+        char *const argv[] = { "--fetch", (char *)remote_path };
+        agent_ctx_t ctx = { fetch_on_line, fetch_on_data, &f, 0, NULL };
+        status = run_cmd_agent_argv(spec, 2, argv, &ctx);
+        if (status == -2) log_info("Fetch: agent unreachable; falling back to ssh");
+    }
+    if (status == -2) {
+        /* Plain `cat` rather than --fetch: the binary's startup log would land in the data */
+        /* The local shell only sees "$1"; the remote one gets the quoted path */
+        ssh_master_ensure(NULL, NULL, 0);
+        char prefix[SSH_PREFIX_MAX], cmd[SSH_PREFIX_MAX + 8];
+        pid_t pid = 0;
+        FILE *fp = NULL;
+        int n = build_ssh_prefix(prefix, sizeof(prefix), SSH_MUX_CLIENT, NULL) == 0
+              ? snprintf(cmd, sizeof(cmd), "%s \"$1\"", prefix) : -1;
+        if (n >= 0 && (size_t)n < sizeof(cmd)) fp = cmd_popen_group(cmd, remote_cmd, &pid);
+        else log_warning("Fetch: ssh command too long");
+        if (!fp) {
+            status = -1;
+        } else {
+            char buf[64 * 1024];
+            size_t n;
+            while ((n = fread(buf, 1, sizeof(buf), fp)) > 0) fetch_on_data(buf, n, &f);
+            status = cmd_pclose_group(fp, pid);
+            if (WIFEXITED(status) && WEXITSTATUS(status) == 255) ssh_master_suspect();
+        }
+    }
+
+    if (fclose(out) != 0) f.failed = 1;
+    if (status != 0 || f.failed) {
+        unlink(local_path);
+        return -1;
+    }
+    if (bytes_out) *bytes_out = f.bytes;
+    return 0;
+}
+
+int pacrf_ssh_connect(void) {
+    if (!ssh_master_ensure(NULL, NULL, 0)) return -1;
+    pthread_mutex_lock(&g_ssh_lock);
+    int ms = (int)g_ssh.last_connect_ms;
+    pthread_mutex_unlock(&g_ssh_lock);
+    return ms;
+}
+
+void pacrf_ssh_get_stats(pacrf_ssh_stats_t *out) {
+    pthread_mutex_lock(&g_ssh_lock);
+    *out = g_ssh;
+    out->enabled = ssh_control_path() != NULL;
+    pthread_mutex_unlock(&g_ssh_lock);
+}
+
+void pacrf_ssh_close(void) {
+    if (!ssh_control_path()) return;
+
+    /* Idle pooled agent sessions ride on the master; end them first */
+    pthread_mutex_lock(&g_agent_lock);
+    while (g_agent_idle_n > 0) agent_drop(&g_agent_idle[--g_agent_idle_n]);
+    pthread_mutex_unlock(&g_agent_lock);
+
+    if (ssh_ctl_run(SSH_MUX_CLIENT, "-O exit") != 0) log_debug("SSH master was not running.");
+
+    pthread_mutex_lock(&g_ssh_lock);
+    g_ssh.up = 0;
+    g_ssh_checked_ms = 0;
+    pthread_mutex_unlock(&g_ssh_lock);
 }
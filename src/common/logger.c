@@ -1,17 +1,531 @@
 #include "logger.h"
+#include "pacrf_atomic.h" // lock-free ring for the async backend
+#include <stdlib.h>    // getenv, malloc, atexit
+#include <string.h>    // memcpy, strlen
+#include <strings.h>   // strcasecmp
+#include <stdint.h>    // uint64_t
+#include <stddef.h>    // ptrdiff_t
+#include <time.h>      // clock_gettime, nanosleep
+#include <pthread.h>   // background formatter thread
+
+// ============================================================================
+// Runtime Threshold
+// ----------------------------------------------------------------------------
+// Messages below this level are dropped before any formatting happens.
+// Defaults to INFO so per-operation DEBUG tracing stays off unless asked for.
+// ============================================================================
+int g_log_level = LOG_LEVEL_INFO;
+
+void log_set_level(int level) {
+    if (level < LOG_LEVEL_DEBUG) level = LOG_LEVEL_DEBUG;
+    if (level > LOG_LEVEL_NONE)  level = LOG_LEVEL_NONE;
+    g_log_level = level;
+}
+
+int log_get_level(void) {
+    return g_log_level;
+}
+
+int log_level_from_string(const char *name) {
+    if (!name || !*name) return -1;
+    if (strcasecmp(name, "debug") == 0)   return LOG_LEVEL_DEBUG;
+    if (strcasecmp(name, "info") == 0)    return LOG_LEVEL_INFO;
+    if (strcasecmp(name, "warning") == 0 ||
+        strcasecmp(name, "warn") == 0)    return LOG_LEVEL_WARNING;
+    if (strcasecmp(name, "error") == 0)   return LOG_LEVEL_ERROR;
+    if (strcasecmp(name, "none") == 0)    return LOG_LEVEL_NONE;
+    return -1;
+}
+
+void log_init_from_env(void) {
+    const char *env = getenv("PACRF_LOG_LEVEL");
+    if (env && *env) {
+        int level = log_level_from_string(env);
+        if (level < 0) log_warning("Ignoring unknown PACRF_LOG_LEVEL=%s", env);
+        else           log_set_level(level);
+    }
+
+    const char *async = getenv("PACRF_LOG_ASYNC");
+    if (async && *async && strcmp(async, "0") != 0) {
+        if (log_async_start(getenv("PACRF_LOG_FILE"), 0) == 0) {
+            atexit(log_async_stop);
+        }
+    }
+}
+
+static const char *const k_level_prefix[] = {
+    "[DEBUG] ", "[INFO] ", "[WARNING] ", "[ERROR] "
+};
+
+// ============================================================================
+// Async Backend: Binary Records
+// ----------------------------------------------------------------------------
+// In async mode a log_* call does NOT format. It walks the format string
+// once, copies the raw arguments (and any %s text, since the caller's
+// buffer may not outlive the call) into a fixed-size record, and pushes
+// that into a bounded lock-free MPSC ring (Vyukov sequence-per-cell).
+// A background thread pops records, formats them and writes whole
+// batches to stdout or a file. When the ring is full the message is
+// dropped and counted; producers never block on terminal I/O.
+// ============================================================================
+
+#define LOG_ASYNC_MAX_ARGS        8     // conversions captured per message
+#define LOG_ASYNC_STR_BYTES       160   // inline storage for %s arguments
+#define LOG_ASYNC_DEFAULT_CAP     4096  // records (rounded to a power of two)
+#define LOG_ASYNC_BATCH_BYTES     (64 * 1024)
+#define LOG_ASYNC_IDLE_NS         (2 * 1000 * 1000)  // consumer poll when empty
+
+typedef union {
+    long long          i;
+    unsigned long long u;
+    double             d;
+    const void        *p;
+} LogArg;
+
+typedef struct {
+    size_t      seq;          // ring sequence (Vyukov)
+    const char *fmt;          // NULL → `text` holds a preformatted message
+    uint64_t    ts_ns;        // CLOCK_REALTIME at the call site
+    uint8_t     level;
+    uint8_t     nargs;
+    uint16_t    text_len;     // bytes used in `text`
+    LogArg      args[LOG_ASYNC_MAX_ARGS];
+    char        text[LOG_ASYNC_STR_BYTES];
+} LogRecord;
+
+typedef struct {
+    LogRecord *cells;
+    size_t     mask;
+
+    PACRF_CACHE_ALIGNED size_t enqueue_pos;   // shared by producers
+    PACRF_CACHE_ALIGNED size_t dequeue_pos;   // owned by the consumer
+    PACRF_CACHE_ALIGNED size_t dropped;       // ring-full drops
+    size_t     inflight;                      // producers currently writing
+
+    FILE      *sink;
+    int        owns_sink;
+    int        accepting;   // producers may enqueue
+    int        running;     // writer thread keeps polling
+    pthread_t  thread;
+} LogAsync;
+
+static LogAsync  g_async_state;
+static LogAsync *g_async = NULL;   // non-NULL while async mode is active
+
+// Conversion spec parsed from a format string
+typedef struct {
+    const char *start;   // points at '%'
+    const char *end;     // one past the conversion character
+    char        conv;
+    int         lmod;    // 0 none, 1 hh, 2 h, 3 l, 4 ll, 5 z, 6 j, 7 t, 8 L
+    int         star_width;
+    int         star_prec;
+} LogSpec;
+
+static const char *log_parse_spec(const char *p, LogSpec *sp) {
+    sp->start = p++;
+    sp->star_width = sp->star_prec = 0;
+    sp->lmod = 0;
+
+    while (*p && strchr("-+ #0'", *p)) p++;
+    if (*p == '*') { sp->star_width = 1; p++; }
+    else while (*p >= '0' && *p <= '9') p++;
+    if (*p == '.') {
+        p++;
+        if (*p == '*') { sp->star_prec = 1; p++; }
+        else while (*p >= '0' && *p <= '9') p++;
+    }
+
+    switch (*p) {
+        case 'h': p++; if (*p == 'h') { sp->lmod = 1; p++; } else sp->lmod = 2; break;
+        case 'l': p++; if (*p == 'l') { sp->lmod = 4; p++; } else sp->lmod = 3; break;
+        case 'z': sp->lmod = 5; p++; break;
+        case 'j': sp->lmod = 6; p++; break;
+        case 't': sp->lmod = 7; p++; break;
+        case 'L': sp->lmod = 8; p++; break;
+        default: break;
+    }
+
+    sp->conv = *p;
+    sp->end  = *p ? p + 1 : p;
+    return sp->end;
+}
+
+// Captures the arguments for `fmt` into `r`. Returns 0 if the format uses
+// something the record cannot hold (then the caller preformats instead).
+static int log_capture_args(LogRecord *r, const char *fmt, va_list ap) {
+    int n = 0;
+    size_t used = 0;
+
+    for (const char *p = fmt; *p; ) {
+        if (*p != '%') { p++; continue; }
+        if (p[1] == '%') { p += 2; continue; }
+
+        LogSpec sp;
+        p = log_parse_spec(p, &sp);
+
+        int need = 1 + sp.star_width + sp.star_prec;
+        if (n + need > LOG_ASYNC_MAX_ARGS) return 0;
+        if (sp.star_width) r->args[n++].i = va_arg(ap, int);
+        if (sp.star_prec)  r->args[n++].i = va_arg(ap, int);
+
+        // %lc / %ls are wide: preformat them like any other conversion we
+        // cannot store as a plain scalar
+        if ((sp.conv == 'c' || sp.conv == 's') && sp.lmod) return 0;
+
+        switch (sp.conv) {
+            case 'd': case 'i':
+                switch (sp.lmod) {
+                    case 1:  r->args[n].i = (signed char)va_arg(ap, int);  break;
+                    case 2:  r->args[n].i = (short)va_arg(ap, int);        break;
+                    case 3:  r->args[n].i = va_arg(ap, long);      break;
+                    case 4:  r->args[n].i = va_arg(ap, long long); break;
+                    case 5:  r->args[n].i = (long long)va_arg(ap, size_t);    break;
+                    case 6:  r->args[n].i = (long long)va_arg(ap, intmax_t);  break;
+                    case 7:  r->args[n].i = (long long)va_arg(ap, ptrdiff_t); break;
+                    default: r->args[n].i = va_arg(ap, int);       break;
+                }
+                break;
+            case 'u': case 'o': case 'x': case 'X': case 'c':
+                switch (sp.lmod) {
+                    case 1:  r->args[n].u = (unsigned char)va_arg(ap, unsigned int);  break;
+                    case 2:  r->args[n].u = (unsigned short)va_arg(ap, unsigned int); break;
+                    case 3:  r->args[n].u = va_arg(ap, unsigned long);      break;
+                    case 4:  r->args[n].u = va_arg(ap, unsigned long long); break;
+                    case 5:  r->args[n].u = va_arg(ap, size_t);             break;
+                    case 6:  r->args[n].u = (unsigned long long)va_arg(ap, uintmax_t); break;
+                    case 7:  r->args[n].u = (unsigned long long)va_arg(ap, ptrdiff_t); break;
+                    default: r->args[n].u = va_arg(ap, unsigned int);       break;
+                }
+                break;
+            case 'f': case 'F': case 'e': case 'E':
+            case 'g': case 'G': case 'a': case 'A':
+                r->args[n].d = (sp.lmod == 8) ? (double)va_arg(ap, long double)
+                                              : va_arg(ap, double);
+                break;
+            case 'p':
+                r->args[n].p = va_arg(ap, void *);
+                break;
+            case 's': {
+                const char *str = va_arg(ap, const char *);
+                if (!str) str = "(null)";
+                // An earlier string filled text[]: preformat the record instead
+                if (used >= sizeof(r->text)) return 0;
+                size_t len  = strlen(str);
+                size_t room = sizeof(r->text) - used - 1;
+                if (len > room) len = room;      // truncate rather than dangle
+                memcpy(r->text + used, str, len);
+                r->text[used + len] = '\0';
+                r->args[n].u = used;
+                used += len + 1;
+                break;
+            }
+            default:
+                return 0;   // %n, %ls, wide chars, ... → preformat
+        }
+        n++;
+    }
+
+    r->nargs    = (uint8_t)n;
+    r->text_len = (uint16_t)used;
+    return 1;
+}
+
+// Formats a captured record into `out` (consumer side). Returns bytes written.
+static size_t log_render_record(const LogRecord *r, char *out, size_t outsz) {
+    size_t len = 0;
+#define LOG_PUT(fn_call) do { \
+        int w_ = (fn_call); \
+        if (w_ > 0) len += ((size_t)w_ < outsz - len) ? (size_t)w_ : outsz - len - 1; \
+    } while (0)
+
+    LOG_PUT(snprintf(out + len, outsz - len, "%s", k_level_prefix[r->level]));
+
+    if (!r->fmt) {
+        LOG_PUT(snprintf(out + len, outsz - len, "%.*s", (int)r->text_len, r->text));
+        return len;
+    }
+
+    int a = 0;
+    for (const char *p = r->fmt; *p && len + 1 < outsz; ) {
+        if (*p != '%') { out[len++] = *p++; continue; }
+        if (p[1] == '%') { out[len++] = '%'; p += 2; continue; }
+
+        LogSpec sp;
+        p = log_parse_spec(p, &sp);
+
+        // Rebuild the spec with '*' resolved and a normalized length modifier
+        char spec[48];
+        size_t sl = 0;
+        int width = sp.star_width ? (int)r->args[a++].i : 0;
+        int prec  = sp.star_prec  ? (int)r->args[a++].i : 0;
+        for (const char *q = sp.start; q < sp.end - 1 && sl < sizeof(spec) - 24; q++) {
+            if (*q == '*') {
+                sl += (size_t)snprintf(spec + sl, sizeof(spec) - sl, "%d",
+                                       (q > sp.start && q[-1] == '.') ? prec : width);
+            } else if (!strchr("hlzjtL", *q)) {
+                spec[sl++] = *q;
+            }
+        }
+
+        const LogArg *v = &r->args[a++];
+        switch (sp.conv) {
+            case 'd': case 'i':
+                spec[sl++] = 'l'; spec[sl++] = 'l'; spec[sl++] = sp.conv; spec[sl] = '\0';
+                LOG_PUT(snprintf(out + len, outsz - len, spec, v->i));
+                break;
+            case 'u': case 'o': case 'x': case 'X':
+                spec[sl++] = 'l'; spec[sl++] = 'l'; spec[sl++] = sp.conv; spec[sl] = '\0';
+                LOG_PUT(snprintf(out + len, outsz - len, spec, v->u));
+                break;
+            case 'c':
+                spec[sl++] = 'c'; spec[sl] = '\0';
+                LOG_PUT(snprintf(out + len, outsz - len, spec, (int)v->u));
+                break;
+            case 'p':
+                spec[sl++] = 'p'; spec[sl] = '\0';
+                LOG_PUT(snprintf(out + len, outsz - len, spec, v->p));
+                break;
+            case 's':
+                spec[sl++] = 's'; spec[sl] = '\0';
+                LOG_PUT(snprintf(out + len, outsz - len, spec, r->text + v->u));
+                break;
+            default:
+                spec[sl++] = sp.conv; spec[sl] = '\0';
+                LOG_PUT(snprintf(out + len, outsz - len, spec, v->d));
+                break;
+        }
+    }
+#undef LOG_PUT
+    out[len] = '\0';
+    return len;
+}
+
+// Producer side: returns 1 if the message went to the ring (or was dropped
+// because it was full), 0 if async mode is off and the caller must print.
+static int log_async_submit(int level, const char *fmt, va_list args) {
+    LogAsync *as = pacrf_load_acquire(&g_async);
+    if (!as) return 0;
+
+    pacrf_fetch_add(&as->inflight, 1);
+    pacrf_fence_seq_cst();                       // pairs with log_async_stop()
+    if (!pacrf_load_acquire(&as->accepting)) {
+        pacrf_fetch_sub(&as->inflight, 1);
+        return 0;
+    }
+
+    LogRecord *cell;
+    size_t pos = pacrf_load_relaxed(&as->enqueue_pos);
+    for (;;) {
+        cell = &as->cells[pos & as->mask];
+        size_t seq = pacrf_load_acquire(&cell->seq);
+        intptr_t dif = (intptr_t)seq - (intptr_t)pos;
+        if (dif == 0) {
+            if (pacrf_cas_weak(&as->enqueue_pos, &pos, pos + 1)) break;
+        } else if (dif < 0) {
+            pacrf_fetch_add(&as->dropped, 1);    // ring full: drop, never block
+            pacrf_fetch_sub(&as->inflight, 1);
+            return 1;
+        } else {
+            pos = pacrf_load_relaxed(&as->enqueue_pos);
+        }
+    }
+
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    cell->ts_ns = (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+    cell->level = (uint8_t)level;
+    cell->fmt   = fmt;
+
+    va_list cap;
+    va_copy(cap, args);
+    int ok = log_capture_args(cell, fmt, cap);
+    va_end(cap);
+    if (!ok) {
+        // Unsupported conversions: fall back to formatting on this thread
+        int w = vsnprintf(cell->text, sizeof(cell->text), fmt, args);
+        cell->fmt = NULL;
+        cell->text_len = (uint16_t)((w < 0) ? 0 : (w >= (int)sizeof(cell->text)
+                                                   ? (int)sizeof(cell->text) - 1 : w));
+    }
+
+    pacrf_store_release(&cell->seq, pos + 1);
+    pacrf_fetch_sub(&as->inflight, 1);
+    return 1;
+}
+
+// Consumer side: drains everything currently published. Returns records written.
+static size_t log_async_drain(LogAsync *as, char *batch, size_t batchsz) {
+    size_t written = 0, blen = 0;
+    char line[512];
+
+    for (;;) {
+        LogRecord *cell = &as->cells[as->dequeue_pos & as->mask];
+        size_t seq = pacrf_load_acquire(&cell->seq);
+        if (seq != as->dequeue_pos + 1) break;
+
+        size_t n = 0;
+        if (as->owns_sink) {
+            // File sinks get a timestamp; stdout keeps the GUI's line format
+            time_t sec = (time_t)(cell->ts_ns / 1000000000ull);
+            struct tm tmv;
+            localtime_r(&sec, &tmv);
+            n = strftime(line, sizeof(line), "%Y-%m-%d %H:%M:%S", &tmv);
+            n += (size_t)snprintf(line + n, sizeof(line) - n, ".%06u ",
+                                  (unsigned)((cell->ts_ns / 1000u) % 1000000u));
+        }
+        n += log_render_record(cell, line + n, sizeof(line) - n - 1);
+        line[n++] = '\n';
+
+        pacrf_store_release(&cell->seq, as->dequeue_pos + as->mask + 1);
+        pacrf_store_release(&as->dequeue_pos, as->dequeue_pos + 1);   // read by log_async_flush
+
+        if (blen + n > batchsz) { fwrite(batch, 1, blen, as->sink); blen = 0; }
+        memcpy(batch + blen, line, n);
+        blen += n;
+        written++;
+    }
+
+    size_t dropped = pacrf_exchange(&as->dropped, (size_t)0);
+    if (dropped) {
+        int w = snprintf(line, sizeof(line), "%sasync logger dropped %zu messages (ring full)\n",
+                         k_level_prefix[LOG_LEVEL_WARNING], dropped);
+        if (blen + (size_t)w > batchsz) { fwrite(batch, 1, blen, as->sink); blen = 0; }
+        memcpy(batch + blen, line, (size_t)w);
+        blen += (size_t)w;
+    }
+
+    if (blen) {
+        fwrite(batch, 1, blen, as->sink);
+        fflush(as->sink);
+    }
+    return written;
+}
+
+static void *log_async_thread(void *arg) {
+    LogAsync *as = (LogAsync *)arg;
+    char *batch = (char *)malloc(LOG_ASYNC_BATCH_BYTES);
+    if (!batch) return NULL;
+
+    const struct timespec idle = { 0, LOG_ASYNC_IDLE_NS };
+    while (pacrf_load_acquire(&as->running)) {
+        if (log_async_drain(as, batch, LOG_ASYNC_BATCH_BYTES) == 0) {
+            nanosleep(&idle, NULL);
+        }
+    }
+    log_async_drain(as, batch, LOG_ASYNC_BATCH_BYTES);   // final flush
+    free(batch);
+    return NULL;
+}
+
+// ============================================================================
+// Async Backend: Control
+// ============================================================================
+int log_async_start(const char *path, size_t capacity) {
+    if (pacrf_load_acquire(&g_async)) return 0;   // already running
+
+    if (capacity == 0) capacity = LOG_ASYNC_DEFAULT_CAP;
+    size_t cap = 1;
+    while (cap < capacity) cap <<= 1;
+
+    LogAsync *as = &g_async_state;
+    memset(as, 0, sizeof(*as));
+    as->cells = (LogRecord *)calloc(cap, sizeof(LogRecord));
+    if (!as->cells) return -1;
+    for (size_t i = 0; i < cap; i++) as->cells[i].seq = i;
+    as->mask = cap - 1;
+
+    as->sink = stdout;
+    if (path && *path) {
+        as->sink = fopen(path, "a");
+        if (!as->sink) {
+            free(as->cells);
+            as->cells = NULL;
+            log_error("Async logger: cannot open %s", path);
+            return -1;
+        }
+        as->owns_sink = 1;
+    }
+
+    as->accepting = 1;
+    as->running   = 1;
+    if (pthread_create(&as->thread, NULL, log_async_thread, as) != 0) {
+        if (as->owns_sink) fclose(as->sink);
+        free(as->cells);
+        as->cells = NULL;
+        return -1;
+    }
+
+    fflush(stdout);                      // keep earlier sync output in order
+    pacrf_store_release(&g_async, as);
+    return 0;
+}
+
+void log_async_flush(void) {
+    LogAsync *as = pacrf_load_acquire(&g_async);
+    if (!as) { fflush(stdout); return; }
+
+    const struct timespec tick = { 0, 500 * 1000 };
+    size_t target = pacrf_load_acquire(&as->enqueue_pos);
+    while (pacrf_load_acquire(&as->running) &&
+           (intptr_t)(target - pacrf_load_acquire(&as->dequeue_pos)) > 0) {
+        nanosleep(&tick, NULL);
+    }
+}
+
+void log_async_stop(void) {
+    LogAsync *as = pacrf_load_acquire(&g_async);
+    if (!as) return;
+
+    // New calls go synchronous; wait out producers already inside the ring
+    pacrf_store_release(&g_async, (LogAsync *)NULL);
+    pacrf_store_release(&as->accepting, 0);
+    pacrf_fence_seq_cst();
+    while (pacrf_load_acquire(&as->inflight) != 0) pacrf_cpu_relax();
+
+    pacrf_store_release(&as->running, 0);
+    pthread_join(as->thread, NULL);      // thread drains before exiting
+    if (as->owns_sink) fclose(as->sink);
+    free(as->cells);
+    as->cells = NULL;
+}
+
+int log_async_active(void) {
+    return pacrf_load_acquire(&g_async) != NULL;
+}
 
 // ============================================================================
 // Internal Helper: Variadic Logger
 // ----------------------------------------------------------------------------
 // Handles printf-style formatting for all logger functions. Takes a format
 // string and a variable argument list, prefixes the message with a tag,
-// and prints it to stdout.
+// and prints it to stdout (or hands it to the async ring when enabled).
 // ============================================================================
 
-static void log_message(const char *prefix, const char *fmt, va_list args) {
-    printf("%s", prefix);      // Print the log level prefix
-    vprintf(fmt, args);        // Print the formatted message
-    printf("\n");              // Add a newline for cleanliness
+static void log_message(int level, const char *fmt, va_list args) {
+    if (log_async_submit(level, fmt, args)) return;
+
+    printf("%s", k_level_prefix[level]);  // Print the log level prefix
+    vprintf(fmt, args);                   // Print the formatted message
+    printf("\n");                         // Add a newline for cleanliness
+}
+
+// The public names are also macros (see logger.h); the parentheses below
+// define the real functions behind them. Each one re-checks the level so
+// direct calls (e.g. through a function pointer) are filtered too.
+
+// ============================================================================
+// Debug Logger
+// ----------------------------------------------------------------------------
+// Used for per-operation tracing on hot paths (enqueue, bit reads, ...).
+// Example: log_debug("Read %zu bits", num_bits);
+// ============================================================================
+void (log_debug)(const char *fmt, ...) {
+    if (!LOG_ENABLED(LOG_LEVEL_DEBUG)) return;
+    va_list args;
+    va_start(args, fmt);
+    log_message(LOG_LEVEL_DEBUG, fmt, args);
+    va_end(args);
 }
 
 // ============================================================================
@@ -20,10 +534,11 @@ static void log_message(const char *prefix, const char *fmt, va_list args) {
 // Used for normal operation messages and general logs.
 // Example: log_info("Processed %d packets", packet_count);
 // ============================================================================
-void log_info(const char *fmt, ...) {
+void (log_info)(const char *fmt, ...) {
+    if (!LOG_ENABLED(LOG_LEVEL_INFO)) return;
     va_list args;
     va_start(args, fmt);
-    log_message("[INFO] ", fmt, args);
+    log_message(LOG_LEVEL_INFO, fmt, args);
     va_end(args);
 }
 
@@ -33,10 +548,11 @@ void log_info(const char *fmt, ...) {
 // Used for potential issues or abnormal conditions that are not fatal.
 // Example: log_warning("Buffer is %d%% full", buffer_usage);
 // ============================================================================
-void log_warning(const char *fmt, ...) {
+void (log_warning)(const char *fmt, ...) {
+    if (!LOG_ENABLED(LOG_LEVEL_WARNING)) return;
     va_list args;
     va_start(args, fmt);
-    log_message("[WARNING] ", fmt, args);
+    log_message(LOG_LEVEL_WARNING, fmt, args);
     va_end(args);
 }
 
@@ -46,10 +562,11 @@ void log_warning(const char *fmt, ...) {
 // Used for serious problems or errors that may halt execution.
 // Example: log_error("Failed to open file: %s", filename);
 // ============================================================================
-void log_error(const char *fmt, ...) {
+void (log_error)(const char *fmt, ...) {
+    if (!LOG_ENABLED(LOG_LEVEL_ERROR)) return;
     va_list args;
     va_start(args, fmt);
-    log_message("[ERROR] ", fmt, args);
+    log_message(LOG_LEVEL_ERROR, fmt, args);
     va_end(args);
 }
 
@@ -0,0 +1,375 @@
+#include <stdio.h>
+#include <stdlib.h>     // For getenv, posix_memalign
+#include <string.h>     // For memset
+#include <pthread.h>    // For the large-mapping table lock
+#include <sys/mman.h>   // For mmap, madvise
+#include <unistd.h>     // For sysconf
+#include "mempool.h"
+#include "config.h"
+#include "logger.h"
+
+#define MEMPOOL_HUGE_PAGE   (2u * 1024u * 1024u)   // MAP_HUGETLB granule tried
+#define MEMPOOL_MAX_MAPS    64                     // live large mappings tracked
+
+// ============================================================
+// Region Mapping
+// ------------------------------------------------------------
+// Huge pages first (only when the size warrants it and the
+// system has them reserved), then normal pages with a THP hint.
+// PACRF_HUGEPAGES=0 skips the MAP_HUGETLB attempt.
+// ============================================================
+static size_t mem_round_up(size_t n, size_t granule) {
+    return (n + granule - 1) / granule * granule;
+}
+
+static size_t mem_page_size(void) {
+    long ps = sysconf(_SC_PAGESIZE);
+    return ps > 0 ? (size_t)ps : 4096;
+}
+
+static bool mem_huge_allowed(void) {
+    const char *v = getenv("PACRF_HUGEPAGES");
+    return !(v && strcmp(v, "0") == 0);
+}
+
+static void *mem_map_region(size_t bytes, size_t *map_bytes, bool *huge) {
+    *huge = false;
+#ifdef MAP_HUGETLB
+    if (bytes >= MEMPOOL_HUGE_PAGE && mem_huge_allowed()) {
+        size_t hb = mem_round_up(bytes, MEMPOOL_HUGE_PAGE);
+        void *p = mmap(NULL, hb, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (p != MAP_FAILED) {
+            *huge = true;
+            *map_bytes = hb;
+            return p;
+        }
+    }
+#endif
+    size_t pb = mem_round_up(bytes, mem_page_size());
+    void *p = mmap(NULL, pb, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED) return NULL;
+#ifdef MADV_HUGEPAGE
+    if (pb >= MEMPOOL_HUGE_PAGE) madvise(p, pb, MADV_HUGEPAGE);
+#endif
+    *map_bytes = pb;
+    return p;
+}
+
+// ============================================================
+// Buffer Pool
+// ------------------------------------------------------------
+// Treiber stack of block indices. The head carries a tag that
+// changes on every pop, so a block freed and re-allocated
+// between another thread's load and CAS cannot be mistaken for
+// the old head (ABA).
+// ============================================================
+bool buffer_pool_init(BufferPool *pool, size_t block_bytes, size_t blocks) {
+    if (!pool || block_bytes == 0 || blocks == 0 || blocks >= UINT32_MAX) return false;
+    memset(pool, 0, sizeof(*pool));
+
+    // Cache-line blocks; page-sized ones stay page aligned (O_DIRECT, USB)
+    block_bytes = mem_round_up(block_bytes, block_bytes >= 4096 ? 4096 : PACRF_CACHELINE);
+
+    pool->next = (uint32_t *)malloc(blocks * sizeof(uint32_t));
+    if (!pool->next) return false;
+
+    pool->base = (uint8_t *)mem_map_region(block_bytes * blocks, &pool->map_bytes, &pool->huge_pages);
+    if (!pool->base) {
+        free(pool->next);
+        pool->next = NULL;
+        return false;
+    }
+    pool->block_bytes = block_bytes;
+    pool->blocks = blocks;
+
+    for (size_t i = 0; i < blocks; i++) pool->next[i] = (i + 1 < blocks) ? (uint32_t)(i + 2) : 0;
+    pool->head = 1;   // tag 0, first block
+
+    log_info("Buffer pool initialized (%zu x %zu bytes%s).", blocks, block_bytes,
+             pool->huge_pages ? ", huge pages" : "");
+    return true;
+}
+
+void buffer_pool_destroy(BufferPool *pool) {
+    if (!pool || !pool->base) return;
+    munmap(pool->base, pool->map_bytes);
+    free(pool->next);
+    memset(pool, 0, sizeof(*pool));
+}
+
+bool buffer_pool_owns(const BufferPool *pool, const void *p) {
+    if (!pool || !pool->base || !p) return false;
+    const uint8_t *b = (const uint8_t *)p;
+    return b >= pool->base && b < pool->base + pool->block_bytes * pool->blocks;
+}
+
+void *buffer_pool_alloc(BufferPool *pool) {
+    if (!pool || !pool->base) return NULL;
+
+    uint64_t old = pacrf_load_acquire(&pool->head);
+    for (;;) {
+        uint32_t top = (uint32_t)old;
+        if (top == 0) {
+            pacrf_fetch_add(&pool->exhausted, 1);
+            return NULL;
+        }
+        uint64_t desired = (((old >> 32) + 1) << 32) | pacrf_load_relaxed(&pool->next[top - 1]);
+        if (pacrf_cas_weak(&pool->head, &old, desired)) {
+            size_t used = pacrf_fetch_add(&pool->in_use, 1) + 1;
+            size_t hwm = pacrf_load_relaxed(&pool->high_water);
+            while (used > hwm && !pacrf_cas_weak(&pool->high_water, &hwm, used)) { }
+            pacrf_fetch_add(&pool->allocs, 1);
+            return pool->base + (size_t)(top - 1) * pool->block_bytes;
+        }
+        pacrf_fence_acquire();   // see the links written by the competing push
+    }
+}
+
+void buffer_pool_free(BufferPool *pool, void *block) {
+    if (!buffer_pool_owns(pool, block)) return;
+    uint32_t idx = (uint32_t)(((uint8_t *)block - pool->base) / pool->block_bytes);
+
+    uint64_t old = pacrf_load_relaxed(&pool->head);
+    for (;;) {
+        pacrf_store_relaxed(&pool->next[idx], (uint32_t)old);
+        uint64_t desired = (old & 0xFFFFFFFF00000000ull) | (uint64_t)(idx + 1);
+        if (pacrf_cas_weak(&pool->head, &old, desired)) break;
+    }
+    pacrf_fetch_sub(&pool->in_use, 1);
+    pacrf_fetch_add(&pool->frees, 1);
+}
+
+void buffer_pool_get_stats(const BufferPool *pool, BufferPoolStats *out) {
+    if (!out) return;
+    memset(out, 0, sizeof(*out));
+    if (!pool) return;
+    out->block_bytes = pool->block_bytes;
+    out->blocks      = pool->blocks;
+    out->in_use      = pacrf_load_relaxed(&pool->in_use);
+    out->high_water  = pacrf_load_relaxed(&pool->high_water);
+    out->allocs      = pacrf_load_relaxed(&pool->allocs);
+    out->frees       = pacrf_load_relaxed(&pool->frees);
+    out->exhausted   = pacrf_load_relaxed(&pool->exhausted);
+    out->huge_pages  = pool->huge_pages;
+}
+
+// ============================================================
+// Arena
+// ============================================================
+bool arena_init(Arena *a, size_t capacity) {
+    if (!a || capacity == 0) return false;
+    memset(a, 0, sizeof(*a));
+    size_t mapped = 0;
+    a->base = (uint8_t *)mem_map_region(capacity, &mapped, &a->huge_pages);
+    if (!a->base) return false;
+    a->capacity = mapped;
+    return true;
+}
+
+void arena_destroy(Arena *a) {
+    if (!a || !a->base) return;
+    munmap(a->base, a->capacity);
+    memset(a, 0, sizeof(*a));
+}
+
+void *arena_alloc(Arena *a, size_t bytes, size_t align) {
+    if (!a || !a->base) return NULL;
+    if (align == 0) align = 16;
+    size_t off = (a->used + align - 1) & ~(align - 1);
+    if (off > a->capacity || bytes > a->capacity - off) {
+        a->failed++;
+        return NULL;
+    }
+    a->used = off + bytes;
+    if (a->used > a->peak) a->peak = a->used;
+    a->allocs++;
+    return a->base + off;
+}
+
+size_t arena_mark(const Arena *a) {
+    return a ? a->used : 0;
+}
+
+void arena_reset_to(Arena *a, size_t mark) {
+    if (a && mark <= a->used) a->used = mark;
+}
+
+void arena_reset(Arena *a) {
+    if (a) a->used = 0;
+}
+
+void arena_get_stats(const Arena *a, ArenaStats *out) {
+    if (!out) return;
+    memset(out, 0, sizeof(*out));
+    if (!a) return;
+    out->capacity   = a->capacity;
+    out->used       = a->used;
+    out->peak       = a->peak;
+    out->allocs     = a->allocs;
+    out->failed     = a->failed;
+    out->huge_pages = a->huge_pages;
+}
+
+// ============================================================
+// Process-Wide Pools
+// ============================================================
+typedef struct {
+    void  *ptr;
+    size_t len;
+} MemMapping;
+
+static BufferPool g_buffers;
+static Arena      g_arena;
+static bool       g_started;
+
+static pthread_mutex_t g_maps_lock = PTHREAD_MUTEX_INITIALIZER;
+static MemMapping      g_maps[MEMPOOL_MAX_MAPS];
+
+// Routing counters (where mempool_alloc calls were served)
+static uint64_t g_from_pool, g_from_map, g_from_heap;
+
+static size_t mem_env_size(const char *name, size_t def) {
+    const char *v = getenv(name);
+    if (!v || !*v) return def;
+    char *end = NULL;
+    unsigned long long x = strtoull(v, &end, 0);
+    return (end && *end == '\0') ? (size_t)x : def;
+}
+
+bool mempool_startup(void) {
+    if (g_started) return true;
+
+    size_t block  = mem_env_size("PACRF_POOL_BLOCK_BYTES", DEFAULT_POOL_BLOCK_BYTES);
+    size_t blocks = mem_env_size("PACRF_POOL_BLOCKS", DEFAULT_POOL_BLOCKS);
+    size_t arena  = mem_env_size("PACRF_ARENA_BYTES", DEFAULT_ARENA_BYTES);
+
+    // Zero disables a pool; callers then use the heap
+    bool ok = true;
+    if (block && blocks && !buffer_pool_init(&g_buffers, block, blocks)) {
+        log_warning("Buffer pool (%zu x %zu bytes) unavailable; using the heap.", blocks, block);
+        ok = false;
+    }
+    if (arena && !arena_init(&g_arena, arena)) {
+        log_warning("Scratch arena (%zu bytes) unavailable.", arena);
+        ok = false;
+    }
+    g_started = true;
+    return ok;
+}
+
+void mempool_shutdown(void) {
+    if (!g_started) return;
+    BufferPoolStats ps;
+    buffer_pool_get_stats(&g_buffers, &ps);
+    if (ps.in_use) log_warning("Buffer pool: %zu blocks still in use at shutdown.", ps.in_use);
+    buffer_pool_destroy(&g_buffers);
+    arena_destroy(&g_arena);
+    g_started = false;
+}
+
+BufferPool *mempool_buffers(void) {
+    return g_buffers.base ? &g_buffers : NULL;
+}
+
+Arena *mempool_arena(void) {
+    return g_arena.base ? &g_arena : NULL;
+}
+
+static bool mem_track_map(void *p, size_t len) {
+    bool ok = false;
+    pthread_mutex_lock(&g_maps_lock);
+    for (int i = 0; i < MEMPOOL_MAX_MAPS; i++) {
+        if (!g_maps[i].ptr) {
+            g_maps[i].ptr = p;
+            g_maps[i].len = len;
+            ok = true;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&g_maps_lock);
+    return ok;
+}
+
+static size_t mem_untrack_map(void *p) {
+    size_t len = 0;
+    pthread_mutex_lock(&g_maps_lock);
+    for (int i = 0; i < MEMPOOL_MAX_MAPS; i++) {
+        if (g_maps[i].ptr == p) {
+            len = g_maps[i].len;
+            g_maps[i].ptr = NULL;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&g_maps_lock);
+    return len;
+}
+
+void *mempool_alloc(size_t bytes) {
+    if (bytes == 0) return NULL;
+
+    BufferPool *pool = mempool_buffers();
+    if (pool && bytes <= pool->block_bytes) {
+        void *p = buffer_pool_alloc(pool);
+        if (p) {
+            pacrf_fetch_add(&g_from_pool, 1);
+            return p;
+        }
+    }
+
+    if (bytes >= MEMPOOL_MAP_THRESHOLD) {
+        size_t len = 0;
+        bool huge = false;
+        void *p = mem_map_region(bytes, &len, &huge);
+        if (p && mem_track_map(p, len)) {
+            pacrf_fetch_add(&g_from_map, 1);
+            return p;
+        }
+        if (p) munmap(p, len);
+    }
+
+    void *p = NULL;
+    if (posix_memalign(&p, bytes >= 4096 ? 4096 : PACRF_CACHELINE, bytes) != 0) return NULL;
+    pacrf_fetch_add(&g_from_heap, 1);
+    return p;
+}
+
+void mempool_free(void *p, size_t bytes) {
+    if (!p) return;
+    BufferPool *pool = mempool_buffers();
+    if (buffer_pool_owns(pool, p)) {
+        buffer_pool_free(pool, p);
+        return;
+    }
+    if (bytes >= MEMPOOL_MAP_THRESHOLD) {
+        size_t len = mem_untrack_map(p);
+        if (len) {
+            munmap(p, len);
+            return;
+        }
+    }
+    free(p);
+}
+
+void *mempool_scratch(size_t bytes) {
+    return arena_alloc(mempool_arena(), bytes, PACRF_CACHELINE);
+}
+
+void mempool_log_stats(void) {
+    BufferPoolStats ps;
+    ArenaStats as;
+    buffer_pool_get_stats(mempool_buffers(), &ps);
+    arena_get_stats(mempool_arena(), &as);
+
+    log_info("Pool Status -> Blocks: %zu / %zu x %zu B | HWM: %zu | Allocs: %llu | Exhausted: %llu%s",
+             ps.in_use, ps.blocks, ps.block_bytes, ps.high_water,
+             (unsigned long long)ps.allocs, (unsigned long long)ps.exhausted,
+             ps.huge_pages ? " | huge pages" : "");
+    log_info("Arena Status -> Peak: %zu / %zu B | Allocs: %llu | Failed: %llu%s",
+             as.peak, as.capacity, (unsigned long long)as.allocs,
+             (unsigned long long)as.failed, as.huge_pages ? " | huge pages" : "");
+    log_info("Alloc routing -> pool: %llu | mapped: %llu | heap: %llu",
+             (unsigned long long)pacrf_load_relaxed(&g_from_pool),
+             (unsigned long long)pacrf_load_relaxed(&g_from_map),
+             (unsigned long long)pacrf_load_relaxed(&g_from_heap));
+}
@@ -0,0 +1,211 @@
+// src/common/metrics.c
+//
+// Per-thread metric shards, merged on read (see metrics.h)
+
+#include "metrics.h"
+#include "pacrf_atomic.h"
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+typedef struct MetricsShard {
+    uint64_t  counter[METRIC_COUNTERS];
+    Histogram *hist[METRIC_HISTOGRAMS];     // allocated on first record, then published
+    struct MetricsShard *next;              // immutable once pushed
+    int       in_use;                       // 0 once its thread exited
+} PACRF_CACHE_ALIGNED MetricsShard;
+
+static MetricsShard *g_shards;              // push-only list
+static uint64_t g_gauge[METRIC_GAUGES];
+static uint64_t g_gauge_max[METRIC_GAUGES];
+static int64_t  g_t0_ns;
+
+static __thread MetricsShard *t_shard;
+static pthread_key_t  metrics_key;
+static pthread_once_t metrics_once = PTHREAD_ONCE_INIT;
+
+static const char *const counter_names[METRIC_COUNTERS] = {
+    "stream_bytes", "stream_blocks", "stream_drops", "sink_errors",
+    "usb_bytes", "gps_uart_bytes",
+    "nmea_ok", "nmea_bad_checksum", "nmea_overflows",
+    "queue_drops", "queue_overwrites", "commands",
+};
+
+static const char *const gauge_names[METRIC_GAUGES] = {
+    "raw_queue_bytes", "sample_queue_bytes",
+};
+
+static const char *const histogram_names[METRIC_HISTOGRAMS] = {
+    "raw_queue", "unpack", "sample_queue", "sink", "stream_total", "command",
+};
+
+static int64_t metrics_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+// The exiting thread's counts stay; the shard waits for the next new thread
+static void metrics_thread_exit(void *arg) {
+    pacrf_store_release(&((MetricsShard *)arg)->in_use, 0);
+}
+
+static void metrics_init_once(void) {
+    pthread_key_create(&metrics_key, metrics_thread_exit);
+    g_t0_ns = metrics_now_ns();
+}
+
+// Slow path, once per thread: reuse a retired shard or push a new one
+static MetricsShard *metrics_shard_claim(void) {
+    pthread_once(&metrics_once, metrics_init_once);
+
+    MetricsShard *s;
+    for (s = pacrf_load_acquire(&g_shards); s; s = s->next) {
+        int idle = 0;
+        if (pacrf_load_relaxed(&s->in_use) == 0 && pacrf_cas_weak(&s->in_use, &idle, 1)) break;
+    }
+    if (!s) {
+        void *mem = NULL;
+        if (posix_memalign(&mem, PACRF_CACHELINE, sizeof(MetricsShard)) != 0) return NULL;
+        s = (MetricsShard *)mem;
+        memset(s, 0, sizeof(*s));
+        s->in_use = 1;
+        MetricsShard *head = pacrf_load_relaxed(&g_shards);
+        do {
+            s->next = head;
+        } while (!pacrf_cas_weak(&g_shards, &head, s));
+    }
+    pthread_setspecific(metrics_key, s);
+    t_shard = s;
+    return s;
+}
+
+static inline MetricsShard *metrics_shard(void) {
+    MetricsShard *s = t_shard;
+    return PACRF_LIKELY(s != NULL) ? s : metrics_shard_claim();
+}
+
+// ============================================================================
+// Updates
+// ============================================================================
+void metrics_add(MetricCounter id, uint64_t v) {
+    MetricsShard *s = metrics_shard();
+    if (!s) return;
+    pacrf_store_relaxed(&s->counter[id], s->counter[id] + v);   // single writer
+}
+
+void metrics_record(MetricHistogram id, uint64_t ns) {
+    MetricsShard *s = metrics_shard();
+    if (!s) return;
+    Histogram *h = s->hist[id];
+    if (PACRF_UNLIKELY(!h)) {
+        h = (Histogram *)malloc(sizeof(*h));
+        if (!h) return;
+        histogram_init(h);
+        pacrf_store_release(&s->hist[id], h);
+    }
+    histogram_record(h, ns);
+}
+
+void metrics_gauge_set(MetricGauge id, uint64_t v) {
+    pacrf_store_relaxed(&g_gauge[id], v);
+    uint64_t max = pacrf_load_relaxed(&g_gauge_max[id]);
+    while (v > max && !pacrf_cas_weak(&g_gauge_max[id], &max, v)) { }
+}
+
+// ============================================================================
+// Snapshot
+// ============================================================================
+void metrics_snapshot(MetricsSnapshot *out) {
+    if (!out) return;
+    memset(out, 0, sizeof(*out));
+    for (int i = 0; i < METRIC_HISTOGRAMS; i++) histogram_init(&out->hist[i]);
+
+    pthread_once(&metrics_once, metrics_init_once);
+    out->t_ns = metrics_now_ns() - g_t0_ns;
+
+    for (const MetricsShard *s = pacrf_load_acquire(&g_shards); s; s = s->next) {
+        out->threads++;
+        for (int i = 0; i < METRIC_COUNTERS; i++) out->counter[i] += pacrf_load_relaxed(&s->counter[i]);
+        for (int i = 0; i < METRIC_HISTOGRAMS; i++) {
+            const Histogram *h = pacrf_load_acquire(&s->hist[i]);
+            if (h) histogram_merge(&out->hist[i], h);
+        }
+    }
+    for (int i = 0; i < METRIC_GAUGES; i++) {
+        out->gauge[i] = pacrf_load_relaxed(&g_gauge[i]);
+        out->gauge_max[i] = pacrf_load_relaxed(&g_gauge_max[i]);
+    }
+}
+
+const char *metrics_counter_name(MetricCounter id) {
+    return ((unsigned)id < METRIC_COUNTERS) ? counter_names[id] : "?";
+}
+
+const char *metrics_gauge_name(MetricGauge id) {
+    return ((unsigned)id < METRIC_GAUGES) ? gauge_names[id] : "?";
+}
+
+const char *metrics_histogram_name(MetricHistogram id) {
+    return ((unsigned)id < METRIC_HISTOGRAMS) ? histogram_names[id] : "?";
+}
+
+// ============================================================================
+// METRICS: line
+// ============================================================================
+static size_t metrics_append(char *buf, size_t cap, size_t pos, const char *fmt, ...)
+    __attribute__((format(printf, 4, 5)));
+
+static size_t metrics_append(char *buf, size_t cap, size_t pos, const char *fmt, ...) {
+    if (pos >= cap) return pos;
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(buf + pos, cap - pos, fmt, ap);
+    va_end(ap);
+    if (n < 0) return pos;
+    return (pos + (size_t)n < cap) ? pos + (size_t)n : cap - 1;
+}
+
+size_t metrics_format(const MetricsSnapshot *s, char *buf, size_t cap) {
+    if (!s || !buf || cap == 0) return 0;
+    size_t pos = metrics_append(buf, cap, 0, "METRICS: t=%.1f threads=%u", (double)s->t_ns / 1e9, s->threads);
+
+    for (int i = 0; i < METRIC_COUNTERS; i++) {
+        pos = metrics_append(buf, cap, pos, " %s=%llu", counter_names[i], (unsigned long long)s->counter[i]);
+    }
+    for (int i = 0; i < METRIC_GAUGES; i++) {
+        pos = metrics_append(buf, cap, pos, " %s=%llu/%llu", gauge_names[i],
+                             (unsigned long long)s->gauge[i], (unsigned long long)s->gauge_max[i]);
+    }
+    // Histograms only once they hold something: lat_<name>_us=p50/p99/p999/max/n
+    for (int i = 0; i < METRIC_HISTOGRAMS; i++) {
+        const Histogram *h = &s->hist[i];
+        if (h->count == 0) continue;
+        pos = metrics_append(buf, cap, pos, " lat_%s_us=%.1f/%.1f/%.1f/%.1f/%llu", histogram_names[i],
+                             histogram_percentile(h, 50.0) / 1e3, histogram_percentile(h, 99.0) / 1e3,
+                             histogram_percentile(h, 99.9) / 1e3, h->max / 1e3,
+                             (unsigned long long)h->count);
+    }
+    return metrics_append(buf, cap, pos, "\n");
+}
+
+int metrics_print(FILE *out) {
+    MetricsSnapshot *s = (MetricsSnapshot *)malloc(sizeof(*s));
+    if (!s) return -1;
+    char line[2048];
+    metrics_snapshot(s);
+    metrics_format(s, line, sizeof(line));
+    free(s);
+    fputs(line, out);
+    fflush(out);
+    return 0;
+}
+
+long metrics_interval_ms(void) {
+    const char *env = getenv("PACRF_METRICS_MS");
+    if (!env || !*env) return 1000;
+    long ms = atol(env);
+    return ms > 0 ? ms : 0;
+}
@@ -1,7 +1,16 @@
 #include "nmea.h"
+#include "metrics.h"
 #include <string.h>
-#include <stdlib.h>
-#include <ctype.h>
+
+// ============================================================================
+// Framing
+// ----------------------------------------------------------------------------
+// One byte at a time: '$' opens a sentence, body bytes are XOR-folded and
+// ',' records the next field offset, '*' closes the last field, and the two
+// hex digits that follow complete it. Nothing is copied or rescanned.
+// ============================================================================
+enum { SCAN_IDLE = 0, SCAN_BODY, SCAN_CS_HI, SCAN_CS_LO };
+enum { SCAN_MORE = 0, SCAN_OK, SCAN_BAD, SCAN_OVERFLOW };
 
 static unsigned char hex2uc(char c){
     if(c>='0'&&c<='9')return (unsigned char)(c-'0');
@@ -10,58 +19,317 @@ static unsigned char hex2uc(char c){
     return 0xFF;
 }
 
-static int checksum_ok(const char *line){
-    if(!line||*line!='$')return 0;
-    unsigned char cs=0; const char *p=line+1;
-    while(*p&&*p!='*'){ cs^=(unsigned char)(*p); p++; }
-    if(*p!='*') return 0;
-    unsigned char hi=hex2uc(*(p+1)), lo=hex2uc(*(p+2));
-    if(hi==0xFF||lo==0xFF) return 0;
-    return cs==((hi<<4)|lo);
+static inline int nmea_scan_byte(nmea_scan_t *sc, char c){
+    if(c=='$'){
+        sc->state=SCAN_BODY; sc->cs=0; sc->len=1;
+        sc->nfields=1; sc->field_off[0]=1;
+        return SCAN_MORE;
+    }
+
+    switch(sc->state){
+        case SCAN_BODY:
+            if(c=='*'){
+                sc->field_off[sc->nfields]=(uint16_t)(sc->len+1);  // end sentinel
+                sc->len++; sc->state=SCAN_CS_HI;
+                return SCAN_MORE;
+            }
+            if(c=='\r'||c=='\n'){ sc->state=SCAN_IDLE; return SCAN_BAD; }  // no checksum
+            if(sc->len>=NMEA_MAX_SENTENCE-3){ sc->state=SCAN_IDLE; return SCAN_OVERFLOW; }
+            sc->cs^=(unsigned char)c;
+            if(c==','&&sc->nfields<NMEA_MAX_FIELDS) sc->field_off[sc->nfields++]=(uint16_t)(sc->len+1);
+            sc->len++;
+            return SCAN_MORE;
+
+        case SCAN_CS_HI: {
+            unsigned char h=hex2uc(c);
+            if(h==0xFF){ sc->state=SCAN_IDLE; return SCAN_BAD; }
+            sc->cs_rx=(uint8_t)(h<<4); sc->len++; sc->state=SCAN_CS_LO;
+            return SCAN_MORE;
+        }
+
+        case SCAN_CS_LO: {
+            unsigned char l=hex2uc(c);
+            sc->state=SCAN_IDLE;
+            if(l==0xFF) return SCAN_BAD;
+            sc->len++;
+            return ((sc->cs_rx|l)==sc->cs)?SCAN_OK:SCAN_BAD;
+        }
+
+        default:
+            return SCAN_MORE;   // between sentences
+    }
+}
+
+// ============================================================================
+// Field access (spans into the sentence, never NUL-terminated)
+// ============================================================================
+typedef struct { const char *p; size_t n; } nmea_span_t;
+
+static nmea_span_t nmea_field(const char *base, const nmea_scan_t *sc, int i){
+    nmea_span_t f={base,0};
+    if(i<0||i>=sc->nfields) return f;
+    f.p=base+sc->field_off[i];
+    f.n=(size_t)(sc->field_off[i+1]-1-sc->field_off[i]);
+    return f;
 }
 
-static double nmea_deg_to_decimal(const char *ddmm,const char *hem){
-    if(!ddmm||!*ddmm) return 0.0;
-    const char *dot=strchr(ddmm,'.');
-    int deg_len=(int)((dot?dot:ddmm+strlen(ddmm))-ddmm)-2;
-    if(deg_len<=0||deg_len>3) return 0.0;
-    char d[4]={0}; strncpy(d,ddmm,(size_t)deg_len);
-    double deg=atof(d), min=atof(ddmm+deg_len);
-    double val=deg+(min/60.0);
-    if(hem&&(*hem=='S'||*hem=='W')) val=-val;
-    return val;
+static int nmea_span_int(nmea_span_t f){
+    int v=0;
+    for(size_t i=0;i<f.n&&f.p[i]>='0'&&f.p[i]<='9';i++) v=v*10+(f.p[i]-'0');
+    return v;
 }
 
-bool nmea_parse_line(const char *line, nmea_info_t *out){
-    if(!line||!out) return false;
-    if(!checksum_ok(line)) return false;
-
-    char buf[256]; strncpy(buf,line,sizeof(buf)-1); buf[sizeof(buf)-1]='\0';
-    char *p=buf; if(*p=='$') p++; char *star=strchr(p,'*'); if(star)*star='\0';
-
-    if(!strncmp(p,"GPGGA",5)||!strncmp(p,"GNGGA",5)){
-        char *f[16]={0}; int n=0;
-        for(char *t=strtok(p,","); t&&n<16; t=strtok(NULL,",")) f[n++]=t;
-        if(n>1 && f[1] && *f[1]){ strncpy(out->time_utc,f[1],sizeof(out->time_utc)-1); out->time_utc[15]='\0'; }
-        if(n>6 && f[6] && *f[6]){ out->fix_quality=atoi(f[6]); out->has_fix=(out->fix_quality>0); }
-        if(n>7 && f[7] && *f[7]) out->sats=atoi(f[7]);
-        if(n>5 && f[2]&&f[3]&&f[4]&&f[5]){
-            out->lat_deg=nmea_deg_to_decimal(f[2],f[3]);
-            out->lon_deg=nmea_deg_to_decimal(f[4],f[5]);
+static void nmea_span_copy(nmea_span_t f, char *dst, size_t cap){
+    size_t n=(f.n<cap-1)?f.n:cap-1;
+    memcpy(dst,f.p,n); dst[n]='\0';
+}
+
+// "ddmm.mmmm" / "dddmm.mmmm" + hemisphere → 1e-7 degrees, integer only
+static bool nmea_coord_e7(nmea_span_t f, nmea_span_t hem, int32_t *out){
+    uint32_t whole=0; size_t i=0, nd=0;
+    for(;i<f.n&&f.p[i]>='0'&&f.p[i]<='9';i++,nd++) whole=whole*10+(uint32_t)(f.p[i]-'0');
+    if(nd<3||nd>5) return false;
+
+    uint64_t frac=0; uint32_t scale=1;   // fractional minutes, up to 7 digits
+    if(i<f.n&&f.p[i]=='.'){
+        for(i++;i<f.n&&f.p[i]>='0'&&f.p[i]<='9';i++){
+            if(scale<10000000u){ frac=frac*10+(uint64_t)(f.p[i]-'0'); scale*=10; }
         }
-        return true;
     }
-    if(!strncmp(p,"GPRMC",5)||!strncmp(p,"GNRMC",5)){
-        char *f[16]={0}; int n=0;
-        for(char *t=strtok(p,","); t&&n<16; t=strtok(NULL,",")) f[n++]=t;
-        if(n>1 && f[1] && *f[1]){ strncpy(out->time_utc,f[1],sizeof(out->time_utc)-1); out->time_utc[15]='\0'; }
-        if(n>2 && f[2] && *f[2]){ if(*f[2]=='A') out->has_fix=true; } // A=valid, V=void
-        if(n>6 && f[3]&&f[4]&&f[5]&&f[6]){
-            out->lat_deg=nmea_deg_to_decimal(f[3],f[4]);
-            out->lon_deg=nmea_deg_to_decimal(f[5],f[6]);
+    if(i!=f.n) return false;
+
+    uint32_t deg=whole/100, min=whole%100;
+    if(min>=60||deg>180) return false;
+
+    uint64_t min_e7=(uint64_t)min*10000000u+frac*(10000000u/scale);
+    int64_t v=(int64_t)deg*10000000+(int64_t)((min_e7+30)/60);
+    if(hem.n&&(hem.p[0]=='S'||hem.p[0]=='W')) v=-v;
+    *out=(int32_t)v;
+    return true;
+}
+
+static void nmea_set_position(nmea_info_t *out, nmea_span_t lat, nmea_span_t ns,
+                              nmea_span_t lon, nmea_span_t ew){
+    int32_t la, lo;
+    if(!nmea_coord_e7(lat,ns,&la)||!nmea_coord_e7(lon,ew,&lo)) return;
+    out->lat_e7=la; out->lon_e7=lo;
+    out->lat_deg=la/1e7; out->lon_deg=lo/1e7;
+}
+
+// Decimal span ("1.25", "-3.5") → float; empty or malformed → `dflt`
+static float nmea_span_float(nmea_span_t f, float dflt){
+    size_t i=0; int neg=0;
+    if(i<f.n&&(f.p[i]=='-'||f.p[i]=='+')){ neg=(f.p[i]=='-'); i++; }
+    if(i>=f.n) return dflt;
+
+    uint32_t whole=0, frac=0, scale=1;
+    for(;i<f.n&&f.p[i]>='0'&&f.p[i]<='9';i++) whole=whole*10+(uint32_t)(f.p[i]-'0');
+    if(i<f.n&&f.p[i]=='.'){
+        for(i++;i<f.n&&f.p[i]>='0'&&f.p[i]<='9';i++){
+            if(scale<1000000u){ frac=frac*10+(uint32_t)(f.p[i]-'0'); scale*=10; }
         }
-        return true;
     }
-    // GSA/GSV are ignored for summary; still return true on checksum OK
-    return true;
+    if(i!=f.n) return dflt;
+    float v=(float)whole+(float)frac/(float)scale;
+    return neg?-v:v;
+}
+
+// "hhmmss[.sss]" → ms of day, -1 if malformed
+static int32_t nmea_span_time_ms(nmea_span_t f){
+    if(f.n<6) return -1;
+    for(int i=0;i<6;i++) if(f.p[i]<'0'||f.p[i]>'9') return -1;
+    int32_t hh=(f.p[0]-'0')*10+(f.p[1]-'0');
+    int32_t mm=(f.p[2]-'0')*10+(f.p[3]-'0');
+    int32_t ss=(f.p[4]-'0')*10+(f.p[5]-'0');
+    if(hh>23||mm>59||ss>60) return -1;
+
+    int32_t ms=0, scale=100;
+    if(f.n>6&&f.p[6]=='.'){
+        for(size_t i=7;i<f.n&&f.p[i]>='0'&&f.p[i]<='9'&&scale>0;i++,scale/=10) ms+=(f.p[i]-'0')*scale;
+    }
+    return ((hh*60+mm)*60+ss)*1000+ms;
+}
+
+static void nmea_set_time(nmea_info_t *out, nmea_span_t f){
+    if(!f.n) return;
+    nmea_span_copy(f,out->time_utc,sizeof(out->time_utc));
+    out->utc_ms=nmea_span_time_ms(f);
+}
+
+static void nmea_set_date(nmea_info_t *out, int day, int month, int year){
+    if(day<1||day>31||month<1||month>12||year<1980||year>2099) return;
+    out->day=(uint8_t)day; out->month=(uint8_t)month; out->year=(uint16_t)year;
+}
+
+// ============================================================================
+// Sentence decoders (fields are 1-based after the address field)
+// ============================================================================
+#define F(i) nmea_field(base,sc,(i))
+
+static void nmea_gga(const char *base, const nmea_scan_t *sc, nmea_info_t *out){
+    nmea_set_time(out,F(1));
+    if(F(6).n){ out->fix_quality=nmea_span_int(F(6)); out->has_fix=(out->fix_quality>0); }
+    if(F(7).n) out->sats=nmea_span_int(F(7));
+    if(F(8).n) out->hdop=nmea_span_float(F(8),out->hdop);
+    nmea_set_position(out,F(2),F(3),F(4),F(5));
+}
+
+static void nmea_rmc(const char *base, const nmea_scan_t *sc, nmea_info_t *out){
+    nmea_set_time(out,F(1));
+    if(F(2).n) out->has_fix=(F(2).p[0]=='A');   // A=valid, V=void (clears a lost fix)
+    nmea_set_position(out,F(3),F(4),F(5),F(6));
+    if(F(7).n) out->speed_knots=nmea_span_float(F(7),out->speed_knots);
+    if(F(8).n) out->course_deg=nmea_span_float(F(8),out->course_deg);
+
+    nmea_span_t d=F(9);   // ddmmyy
+    if(d.n==6){
+        int v=nmea_span_int(d);
+        nmea_set_date(out,v/10000,(v/100)%100,2000+v%100);
+    }
+}
+
+static void nmea_gsa(const char *base, const nmea_scan_t *sc, nmea_info_t *out){
+    // 1 mode, 2 fix type, 3..14 PRNs, 15 PDOP, 16 HDOP, 17 VDOP
+    if(F(2).n) out->fix_type=nmea_span_int(F(2));
+    out->pdop=nmea_span_float(F(15),out->pdop);
+    out->hdop=nmea_span_float(F(16),out->hdop);
+    out->vdop=nmea_span_float(F(17),out->vdop);
+}
+
+static void nmea_gsv(const char *base, const nmea_scan_t *sc, nmea_info_t *out){
+    // 1 total msgs, 2 msg number, 3 sats in view, then 4x (PRN, elev, az, SNR)
+    // [, signal ID on NMEA 4.10+; a lone trailing field is skipped below]
+    const char *talker=F(0).p;
+    if(nmea_span_int(F(2))==1){
+        // New cycle for this constellation: drop its previous entries
+        int k=0;
+        for(int i=0;i<out->sats_in_view;i++){
+            if(memcmp(out->sat[i].talker,talker,2)!=0) out->sat[k++]=out->sat[i];
+        }
+        out->sats_in_view=k;
+    }
+
+    for(int f=4;f+3<sc->nfields&&out->sats_in_view<NMEA_MAX_SATS;f+=4){
+        if(!F(f).n) continue;
+        nmea_sat_t *st=&out->sat[out->sats_in_view++];
+        memcpy(st->talker,talker,2);
+        st->prn=(uint16_t)nmea_span_int(F(f));
+        st->elev_deg=(int8_t)(F(f+1).n?nmea_span_int(F(f+1)):-1);
+        st->az_deg=(uint16_t)nmea_span_int(F(f+2));
+        st->snr_db=(int8_t)(F(f+3).n?nmea_span_int(F(f+3)):-1);
+    }
+}
+
+static void nmea_vtg(const char *base, const nmea_scan_t *sc, nmea_info_t *out){
+    // 1 course true, 3 course magnetic, 5 knots, 7 km/h
+    if(F(1).n) out->course_deg=nmea_span_float(F(1),out->course_deg);
+    if(F(5).n) out->speed_knots=nmea_span_float(F(5),out->speed_knots);
+    if(F(7).n) out->speed_kmh=nmea_span_float(F(7),out->speed_kmh);
+}
+
+static void nmea_zda(const char *base, const nmea_scan_t *sc, nmea_info_t *out){
+    // 1 hhmmss.ss, 2 day, 3 month, 4 year, 5/6 local zone
+    nmea_set_time(out,F(1));
+    if(F(2).n&&F(3).n&&F(4).n) nmea_set_date(out,nmea_span_int(F(2)),nmea_span_int(F(3)),nmea_span_int(F(4)));
+}
+
+#undef F
+
+// ============================================================================
+// Dispatch
+// ----------------------------------------------------------------------------
+// Keyed on the 3-letter sentence type packed into an int, so any talker
+// (GP, GN, GL, GA, GB, ...) is accepted and the switch compiles to a jump
+// or compare tree rather than a strncmp chain. Add new types here.
+// ============================================================================
+#define NMEA_TYPE(a,b,c) (((uint32_t)(a)<<16)|((uint32_t)(b)<<8)|(uint32_t)(c))
+
+static void nmea_decode(const char *base, const nmea_scan_t *sc, nmea_info_t *out){
+    nmea_span_t id=nmea_field(base,sc,0);
+    if(id.n!=5) return;   // proprietary ($P...) and malformed addresses
+
+    switch(NMEA_TYPE(id.p[2],id.p[3],id.p[4])){
+        case NMEA_TYPE('G','G','A'): nmea_gga(base,sc,out); break;
+        case NMEA_TYPE('R','M','C'): nmea_rmc(base,sc,out); break;
+        case NMEA_TYPE('G','S','A'): nmea_gsa(base,sc,out); break;
+        case NMEA_TYPE('G','S','V'): nmea_gsv(base,sc,out); break;
+        case NMEA_TYPE('V','T','G'): nmea_vtg(base,sc,out); break;
+        case NMEA_TYPE('Z','D','A'): nmea_zda(base,sc,out); break;
+        default: break;   // valid but not summarized
+    }
+}
+
+// ============================================================================
+// Public API
+// ============================================================================
+void nmea_info_init(nmea_info_t *info){
+    if(!info) return;
+    memset(info,0,sizeof(*info));
+    info->utc_ms=-1;
+}
+
+int64_t nmea_utc_epoch_ms(const nmea_info_t *info){
+    if(!info||!info->year||info->utc_ms<0) return -1;
+
+    // Days since 1970-01-01 (proleptic Gregorian, civil-from-days inverse)
+    int y=info->year-(info->month<=2);
+    int era=y/400;
+    int yoe=y-era*400;
+    int mp=(info->month+9)%12;
+    int doy=(153*mp+2)/5+info->day-1;
+    int doe=yoe*365+yoe/4-yoe/100+doy;
+    int64_t days=(int64_t)era*146097+doe-719468;
+
+    return days*86400000LL+info->utc_ms;
+}
+
+bool nmea_parse_line(const char *line, nmea_info_t *out){
+    if(!line||!out||*line!='$') return false;
+
+    nmea_scan_t sc; sc.state=SCAN_IDLE;
+    const char *base=line;
+    int ev=SCAN_MORE;
+    for(const char *p=line;*p;p++){
+        if(*p=='$') base=p;
+        ev=nmea_scan_byte(&sc,*p);
+        if(ev==SCAN_OK){ metrics_add(METRIC_NMEA_OK,1); nmea_decode(base,&sc,out); return true; }
+        if(ev!=SCAN_MORE) break;
+    }
+    // Bad checksum, overlong, or the line ended before "*hh"
+    metrics_add(ev==SCAN_OVERFLOW ? METRIC_NMEA_OVERFLOWS : METRIC_NMEA_BAD_CHECKSUM,1);
+    return false;
+}
+
+void nmea_stream_init(nmea_stream_t *s){
+    if(!s) return;
+    memset(s,0,sizeof(*s));
+    s->scan.state=SCAN_IDLE;
+}
+
+size_t nmea_stream_feed(nmea_stream_t *s, const char *data, size_t n,
+                        nmea_info_t *info, nmea_sentence_cb cb, void *user){
+    if(!s||!data) return 0;
+
+    nmea_scan_t *sc=&s->scan;
+    size_t good=0;
+    for(size_t i=0;i<n;i++){
+        char c=data[i];
+        if(c=='$') s->buf[0]='$';
+        else if(sc->state!=SCAN_IDLE&&sc->len<NMEA_MAX_SENTENCE) s->buf[sc->len]=c;
+
+        int ev=nmea_scan_byte(sc,c);
+        if(ev==SCAN_MORE) continue;
+        if(ev==SCAN_OVERFLOW){ s->overflows++; metrics_add(METRIC_NMEA_OVERFLOWS,1); continue; }
+
+        bool ok=(ev==SCAN_OK);
+        if(ok){ s->ok++; good++; if(info) nmea_decode(s->buf,sc,info); }
+        else{ s->bad_checksum++; metrics_add(METRIC_NMEA_BAD_CHECKSUM,1); }
+
+        if(cb){
+            s->buf[sc->len]='\0';
+            cb(s->buf,sc->len,ok,user);
+        }
+    }
+    if(good) metrics_add(METRIC_NMEA_OK,good);
+    return good;
 }
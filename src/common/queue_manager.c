@@ -1,7 +1,10 @@
 #include <stdio.h>
-#include <stdlib.h>     // For malloc/free
 #include <string.h>     // For memcpy
+#include <errno.h>      // For ETIMEDOUT
+#include <time.h>       // For clock_gettime
 #include "queue_manager.h"
+#include "mempool.h"      // Startup pools back the queue storage
+#include "metrics.h"      // Process-wide drop/overwrite counters
 
 // ============================================================
 // Queue Initialization
@@ -9,13 +12,15 @@
 bool queue_init(Queue *q, size_t capacity) {
     if (!q || capacity == 0) return false;
 
-    q->items = (QueueItem *)malloc(sizeof(QueueItem) * capacity);
+    q->items = (QueueItem *)mempool_alloc(sizeof(QueueItem) * capacity);
     if (!q->items) return false;
 
     q->capacity = capacity;
     q->head = 0;
     q->tail = 0;
     q->count = 0;
+    q->policy = QUEUE_OVERFLOW_REJECT;
+    memset(&q->stats, 0, sizeof(q->stats));
 
     log_info("Queue initialized successfully.");
     return true;
@@ -27,7 +32,7 @@ bool queue_init(Queue *q, size_t capacity) {
 void queue_destroy(Queue *q) {
     if (!q || !q->items) return;
 
-    free(q->items);
+    mempool_free(q->items, sizeof(QueueItem) * q->capacity);
     q->items = NULL;
     q->capacity = 0;
     q->head = 0;
@@ -37,22 +42,65 @@ void queue_destroy(Queue *q) {
     log_info("Queue destroyed and memory freed.");
 }
 
+// ============================================================
+// Queue Overflow Policy & Stats
+// ------------------------------------------------------------
+// Counters are bumped with relaxed atomics so another thread can
+// sample them (queue_get_stats) without locking the queue.
+// ============================================================
+bool queue_set_overflow_policy(Queue *q, QueueOverflowPolicy policy) {
+    if (!q) return false;
+    if (policy == QUEUE_OVERFLOW_BLOCK) {
+        log_warning("Queue: BLOCK policy needs a concurrent consumer; use SpscQueue.");
+        return false;
+    }
+    q->policy = policy;
+    return true;
+}
+
+void queue_get_stats(const Queue *q, QueueStats *out) {
+    if (!out) return;
+    memset(out, 0, sizeof(*out));
+    if (!q) return;
+
+    out->high_water = pacrf_load_relaxed(&q->stats.high_water);
+    out->enqueued   = pacrf_load_relaxed(&q->stats.enqueued);
+    out->dequeued   = pacrf_load_relaxed(&q->stats.dequeued);
+    out->drops      = pacrf_load_relaxed(&q->stats.drops);
+    out->overwrites = pacrf_load_relaxed(&q->stats.overwrites);
+}
+
+static inline void queue_note_high_water(Queue *q) {
+    if (q->count > q->stats.high_water) pacrf_store_relaxed(&q->stats.high_water, q->count);
+}
+
 // ============================================================
 // Queue Enqueue
 // ============================================================
 bool queue_enqueue(Queue *q, const QueueItem *item) {
     if (!q || !item) return false;
     if (queue_is_full(q)) {
-        log_warning("Queue is full! Cannot enqueue new item.");
-        return false;
+        if (q->policy != QUEUE_OVERFLOW_OVERWRITE_OLDEST) {
+            pacrf_fetch_add(&q->stats.drops, 1);
+            metrics_add(METRIC_QUEUE_DROPS, 1);
+            log_debug("Queue is full! Cannot enqueue new item.");
+            return false;
+        }
+        // Retire the oldest item to make room
+        q->head = (q->head + 1) % q->capacity;
+        q->count--;
+        pacrf_fetch_add(&q->stats.overwrites, 1);
+        metrics_add(METRIC_QUEUE_OVERWRITES, 1);
     }
 
     // Copy item into queue
     q->items[q->tail] = *item;
     q->tail = (q->tail + 1) % q->capacity;
     q->count++;
+    pacrf_fetch_add(&q->stats.enqueued, 1);
+    queue_note_high_water(q);
 
-    log_info("Item enqueued successfully.");
+    log_debug("Item enqueued successfully.");
     return true;
 }
 
@@ -70,11 +118,83 @@ bool queue_dequeue(Queue *q, QueueItem *out_item) {
     *out_item = q->items[q->head];
     q->head = (q->head + 1) % q->capacity;
     q->count--;
+    pacrf_fetch_add(&q->stats.dequeued, 1);
 
-    log_info("Item dequeued successfully.");
+    log_debug("Item dequeued successfully.");
     return true;
 }
 
+// ============================================================
+// Queue Bulk Enqueue / Dequeue
+// ------------------------------------------------------------
+// Move a run of items with at most two memcpy segments (split at
+// the end of the ring) and a single head/tail/count update.
+// ============================================================
+size_t queue_enqueue_bulk(Queue *q, const QueueItem *items, size_t n) {
+    if (!q || !items || n == 0) return 0;
+
+    size_t accepted = n;
+    size_t room = q->capacity - q->count;
+    if (n > room) {
+        if (q->policy == QUEUE_OVERFLOW_OVERWRITE_OLDEST) {
+            // Same end state as n single enqueues: only the newest
+            // `capacity` inputs survive, the rest count as overwrites
+            size_t skip = (n > q->capacity) ? n - q->capacity : 0;
+            items += skip;
+            n -= skip;
+
+            size_t evict = n - room;
+            q->head = (q->head + evict) % q->capacity;
+            q->count -= evict;
+            pacrf_fetch_add(&q->stats.overwrites, (uint64_t)(evict + skip));
+            metrics_add(METRIC_QUEUE_OVERWRITES, (uint64_t)(evict + skip));
+        } else {
+            pacrf_fetch_add(&q->stats.drops, (uint64_t)(n - room));
+            metrics_add(METRIC_QUEUE_DROPS, (uint64_t)(n - room));
+            n = accepted = room;
+        }
+    }
+    if (n == 0) {
+        log_debug("Queue is full! Cannot enqueue new items.");
+        return 0;
+    }
+
+    size_t first = q->capacity - q->tail;
+    if (first > n) first = n;
+    memcpy(&q->items[q->tail], items, first * sizeof(QueueItem));
+    memcpy(&q->items[0], items + first, (n - first) * sizeof(QueueItem));
+
+    q->tail = (q->tail + n) % q->capacity;
+    q->count += n;
+    pacrf_fetch_add(&q->stats.enqueued, (uint64_t)accepted);
+    queue_note_high_water(q);
+
+    log_debug("%zu items enqueued successfully.", accepted);
+    return accepted;
+}
+
+size_t queue_dequeue_bulk(Queue *q, QueueItem *out_items, size_t max) {
+    if (!q || !out_items || max == 0) return 0;
+
+    size_t n = (max < q->count) ? max : q->count;
+    if (n == 0) {
+        log_debug("Queue is empty! Nothing to dequeue.");
+        return 0;
+    }
+
+    size_t first = q->capacity - q->head;
+    if (first > n) first = n;
+    memcpy(out_items, &q->items[q->head], first * sizeof(QueueItem));
+    memcpy(out_items + first, &q->items[0], (n - first) * sizeof(QueueItem));
+
+    q->head = (q->head + n) % q->capacity;
+    q->count -= n;
+    pacrf_fetch_add(&q->stats.dequeued, (uint64_t)n);
+
+    log_debug("%zu items dequeued successfully.", n);
+    return n;
+}
+
 // ============================================================
 // Queue Status Helpers
 // ============================================================
@@ -95,9 +215,639 @@ void queue_log_status(const Queue *q) {
         return;
     }
 
-    char status[128];
+    QueueStats st;
+    queue_get_stats(q, &st);
+
+    char status[256];
     snprintf(status, sizeof(status),
-             "Queue Status -> Count: %zu / %zu | Head: %zu | Tail: %zu",
-             q->count, q->capacity, q->head, q->tail);
-    log_info(status);
+             "Queue Status -> Count: %zu / %zu | Head: %zu | Tail: %zu"
+             " | HWM: %zu | Drops: %llu | Overwrites: %llu",
+             q->count, q->capacity, q->head, q->tail, st.high_water,
+             (unsigned long long)st.drops, (unsigned long long)st.overwrites);
+    log_info("%s", status);
+}
+
+// ============================================================
+// Queue Waiter Helpers
+// ------------------------------------------------------------
+// Sleeper registers in `waiters`, fences, then re-checks; the side
+// making progress publishes, fences, then checks `waiters`. With
+// both fences at least one of them sees the other, so no wakeup is
+// lost, and nobody touches the mutex while nobody sleeps.
+// ============================================================
+static void queue_waiter_init(QueueWaiter *w) {
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+#if defined(__linux__)
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+#endif
+    pthread_mutex_init(&w->lock, NULL);
+    pthread_cond_init(&w->cond, &attr);
+    pthread_condattr_destroy(&attr);
+    w->waiters = 0;
+}
+
+static void queue_waiter_destroy(QueueWaiter *w) {
+    pthread_cond_destroy(&w->cond);
+    pthread_mutex_destroy(&w->lock);
+}
+
+// Absolute deadline `timeout_ms` from now, on the condvar's clock
+static void queue_deadline(struct timespec *ts, int timeout_ms) {
+#if defined(__linux__)
+    clock_gettime(CLOCK_MONOTONIC, ts);
+#else
+    clock_gettime(CLOCK_REALTIME, ts);
+#endif
+    ts->tv_sec  += timeout_ms / 1000;
+    ts->tv_nsec += (long)(timeout_ms % 1000) * 1000000L;
+    if (ts->tv_nsec >= 1000000000L) {
+        ts->tv_sec++;
+        ts->tv_nsec -= 1000000000L;
+    }
+}
+
+// Call after publishing progress (new data or freed space)
+static inline void queue_waiter_notify(QueueWaiter *w) {
+    pacrf_fence_seq_cst();
+    if (pacrf_load_relaxed(&w->waiters) > 0) {
+        pthread_mutex_lock(&w->lock);
+        pthread_cond_broadcast(&w->cond);
+        pthread_mutex_unlock(&w->lock);
+    }
+}
+
+// Sleeps until *index moves away from `seen` or the deadline passes
+// (deadline NULL = forever). Returns true if the index moved.
+static bool queue_waiter_wait(QueueWaiter *w, const size_t *index, size_t seen,
+                              const struct timespec *deadline) {
+    bool moved;
+
+    pthread_mutex_lock(&w->lock);
+    pacrf_fetch_add(&w->waiters, 1);
+    pacrf_fence_seq_cst();
+    while (!(moved = (pacrf_load_acquire(index) != seen))) {
+        int rc = deadline ? pthread_cond_timedwait(&w->cond, &w->lock, deadline)
+                          : pthread_cond_wait(&w->cond, &w->lock);
+        if (rc == ETIMEDOUT) {
+            moved = (pacrf_load_acquire(index) != seen);
+            break;
+        }
+    }
+    pacrf_fetch_sub(&w->waiters, 1);
+    pthread_mutex_unlock(&w->lock);
+    return moved;
+}
+
+// ============================================================
+// SPSC Queue: Copy Helper
+// ------------------------------------------------------------
+// Copies only the used part of the payload instead of the whole
+// 256-byte buffer; small packets stay cheap.
+// ============================================================
+static inline void queue_item_copy(QueueItem *dst, const QueueItem *src) {
+    size_t len = src->length;
+    if (len > sizeof(dst->data)) len = sizeof(dst->data);
+    memcpy(dst->data, src->data, len);
+    dst->length = len;
+}
+
+// ============================================================
+// SPSC Queue Initialization
+// ============================================================
+bool spsc_queue_init(SpscQueue *q, size_t capacity) {
+    if (!q || capacity == 0) return false;
+
+    size_t cap = 1;
+    while (cap < capacity) cap <<= 1;
+
+    void *mem = mempool_alloc(sizeof(QueueItem) * cap);   // cache-line aligned
+    if (!mem) return false;
+
+    q->items = (QueueItem *)mem;
+    q->capacity = cap;
+    q->mask = cap - 1;
+    q->tail = 0;
+    q->head_cache = 0;
+    q->head = 0;
+    q->tail_cache = 0;
+    q->policy = QUEUE_OVERFLOW_REJECT;
+    q->block_timeout_ms = -1;
+    q->high_water = 0;
+    q->enqueued = q->drops = q->overwrites = 0;
+    q->dequeued = 0;
+    queue_waiter_init(&q->not_empty);
+    queue_waiter_init(&q->not_full);
+
+    log_info("SPSC queue initialized (capacity=%zu).", cap);
+    return true;
+}
+
+// ============================================================
+// SPSC Queue Destruction
+// ============================================================
+void spsc_queue_destroy(SpscQueue *q) {
+    if (!q || !q->items) return;
+
+    mempool_free(q->items, sizeof(QueueItem) * q->capacity);
+    q->items = NULL;
+    q->capacity = 0;
+    q->mask = 0;
+    q->head = q->tail = 0;
+    q->head_cache = q->tail_cache = 0;
+    queue_waiter_destroy(&q->not_empty);
+    queue_waiter_destroy(&q->not_full);
+
+    log_info("SPSC queue destroyed and memory freed.");
+}
+
+// ============================================================
+// SPSC Queue Overflow Policy & Stats
+// ------------------------------------------------------------
+// Each counter has exactly one writer (producer or consumer), so
+// they are plain relaxed stores; readers use relaxed loads.
+//
+// OVERWRITE_OLDEST: when full, the producer retires slot `head`
+// with a CAS before reusing it. The consumer therefore copies a
+// slot first and then claims it with a CAS on head; a failed CAS
+// means the slot was overwritten under it and the copy is retried.
+// ============================================================
+void spsc_queue_set_overflow_policy(SpscQueue *q, QueueOverflowPolicy policy, int block_timeout_ms) {
+    if (!q) return;
+    q->policy = policy;
+    q->block_timeout_ms = block_timeout_ms;
+}
+
+void spsc_queue_get_stats(const SpscQueue *q, QueueStats *out) {
+    if (!out) return;
+    memset(out, 0, sizeof(*out));
+    if (!q) return;
+
+    out->high_water = pacrf_load_relaxed(&q->high_water);
+    out->enqueued   = pacrf_load_relaxed(&q->enqueued);
+    out->dequeued   = pacrf_load_relaxed(&q->dequeued);
+    out->drops      = pacrf_load_relaxed(&q->drops);
+    out->overwrites = pacrf_load_relaxed(&q->overwrites);
+}
+
+// Producer: record `tail` as published. The cached head overestimates
+// occupancy, so refresh it before raising the high-water mark.
+static inline void spsc_note_enqueued(SpscQueue *q, size_t tail, size_t n) {
+    pacrf_store_relaxed(&q->enqueued, q->enqueued + n);
+    if (tail - q->head_cache > q->high_water) {
+        q->head_cache = pacrf_load_relaxed(&q->head);
+        size_t used = tail - q->head_cache;
+        if (used > q->high_water) pacrf_store_relaxed(&q->high_water, used);
+    }
+}
+
+static inline void spsc_note_drops(SpscQueue *q, size_t n) {
+    pacrf_store_relaxed(&q->drops, q->drops + n);
+    metrics_add(METRIC_QUEUE_DROPS, n);
+}
+
+// Producer: in overwrite mode, make room for `n` slots at `tail` by
+// advancing head past the oldest items. Returns the number retired.
+static size_t spsc_retire_oldest(SpscQueue *q, size_t tail, size_t n) {
+    size_t head = pacrf_load_acquire(&q->head);
+    for (;;) {
+        size_t used = tail - head;
+        if (used + n <= q->capacity) break;          // consumer freed enough
+        size_t evict = used + n - q->capacity;
+        if (pacrf_cas_weak(&q->head, &head, head + evict)) {
+            head += evict;
+            pacrf_store_relaxed(&q->overwrites, q->overwrites + evict);
+            metrics_add(METRIC_QUEUE_OVERWRITES, evict);
+            q->head_cache = head;
+            return evict;
+        }
+    }
+    q->head_cache = head;
+    return 0;
+}
+
+// ============================================================
+// SPSC Queue Enqueue (producer)
+// ============================================================
+static bool spsc_try_enqueue(SpscQueue *q, const QueueItem *item) {
+    size_t tail = q->tail;                       // only we write tail
+    if (tail - q->head_cache == q->capacity) {
+        q->head_cache = pacrf_load_acquire(&q->head);
+        if (tail - q->head_cache == q->capacity) return false;
+    }
+
+    queue_item_copy(&q->items[tail & q->mask], item);
+    pacrf_store_release(&q->tail, tail + 1);     // publish the slot
+    spsc_note_enqueued(q, tail + 1, 1);
+    queue_waiter_notify(&q->not_empty);
+    return true;
+}
+
+static bool spsc_enqueue_overwrite(SpscQueue *q, const QueueItem *item) {
+    size_t tail = q->tail;
+    if (tail - q->head_cache == q->capacity) spsc_retire_oldest(q, tail, 1);
+    return spsc_try_enqueue(q, item);
+}
+
+bool spsc_queue_enqueue(SpscQueue *q, const QueueItem *item) {
+    if (!q || !item) return false;
+    if (PACRF_LIKELY(spsc_try_enqueue(q, item))) return true;
+
+    switch (q->policy) {
+        case QUEUE_OVERFLOW_OVERWRITE_OLDEST:
+            while (!spsc_enqueue_overwrite(q, item)) { }
+            return true;
+        case QUEUE_OVERFLOW_BLOCK:
+            return spsc_queue_enqueue_wait(q, item, q->block_timeout_ms);
+        case QUEUE_OVERFLOW_REJECT:
+        default:
+            spsc_note_drops(q, 1);
+            log_debug("SPSC queue is full! Cannot enqueue new item.");
+            return false;
+    }
+}
+
+// ============================================================
+// SPSC Queue Dequeue (consumer)
+// ============================================================
+// Consumer: hand back `n` slots starting at `head`. Under overwrite
+// the producer may have moved head already; return false to retry.
+static inline bool spsc_release(SpscQueue *q, size_t head, size_t n) {
+    if (q->policy == QUEUE_OVERFLOW_OVERWRITE_OLDEST) {
+        size_t expected = head;
+        if (!pacrf_cas_weak(&q->head, &expected, head + n)) return false;
+    } else {
+        pacrf_store_release(&q->head, head + n);
+    }
+    pacrf_store_relaxed(&q->dequeued, q->dequeued + n);
+    queue_waiter_notify(&q->not_full);
+    return true;
+}
+
+bool spsc_queue_dequeue(SpscQueue *q, QueueItem *out_item) {
+    return q && out_item && spsc_queue_dequeue_bulk(q, out_item, 1) == 1;
+}
+
+// ============================================================
+// SPSC Queue Bulk Enqueue / Dequeue
+// ============================================================
+size_t spsc_queue_enqueue_bulk(SpscQueue *q, const QueueItem *items, size_t n) {
+    if (!q || !items || n == 0) return 0;
+
+    size_t accepted = n;
+    size_t tail = q->tail;
+    size_t room = q->capacity - (tail - q->head_cache);
+    if (room < n) {
+        q->head_cache = pacrf_load_acquire(&q->head);
+        room = q->capacity - (tail - q->head_cache);
+    }
+    if (n > room) {
+        if (q->policy == QUEUE_OVERFLOW_OVERWRITE_OLDEST) {
+            // Only the newest `capacity` inputs can survive
+            size_t skip = (n > q->capacity) ? n - q->capacity : 0;
+            items += skip;
+            n -= skip;
+            pacrf_store_relaxed(&q->overwrites, q->overwrites + skip);
+            metrics_add(METRIC_QUEUE_OVERWRITES, skip);
+            spsc_retire_oldest(q, tail, n);
+        } else {
+            spsc_note_drops(q, n - room);
+            n = accepted = room;
+        }
+    }
+    if (n == 0) return 0;
+
+    for (size_t i = 0; i < n; i++) {
+        queue_item_copy(&q->items[(tail + i) & q->mask], &items[i]);
+    }
+    pacrf_store_release(&q->tail, tail + n);     // one publish for the batch
+    spsc_note_enqueued(q, tail + n, n);
+    queue_waiter_notify(&q->not_empty);
+    return accepted;
+}
+
+size_t spsc_queue_dequeue_bulk(SpscQueue *q, QueueItem *out_items, size_t max) {
+    if (!q || !out_items || max == 0) return 0;
+
+    for (;;) {
+        size_t head = (q->policy == QUEUE_OVERFLOW_OVERWRITE_OLDEST)
+                    ? pacrf_load_acquire(&q->head)   // the producer may move it
+                    : q->head;                       // otherwise only we write head
+        size_t avail = q->tail_cache - head;
+        if (avail < max || avail > q->capacity) {
+            q->tail_cache = pacrf_load_acquire(&q->tail);
+            avail = q->tail_cache - head;
+        }
+        size_t n = (max < avail) ? max : avail;
+        if (n == 0) return 0;
+
+        for (size_t i = 0; i < n; i++) {
+            queue_item_copy(&out_items[i], &q->items[(head + i) & q->mask]);
+        }
+        if (spsc_release(q, head, n)) return n;  // one release for the batch
+    }
+}
+
+// ============================================================
+// SPSC Queue Blocking Variants
+// ============================================================
+bool spsc_queue_enqueue_wait(SpscQueue *q, const QueueItem *item, int timeout_ms) {
+    if (!q || !item) return false;
+    if (spsc_try_enqueue(q, item)) return true;
+
+    struct timespec deadline;
+    if (timeout_ms > 0) queue_deadline(&deadline, timeout_ms);
+
+    while (timeout_ms != 0) {
+        // Full means head == tail - capacity; sleep until the consumer moves it
+        if (!queue_waiter_wait(&q->not_full, &q->head, q->tail - q->capacity,
+                               timeout_ms > 0 ? &deadline : NULL)) {
+            break;
+        }
+        if (spsc_try_enqueue(q, item)) return true;
+    }
+    if (spsc_try_enqueue(q, item)) return true;
+
+    spsc_note_drops(q, 1);
+    log_debug("SPSC queue is full! Timed out waiting for space.");
+    return false;
+}
+
+bool spsc_queue_dequeue_wait(SpscQueue *q, QueueItem *out_item, int timeout_ms) {
+    return spsc_queue_dequeue_bulk_wait(q, out_item, 1, timeout_ms) == 1;
+}
+
+size_t spsc_queue_dequeue_bulk_wait(SpscQueue *q, QueueItem *out_items, size_t max, int timeout_ms) {
+    size_t n = spsc_queue_dequeue_bulk(q, out_items, max);
+    if (n || !q || !out_items || timeout_ms == 0) return n;
+
+    struct timespec deadline;
+    if (timeout_ms > 0) queue_deadline(&deadline, timeout_ms);
+
+    for (;;) {
+        // Empty means tail == head; sleep until the producer moves it
+        if (!queue_waiter_wait(&q->not_empty, &q->tail, q->head,
+                               timeout_ms > 0 ? &deadline : NULL)) {
+            return spsc_queue_dequeue_bulk(q, out_items, max);
+        }
+        n = spsc_queue_dequeue_bulk(q, out_items, max);
+        if (n) return n;
+    }
+}
+
+// ============================================================
+// SPSC Queue Status Helpers
+// ============================================================
+size_t spsc_queue_size(const SpscQueue *q) {
+    if (!q) return 0;
+    size_t head = pacrf_load_acquire(&q->head);
+    size_t tail = pacrf_load_acquire(&q->tail);
+    return tail - head;
+}
+
+bool spsc_queue_is_empty(const SpscQueue *q) {
+    return spsc_queue_size(q) == 0;
+}
+
+void spsc_queue_log_status(const SpscQueue *q) {
+    if (!q) {
+        log_error("SPSC queue is NULL.");
+        return;
+    }
+
+    QueueStats st;
+    spsc_queue_get_stats(q, &st);
+
+    log_info("SPSC Queue Status -> Count: %zu / %zu | Head: %zu | Tail: %zu"
+             " | HWM: %zu | Drops: %llu | Overwrites: %llu",
+             spsc_queue_size(q), q->capacity,
+             pacrf_load_relaxed(&q->head) & q->mask,
+             pacrf_load_relaxed(&q->tail) & q->mask, st.high_water,
+             (unsigned long long)st.drops, (unsigned long long)st.overwrites);
+}
+
+// ============================================================
+// Record Queue: Layout Helpers
+// ------------------------------------------------------------
+// Each record is [uint32 len][uint32 reserved][payload][pad to 8].
+// A header with len == RECORD_WRAP means "skip to the ring start".
+// ============================================================
+#define RECORD_HDR   8u
+#define RECORD_WRAP  0xFFFFFFFFu
+#define RECORD_MIN_CAPACITY 64u
+
+static inline size_t record_span(size_t len) {
+    return RECORD_HDR + ((len + 7u) & ~(size_t)7u);
+}
+
+static inline uint32_t *record_hdr(const RecordQueue *q, size_t pos) {
+    return (uint32_t *)(void *)(q->buf + (pos & q->mask));
+}
+
+// ============================================================
+// Record Queue Initialization
+// ============================================================
+bool record_queue_init(RecordQueue *q, size_t capacity) {
+    if (!q || capacity == 0) return false;
+
+    size_t cap = RECORD_MIN_CAPACITY;
+    while (cap < capacity) cap <<= 1;
+
+    void *mem = mempool_alloc(cap);   // large rings get their own (huge-page) mapping
+    if (!mem) return false;
+
+    q->buf = (uint8_t *)mem;
+    q->capacity = cap;
+    q->mask = cap - 1;
+    q->tail = q->head_cache = 0;
+    q->resv_pad = q->resv_len = 0;
+    q->head = q->tail_cache = 0;
+    q->peek_size = 0;
+    queue_waiter_init(&q->not_empty);
+    queue_waiter_init(&q->not_full);
+
+    log_info("Record queue initialized (capacity=%zu bytes).", cap);
+    return true;
+}
+
+// ============================================================
+// Record Queue Destruction
+// ============================================================
+void record_queue_destroy(RecordQueue *q) {
+    if (!q || !q->buf) return;
+
+    mempool_free(q->buf, q->capacity);
+    q->buf = NULL;
+    q->capacity = 0;
+    q->mask = 0;
+    q->tail = q->head = 0;
+    queue_waiter_destroy(&q->not_empty);
+    queue_waiter_destroy(&q->not_full);
+
+    log_info("Record queue destroyed and memory freed.");
+}
+
+size_t record_queue_max_record(const RecordQueue *q) {
+    // Half the ring: always reservable once the consumer drains, even
+    // when the write position sits just short of the wrap point.
+    return q ? (q->capacity / 2) - RECORD_HDR : 0;
+}
+
+// ============================================================
+// Record Queue Reserve / Commit (producer)
+// ============================================================
+void *record_queue_reserve(RecordQueue *q, size_t max_len) {
+    if (!q || !q->buf || max_len > record_queue_max_record(q)) return NULL;
+
+    size_t tail   = q->tail;
+    size_t need   = record_span(max_len);
+    size_t to_end = q->capacity - (tail & q->mask);
+    size_t pad    = (need > to_end) ? to_end : 0;   // never straddle the end
+
+    if (tail + pad + need - q->head_cache > q->capacity) {
+        q->head_cache = pacrf_load_acquire(&q->head);
+        if (tail + pad + need - q->head_cache > q->capacity) {
+            log_debug("Record queue is full! Cannot reserve %zu bytes.", max_len);
+            return NULL;
+        }
+    }
+
+    if (pad) *record_hdr(q, tail) = RECORD_WRAP;     // consumer skips the gap
+
+    q->resv_pad = pad;
+    q->resv_len = max_len;
+    return q->buf + ((tail + pad) & q->mask) + RECORD_HDR;
+}
+
+void record_queue_commit(RecordQueue *q, size_t len) {
+    if (!q) return;
+    if (len > q->resv_len) {
+        log_warning("record_queue_commit: %zu bytes exceeds reservation (%zu)", len, q->resv_len);
+        len = q->resv_len;
+    }
+
+    size_t start = q->tail + q->resv_pad;
+    *record_hdr(q, start) = (uint32_t)len;
+
+    q->resv_pad = q->resv_len = 0;
+    pacrf_store_release(&q->tail, start + record_span(len));   // publish
+    queue_waiter_notify(&q->not_empty);
+}
+
+// ============================================================
+// Record Queue Peek / Release (consumer)
+// ============================================================
+const void *record_queue_peek(RecordQueue *q, size_t *len) {
+    if (!q || !q->buf) return NULL;
+
+    size_t head = q->head;
+    for (;;) {
+        if (head == q->tail_cache) {
+            q->tail_cache = pacrf_load_acquire(&q->tail);
+            if (head == q->tail_cache) return NULL;
+        }
+
+        uint32_t rec_len = *record_hdr(q, head);
+        if (rec_len == RECORD_WRAP) {
+            // Give the gap back right away and continue at the ring start
+            head += q->capacity - (head & q->mask);
+            pacrf_store_release(&q->head, head);
+            continue;
+        }
+
+        q->peek_size = record_span(rec_len);
+        if (len) *len = rec_len;
+        return q->buf + (head & q->mask) + RECORD_HDR;
+    }
+}
+
+void record_queue_release(RecordQueue *q) {
+    if (!q || q->peek_size == 0) return;
+    pacrf_store_release(&q->head, q->head + q->peek_size);
+    q->peek_size = 0;
+    queue_waiter_notify(&q->not_full);
+}
+
+// ============================================================
+// Record Queue Blocking Variants
+// ============================================================
+void *record_queue_reserve_wait(RecordQueue *q, size_t max_len, int timeout_ms) {
+    void *slot = record_queue_reserve(q, max_len);
+    if (slot || !q || !q->buf || timeout_ms == 0 ||
+        max_len > record_queue_max_record(q)) return slot;
+
+    struct timespec deadline;
+    if (timeout_ms > 0) queue_deadline(&deadline, timeout_ms);
+
+    for (;;) {
+        if (!queue_waiter_wait(&q->not_full, &q->head, q->head_cache,
+                               timeout_ms > 0 ? &deadline : NULL)) {
+            return record_queue_reserve(q, max_len);
+        }
+        slot = record_queue_reserve(q, max_len);
+        if (slot) return slot;
+    }
+}
+
+const void *record_queue_peek_wait(RecordQueue *q, size_t *len, int timeout_ms) {
+    const void *rec = record_queue_peek(q, len);
+    if (rec || !q || !q->buf || timeout_ms == 0) return rec;
+
+    struct timespec deadline;
+    if (timeout_ms > 0) queue_deadline(&deadline, timeout_ms);
+
+    for (;;) {
+        if (!queue_waiter_wait(&q->not_empty, &q->tail, q->head,
+                               timeout_ms > 0 ? &deadline : NULL)) {
+            return record_queue_peek(q, len);
+        }
+        rec = record_queue_peek(q, len);
+        if (rec) return rec;
+    }
+}
+
+// ============================================================
+// Record Queue Copy Wrappers
+// ============================================================
+bool record_queue_push(RecordQueue *q, const void *data, size_t len) {
+    void *slot = record_queue_reserve(q, len);
+    if (!slot) return false;
+    memcpy(slot, data, len);
+    record_queue_commit(q, len);
+    return true;
+}
+
+size_t record_queue_pop(RecordQueue *q, void *out, size_t out_cap) {
+    size_t len = 0;
+    const void *rec = record_queue_peek(q, &len);
+    if (!rec) return 0;
+    if (len > out_cap) {
+        log_warning("record_queue_pop: record of %zu bytes truncated to %zu", len, out_cap);
+        len = out_cap;
+    }
+    memcpy(out, rec, len);
+    record_queue_release(q);
+    return len;
+}
+
+// ============================================================
+// Record Queue Status Helpers
+// ============================================================
+size_t record_queue_used(const RecordQueue *q) {
+    if (!q) return 0;
+    size_t head = pacrf_load_acquire(&q->head);
+    size_t tail = pacrf_load_acquire(&q->tail);
+    return tail - head;
+}
+
+void record_queue_log_status(const RecordQueue *q) {
+    if (!q) {
+        log_error("Record queue is NULL.");
+        return;
+    }
+
+    log_info("Record Queue Status -> Used: %zu / %zu bytes | Head: %zu | Tail: %zu",
+             record_queue_used(q), q->capacity,
+             pacrf_load_relaxed(&q->head) & q->mask,
+             pacrf_load_relaxed(&q->tail) & q->mask);
 }
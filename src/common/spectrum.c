@@ -0,0 +1,429 @@
+// src/common/spectrum.c
+//
+// Spectrum engine: windowed real FFT plan and the "spectrum" stream sink
+// that averages / max-holds, decimates and emits SPEC: frames (see spectrum.h).
+
+#include "spectrum.h"
+#include "stream.h"
+#include "logger.h"
+#include "mempool.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__SSE2__) || defined(__x86_64__)
+#define SPECTRUM_SSE 1
+#include <xmmintrin.h>
+#elif defined(__aarch64__) || (defined(__ARM_NEON) && defined(PACRF_HAVE_NEON))
+#define SPECTRUM_NEON 1
+#include <arm_neon.h>
+#endif
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+typedef char spectrum_header_is_48[(sizeof(SpectrumFrameHeader) == 48) ? 1 : -1];
+
+static bool spectrum_is_pow2(size_t n) { return n && !(n & (n - 1)); }
+
+/* ============================================================================
+ *  Plan
+ * ==========================================================================*/
+size_t spectrum_plan_bytes(size_t n) {
+    size_t half = n / 2;
+    // window (n) + rev, tw_re, tw_im, post_re, post_im, re, im (half each)
+    return (n + 7 * half) * sizeof(float);
+}
+
+bool spectrum_plan_init(SpectrumPlan *p, size_t n, void *mem) {
+    if (!spectrum_is_pow2(n) || n < SPECTRUM_MIN_FFT || n > SPECTRUM_MAX_FFT || !mem) return false;
+
+    size_t half = n / 2;
+    float *f = (float *)mem;
+    p->n       = n;
+    p->half    = half;
+    p->window  = f;              f += n;
+    p->rev     = (uint32_t *)f;  f += half;
+    p->tw_re   = f;              f += half;
+    p->tw_im   = f;              f += half;
+    p->post_re = f;              f += half;
+    p->post_im = f;              f += half;
+    p->re      = f;              f += half;
+    p->im      = f;
+
+    // Periodic Hann window
+    double sum = 0.0;
+    for (size_t i = 0; i < n; i++) {
+        p->window[i] = (float)(0.5 - 0.5 * cos(2.0 * M_PI * (double)i / (double)n));
+        sum += p->window[i];
+    }
+    p->gain = (float)(sum / 2.0);
+
+    unsigned bits = 0;
+    while (((size_t)1 << bits) < half) bits++;
+    for (size_t i = 0; i < half; i++) {
+        uint32_t r = 0;
+        for (unsigned b = 0; b < bits; b++) r |= (uint32_t)((i >> b) & 1u) << (bits - 1 - b);
+        p->rev[i] = r;
+    }
+
+    // Stage with half-size h needs e^{-iπj/h}, j < h; stored contiguously
+    // at offset h - 1 so every butterfly loop reads its twiddles in order
+    for (size_t h = 1; h < half; h <<= 1) {
+        for (size_t j = 0; j < h; j++) {
+            double a = -M_PI * (double)j / (double)h;
+            p->tw_re[h - 1 + j] = (float)cos(a);
+            p->tw_im[h - 1 + j] = (float)sin(a);
+        }
+    }
+    for (size_t k = 0; k < half; k++) {
+        double a = -2.0 * M_PI * (double)k / (double)n;
+        p->post_re[k] = (float)cos(a);
+        p->post_im[k] = (float)sin(a);
+    }
+    return true;
+}
+
+/* ============================================================================
+ *  Butterflies: a[j], a[j + h] for j < h, split re/im arrays
+ * ==========================================================================*/
+static void spectrum_bfly_scalar(float *re, float *im, const float *wr, const float *wi, size_t h) {
+    float *re2 = re + h, *im2 = im + h;
+    for (size_t j = 0; j < h; j++) {
+        float tr = re2[j] * wr[j] - im2[j] * wi[j];
+        float ti = re2[j] * wi[j] + im2[j] * wr[j];
+        re2[j] = re[j] - tr;
+        im2[j] = im[j] - ti;
+        re[j] += tr;
+        im[j] += ti;
+    }
+}
+
+#if defined(SPECTRUM_SSE)
+static void spectrum_bfly(float *re, float *im, const float *wr, const float *wi, size_t h) {
+    if (h < 4) {
+        spectrum_bfly_scalar(re, im, wr, wi, h);
+        return;
+    }
+    float *re2 = re + h, *im2 = im + h;
+    for (size_t j = 0; j < h; j += 4) {
+        __m128 xr = _mm_loadu_ps(re2 + j), xi = _mm_loadu_ps(im2 + j);
+        __m128 cr = _mm_loadu_ps(wr + j),  ci = _mm_loadu_ps(wi + j);
+        __m128 tr = _mm_sub_ps(_mm_mul_ps(xr, cr), _mm_mul_ps(xi, ci));
+        __m128 ti = _mm_add_ps(_mm_mul_ps(xr, ci), _mm_mul_ps(xi, cr));
+        __m128 ar = _mm_loadu_ps(re + j),  ai = _mm_loadu_ps(im + j);
+        _mm_storeu_ps(re2 + j, _mm_sub_ps(ar, tr));
+        _mm_storeu_ps(im2 + j, _mm_sub_ps(ai, ti));
+        _mm_storeu_ps(re + j,  _mm_add_ps(ar, tr));
+        _mm_storeu_ps(im + j,  _mm_add_ps(ai, ti));
+    }
+}
+#elif defined(SPECTRUM_NEON)
+static void spectrum_bfly(float *re, float *im, const float *wr, const float *wi, size_t h) {
+    if (h < 4) {
+        spectrum_bfly_scalar(re, im, wr, wi, h);
+        return;
+    }
+    float *re2 = re + h, *im2 = im + h;
+    for (size_t j = 0; j < h; j += 4) {
+        float32x4_t xr = vld1q_f32(re2 + j), xi = vld1q_f32(im2 + j);
+        float32x4_t cr = vld1q_f32(wr + j),  ci = vld1q_f32(wi + j);
+        float32x4_t tr = vmlsq_f32(vmulq_f32(xr, cr), xi, ci);
+        float32x4_t ti = vmlaq_f32(vmulq_f32(xr, ci), xi, cr);
+        float32x4_t ar = vld1q_f32(re + j),  ai = vld1q_f32(im + j);
+        vst1q_f32(re2 + j, vsubq_f32(ar, tr));
+        vst1q_f32(im2 + j, vsubq_f32(ai, ti));
+        vst1q_f32(re + j,  vaddq_f32(ar, tr));
+        vst1q_f32(im + j,  vaddq_f32(ai, ti));
+    }
+}
+#else
+#define spectrum_bfly spectrum_bfly_scalar
+#endif
+
+const char *spectrum_kernel_name(void) {
+#if defined(SPECTRUM_SSE)
+    return "sse";
+#elif defined(SPECTRUM_NEON)
+    return "neon";
+#else
+    return "scalar";
+#endif
+}
+
+void spectrum_power(SpectrumPlan *p, const int16_t *x, float *power, float full_scale) {
+    const size_t half = p->half;
+    float *re = p->re, *im = p->im;
+
+    // Window, pack even/odd samples as one complex point, bit-reverse on store
+    for (size_t k = 0; k < half; k++) {
+        uint32_t r = p->rev[k];
+        re[r] = (float)x[2 * k]     * p->window[2 * k];
+        im[r] = (float)x[2 * k + 1] * p->window[2 * k + 1];
+    }
+
+    // Iterative radix-2 DIT
+    for (size_t h = 1; h < half; h <<= 1) {
+        const float *wr = p->tw_re + h - 1, *wi = p->tw_im + h - 1;
+        for (size_t b = 0; b < half; b += 2 * h) spectrum_bfly(re + b, im + b, wr, wi, h);
+    }
+
+    // Split the half-size result into the real input's spectrum:
+    // X[k] = E[k] + W^k O[k], E/O from Z[k] and conj(Z[half - k])
+    const float norm = 1.0f / (p->gain * full_scale * p->gain * full_scale);
+    for (size_t k = 0; k < half; k++) {
+        size_t m = k ? half - k : 0;
+        float ar = re[k], ai = im[k];
+        float br = re[m], bi = -im[m];
+        float er = 0.5f * (ar + br), ei = 0.5f * (ai + bi);
+        float or_ = 0.5f * (ai - bi), oi = -0.5f * (ar - br);
+        float wr = p->post_re[k], wi = p->post_im[k];
+        float xr = er + (wr * or_ - wi * oi);
+        float xi = ei + (wr * oi + wi * or_);
+        power[k] = (xr * xr + xi * xi) * norm;
+    }
+}
+
+/* ============================================================================
+ *  Sink: spectrum[:fft=N,avg=N,mode=avg|max,rate=R,bins=B]
+ * ==========================================================================*/
+typedef struct {
+    SpectrumPlan plan;
+    unsigned  fft, avg, mode, rate, bins;
+    float     full_scale;
+    uint64_t  sample_rate;
+
+    int16_t  *pending;        // fft samples being collected
+    size_t    pending_n;
+    float    *power, *acc;    // half bins each
+    unsigned  acc_n;          // FFTs in acc
+    uint8_t  *frame;          // header + bins
+    char     *line;           // base64 of frame
+
+    bool      collecting;
+    int64_t   next_ns;        // earliest block time for the next frame
+    int64_t   period_ns;
+    int64_t   t0_ns;
+    uint32_t  seq;
+    uint64_t  ffts;
+
+    void     *mem;
+    size_t    mem_bytes;
+    bool      mem_heap;       // arena was full: came from mempool_alloc
+} SpectrumSink;
+
+static size_t spectrum_b64_len(size_t n) { return (n + 2) / 3 * 4; }
+
+static void spectrum_b64(const uint8_t *src, size_t n, char *out) {
+    static const char tbl[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    size_t i = 0;
+    for (; i + 3 <= n; i += 3) {
+        uint32_t v = (uint32_t)src[i] << 16 | (uint32_t)src[i + 1] << 8 | src[i + 2];
+        *out++ = tbl[v >> 18];
+        *out++ = tbl[(v >> 12) & 63];
+        *out++ = tbl[(v >> 6) & 63];
+        *out++ = tbl[v & 63];
+    }
+    if (i < n) {
+        uint32_t v = (uint32_t)src[i] << 16 | (i + 1 < n ? (uint32_t)src[i + 1] << 8 : 0);
+        *out++ = tbl[v >> 18];
+        *out++ = tbl[(v >> 12) & 63];
+        *out++ = i + 1 < n ? tbl[(v >> 6) & 63] : '=';
+        *out++ = '=';
+    }
+    *out = '\0';
+}
+
+static bool spectrum_parse_opts(SpectrumSink *s, const char *arg) {
+    s->fft = 1024;
+    s->avg = 8;
+    s->mode = SPECTRUM_MODE_AVG;
+    s->rate = 10;
+    s->bins = 512;
+
+    char buf[256];
+    snprintf(buf, sizeof(buf), "%s", arg ? arg : "");
+    for (char *save = NULL, *opt = strtok_r(buf, ",", &save); opt; opt = strtok_r(NULL, ",", &save)) {
+        char *eq = strchr(opt, '=');
+        if (!eq) {
+            log_warning("spectrum: ignoring option '%s'", opt);
+            continue;
+        }
+        *eq++ = '\0';
+        unsigned v = (unsigned)strtoul(eq, NULL, 10);
+        if      (strcmp(opt, "fft") == 0)  s->fft = v;
+        else if (strcmp(opt, "avg") == 0)  s->avg = v ? v : 1;
+        else if (strcmp(opt, "rate") == 0) s->rate = v ? v : 1;
+        else if (strcmp(opt, "bins") == 0) s->bins = v;
+        else if (strcmp(opt, "mode") == 0) {
+            if (strcmp(eq, "max") == 0) s->mode = SPECTRUM_MODE_MAX;
+            else if (strcmp(eq, "avg") == 0) s->mode = SPECTRUM_MODE_AVG;
+            else log_warning("spectrum: unknown mode '%s' (avg|max)", eq);
+        } else {
+            log_warning("spectrum: ignoring option '%s'", opt);
+        }
+    }
+
+    if (!spectrum_is_pow2(s->fft) || s->fft < SPECTRUM_MIN_FFT || s->fft > SPECTRUM_MAX_FFT) {
+        log_error("spectrum: fft=%u must be a power of two in [%u, %u]",
+                  s->fft, SPECTRUM_MIN_FFT, SPECTRUM_MAX_FFT);
+        return false;
+    }
+    if (s->bins > s->fft / 2) s->bins = s->fft / 2;
+    if (s->bins > SPECTRUM_MAX_BINS) s->bins = SPECTRUM_MAX_BINS;
+    if (!spectrum_is_pow2(s->bins)) {
+        log_error("spectrum: bins=%u must be a power of two", s->bins);
+        return false;
+    }
+    return true;
+}
+
+static int spectrum_open(StreamSink *k, const char *arg, const StreamConfig *cfg) {
+    SpectrumSink *s = (SpectrumSink *)calloc(1, sizeof(*s));
+    if (!s) return -1;
+    if (!spectrum_parse_opts(s, arg)) {
+        free(s);
+        return -1;
+    }
+
+    size_t half = s->fft / 2;
+    size_t frame_bytes = sizeof(SpectrumFrameHeader) + s->bins;
+    size_t plan_bytes = spectrum_plan_bytes(s->fft);
+    size_t pending_bytes = (s->fft * sizeof(int16_t) + 15) & ~(size_t)15;
+    s->mem_bytes = plan_bytes + pending_bytes + 2 * half * sizeof(float)
+                 + ((frame_bytes + 15) & ~(size_t)15) + spectrum_b64_len(frame_bytes) + 1;
+
+    // Per-command scratch; the arena is reset when --spectrum-start returns
+    s->mem = mempool_scratch(s->mem_bytes);
+    if (!s->mem) {
+        s->mem = mempool_alloc(s->mem_bytes);
+        s->mem_heap = true;
+    }
+    if (!s->mem) {
+        free(s);
+        return -1;
+    }
+
+    uint8_t *m = (uint8_t *)s->mem;
+    spectrum_plan_init(&s->plan, s->fft, m);   m += plan_bytes;
+    s->pending = (int16_t *)m;                 m += pending_bytes;
+    s->power   = (float *)m;                   m += half * sizeof(float);
+    s->acc     = (float *)m;                   m += half * sizeof(float);
+    s->frame   = m;                            m += (frame_bytes + 15) & ~(size_t)15;
+    s->line    = (char *)m;
+
+    s->full_scale  = (float)(1u << (cfg->width - 1));
+    s->sample_rate = cfg->rate_hz;
+    s->period_ns   = 1000000000LL / s->rate;
+    s->next_ns     = 0;
+    s->t0_ns       = -1;
+    k->priv = s;
+
+    log_info("spectrum: fft=%u (%s) avg=%u mode=%s rate=%u/s bins=%u (%zu-byte frames)",
+             s->fft, spectrum_kernel_name(), s->avg, s->mode == SPECTRUM_MODE_MAX ? "max" : "avg",
+             s->rate, s->bins, frame_bytes);
+    return 0;
+}
+
+static void spectrum_emit(SpectrumSink *s, int64_t t_ns) {
+    const size_t half = s->fft / 2;
+    const size_t group = half / s->bins;
+    const float  inv = s->mode == SPECTRUM_MODE_AVG ? 1.0f / (float)s->acc_n : 1.0f;
+    uint8_t *out = s->frame + sizeof(SpectrumFrameHeader);
+
+    // Peak-preserving decimation: each output bin keeps its loudest input bin
+    for (size_t b = 0; b < s->bins; b++) {
+        float peak = 0.0f;
+        for (size_t i = b * group; i < (b + 1) * group; i++) {
+            if (s->acc[i] > peak) peak = s->acc[i];
+        }
+        float db = 10.0f * log10f(peak * inv + 1e-20f);
+        float v = (db - SPECTRUM_DB_FLOOR) / SPECTRUM_DB_STEP + 0.5f;
+        out[b] = v <= 0.0f ? 0 : v >= 255.0f ? 255 : (uint8_t)v;
+    }
+
+    SpectrumFrameHeader h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, SPECTRUM_MAGIC, 4);
+    h.version = SPECTRUM_VERSION;
+    h.bins = (uint16_t)s->bins;
+    h.seq = s->seq++;
+    h.fft_size = s->fft;
+    h.averaged = s->acc_n;
+    h.mode = (uint16_t)s->mode;
+    h.sample_rate_hz = s->sample_rate;
+    h.t_ns = t_ns;
+    h.db_floor = SPECTRUM_DB_FLOOR;
+    h.db_step = SPECTRUM_DB_STEP;
+    memcpy(s->frame, &h, sizeof(h));
+
+    spectrum_b64(s->frame, sizeof(h) + s->bins, s->line);
+    printf("SPEC: %s\n", s->line);
+    fflush(stdout);
+}
+
+static int spectrum_write(StreamSink *k, const StreamBlock *blk, const int16_t *samples, size_t count) {
+    SpectrumSink *s = (SpectrumSink *)k->priv;
+    const size_t half = s->fft / 2;
+    if (s->t0_ns < 0) s->t0_ns = blk->t_mono_ns;
+
+    if (!s->collecting) {
+        if (blk->t_mono_ns < s->next_ns) return 0;   // between frames: skip
+        s->collecting = true;
+        s->pending_n = 0;
+        s->acc_n = 0;
+    } else if (blk->flags & STREAM_BLOCK_GAP) {
+        s->pending_n = 0;   // don't transform across lost data
+    }
+
+    size_t i = 0;
+    while (i < count) {
+        size_t take = s->fft - s->pending_n;
+        if (take > count - i) take = count - i;
+        memcpy(s->pending + s->pending_n, samples + i, take * sizeof(int16_t));
+        s->pending_n += take;
+        i += take;
+        if (s->pending_n < s->fft) break;
+
+        spectrum_power(&s->plan, s->pending, s->acc_n ? s->power : s->acc, s->full_scale);
+        if (s->acc_n) {
+            if (s->mode == SPECTRUM_MODE_MAX) {
+                for (size_t b = 0; b < half; b++) if (s->power[b] > s->acc[b]) s->acc[b] = s->power[b];
+            } else {
+                for (size_t b = 0; b < half; b++) s->acc[b] += s->power[b];
+            }
+        }
+        s->acc_n++;
+        s->ffts++;
+        s->pending_n = 0;
+
+        if (s->acc_n == s->avg) {
+            spectrum_emit(s, blk->t_mono_ns - s->t0_ns);
+            s->collecting = false;
+            // Next frame one period on; never try to catch up in a burst
+            s->next_ns = s->next_ns ? s->next_ns + s->period_ns : blk->t_mono_ns + s->period_ns;
+            if (s->next_ns < blk->t_mono_ns) s->next_ns = blk->t_mono_ns;
+            break;   // rest of the block falls between frames
+        }
+    }
+    return 0;
+}
+
+static void spectrum_close(StreamSink *k) {
+    SpectrumSink *s = (SpectrumSink *)k->priv;
+    if (!s) return;
+    log_info("spectrum: %u frames from %llu FFTs", s->seq, (unsigned long long)s->ffts);
+    if (s->mem_heap) mempool_free(s->mem, s->mem_bytes);
+    free(s);
+    k->priv = NULL;
+}
+
+static const StreamSinkOps spectrum_sink_ops = {
+    "spectrum", spectrum_open, spectrum_write, spectrum_close
+};
+
+void spectrum_stream_register(void) {
+    stream_register_sink(&spectrum_sink_ops);
+}
@@ -0,0 +1,1005 @@
+// src/common/stream.c
+//
+// Source → unpack → sink streaming pipeline (see stream.h).
+// Each stage is one thread; stages are linked by SPSC RecordQueues so the
+// hot path takes no locks and never copies a raw block between queues.
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE            // pthread_setaffinity_np, CPU_SET
+#endif
+
+#include "stream.h"
+#include "queue_manager.h"
+#include "bit_parser.h"
+#include "unpack.h"
+#include "config.h"
+#include "logger.h"
+#include "pacrf_atomic.h"
+#include "mempool.h"
+#include "metrics.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <netdb.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+#define STREAM_MAX_TYPES     16
+#define STREAM_WAIT_MS       100     // queue wait slice; stop flags are re-checked between
+#define STREAM_DEFAULT_BLOCK (16 * 1024)
+#define STREAM_DEFAULT_QUEUE (1024 * 1024)
+#define STREAM_DEFAULT_RATE  1000000u
+#define STREAM_POLL_SPINS    4096    // busy-poll attempts per wait slice
+#define STREAM_LOCKED_STACK  (256 * 1024)   // stage stack when memory is locked
+
+static int64_t stream_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+// Single-writer counter bump (readers use relaxed loads)
+#define STAT_ADD(field, v) pacrf_store_relaxed(&(field), (field) + (v))
+
+// Stage latency goes to the pipeline's own histograms (the per-run report)
+// and to the process-wide metrics, whose stream entries share the order
+typedef char stream_lat_matches_metrics[(METRIC_LAT_RAW_QUEUE + STREAM_LAT_TOTAL == METRIC_LAT_STREAM_TOTAL) ? 1 : -1];
+
+static inline void stream_lat_record(StreamLatency *lat, StreamLatencyStage st, uint64_t ns) {
+    histogram_record(&lat->stage[st], ns);
+    metrics_record((MetricHistogram)(METRIC_LAT_RAW_QUEUE + st), ns);
+}
+
+/* ============================================================================
+ *  Source: sim — a tone plus noise, quantized and packed MSB-first
+ *  Arg (optional): tone frequency in Hz (default rate/16). Paced to rate_hz.
+ * ==========================================================================*/
+typedef struct {
+    unsigned width;
+    uint32_t rate_hz;
+    double   phase, step;
+    uint32_t rng;
+    int64_t  t_next_ns;   // when the next block is due (paced mode)
+} SimSource;
+
+static int sim_open(StreamSource *s, const char *arg, const StreamConfig *cfg) {
+    SimSource *sim = (SimSource *)calloc(1, sizeof(*sim));
+    if (!sim) return -1;
+
+    double rate = cfg->rate_hz ? (double)cfg->rate_hz : (double)STREAM_DEFAULT_RATE;
+    double tone = (arg && *arg) ? atof(arg) : rate / 16.0;
+    sim->width = cfg->width;
+    sim->rate_hz = cfg->rate_hz;
+    sim->step = 2.0 * M_PI * tone / rate;
+    sim->rng = 0x12345678u;
+    sim->t_next_ns = stream_now_ns();
+    s->priv = sim;
+    return 0;
+}
+
+static ssize_t sim_read(StreamSource *s, void *buf, size_t cap) {
+    SimSource *sim = (SimSource *)s->priv;
+    const unsigned w = sim->width;
+    const double amp = (double)((1 << (w - 1)) - 1) * 0.7;
+    const uint32_t mask = (w == 32) ? 0xFFFFFFFFu : ((1u << w) - 1);
+    size_t count = cap * 8 / w;
+
+    uint8_t *out = (uint8_t *)buf;
+    uint64_t acc = 0;
+    unsigned bits = 0;
+    size_t pos = 0;
+    for (size_t i = 0; i < count; i++) {
+        sim->rng = sim->rng * 1664525u + 1013904223u;
+        double noise = ((double)(sim->rng >> 16) / 65536.0 - 0.5) * amp * 0.05;
+        long v = lrint(amp * sin(sim->phase) + noise);
+        sim->phase += sim->step;
+        if (sim->phase > 2.0 * M_PI) sim->phase -= 2.0 * M_PI;
+
+        acc = (acc << w) | ((uint32_t)v & mask);
+        bits += w;
+        while (bits >= 8) {
+            bits -= 8;
+            out[pos++] = (uint8_t)(acc >> bits);
+        }
+    }
+    if (bits) out[pos++] = (uint8_t)(acc << (8 - bits));
+
+    if (sim->rate_hz) {
+        // Sleep until this block would have finished arriving at rate_hz
+        sim->t_next_ns += (int64_t)(count * 1000000000ULL / sim->rate_hz);
+        int64_t now = stream_now_ns();
+        if (sim->t_next_ns > now) {
+            struct timespec ts = { (time_t)(sim->t_next_ns / 1000000000LL),
+                                   (long)(sim->t_next_ns % 1000000000LL) };
+            while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR) { }
+        } else if (now - sim->t_next_ns > 1000000000LL) {
+            sim->t_next_ns = now;   // fell >1 s behind: don't burst to catch up
+        }
+    }
+    return (ssize_t)pos;
+}
+
+static void sim_close(StreamSource *s) {
+    free(s->priv);
+    s->priv = NULL;
+}
+
+static const StreamSourceOps stream_source_sim = {
+    "sim", sim_open, sim_read, NULL, sim_close
+};
+
+/* ============================================================================
+ *  Source: file:<path> — raw packed samples, read until EOF
+ * ==========================================================================*/
+static int file_src_open(StreamSource *s, const char *arg, const StreamConfig *cfg) {
+    (void)cfg;
+    if (!arg || !*arg) {
+        log_error("stream: file source needs a path (file:<path>)");
+        return -1;
+    }
+    int fd = open(arg, O_RDONLY);
+    if (fd < 0) {
+        log_error("stream: cannot open %s: %s", arg, strerror(errno));
+        return -1;
+    }
+    s->priv = (void *)(intptr_t)fd;
+    return 0;
+}
+
+static ssize_t file_src_read(StreamSource *s, void *buf, size_t cap) {
+    int fd = (int)(intptr_t)s->priv;
+    size_t got = 0;
+    while (got < cap) {
+        ssize_t n = read(fd, (uint8_t *)buf + got, cap - got);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0) return got ? (ssize_t)got : STREAM_ERROR;
+        if (n == 0) break;
+        got += (size_t)n;
+    }
+    return (ssize_t)got;   // 0 == STREAM_EOF
+}
+
+static void file_src_close(StreamSource *s) {
+    close((int)(intptr_t)s->priv);
+}
+
+static const StreamSourceOps stream_source_file = {
+    "file", file_src_open, file_src_read, NULL, file_src_close
+};
+
+/* ============================================================================
+ *  Sinks: null, stdout, file:<path>, tcp:<host>:<port>, unix:<path>
+ *  All but null write native-endian int16 samples to a descriptor.
+ * ==========================================================================*/
+typedef struct {
+    int  fd;
+    bool is_socket;
+    bool owns_fd;
+} FdSink;
+
+static int null_open(StreamSink *k, const char *arg, const StreamConfig *cfg) {
+    (void)k; (void)arg; (void)cfg;
+    return 0;
+}
+
+static int null_write(StreamSink *k, const StreamBlock *blk, const int16_t *samples, size_t count) {
+    (void)k; (void)blk; (void)samples; (void)count;
+    return 0;
+}
+
+static void null_close(StreamSink *k) { (void)k; }
+
+static int fd_sink_attach(StreamSink *k, int fd, bool is_socket, bool owns_fd) {
+    FdSink *f = (FdSink *)malloc(sizeof(*f));
+    if (!f) {
+        if (owns_fd) close(fd);
+        return -1;
+    }
+    f->fd = fd;
+    f->is_socket = is_socket;
+    f->owns_fd = owns_fd;
+    k->priv = f;
+    return 0;
+}
+
+// The samples take over the real stdout; fd 1 (printf, log_*) is pointed at
+// stderr meanwhile so text never interleaves with the binary stream.
+// Under the agent, PACRF_DATA_FD names its DATA channel and stdout stays text.
+static int stdout_open(StreamSink *k, const char *arg, const StreamConfig *cfg) {
+    (void)arg; (void)cfg;
+    const char *data_fd = getenv("PACRF_DATA_FD");
+    if (data_fd && *data_fd) return fd_sink_attach(k, atoi(data_fd), false, false);
+
+    fflush(stdout);
+    int fd = dup(STDOUT_FILENO);
+    if (fd < 0 || dup2(STDERR_FILENO, STDOUT_FILENO) < 0) {
+        log_error("stream: cannot take over stdout: %s", strerror(errno));
+        if (fd >= 0) close(fd);
+        return -1;
+    }
+    return fd_sink_attach(k, fd, false, true);
+}
+
+static void stdout_close(StreamSink *k) {
+    FdSink *f = (FdSink *)k->priv;
+    if (!f) return;
+    if (f->owns_fd) {   // took over stdout: give it back
+        fflush(stdout);
+        dup2(f->fd, STDOUT_FILENO);
+        close(f->fd);
+    }
+    free(f);
+    k->priv = NULL;
+}
+
+static int file_sink_open(StreamSink *k, const char *arg, const StreamConfig *cfg) {
+    (void)cfg;
+    if (!arg || !*arg) {
+        log_error("stream: file sink needs a path (file:<path>)");
+        return -1;
+    }
+    int fd = open(arg, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        log_error("stream: cannot create %s: %s", arg, strerror(errno));
+        return -1;
+    }
+    return fd_sink_attach(k, fd, false, true);
+}
+
+static int tcp_open(StreamSink *k, const char *arg, const StreamConfig *cfg) {
+    (void)cfg;
+    const char *colon = arg ? strrchr(arg, ':') : NULL;
+    if (!colon || colon == arg) {
+        log_error("stream: tcp sink needs host:port");
+        return -1;
+    }
+    char host[256];
+    size_t hlen = (size_t)(colon - arg);
+    if (hlen >= sizeof(host)) hlen = sizeof(host) - 1;
+    memcpy(host, arg, hlen);
+    host[hlen] = '\0';
+
+    struct addrinfo hints, *res = NULL;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    int rc = getaddrinfo(host, colon + 1, &hints, &res);
+    if (rc != 0) {
+        log_error("stream: cannot resolve %s: %s", arg, gai_strerror(rc));
+        return -1;
+    }
+
+    int fd = -1;
+    for (struct addrinfo *ai = res; ai; ai = ai->ai_next) {
+        fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+        if (fd < 0) continue;
+        if (connect(fd, ai->ai_addr, ai->ai_addrlen) == 0) break;
+        close(fd);
+        fd = -1;
+    }
+    freeaddrinfo(res);
+    if (fd < 0) {
+        log_error("stream: cannot connect to %s: %s", arg, strerror(errno));
+        return -1;
+    }
+    return fd_sink_attach(k, fd, true, true);
+}
+
+static int unix_open(StreamSink *k, const char *arg, const StreamConfig *cfg) {
+    (void)cfg;
+    struct sockaddr_un sa;
+    if (!arg || !*arg || strlen(arg) >= sizeof(sa.sun_path)) {
+        log_error("stream: unix sink needs a socket path");
+        return -1;
+    }
+    memset(&sa, 0, sizeof(sa));
+    sa.sun_family = AF_UNIX;
+    strcpy(sa.sun_path, arg);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || connect(fd, (struct sockaddr *)&sa, sizeof(sa)) != 0) {
+        log_error("stream: cannot connect to %s: %s", arg, strerror(errno));
+        if (fd >= 0) close(fd);
+        return -1;
+    }
+    return fd_sink_attach(k, fd, true, true);
+}
+
+static int fd_sink_write(StreamSink *k, const StreamBlock *blk, const int16_t *samples, size_t count) {
+    (void)blk;
+    FdSink *f = (FdSink *)k->priv;
+    const uint8_t *p = (const uint8_t *)samples;
+    size_t left = count * sizeof(int16_t);
+
+    while (left) {
+        ssize_t n = f->is_socket ? send(f->fd, p, left, MSG_NOSIGNAL)
+                                 : write(f->fd, p, left);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) {
+            log_error("stream: sink write failed: %s", strerror(errno));
+            return -1;
+        }
+        p += n;
+        left -= (size_t)n;
+    }
+    return 0;
+}
+
+static void fd_sink_close(StreamSink *k) {
+    FdSink *f = (FdSink *)k->priv;
+    if (!f) return;
+    if (f->owns_fd) close(f->fd);
+    free(f);
+    k->priv = NULL;
+}
+
+static const StreamSinkOps stream_sink_null   = { "null",   null_open,      null_write,    null_close };
+static const StreamSinkOps stream_sink_stdout = { "stdout", stdout_open,    fd_sink_write, stdout_close  };
+static const StreamSinkOps stream_sink_file   = { "file",   file_sink_open, fd_sink_write, fd_sink_close };
+static const StreamSinkOps stream_sink_tcp    = { "tcp",    tcp_open,       fd_sink_write, fd_sink_close };
+static const StreamSinkOps stream_sink_unix   = { "unix",   unix_open,      fd_sink_write, fd_sink_close };
+
+/* ============================================================================
+ *  Registry
+ * ==========================================================================*/
+static const StreamSourceOps *g_sources[STREAM_MAX_TYPES] = {
+    &stream_source_sim, &stream_source_file
+};
+static const StreamSinkOps *g_sinks[STREAM_MAX_TYPES] = {
+    &stream_sink_null, &stream_sink_stdout, &stream_sink_file,
+    &stream_sink_tcp, &stream_sink_unix
+};
+
+bool stream_register_source(const StreamSourceOps *ops) {
+    for (int i = 0; ops && i < STREAM_MAX_TYPES; i++) {
+        if (g_sources[i] == ops) return true;
+        if (!g_sources[i]) { g_sources[i] = ops; return true; }
+    }
+    return false;
+}
+
+bool stream_register_sink(const StreamSinkOps *ops) {
+    for (int i = 0; ops && i < STREAM_MAX_TYPES; i++) {
+        if (g_sinks[i] == ops) return true;
+        if (!g_sinks[i]) { g_sinks[i] = ops; return true; }
+    }
+    return false;
+}
+
+// Splits "name[:arg]": returns the name length, *arg points past the ':'
+static size_t stream_spec_split(const char *spec, const char **arg) {
+    const char *colon = strchr(spec, ':');
+    *arg = colon ? colon + 1 : NULL;
+    return colon ? (size_t)(colon - spec) : strlen(spec);
+}
+
+static bool stream_name_is(const char *name, const char *spec, size_t nlen) {
+    return strlen(name) == nlen && strncmp(name, spec, nlen) == 0;
+}
+
+static const StreamSourceOps *stream_find_source(const char *spec, const char **arg) {
+    size_t nlen = stream_spec_split(spec, arg);
+    for (int i = 0; i < STREAM_MAX_TYPES && g_sources[i]; i++)
+        if (stream_name_is(g_sources[i]->name, spec, nlen)) return g_sources[i];
+    return NULL;
+}
+
+static const StreamSinkOps *stream_find_sink(const char *spec, const char **arg) {
+    size_t nlen = stream_spec_split(spec, arg);
+    for (int i = 0; i < STREAM_MAX_TYPES && g_sinks[i]; i++)
+        if (stream_name_is(g_sinks[i]->name, spec, nlen)) return g_sinks[i];
+    return NULL;
+}
+
+/* ============================================================================
+ *  Pipeline
+ * ==========================================================================*/
+struct StreamPipeline {
+    StreamConfig cfg;
+    StreamSource src;
+    StreamSink   sink;
+    RecordQueue  raw_q;      // reader → unpack
+    RecordQueue  sample_q;   // unpack → sink
+    size_t       raw_cap;    // inline payload bytes per raw block
+
+    pthread_t th_reader, th_unpack, th_sink;
+    int       threads;       // how many were started
+    bool      locked;        // mlockall() succeeded; undone on destroy
+
+    int stop;                // source should stop (atomic)
+    int done;                // sink thread finished (atomic)
+    pthread_mutex_t done_lock;
+    pthread_cond_t  done_cond;
+
+    int64_t t_start_ns;
+    int64_t t_end_ns;
+
+    PACRF_CACHE_ALIGNED StreamStageStats reader;
+    PACRF_CACHE_ALIGNED StreamStageStats unpack;
+    PACRF_CACHE_ALIGNED StreamStageStats sinkst;
+
+    // Latency, split by writer: the unpack thread owns the first two
+    // stages, the sink thread the rest
+    StreamLatency lat;
+};
+
+void stream_config_init(StreamConfig *cfg) {
+    if (!cfg) return;
+    memset(cfg, 0, sizeof(*cfg));
+    cfg->source = "sim";
+    cfg->sink = "null";
+    cfg->width = DEFAULT_BITWIDTH;
+    cfg->rate_hz = STREAM_DEFAULT_RATE;
+    cfg->block_bytes = STREAM_DEFAULT_BLOCK;
+    cfg->queue_bytes = STREAM_DEFAULT_QUEUE;
+    cfg->block_on_full = 1;
+    for (int i = 0; i < STREAM_STAGES; i++) cfg->stage[i].cpu = -1;
+
+    const char *sched = getenv("PACRF_STREAM_SCHED");
+    if (sched && *sched) stream_config_set_sched(cfg, sched);
+}
+
+/* ============================================================================
+ *  Stage scheduling (see stream.h)
+ * ==========================================================================*/
+const char *stream_stage_name(StreamStage stage) {
+    static const char *const names[STREAM_STAGES] = { "reader", "unpack", "sink" };
+    return (unsigned)stage < STREAM_STAGES ? names[stage] : "?";
+}
+
+// One "key=value" or flag of a stage item; false if malformed
+static bool stream_sched_opt(StreamStage st, StreamStageSched *sc, const char *opt) {
+    char *end = NULL;
+    if (strncmp(opt, "cpu=", 4) == 0) {
+        long v = strtol(opt + 4, &end, 10);
+        if (end == opt + 4 || *end || v < 0 || v >= CPU_SETSIZE) return false;
+        sc->cpu = (int)v;
+    } else if (strncmp(opt, "prio=", 5) == 0) {
+        long v = strtol(opt + 5, &end, 10);
+        if (end == opt + 5 || *end || v < 0 || v > sched_get_priority_max(SCHED_FIFO)) return false;
+        sc->rt_priority = (int)v;
+    } else if (strncmp(opt, "queue=", 6) == 0 && st != STREAM_STAGE_READER) {
+        unsigned long long v = strtoull(opt + 6, &end, 10);
+        if (end == opt + 6 || *end) return false;
+        sc->queue_bytes = (size_t)v;
+    } else if (strcmp(opt, "poll") == 0) {
+        sc->busy_poll = 1;
+    } else if (strcmp(opt, "block") == 0) {
+        sc->busy_poll = 0;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+bool stream_config_set_sched(StreamConfig *cfg, const char *spec) {
+    if (!cfg || !spec) return false;
+    char *copy = strdup(spec);
+    if (!copy) return false;
+
+    bool ok = true;
+    char *save = NULL;
+    for (char *item = strtok_r(copy, "; ", &save); item; item = strtok_r(NULL, "; ", &save)) {
+        if (strcmp(item, "mlock") == 0) {
+            cfg->lock_memory = 1;
+            continue;
+        }
+        char *opts = strchr(item, ':');
+        int st = STREAM_STAGES;
+        if (opts) {
+            *opts++ = '\0';
+            for (st = 0; st < STREAM_STAGES && strcmp(item, stream_stage_name((StreamStage)st)) != 0; st++) { }
+        }
+        if (st == STREAM_STAGES) {
+            log_warning("stream: unknown sched item '%s' (want mlock or reader|unpack|sink:...)", item);
+            ok = false;
+            continue;
+        }
+        char *save_opt = NULL;
+        for (char *o = strtok_r(opts, ",", &save_opt); o; o = strtok_r(NULL, ",", &save_opt)) {
+            if (!stream_sched_opt((StreamStage)st, &cfg->stage[st], o)) {
+                log_warning("stream: ignoring sched option '%s' for %s", o, item);
+                ok = false;
+            }
+        }
+    }
+    free(copy);
+    return ok;
+}
+
+// A FIFO poller needs a pinned CPU no other stage uses; otherwise it blocks
+static void stream_sched_check(StreamConfig *cfg) {
+    for (int i = 0; i < STREAM_STAGES; i++) {
+        StreamStageSched *sc = &cfg->stage[i];
+        if (!sc->busy_poll || sc->rt_priority == 0) continue;
+        bool alone = sc->cpu >= 0;
+        for (int j = 0; alone && j < STREAM_STAGES; j++) alone = (j == i || cfg->stage[j].cpu != sc->cpu);
+        if (!alone) {
+            log_warning("stream: %s polls under SCHED_FIFO without a CPU of its own; it will block instead",
+                        stream_stage_name((StreamStage)i));
+            sc->busy_poll = 0;
+        }
+    }
+}
+
+// Called first thing by each stage thread
+static void stream_stage_setup(const StreamPipeline *p, StreamStage st) {
+    const StreamStageSched *sc = &p->cfg.stage[st];
+    const char *name = stream_stage_name(st);
+    char tname[16];
+    snprintf(tname, sizeof(tname), "pacrf-%s", name);
+    pthread_setname_np(pthread_self(), tname);
+
+    if (sc->cpu >= 0) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(sc->cpu, &set);
+        int rc = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+        if (rc != 0) log_warning("stream: cannot pin %s to cpu %d: %s", name, sc->cpu, strerror(rc));
+    }
+    if (sc->rt_priority > 0) {
+        struct sched_param sp;
+        memset(&sp, 0, sizeof(sp));
+        sp.sched_priority = sc->rt_priority;
+        int rc = pthread_setschedparam(pthread_self(), SCHED_FIFO, &sp);
+        if (rc != 0) log_warning("stream: cannot give %s SCHED_FIFO %d: %s", name, sc->rt_priority, strerror(rc));
+    }
+    if (sc->cpu >= 0 || sc->rt_priority > 0 || sc->busy_poll) {
+        log_info("stream: %s on cpu %d, %s %d, %s", name, sc->cpu,
+                 sc->rt_priority ? "fifo" : "other", sc->rt_priority, sc->busy_poll ? "busy-poll" : "block");
+    }
+}
+
+// Queue waits of a stage: a STREAM_WAIT_MS sleep, or a bounded spin when it
+// busy-polls. Both return NULL when the slice ends empty-handed.
+static const void *stream_peek(const StreamPipeline *p, StreamStage st, RecordQueue *q, size_t *len) {
+    if (!p->cfg.stage[st].busy_poll) return record_queue_peek_wait(q, len, STREAM_WAIT_MS);
+    for (unsigned i = 0; i < STREAM_POLL_SPINS; i++) {
+        const void *rec = record_queue_peek(q, len);
+        if (rec) return rec;
+        pacrf_cpu_relax();
+    }
+    return NULL;
+}
+
+static void *stream_reserve_slice(const StreamPipeline *p, StreamStage st, RecordQueue *q, size_t len) {
+    if (!p->cfg.stage[st].busy_poll) return record_queue_reserve_wait(q, len, STREAM_WAIT_MS);
+    for (unsigned i = 0; i < STREAM_POLL_SPINS; i++) {
+        void *slot = record_queue_reserve(q, len);
+        if (slot) return slot;
+        pacrf_cpu_relax();
+    }
+    return NULL;
+}
+
+static bool stream_stopping(const StreamPipeline *p) {
+    return pacrf_load_acquire(&p->stop) != 0;
+}
+
+// Pushes an EOS block; waits as long as it takes (the consumer always drains)
+static void stream_push_eos(RecordQueue *q, uint64_t seq) {
+    StreamBlock *b;
+    while (!(b = (StreamBlock *)record_queue_reserve_wait(q, sizeof(*b), STREAM_WAIT_MS))) { }
+    memset(b, 0, sizeof(*b));
+    b->seq = seq;
+    b->flags = STREAM_BLOCK_EOS;
+    b->t_mono_ns = stream_now_ns();
+    record_queue_commit(q, sizeof(*b));
+}
+
+// Reserves room for a raw block, honouring block_on_full; NULL = drop it
+static void *stream_reserve(StreamPipeline *p, RecordQueue *q, size_t len, StreamStageStats *st) {
+    void *slot = record_queue_reserve(q, len);
+    if (slot || !p->cfg.block_on_full) return slot;
+
+    STAT_ADD(st->stalls, 1);
+    while (!stream_stopping(p)) {
+        slot = stream_reserve_slice(p, STREAM_STAGE_READER, q, len);
+        if (slot) return slot;
+    }
+    return NULL;
+}
+
+static void *stream_reader_main(void *arg) {
+    StreamPipeline *p = (StreamPipeline *)arg;
+    StreamStageStats *st = &p->reader;
+    const size_t hdr = sizeof(StreamBlock);
+    uint8_t *scratch = NULL;   // drop target when the queue is full and we must not wait
+    uint64_t seq = 0;
+    bool gap = false;
+
+    stream_stage_setup(p, STREAM_STAGE_READER);
+    while (!stream_stopping(p)) {
+        ssize_t n;
+        StreamBlock *b;
+
+        if (p->src.ops->read_ref) {
+            // Zero-copy: the queue carries only a descriptor
+            StreamRef ref;
+            n = p->src.ops->read_ref(&p->src, &ref, STREAM_WAIT_MS);
+            if (n == STREAM_AGAIN) continue;
+            if (n <= 0) break;
+
+            b = (StreamBlock *)stream_reserve(p, &p->raw_q, hdr, st);
+            if (!b) {
+                if (ref.release) ref.release(ref.ctx, ref.data);
+                STAT_ADD(st->drops, 1);
+                metrics_add(METRIC_STREAM_DROPS, 1);
+                gap = true;
+                continue;
+            }
+            b->flags = STREAM_BLOCK_REF;
+            b->ref = ref.data;
+            b->release = ref.release;
+            b->release_ctx = ref.ctx;
+        } else {
+            b = (StreamBlock *)stream_reserve(p, &p->raw_q, hdr + p->raw_cap, st);
+            if (!b) {
+                if (stream_stopping(p)) break;
+                // Real-time source, no room: read into scratch and count a drop
+                if (!scratch && !(scratch = (uint8_t *)mempool_alloc(p->raw_cap))) break;
+                n = p->src.ops->read(&p->src, scratch, p->raw_cap);
+                if (n == STREAM_AGAIN) continue;
+                if (n <= 0) break;
+                STAT_ADD(st->drops, 1);
+                metrics_add(METRIC_STREAM_DROPS, 1);
+                gap = true;
+                continue;
+            }
+            n = p->src.ops->read(&p->src, b + 1, p->raw_cap);
+            if (n == STREAM_AGAIN) continue;   // reservation stays open
+            if (n <= 0) break;
+            b->flags = 0;
+            b->ref = NULL;
+            b->release = NULL;
+            b->release_ctx = NULL;
+        }
+
+        b->seq = seq++;
+        b->t_mono_ns = stream_now_ns();
+        b->t_stage_ns = b->t_mono_ns;
+        b->len = (uint32_t)n;
+        b->width = (uint16_t)p->cfg.width;
+        if (gap) { b->flags |= STREAM_BLOCK_GAP; gap = false; }
+        record_queue_commit(&p->raw_q, (b->flags & STREAM_BLOCK_REF) ? hdr : hdr + (size_t)n);
+
+        STAT_ADD(st->blocks, 1);
+        STAT_ADD(st->bytes, (uint64_t)n);
+        STAT_ADD(st->samples, (uint64_t)n * 8 / p->cfg.width);
+        metrics_add(METRIC_STREAM_BLOCKS, 1);
+        metrics_add(METRIC_STREAM_BYTES, (uint64_t)n);
+        metrics_gauge_set(METRIC_GAUGE_RAW_QUEUE_BYTES, record_queue_used(&p->raw_q));
+    }
+
+    mempool_free(scratch, p->raw_cap);
+    stream_push_eos(&p->raw_q, seq);
+    return NULL;
+}
+
+static void *stream_unpack_main(void *arg) {
+    StreamPipeline *p = (StreamPipeline *)arg;
+    StreamStageStats *st = &p->unpack;
+    const size_t hdr = sizeof(StreamBlock);
+
+    stream_stage_setup(p, STREAM_STAGE_UNPACK);
+    for (;;) {
+        size_t len;
+        const StreamBlock *in = (const StreamBlock *)stream_peek(p, STREAM_STAGE_UNPACK, &p->raw_q, &len);
+        if (!in) { STAT_ADD(st->stalls, 1); continue; }
+
+        if (in->flags & STREAM_BLOCK_EOS) {
+            record_queue_release(&p->raw_q);
+            break;
+        }
+
+        int64_t t_in = stream_now_ns();
+        stream_lat_record(&p->lat, STREAM_LAT_RAW_QUEUE, (uint64_t)(t_in - in->t_mono_ns));
+
+        const uint8_t *data = (in->flags & STREAM_BLOCK_REF) ? (const uint8_t *)in->ref
+                                                             : (const uint8_t *)(in + 1);
+        BitParser bp;
+        bit_parser_init(&bp, data, (size_t)in->len * 8);
+        size_t remaining = (size_t)in->len * 8 / in->width;
+        size_t chunk_max = p->raw_cap * 8 / in->width;   // fits the sample queue
+        uint16_t gap = in->flags & STREAM_BLOCK_GAP;
+
+        // Referenced blocks (USB transfers) may exceed the inline block
+        // size; they go out as several sample blocks with the same seq
+        while (remaining) {
+            size_t nsamp = remaining < chunk_max ? remaining : chunk_max;
+
+            // Sink backpressure just waits: the raw queue absorbs it, and the
+            // reader applies the drop policy if that fills too
+            StreamBlock *out;
+            while (!(out = (StreamBlock *)stream_reserve_slice(p, STREAM_STAGE_UNPACK, &p->sample_q,
+                                                               hdr + nsamp * sizeof(int16_t)))) {
+                STAT_ADD(st->stalls, 1);
+            }
+
+            size_t got = unpack_samples_i16(&bp, in->width, (int16_t *)(out + 1), nsamp);
+            *out = *in;
+            out->flags = gap;
+            out->ref = NULL;
+            out->release = NULL;
+            out->release_ctx = NULL;
+            out->len = (uint32_t)(got * sizeof(int16_t));
+            out->t_stage_ns = stream_now_ns();
+            record_queue_commit(&p->sample_q, hdr + got * sizeof(int16_t));
+            metrics_gauge_set(METRIC_GAUGE_SAMPLE_QUEUE_BYTES, record_queue_used(&p->sample_q));
+
+            gap = 0;
+            STAT_ADD(st->samples, (uint64_t)got);
+            if (got < nsamp) break;
+            remaining -= got;
+        }
+
+        if ((in->flags & STREAM_BLOCK_REF) && in->release) in->release(in->release_ctx, in->ref);
+        stream_lat_record(&p->lat, STREAM_LAT_UNPACK, (uint64_t)(stream_now_ns() - t_in));
+        STAT_ADD(st->blocks, 1);
+        STAT_ADD(st->bytes, (uint64_t)in->len);
+        record_queue_release(&p->raw_q);
+    }
+
+    stream_push_eos(&p->sample_q, 0);
+    return NULL;
+}
+
+static void *stream_sink_main(void *arg) {
+    StreamPipeline *p = (StreamPipeline *)arg;
+    StreamStageStats *st = &p->sinkst;
+    bool failed = false;
+
+    stream_stage_setup(p, STREAM_STAGE_SINK);
+    for (;;) {
+        size_t len;
+        const StreamBlock *b = (const StreamBlock *)stream_peek(p, STREAM_STAGE_SINK, &p->sample_q, &len);
+        if (!b) { STAT_ADD(st->stalls, 1); continue; }
+
+        if (b->flags & STREAM_BLOCK_EOS) {
+            record_queue_release(&p->sample_q);
+            break;
+        }
+
+        size_t count = b->len / sizeof(int16_t);
+        if (!failed) {
+            int64_t t_in = stream_now_ns();
+            int rc = p->sink.ops->write(&p->sink, b, (const int16_t *)(b + 1), count);
+            int64_t t_out = stream_now_ns();
+            stream_lat_record(&p->lat, STREAM_LAT_SAMPLE_QUEUE, (uint64_t)(t_in - b->t_stage_ns));
+            stream_lat_record(&p->lat, STREAM_LAT_SINK, (uint64_t)(t_out - t_in));
+            stream_lat_record(&p->lat, STREAM_LAT_TOTAL, (uint64_t)(t_out - b->t_mono_ns));
+            if (rc != 0) {
+                // Keep draining so upstream never blocks; just stop the source
+                failed = true;
+                STAT_ADD(st->errors, 1);
+                metrics_add(METRIC_SINK_ERRORS, 1);
+                stream_pipeline_request_stop(p);
+            } else {
+                STAT_ADD(st->blocks, 1);
+                STAT_ADD(st->bytes, (uint64_t)b->len);
+                STAT_ADD(st->samples, (uint64_t)count);
+            }
+        }
+        record_queue_release(&p->sample_q);
+    }
+
+    pthread_mutex_lock(&p->done_lock);
+    p->t_end_ns = stream_now_ns();
+    pacrf_store_release(&p->done, 1);
+    pthread_cond_broadcast(&p->done_cond);
+    pthread_mutex_unlock(&p->done_lock);
+    return NULL;
+}
+
+int stream_pipeline_start(StreamPipeline **out, const StreamConfig *cfg_in) {
+    if (!out) return -1;
+    *out = NULL;
+
+    StreamPipeline *p = (StreamPipeline *)calloc(1, sizeof(*p));
+    if (!p) return -1;
+
+    if (cfg_in) p->cfg = *cfg_in; else stream_config_init(&p->cfg);
+    StreamConfig *cfg = &p->cfg;
+    if (!cfg->source) cfg->source = "sim";
+    if (!cfg->sink) cfg->sink = "null";
+    if (cfg->width < 1 || cfg->width > 16) {
+        log_error("stream: invalid bit width %u", cfg->width);
+        free(p);
+        return -1;
+    }
+    if (!cfg->block_bytes) cfg->block_bytes = STREAM_DEFAULT_BLOCK;
+    if (!cfg->queue_bytes) cfg->queue_bytes = STREAM_DEFAULT_QUEUE;
+
+    // Whole samples per block: a multiple of `width` bytes is 8 samples
+    p->raw_cap = cfg->block_bytes - cfg->block_bytes % cfg->width;
+    if (!p->raw_cap) p->raw_cap = cfg->width;
+
+    const char *src_arg, *sink_arg;
+    const StreamSourceOps *src_ops = stream_find_source(cfg->source, &src_arg);
+    const StreamSinkOps *sink_ops = stream_find_sink(cfg->sink, &sink_arg);
+    if (!src_ops || !sink_ops) {
+        log_error("stream: unknown %s '%s'", src_ops ? "sink" : "source", src_ops ? cfg->sink : cfg->source);
+        free(p);
+        return -1;
+    }
+
+    // Each ring is sized by the stage that consumes it
+    size_t raw_bytes = cfg->stage[STREAM_STAGE_UNPACK].queue_bytes ? cfg->stage[STREAM_STAGE_UNPACK].queue_bytes
+                                                                  : cfg->queue_bytes;
+    size_t sample_bytes = cfg->stage[STREAM_STAGE_SINK].queue_bytes ? cfg->stage[STREAM_STAGE_SINK].queue_bytes
+                                                                   : cfg->queue_bytes;
+    size_t sample_rec = sizeof(StreamBlock) + p->raw_cap * 8 / cfg->width * sizeof(int16_t);
+    if (!record_queue_init(&p->raw_q, raw_bytes) ||
+        !record_queue_init(&p->sample_q, sample_bytes)) {
+        record_queue_destroy(&p->raw_q);
+        free(p);
+        return -1;
+    }
+    if (sizeof(StreamBlock) + p->raw_cap > record_queue_max_record(&p->raw_q) ||
+        sample_rec > record_queue_max_record(&p->sample_q)) {
+        log_error("stream: block of %zu bytes does not fit the %zu/%zu-byte queues",
+                  p->raw_cap, raw_bytes, sample_bytes);
+        record_queue_destroy(&p->raw_q);
+        record_queue_destroy(&p->sample_q);
+        free(p);
+        return -1;
+    }
+
+    p->src.ops = src_ops;
+    p->sink.ops = sink_ops;
+    if (src_ops->open(&p->src, src_arg, cfg) != 0) {
+        log_error("stream: source '%s' failed to open", cfg->source);
+        record_queue_destroy(&p->raw_q);
+        record_queue_destroy(&p->sample_q);
+        free(p);
+        return -1;
+    }
+    if (sink_ops->open(&p->sink, sink_arg, cfg) != 0) {
+        log_error("stream: sink '%s' failed to open", cfg->sink);
+        src_ops->close(&p->src);
+        record_queue_destroy(&p->raw_q);
+        record_queue_destroy(&p->sample_q);
+        free(p);
+        return -1;
+    }
+
+    stream_sched_check(cfg);
+    if (cfg->lock_memory) {
+        // Rings, pools and stacks stay resident: no page fault on the hot path
+        if (mlockall(MCL_CURRENT | MCL_FUTURE) == 0) p->locked = true;
+        else log_warning("stream: mlockall failed: %s", strerror(errno));
+    }
+
+    for (int i = 0; i < STREAM_LAT_STAGES; i++) histogram_init(&p->lat.stage[i]);
+    pthread_mutex_init(&p->done_lock, NULL);
+    pthread_cond_init(&p->done_cond, NULL);
+    p->t_start_ns = stream_now_ns();
+
+    // Locked memory includes every stack: the stages need little of the
+    // default 8 MiB, so do not pin it
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    if (p->locked) pthread_attr_setstacksize(&attr, STREAM_LOCKED_STACK);
+
+    // Downstream first, so nothing is produced before its consumer exists
+    bool started = pthread_create(&p->th_sink, &attr, stream_sink_main, p) == 0;
+    if (started) {
+        p->threads = 1;
+        started = pthread_create(&p->th_unpack, &attr, stream_unpack_main, p) == 0;
+    }
+    if (started) {
+        p->threads = 2;
+        started = pthread_create(&p->th_reader, &attr, stream_reader_main, p) == 0;
+    }
+    if (started) p->threads = 3;
+    pthread_attr_destroy(&attr);
+    if (!started) goto fail;
+
+    log_info("stream: %s → unpack(%u-bit, %s) → %s started", cfg->source, cfg->width,
+             unpack_kernel_name(unpack_active_kernel()), cfg->sink);
+    *out = p;
+    return 0;
+
+fail:
+    log_error("stream: cannot start pipeline threads");
+    // Unwind: whatever started will see EOS and exit
+    if (p->threads >= 2) stream_push_eos(&p->raw_q, 0);
+    else if (p->threads == 1) stream_push_eos(&p->sample_q, 0);
+    stream_pipeline_destroy(p);
+    return -1;
+}
+
+void stream_pipeline_request_stop(StreamPipeline *p) {
+    if (p) pacrf_store_release(&p->stop, 1);
+}
+
+bool stream_pipeline_wait(StreamPipeline *p, int timeout_ms) {
+    if (!p) return true;
+    if (pacrf_load_acquire(&p->done)) return true;
+    if (p->threads == 0) return true;
+
+    struct timespec deadline;
+    if (timeout_ms >= 0) {
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += timeout_ms / 1000;
+        deadline.tv_nsec += (long)(timeout_ms % 1000) * 1000000L;
+        if (deadline.tv_nsec >= 1000000000L) { deadline.tv_sec++; deadline.tv_nsec -= 1000000000L; }
+    }
+
+    pthread_mutex_lock(&p->done_lock);
+    while (!p->done) {
+        if (timeout_ms < 0) {
+            pthread_cond_wait(&p->done_cond, &p->done_lock);
+        } else if (pthread_cond_timedwait(&p->done_cond, &p->done_lock, &deadline) == ETIMEDOUT) {
+            break;
+        }
+    }
+    bool done = p->done != 0;
+    pthread_mutex_unlock(&p->done_lock);
+    return done;
+}
+
+static void stream_stage_snapshot(const StreamStageStats *src, StreamStageStats *dst) {
+    dst->blocks  = pacrf_load_relaxed(&src->blocks);
+    dst->bytes   = pacrf_load_relaxed(&src->bytes);
+    dst->samples = pacrf_load_relaxed(&src->samples);
+    dst->stalls  = pacrf_load_relaxed(&src->stalls);
+    dst->drops   = pacrf_load_relaxed(&src->drops);
+    dst->errors  = pacrf_load_relaxed(&src->errors);
+}
+
+void stream_pipeline_get_stats(const StreamPipeline *p, StreamStats *out) {
+    if (!out) return;
+    memset(out, 0, sizeof(*out));
+    if (!p) return;
+
+    stream_stage_snapshot(&p->reader, &out->reader);
+    stream_stage_snapshot(&p->unpack, &out->unpack);
+    stream_stage_snapshot(&p->sinkst, &out->sink);
+    out->raw_queue_used = record_queue_used(&p->raw_q);
+    out->sample_queue_used = record_queue_used(&p->sample_q);
+    out->running = !pacrf_load_acquire(&p->done);
+    int64_t end = out->running ? stream_now_ns() : p->t_end_ns;
+    out->elapsed_ns = end - p->t_start_ns;
+}
+
+void stream_pipeline_get_latency(const StreamPipeline *p, StreamLatency *out) {
+    if (!out) return;
+    for (int i = 0; i < STREAM_LAT_STAGES; i++) {
+        histogram_init(&out->stage[i]);
+        if (p) histogram_merge(&out->stage[i], &p->lat.stage[i]);
+    }
+}
+
+const char *stream_latency_stage_name(StreamLatencyStage stage) {
+    static const char *const names[STREAM_LAT_STAGES] = {
+        "raw_queue", "unpack", "sample_queue", "sink", "total"
+    };
+    return (unsigned)stage < STREAM_LAT_STAGES ? names[stage] : "?";
+}
+
+void stream_pipeline_destroy(StreamPipeline *p) {
+    if (!p) return;
+
+    stream_pipeline_request_stop(p);
+    if (p->threads >= 3) pthread_join(p->th_reader, NULL);
+    if (p->threads >= 2) pthread_join(p->th_unpack, NULL);
+    if (p->threads >= 1) pthread_join(p->th_sink, NULL);
+
+    p->sink.ops->close(&p->sink);
+    p->src.ops->close(&p->src);
+    record_queue_destroy(&p->raw_q);
+    record_queue_destroy(&p->sample_q);
+    pthread_cond_destroy(&p->done_cond);
+    pthread_mutex_destroy(&p->done_lock);
+    if (p->locked) munlockall();
+    free(p);
+}
@@ -0,0 +1,208 @@
+// src/common/unpack.c
+//
+// Runtime kernel selection and the scalar (BitParser) fallback for the
+// sample unpacker. Vector kernels live in unpack_x86.c / unpack_neon.c.
+
+#include "unpack.h"
+#include "unpack_kernels.h"
+#include "logger.h"
+#include "pacrf_atomic.h"
+#include <stdlib.h>   // getenv
+#include <string.h>   // strcmp
+#include <pthread.h>  // pthread_once
+
+#if defined(PACRF_HAVE_NEON) && defined(__arm__) && defined(__linux__)
+#include <sys/auxv.h> // getauxval(AT_HWCAP)
+#ifndef HWCAP_NEON
+#define HWCAP_NEON (1 << 12)
+#endif
+#endif
+
+// Samples staged per pass when widening or sign-extending
+#define UNPACK_BLOCK 256
+
+/* ============================================================================
+ *  Scalar fallback (BitParser path)
+ * ==========================================================================*/
+static void scalar_widen_i32(const int16_t *src, int32_t *dst, size_t n) {
+    unpack_tail_i32(src, dst, n);
+}
+
+static void scalar_widen_f32(const int16_t *src, float *dst, size_t n, float scale) {
+    unpack_tail_f32(src, dst, n, scale);
+}
+
+// No packed kernels: unpack_samples_i16 routes every width to BitParser
+static const UnpackOps unpack_ops_scalar = {
+    UNPACK_KERNEL_SCALAR, NULL, NULL, NULL, scalar_widen_i32, scalar_widen_f32
+};
+
+static size_t unpack_scalar_i16(BitParser *parser, size_t width, int16_t *out, size_t count) {
+    const int sign = 1 << (width - 1);
+    uint16_t tmp[UNPACK_BLOCK];
+    size_t done = 0;
+
+    while (done < count) {
+        size_t want = count - done;
+        if (want > UNPACK_BLOCK) want = UNPACK_BLOCK;
+
+        size_t got = bit_parser_read_many(parser, width, tmp, want);
+        for (size_t i = 0; i < got; i++) {
+            out[done + i] = (int16_t)(((int)tmp[i] ^ sign) - sign);
+        }
+        done += got;
+        if (got < want) break;
+    }
+    return done;
+}
+
+/* ============================================================================
+ *  Kernel selection
+ * ==========================================================================*/
+static const UnpackOps *g_ops = &unpack_ops_scalar;   // swapped by unpack_set_kernel while workers read
+static pthread_once_t   g_ops_once = PTHREAD_ONCE_INIT;
+
+static const UnpackOps *unpack_ops_for(UnpackKernel kernel) {
+    switch (kernel) {
+        case UNPACK_KERNEL_SCALAR:
+            return &unpack_ops_scalar;
+#if defined(__x86_64__) || defined(__SSE2__)
+        case UNPACK_KERNEL_SSE2:
+            return &unpack_ops_sse2;
+        case UNPACK_KERNEL_AVX2:
+            return unpack_x86_has_avx2() ? &unpack_ops_avx2 : NULL;
+#endif
+#if defined(PACRF_HAVE_NEON)
+        case UNPACK_KERNEL_NEON:
+#if defined(__arm__) && defined(__linux__)
+            return (getauxval(AT_HWCAP) & HWCAP_NEON) ? &unpack_ops_neon : NULL;
+#else
+            return &unpack_ops_neon;   // AArch64: NEON is baseline
+#endif
+#endif
+        default:
+            return NULL;
+    }
+}
+
+static void unpack_select(void) {
+    static const UnpackKernel preference[] = {
+        UNPACK_KERNEL_AVX2, UNPACK_KERNEL_NEON, UNPACK_KERNEL_SSE2
+    };
+
+    const char *force = getenv("PACRF_UNPACK_KERNEL");
+    if (force && *force) {
+        for (int k = UNPACK_KERNEL_SCALAR; k <= UNPACK_KERNEL_NEON; k++) {
+            if (strcmp(force, unpack_kernel_name((UnpackKernel)k)) == 0) {
+                const UnpackOps *ops = unpack_ops_for((UnpackKernel)k);
+                if (ops) { pacrf_store_release(&g_ops, ops); return; }
+            }
+        }
+        log_warning("PACRF_UNPACK_KERNEL=%s not available; auto-selecting", force);
+    }
+
+    for (size_t i = 0; i < sizeof(preference) / sizeof(preference[0]); i++) {
+        const UnpackOps *ops = unpack_ops_for(preference[i]);
+        if (ops) { pacrf_store_release(&g_ops, ops); return; }
+    }
+    pacrf_store_release(&g_ops, &unpack_ops_scalar);
+}
+
+static const UnpackOps *unpack_ops(void) {
+    pthread_once(&g_ops_once, unpack_select);
+    return pacrf_load_acquire(&g_ops);
+}
+
+/* ============================================================================
+ *  Public API
+ * ==========================================================================*/
+UnpackKernel unpack_active_kernel(void) {
+    return unpack_ops()->kernel;
+}
+
+const char *unpack_kernel_name(UnpackKernel kernel) {
+    switch (kernel) {
+        case UNPACK_KERNEL_SCALAR: return "scalar";
+        case UNPACK_KERNEL_SSE2:   return "sse2";
+        case UNPACK_KERNEL_AVX2:   return "avx2";
+        case UNPACK_KERNEL_NEON:   return "neon";
+    }
+    return "unknown";
+}
+
+bool unpack_set_kernel(UnpackKernel kernel) {
+    (void)unpack_ops();   // make sure auto-selection does not overwrite us later
+    const UnpackOps *ops = unpack_ops_for(kernel);
+    if (!ops) return false;
+    pacrf_store_release(&g_ops, ops);
+    return true;
+}
+
+size_t unpack_samples_i16(BitParser *parser, size_t width, int16_t *out, size_t count) {
+    if (!parser || !out || count == 0) return 0;
+    if (width == 0 || width > 16) {
+        log_warning("unpack_samples_i16: Invalid bit width (%zu bits)", width);
+        return 0;
+    }
+
+    const UnpackOps *ops = unpack_ops();
+    void (*fn)(const uint8_t *, int16_t *, size_t) = NULL;
+    switch (width) {
+        case 4:  fn = ops->w4;  break;
+        case 8:  fn = ops->w8;  break;
+        case 16: fn = ops->w16; break;
+        default: break;
+    }
+
+    // Vector kernels need a byte-aligned cursor; everything else is scalar
+    if (!fn || (parser->bit_pos & 7) != 0) {
+        return unpack_scalar_i16(parser, width, out, count);
+    }
+
+    size_t avail = bit_parser_remaining(parser) / width;
+    if (count > avail) count = avail;
+
+    fn(parser->data + (parser->bit_pos >> 3), out, count);
+    parser->bit_pos += count * width;
+    return count;
+}
+
+size_t unpack_samples_i32(BitParser *parser, size_t width, int32_t *out, size_t count) {
+    const UnpackOps *ops = unpack_ops();
+    int16_t tmp[UNPACK_BLOCK];
+    size_t done = 0;
+
+    while (done < count) {
+        size_t want = count - done;
+        if (want > UNPACK_BLOCK) want = UNPACK_BLOCK;
+
+        size_t got = unpack_samples_i16(parser, width, tmp, want);
+        ops->widen_i32(tmp, out + done, got);
+        done += got;
+        if (got < want) break;
+    }
+    return done;
+}
+
+size_t unpack_samples_f32(BitParser *parser, size_t width, float *out, size_t count) {
+    if (width == 0 || width > 16) {
+        log_warning("unpack_samples_f32: Invalid bit width (%zu bits)", width);
+        return 0;
+    }
+
+    const UnpackOps *ops = unpack_ops();
+    const float scale = 1.0f / (float)(1 << (width - 1));
+    int16_t tmp[UNPACK_BLOCK];
+    size_t done = 0;
+
+    while (done < count) {
+        size_t want = count - done;
+        if (want > UNPACK_BLOCK) want = UNPACK_BLOCK;
+
+        size_t got = unpack_samples_i16(parser, width, tmp, want);
+        ops->widen_f32(tmp, out + done, got, scale);
+        done += got;
+        if (got < want) break;
+    }
+    return done;
+}
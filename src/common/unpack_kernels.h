@@ -0,0 +1,62 @@
+#ifndef UNPACK_KERNELS_H
+#define UNPACK_KERNELS_H
+
+// Internal to the unpacker: per-ISA kernel tables and the scalar tails
+// the vector kernels share. Not part of the public include/ API.
+
+#include <stddef.h>
+#include <stdint.h>
+#include "unpack.h"
+
+typedef struct {
+    UnpackKernel kernel;
+
+    // Byte-aligned packed samples → int16 (n = sample count)
+    void (*w4) (const uint8_t *src, int16_t *dst, size_t n);
+    void (*w8) (const uint8_t *src, int16_t *dst, size_t n);
+    void (*w16)(const uint8_t *src, int16_t *dst, size_t n);
+
+    // int16 → wider types
+    void (*widen_i32)(const int16_t *src, int32_t *dst, size_t n);
+    void (*widen_f32)(const int16_t *src, float *dst, size_t n, float scale);
+} UnpackOps;
+
+#if defined(__x86_64__) || defined(__SSE2__)
+extern const UnpackOps unpack_ops_sse2;
+extern const UnpackOps unpack_ops_avx2;
+int unpack_x86_has_avx2(void);
+#endif
+
+#if defined(PACRF_HAVE_NEON)
+extern const UnpackOps unpack_ops_neon;
+#endif
+
+// -------------------- Scalar tails --------------------
+
+static inline void unpack_tail_w4(const uint8_t *src, int16_t *dst, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        uint8_t b   = src[i >> 1];
+        int     nib = (i & 1) ? (b & 0x0F) : (b >> 4);
+        dst[i] = (int16_t)((nib ^ 0x8) - 0x8);
+    }
+}
+
+static inline void unpack_tail_w8(const uint8_t *src, int16_t *dst, size_t n) {
+    for (size_t i = 0; i < n; i++) dst[i] = (int8_t)src[i];
+}
+
+static inline void unpack_tail_w16(const uint8_t *src, int16_t *dst, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        dst[i] = (int16_t)((src[2 * i] << 8) | src[2 * i + 1]);
+    }
+}
+
+static inline void unpack_tail_i32(const int16_t *src, int32_t *dst, size_t n) {
+    for (size_t i = 0; i < n; i++) dst[i] = src[i];
+}
+
+static inline void unpack_tail_f32(const int16_t *src, float *dst, size_t n, float scale) {
+    for (size_t i = 0; i < n; i++) dst[i] = (float)src[i] * scale;
+}
+
+#endif // UNPACK_KERNELS_H
@@ -0,0 +1,80 @@
+// src/common/unpack_neon.c
+//
+// NEON unpack kernels. On AArch64 NEON is baseline; on 32-bit ARM (Zynq-7000)
+// CMake compiles only this file with -mfpu=neon, and unpack.c checks HWCAP
+// before selecting it, so the rest of the binary stays NEON-free.
+
+#include "unpack_kernels.h"
+
+#if defined(PACRF_HAVE_NEON) && (defined(__ARM_NEON) || defined(__ARM_NEON__))
+
+#include <arm_neon.h>
+
+static void neon_w8(const uint8_t *src, int16_t *dst, size_t n) {
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        int8x16_t v = vld1q_s8((const int8_t *)(src + i));
+        vst1q_s16(dst + i,     vmovl_s8(vget_low_s8(v)));
+        vst1q_s16(dst + i + 8, vmovl_s8(vget_high_s8(v)));
+    }
+    unpack_tail_w8(src + i, dst + i, n - i);
+}
+
+static void neon_w16(const uint8_t *src, int16_t *dst, size_t n) {
+    size_t i = 0;
+#ifndef __ARM_BIG_ENDIAN
+    for (; i + 8 <= n; i += 8) {
+        // Big-endian samples → little-endian lanes
+        uint8x16_t v = vrev16q_u8(vld1q_u8(src + 2 * i));
+        vst1q_s16(dst + i, vreinterpretq_s16_u8(v));
+    }
+#endif
+    unpack_tail_w16(src + 2 * i, dst + i, n - i);
+}
+
+static void neon_w4(const uint8_t *src, int16_t *dst, size_t n) {
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        int8x16_t v  = vld1q_s8((const int8_t *)(src + (i >> 1)));
+        int8x16_t hi = vshrq_n_s8(v, 4);
+        int8x16_t lo = vshrq_n_s8(vshlq_n_s8(v, 4), 4);
+        int8x16x2_t z = vzipq_s8(hi, lo);      // hi0,lo0,hi1,lo1,...
+        vst1q_s16(dst + i,      vmovl_s8(vget_low_s8(z.val[0])));
+        vst1q_s16(dst + i + 8,  vmovl_s8(vget_high_s8(z.val[0])));
+        vst1q_s16(dst + i + 16, vmovl_s8(vget_low_s8(z.val[1])));
+        vst1q_s16(dst + i + 24, vmovl_s8(vget_high_s8(z.val[1])));
+    }
+    unpack_tail_w4(src + (i >> 1), dst + i, n - i);
+}
+
+static void neon_widen_i32(const int16_t *src, int32_t *dst, size_t n) {
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        int16x8_t v = vld1q_s16(src + i);
+        vst1q_s32(dst + i,     vmovl_s16(vget_low_s16(v)));
+        vst1q_s32(dst + i + 4, vmovl_s16(vget_high_s16(v)));
+    }
+    unpack_tail_i32(src + i, dst + i, n - i);
+}
+
+static void neon_widen_f32(const int16_t *src, float *dst, size_t n, float scale) {
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        int16x8_t v = vld1q_s16(src + i);
+        float32x4_t lo = vcvtq_f32_s32(vmovl_s16(vget_low_s16(v)));
+        float32x4_t hi = vcvtq_f32_s32(vmovl_s16(vget_high_s16(v)));
+        vst1q_f32(dst + i,     vmulq_n_f32(lo, scale));
+        vst1q_f32(dst + i + 4, vmulq_n_f32(hi, scale));
+    }
+    unpack_tail_f32(src + i, dst + i, n - i, scale);
+}
+
+const UnpackOps unpack_ops_neon = {
+    UNPACK_KERNEL_NEON, neon_w4, neon_w8, neon_w16, neon_widen_i32, neon_widen_f32
+};
+
+#else
+
+typedef int unpack_neon_unused_t;   // keep the TU non-empty without NEON
+
+#endif
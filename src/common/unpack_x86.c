@@ -0,0 +1,175 @@
+// src/common/unpack_x86.c
+//
+// SSE2 and AVX2 unpack kernels. SSE2 is baseline on x86-64 so it needs no
+// flags; the AVX2 functions carry a target attribute so the rest of the
+// binary still runs on pre-Haswell CPUs (selection happens at runtime).
+
+#include "unpack_kernels.h"
+
+#if defined(__x86_64__) || defined(__SSE2__)
+
+#include <emmintrin.h>
+
+// target("avx2") + intrinsics needs GCC 4.9+ (or clang); older compilers
+// simply don't get the AVX2 table and fall back to SSE2.
+#if defined(__clang__) || (defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9)))
+#define PACRF_UNPACK_AVX2 1
+#include <immintrin.h>
+#endif
+
+/* ============================================================================
+ *  SSE2
+ * ==========================================================================*/
+static void sse2_w8(const uint8_t *src, int16_t *dst, size_t n) {
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i x = _mm_loadu_si128((const __m128i *)(src + i));
+        // Duplicate each byte into a 16-bit lane, then shift down with sign
+        __m128i lo = _mm_srai_epi16(_mm_unpacklo_epi8(x, x), 8);
+        __m128i hi = _mm_srai_epi16(_mm_unpackhi_epi8(x, x), 8);
+        _mm_storeu_si128((__m128i *)(dst + i),     lo);
+        _mm_storeu_si128((__m128i *)(dst + i + 8), hi);
+    }
+    unpack_tail_w8(src + i, dst + i, n - i);
+}
+
+static void sse2_w16(const uint8_t *src, int16_t *dst, size_t n) {
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m128i x = _mm_loadu_si128((const __m128i *)(src + 2 * i));
+        // Big-endian → host order: swap the two bytes of every lane
+        __m128i s = _mm_or_si128(_mm_slli_epi16(x, 8), _mm_srli_epi16(x, 8));
+        _mm_storeu_si128((__m128i *)(dst + i), s);
+    }
+    unpack_tail_w16(src + 2 * i, dst + i, n - i);
+}
+
+static void sse2_w4(const uint8_t *src, int16_t *dst, size_t n) {
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m128i x = _mm_loadu_si128((const __m128i *)(src + (i >> 1)));
+        __m128i w[2] = { _mm_unpacklo_epi8(x, x), _mm_unpackhi_epi8(x, x) };
+        for (int k = 0; k < 2; k++) {
+            // Lane = b<<8|b: bits 15..12 are the high nibble, 3..0 the low one
+            __m128i hi = _mm_srai_epi16(w[k], 12);
+            __m128i lo = _mm_srai_epi16(_mm_slli_epi16(w[k], 12), 12);
+            _mm_storeu_si128((__m128i *)(dst + i + 16 * k),     _mm_unpacklo_epi16(hi, lo));
+            _mm_storeu_si128((__m128i *)(dst + i + 16 * k + 8), _mm_unpackhi_epi16(hi, lo));
+        }
+    }
+    unpack_tail_w4(src + (i >> 1), dst + i, n - i);
+}
+
+static void sse2_widen_i32(const int16_t *src, int32_t *dst, size_t n) {
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m128i x = _mm_loadu_si128((const __m128i *)(src + i));
+        _mm_storeu_si128((__m128i *)(dst + i),     _mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16));
+        _mm_storeu_si128((__m128i *)(dst + i + 4), _mm_srai_epi32(_mm_unpackhi_epi16(x, x), 16));
+    }
+    unpack_tail_i32(src + i, dst + i, n - i);
+}
+
+static void sse2_widen_f32(const int16_t *src, float *dst, size_t n, float scale) {
+    const __m128 k = _mm_set1_ps(scale);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m128i x  = _mm_loadu_si128((const __m128i *)(src + i));
+        __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16);
+        __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(x, x), 16);
+        _mm_storeu_ps(dst + i,     _mm_mul_ps(_mm_cvtepi32_ps(lo), k));
+        _mm_storeu_ps(dst + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(hi), k));
+    }
+    unpack_tail_f32(src + i, dst + i, n - i, scale);
+}
+
+const UnpackOps unpack_ops_sse2 = {
+    UNPACK_KERNEL_SSE2, sse2_w4, sse2_w8, sse2_w16, sse2_widen_i32, sse2_widen_f32
+};
+
+/* ============================================================================
+ *  AVX2
+ * ==========================================================================*/
+#ifdef PACRF_UNPACK_AVX2
+
+#define AVX2_FN __attribute__((target("avx2")))
+
+AVX2_FN static void avx2_w8(const uint8_t *src, int16_t *dst, size_t n) {
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m128i a = _mm_loadu_si128((const __m128i *)(src + i));
+        __m128i b = _mm_loadu_si128((const __m128i *)(src + i + 16));
+        _mm256_storeu_si256((__m256i *)(dst + i),      _mm256_cvtepi8_epi16(a));
+        _mm256_storeu_si256((__m256i *)(dst + i + 16), _mm256_cvtepi8_epi16(b));
+    }
+    unpack_tail_w8(src + i, dst + i, n - i);
+}
+
+AVX2_FN static void avx2_w16(const uint8_t *src, int16_t *dst, size_t n) {
+    const __m256i swap = _mm256_setr_epi8(
+        1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14,
+        1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14);
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m256i x = _mm256_loadu_si256((const __m256i *)(src + 2 * i));
+        _mm256_storeu_si256((__m256i *)(dst + i), _mm256_shuffle_epi8(x, swap));
+    }
+    unpack_tail_w16(src + 2 * i, dst + i, n - i);
+}
+
+AVX2_FN static void avx2_w4(const uint8_t *src, int16_t *dst, size_t n) {
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i s  = _mm256_cvtepi8_epi16(_mm_loadu_si128((const __m128i *)(src + (i >> 1))));
+        __m256i hi = _mm256_srai_epi16(s, 4);
+        __m256i lo = _mm256_srai_epi16(_mm256_slli_epi16(s, 12), 12);
+        // unpack works per 128-bit lane; permute the halves back into order
+        __m256i a  = _mm256_unpacklo_epi16(hi, lo);
+        __m256i b  = _mm256_unpackhi_epi16(hi, lo);
+        _mm256_storeu_si256((__m256i *)(dst + i),      _mm256_permute2x128_si256(a, b, 0x20));
+        _mm256_storeu_si256((__m256i *)(dst + i + 16), _mm256_permute2x128_si256(a, b, 0x31));
+    }
+    unpack_tail_w4(src + (i >> 1), dst + i, n - i);
+}
+
+AVX2_FN static void avx2_widen_i32(const int16_t *src, int32_t *dst, size_t n) {
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m128i x = _mm_loadu_si128((const __m128i *)(src + i));
+        _mm256_storeu_si256((__m256i *)(dst + i), _mm256_cvtepi16_epi32(x));
+    }
+    unpack_tail_i32(src + i, dst + i, n - i);
+}
+
+AVX2_FN static void avx2_widen_f32(const int16_t *src, float *dst, size_t n, float scale) {
+    const __m256 k = _mm256_set1_ps(scale);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i x = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *)(src + i)));
+        _mm256_storeu_ps(dst + i, _mm256_mul_ps(_mm256_cvtepi32_ps(x), k));
+    }
+    unpack_tail_f32(src + i, dst + i, n - i, scale);
+}
+
+const UnpackOps unpack_ops_avx2 = {
+    UNPACK_KERNEL_AVX2, avx2_w4, avx2_w8, avx2_w16, avx2_widen_i32, avx2_widen_f32
+};
+
+int unpack_x86_has_avx2(void) {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+}
+
+#else  // !PACRF_UNPACK_AVX2
+
+const UnpackOps unpack_ops_avx2 = { UNPACK_KERNEL_AVX2, NULL, NULL, NULL, NULL, NULL };
+
+int unpack_x86_has_avx2(void) { return 0; }
+
+#endif // PACRF_UNPACK_AVX2
+
+#else
+
+typedef int unpack_x86_unused_t;   // keep the TU non-empty on other ISAs
+
+#endif // x86
@@ -0,0 +1,512 @@
+// src/common/usb_engine.c
+//
+// Asynchronous libusb bulk-IN engine (see usb_engine.h).
+//
+// Buffer life cycle:  free ──submit──▶ in flight ──complete──▶ done ring
+//                       ▲                                        │
+//                       └──────── release (resubmit or park) ◀───┘ consumer
+//
+// Completions run on the engine's event thread; the done ring is SPSC
+// (event thread → consumer) and a semaphore wakes the consumer. The free
+// stack, in-flight count and counters are shared with release() and kept
+// under one mutex, held only for bookkeeping and libusb_submit_transfer.
+
+#include "usb_engine.h"
+#include "stream.h"
+#include "logger.h"
+#include "pacrf_atomic.h"
+#include "mempool.h"
+#include "metrics.h"
+#include <libusb.h>
+#include <errno.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define USB_EVENT_SLICE_US 100000    // event loop wake-up to check for stop
+#define USB_DRAIN_MS       1000      // how long stop waits for cancellations
+
+enum { USB_BUF_FREE, USB_BUF_IN_FLIGHT, USB_BUF_DONE };
+
+typedef struct {
+    struct libusb_transfer *xfer;
+    UsbEngine              *engine;
+    unsigned                index;
+    int                     state;     // USB_BUF_* (under engine->lock)
+} UsbBuf;
+
+struct UsbEngine {
+    UsbEngineConfig       cfg;
+    libusb_context       *ctx;
+    libusb_device_handle *dev;
+    bool                  claimed;
+
+    uint8_t  *pool;          // nbufs * transfer_bytes, one allocation
+    bool      pool_dev_mem;  // from libusb_dev_mem_alloc (kernel-mapped)
+    UsbBuf   *bufs;
+    unsigned  nbufs;
+
+    // Done ring: written by the event thread, read by the consumer
+    unsigned *done;
+    size_t    done_mask;
+    PACRF_CACHE_ALIGNED size_t done_tail;   // producer
+    PACRF_CACHE_ALIGNED size_t done_head;   // consumer
+    sem_t     done_sem;
+
+    PACRF_CACHE_ALIGNED pthread_mutex_t lock;
+    unsigned *free_stack;
+    unsigned  free_count;
+    UsbEngineStats stats;    // written under lock, read relaxed
+
+    pthread_t thread;
+    bool      thread_started;
+    int       stopping;      // atomic; set by stop() or a vanished device
+};
+
+#define USB_STAT_ADD(e, field, v) \
+    pacrf_store_relaxed(&(e)->stats.field, (e)->stats.field + (v))
+
+static unsigned usb_env_uint(const char *name, unsigned def) {
+    const char *v = getenv(name);
+    if (!v || !*v) return def;
+    char *end = NULL;
+    unsigned long x = strtoul(v, &end, 0);
+    return (end && *end == '\0' && x > 0) ? (unsigned)x : def;
+}
+
+void usb_engine_config_init(UsbEngineConfig *cfg) {
+    if (!cfg) return;
+    memset(cfg, 0, sizeof(*cfg));
+    cfg->vid = (uint16_t)usb_env_uint("PACRF_USB_VID", USB_DEFAULT_VID);
+    cfg->pid = (uint16_t)usb_env_uint("PACRF_USB_PID", USB_DEFAULT_PID);
+    cfg->endpoint = (uint8_t)usb_env_uint("PACRF_USB_EP", USB_DEFAULT_ENDPOINT);
+    cfg->interface = USB_DEFAULT_INTERFACE;
+    cfg->transfers = usb_env_uint("PACRF_USB_XFERS", USB_DEFAULT_TRANSFERS);
+    cfg->spare = USB_DEFAULT_SPARE;
+    cfg->transfer_bytes = usb_env_uint("PACRF_USB_XFER_BYTES", USB_DEFAULT_TRANSFER_BYTES);
+    cfg->timeout_ms = 0;
+}
+
+/* ============================================================================
+ *  Submission (caller holds e->lock)
+ * ==========================================================================*/
+static void usb_park_locked(UsbEngine *e, UsbBuf *b) {
+    b->state = USB_BUF_FREE;
+    e->free_stack[e->free_count++] = b->index;
+}
+
+static void usb_submit_locked(UsbEngine *e, UsbBuf *b) {
+    if (pacrf_load_acquire(&e->stopping)) {
+        usb_park_locked(e, b);
+        return;
+    }
+
+    int rc = libusb_submit_transfer(b->xfer);
+    if (rc != 0) {
+        log_error("USB: submit failed: %s", libusb_error_name(rc));
+        USB_STAT_ADD(e, errors, 1);
+        usb_park_locked(e, b);
+        if (rc == LIBUSB_ERROR_NO_DEVICE) pacrf_store_release(&e->stopping, 1);
+        return;
+    }
+    b->state = USB_BUF_IN_FLIGHT;
+    USB_STAT_ADD(e, in_flight, 1);
+}
+
+// Tops the device back up to cfg.transfers from the free stack
+static void usb_refill_locked(UsbEngine *e) {
+    while (e->stats.in_flight < e->cfg.transfers && e->free_count &&
+           !pacrf_load_relaxed(&e->stopping)) {
+        usb_submit_locked(e, &e->bufs[e->free_stack[--e->free_count]]);
+    }
+    if (e->stats.in_flight < e->cfg.transfers && !pacrf_load_relaxed(&e->stopping))
+        USB_STAT_ADD(e, starved, 1);
+}
+
+/* ============================================================================
+ *  Completion (event thread)
+ * ==========================================================================*/
+static void LIBUSB_CALL usb_on_complete(struct libusb_transfer *xfer) {
+    UsbBuf *b = (UsbBuf *)xfer->user_data;
+    UsbEngine *e = b->engine;
+    bool deliver = false;
+    bool wake = false;
+
+    pthread_mutex_lock(&e->lock);
+    USB_STAT_ADD(e, in_flight, (unsigned)-1);
+
+    switch (xfer->status) {
+    case LIBUSB_TRANSFER_COMPLETED:
+    case LIBUSB_TRANSFER_TIMED_OUT:      // may still carry a partial buffer
+        deliver = xfer->actual_length > 0;
+        break;
+    case LIBUSB_TRANSFER_CANCELLED:
+        usb_park_locked(e, b);
+        pthread_mutex_unlock(&e->lock);
+        return;
+    case LIBUSB_TRANSFER_NO_DEVICE:
+        log_error("USB: device disconnected.");
+        pacrf_store_release(&e->stopping, 1);
+        usb_park_locked(e, b);
+        pthread_mutex_unlock(&e->lock);
+        sem_post(&e->done_sem);          // wake the consumer to see the stop
+        return;
+    default:                             // ERROR, STALL, OVERFLOW
+        USB_STAT_ADD(e, errors, 1);
+        break;
+    }
+
+    if (deliver) {
+        USB_STAT_ADD(e, completed, 1);
+        USB_STAT_ADD(e, bytes, (uint64_t)xfer->actual_length);
+        metrics_add(METRIC_USB_BYTES, (uint64_t)xfer->actual_length);
+        if ((size_t)xfer->actual_length < e->cfg.transfer_bytes) USB_STAT_ADD(e, short_packets, 1);
+        USB_STAT_ADD(e, held, 1);
+        b->state = USB_BUF_DONE;
+
+        size_t tail = e->done_tail;      // ring holds every buffer: never full
+        e->done[tail & e->done_mask] = b->index;
+        pacrf_store_release(&e->done_tail, tail + 1);
+        wake = true;
+
+        // A spare buffer goes out in its place so the device stays fed
+        usb_refill_locked(e);
+    } else {
+        usb_submit_locked(e, b);         // same buffer straight back
+    }
+    pthread_mutex_unlock(&e->lock);
+
+    if (wake) sem_post(&e->done_sem);
+}
+
+static void *usb_event_main(void *arg) {
+    UsbEngine *e = (UsbEngine *)arg;
+    struct timeval tv = { 0, USB_EVENT_SLICE_US };
+
+    while (!pacrf_load_acquire(&e->stopping)) {
+        int rc = libusb_handle_events_timeout_completed(e->ctx, &tv, NULL);
+        if (rc != 0 && rc != LIBUSB_ERROR_INTERRUPTED) {
+            log_error("USB: event loop failed: %s", libusb_error_name(rc));
+            pacrf_store_release(&e->stopping, 1);
+        }
+    }
+
+    // Cancel what is still queued and let the cancellations complete
+    pthread_mutex_lock(&e->lock);
+    for (unsigned i = 0; i < e->nbufs; i++) {
+        if (e->bufs[i].state == USB_BUF_IN_FLIGHT) libusb_cancel_transfer(e->bufs[i].xfer);
+    }
+    pthread_mutex_unlock(&e->lock);
+
+    struct timespec t0, now;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    while (pacrf_load_relaxed(&e->stats.in_flight) > 0) {
+        libusb_handle_events_timeout_completed(e->ctx, &tv, NULL);
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        long ms = (long)(now.tv_sec - t0.tv_sec) * 1000 + (now.tv_nsec - t0.tv_nsec) / 1000000;
+        if (ms > USB_DRAIN_MS) {
+            // usb_engine_close() then keeps the engine: libusb still owns them
+            log_warning("USB: %u transfers did not cancel in time.", e->stats.in_flight);
+            break;
+        }
+    }
+
+    sem_post(&e->done_sem);
+    return NULL;
+}
+
+/* ============================================================================
+ *  Open / Start / Stop / Close
+ * ==========================================================================*/
+UsbEngine *usb_engine_open(const UsbEngineConfig *cfg_in) {
+    UsbEngine *e = (UsbEngine *)calloc(1, sizeof(*e));
+    if (!e) return NULL;
+    if (cfg_in) e->cfg = *cfg_in; else usb_engine_config_init(&e->cfg);
+    UsbEngineConfig *cfg = &e->cfg;
+    if (cfg->transfers == 0) cfg->transfers = 1;
+
+    pthread_mutex_init(&e->lock, NULL);
+    sem_init(&e->done_sem, 0, 0);
+
+    int rc = libusb_init(&e->ctx);
+    if (rc != 0) {
+        log_error("USB: libusb_init failed: %s", libusb_error_name(rc));
+        usb_engine_close(e);
+        return NULL;
+    }
+
+    e->dev = libusb_open_device_with_vid_pid(e->ctx, cfg->vid, cfg->pid);
+    if (!e->dev) {
+        log_error("USB: device %04x:%04x not found (or no permission).", cfg->vid, cfg->pid);
+        usb_engine_close(e);
+        return NULL;
+    }
+    libusb_set_auto_detach_kernel_driver(e->dev, 1);   // unsupported on some OSes: ignore
+    rc = libusb_claim_interface(e->dev, cfg->interface);
+    if (rc != 0) {
+        log_error("USB: cannot claim interface %d: %s", cfg->interface, libusb_error_name(rc));
+        usb_engine_close(e);
+        return NULL;
+    }
+    e->claimed = true;
+
+    // Whole packets per transfer, so only the final packet can be short
+    int mps = libusb_get_max_packet_size(libusb_get_device(e->dev), cfg->endpoint);
+    if (mps > 0) {
+        size_t m = (size_t)mps;
+        cfg->transfer_bytes = cfg->transfer_bytes < m ? m : cfg->transfer_bytes - cfg->transfer_bytes % m;
+    }
+
+    e->nbufs = cfg->transfers + cfg->spare;
+    size_t ring = 1;
+    while (ring < e->nbufs) ring <<= 1;
+    e->done_mask = ring - 1;
+    e->done = (unsigned *)calloc(ring, sizeof(unsigned));
+    e->free_stack = (unsigned *)calloc(e->nbufs, sizeof(unsigned));
+    e->bufs = (UsbBuf *)calloc(e->nbufs, sizeof(UsbBuf));
+    if (!e->done || !e->free_stack || !e->bufs) {
+        usb_engine_close(e);
+        return NULL;
+    }
+
+    // Device memory lets usbfs DMA straight into our pages (no bounce copy)
+    size_t pool_bytes = (size_t)e->nbufs * cfg->transfer_bytes;
+#if defined(LIBUSB_API_VERSION) && (LIBUSB_API_VERSION >= 0x01000105)
+    e->pool = libusb_dev_mem_alloc(e->dev, pool_bytes);
+    e->pool_dev_mem = e->pool != NULL;
+#endif
+    if (!e->pool) {
+        void *mem = mempool_alloc(pool_bytes);   // page aligned; huge pages when reserved
+        if (!mem) {
+            log_error("USB: cannot allocate %zu-byte transfer pool.", pool_bytes);
+            usb_engine_close(e);
+            return NULL;
+        }
+        e->pool = (uint8_t *)mem;
+    }
+
+    for (unsigned i = 0; i < e->nbufs; i++) {
+        UsbBuf *b = &e->bufs[i];
+        b->engine = e;
+        b->index = i;
+        b->xfer = libusb_alloc_transfer(0);
+        if (!b->xfer) {
+            usb_engine_close(e);
+            return NULL;
+        }
+        libusb_fill_bulk_transfer(b->xfer, e->dev, cfg->endpoint,
+                                  e->pool + (size_t)i * cfg->transfer_bytes,
+                                  (int)cfg->transfer_bytes, usb_on_complete, b, cfg->timeout_ms);
+        usb_park_locked(e, b);
+    }
+
+    log_info("USB: %04x:%04x ep 0x%02x, %u x %zu-byte transfers in flight (+%u spare)%s.",
+             cfg->vid, cfg->pid, cfg->endpoint, cfg->transfers, cfg->transfer_bytes,
+             cfg->spare, e->pool_dev_mem ? ", device memory" : "");
+    return e;
+}
+
+int usb_engine_start(UsbEngine *e) {
+    if (!e || e->thread_started) return -1;
+    pacrf_store_release(&e->stopping, 0);
+
+    pthread_mutex_lock(&e->lock);
+    usb_refill_locked(e);
+    unsigned queued = e->stats.in_flight;
+    pthread_mutex_unlock(&e->lock);
+    if (queued == 0) return -1;
+
+    if (pthread_create(&e->thread, NULL, usb_event_main, e) != 0) {
+        log_error("USB: cannot start event thread.");
+        pacrf_store_release(&e->stopping, 1);
+        return -1;
+    }
+    e->thread_started = true;
+    return 0;
+}
+
+ssize_t usb_engine_next(UsbEngine *e, const void **data, int timeout_ms) {
+    if (!e || !data) return 0;
+
+    for (;;) {
+        int rc;
+        if (timeout_ms < 0) {
+            rc = sem_wait(&e->done_sem);
+        } else if (timeout_ms == 0) {
+            rc = sem_trywait(&e->done_sem);
+        } else {
+            struct timespec ts;
+            clock_gettime(CLOCK_REALTIME, &ts);
+            ts.tv_sec += timeout_ms / 1000;
+            ts.tv_nsec += (long)(timeout_ms % 1000) * 1000000L;
+            if (ts.tv_nsec >= 1000000000L) { ts.tv_sec++; ts.tv_nsec -= 1000000000L; }
+            rc = sem_timedwait(&e->done_sem, &ts);
+        }
+        if (rc != 0) {
+            if (errno == EINTR) continue;
+            return -2;
+        }
+
+        size_t head = e->done_head;
+        if (head != pacrf_load_acquire(&e->done_tail)) {
+            UsbBuf *b = &e->bufs[e->done[head & e->done_mask]];
+            pacrf_store_release(&e->done_head, head + 1);
+            *data = b->xfer->buffer;
+            return (ssize_t)b->xfer->actual_length;
+        }
+        if (pacrf_load_acquire(&e->stopping)) {
+            sem_post(&e->done_sem);      // stay readable for the next call
+            return 0;
+        }
+    }
+}
+
+void usb_engine_release(UsbEngine *e, const void *data) {
+    if (!e || !data) return;
+    size_t off = (size_t)((const uint8_t *)data - e->pool);
+    UsbBuf *b = &e->bufs[off / e->cfg.transfer_bytes];
+
+    pthread_mutex_lock(&e->lock);
+    USB_STAT_ADD(e, held, (unsigned)-1);
+    if (e->stats.in_flight < e->cfg.transfers) usb_submit_locked(e, b);
+    else usb_park_locked(e, b);
+    pthread_mutex_unlock(&e->lock);
+}
+
+void usb_engine_stop(UsbEngine *e) {
+    if (!e) return;
+    pacrf_store_release(&e->stopping, 1);
+    if (e->thread_started) {
+        pthread_join(e->thread, NULL);
+        e->thread_started = false;
+    }
+    sem_post(&e->done_sem);
+}
+
+void usb_engine_get_stats(const UsbEngine *e, UsbEngineStats *out) {
+    if (!out) return;
+    memset(out, 0, sizeof(*out));
+    if (!e) return;
+    out->completed     = pacrf_load_relaxed(&e->stats.completed);
+    out->bytes         = pacrf_load_relaxed(&e->stats.bytes);
+    out->short_packets = pacrf_load_relaxed(&e->stats.short_packets);
+    out->errors        = pacrf_load_relaxed(&e->stats.errors);
+    out->starved       = pacrf_load_relaxed(&e->stats.starved);
+    out->in_flight     = pacrf_load_relaxed(&e->stats.in_flight);
+    out->held          = pacrf_load_relaxed(&e->stats.held);
+}
+
+void usb_engine_close(UsbEngine *e) {
+    if (!e) return;
+    usb_engine_stop(e);
+
+    // Transfers that never finished cancelling still belong to libusb, and
+    // their callbacks use the engine, its ring and the pool: leak it all
+    // rather than free memory a late completion would write to
+    unsigned stuck = pacrf_load_relaxed(&e->stats.in_flight);
+    if (stuck > 0) {
+        log_warning("USB: %u transfers still in flight; leaking the engine (%zu-byte pool).",
+                    stuck, (size_t)e->nbufs * e->cfg.transfer_bytes);
+        return;
+    }
+
+    if (e->bufs) {
+        for (unsigned i = 0; i < e->nbufs; i++) {
+            if (e->bufs[i].xfer) libusb_free_transfer(e->bufs[i].xfer);
+        }
+    }
+    if (e->pool) {
+#if defined(LIBUSB_API_VERSION) && (LIBUSB_API_VERSION >= 0x01000105)
+        if (e->pool_dev_mem) libusb_dev_mem_free(e->dev, e->pool, (size_t)e->nbufs * e->cfg.transfer_bytes);
+        else
+#endif
+        mempool_free(e->pool, (size_t)e->nbufs * e->cfg.transfer_bytes);
+    }
+    if (e->claimed) libusb_release_interface(e->dev, e->cfg.interface);
+    if (e->dev) libusb_close(e->dev);
+    if (e->ctx) libusb_exit(e->ctx);
+
+    free(e->bufs);
+    free(e->free_stack);
+    free(e->done);
+    sem_destroy(&e->done_sem);
+    pthread_mutex_destroy(&e->lock);
+    free(e);
+}
+
+/* ============================================================================
+ *  Stream source: usb[:VID:PID]
+ *  Transfers are handed to the pipeline by reference; the unpack stage
+ *  releases each one back to the engine once it has read it.
+ * ==========================================================================*/
+static void usb_src_release(void *ctx, const void *data) {
+    usb_engine_release((UsbEngine *)ctx, data);
+}
+
+static int usb_src_open(StreamSource *s, const char *arg, const StreamConfig *cfg) {
+    UsbEngineConfig uc;
+    usb_engine_config_init(&uc);
+    if (arg && *arg) {
+        unsigned vid, pid;
+        if (sscanf(arg, "%x:%x", &vid, &pid) != 2) {
+            log_error("stream: usb source expects usb:<vid>:<pid> (hex)");
+            return -1;
+        }
+        uc.vid = (uint16_t)vid;
+        uc.pid = (uint16_t)pid;
+    }
+
+    // Whole samples per transfer (a multiple of width bytes) that is also
+    // whole packets at any bus speed (max packet <= 1024)
+    size_t unit = 1024u * cfg->width;
+    if (uc.transfer_bytes >= unit) uc.transfer_bytes -= uc.transfer_bytes % unit;
+
+    UsbEngine *e = usb_engine_open(&uc);
+    if (!e) return -1;
+    if (usb_engine_start(e) != 0) {
+        usb_engine_close(e);
+        return -1;
+    }
+    s->priv = e;
+    return 0;
+}
+
+static ssize_t usb_src_read_ref(StreamSource *s, StreamRef *ref, int timeout_ms) {
+    UsbEngine *e = (UsbEngine *)s->priv;
+    const void *data = NULL;
+    ssize_t n = usb_engine_next(e, &data, timeout_ms);
+    if (n == -2) return STREAM_AGAIN;
+    if (n <= 0) return STREAM_EOF;
+
+    ref->data = data;
+    ref->len = (size_t)n;
+    ref->release = usb_src_release;
+    ref->ctx = e;
+    return n;
+}
+
+static void usb_src_close(StreamSource *s) {
+    UsbEngine *e = (UsbEngine *)s->priv;
+    if (!e) return;
+    usb_engine_stop(e);
+
+    UsbEngineStats st;
+    usb_engine_get_stats(e, &st);
+    log_info("USB: %llu transfers, %llu bytes, %llu short, %llu errors, %llu starved.",
+             (unsigned long long)st.completed, (unsigned long long)st.bytes,
+             (unsigned long long)st.short_packets, (unsigned long long)st.errors,
+             (unsigned long long)st.starved);
+    usb_engine_close(e);
+    s->priv = NULL;
+}
+
+static const StreamSourceOps usb_stream_source = {
+    "usb", usb_src_open, NULL, usb_src_read_ref, usb_src_close
+};
+
+void usb_stream_register(void) {
+    stream_register_source(&usb_stream_source);
+}
@@ -0,0 +1,262 @@
+// src/gui/img_cache.c
+//
+// IMG: fetch → content-hash store → decode worker → GdkTexture (see img_cache.h)
+
+#include "img_cache.h"
+#include "interface.h"
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+struct ImgCache {
+    char            *dir;
+    ImgCacheReadyFn  ready;
+    gpointer         user;
+    GThreadPool     *pool;
+
+    GMutex           lock;        // guards everything below
+    GHashTable      *by_path;     // remote path → sha256 (both owned)
+    GHashTable      *textures;    // sha256 → GdkTexture (ref owned)
+    GQueue           lru;         // sha256 keys of `textures`, newest first
+    GHashTable      *inflight;    // remote paths being fetched
+    guint            tmp_seq;
+};
+
+// Carries its own callback so it can still be delivered after img_cache_free()
+typedef struct {
+    ImgCacheReadyFn ready;
+    gpointer    user;
+    char       *path;
+    GdkTexture *tex;
+    char       *note;
+} ImgReady;
+
+// ==============================
+// Delivery to the GTK thread
+// ==============================
+static gboolean img_dispatch(gpointer data) {
+    ImgReady *r = (ImgReady *)data;
+    r->ready(r->path, r->tex, r->note, r->user);
+    if (r->tex) g_object_unref(r->tex);
+    g_free(r->path);
+    g_free(r->note);
+    g_free(r);
+    return G_SOURCE_REMOVE;
+}
+
+// Takes ownership of `tex` and `note`
+static void img_post(ImgCache *c, const char *path, GdkTexture *tex, char *note) {
+    ImgReady *r = g_new0(ImgReady, 1);
+    r->ready = c->ready;
+    r->user = c->user;
+    r->path = g_strdup(path);
+    r->tex = tex;
+    r->note = note;
+    g_idle_add(img_dispatch, r);
+}
+
+// ==============================
+// Store
+// ==============================
+static char *img_hash_file(const char *file) {
+    FILE *f = fopen(file, "rb");
+    if (!f) return NULL;
+    GChecksum *cs = g_checksum_new(G_CHECKSUM_SHA256);
+    guchar buf[64 * 1024];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0) g_checksum_update(cs, buf, (gssize)n);
+    gboolean ok = !ferror(f);
+    fclose(f);
+    char *hex = ok ? g_strdup(g_checksum_get_string(cs)) : NULL;
+    g_checksum_free(cs);
+    return hex;
+}
+
+static char *img_store_path(const ImgCache *c, const char *hash) {
+    return g_build_filename(c->dir, hash, NULL);
+}
+
+static void img_index_load(ImgCache *c) {
+    char *index = g_build_filename(c->dir, "index", NULL);
+    FILE *f = fopen(index, "r");
+    g_free(index);
+    if (!f) return;
+
+    char line[4096 + 80];
+    while (fgets(line, sizeof(line), f)) {
+        line[strcspn(line, "\n")] = '\0';
+        char *sp = strchr(line, ' ');
+        if (!sp || sp - line != 64) continue;
+        *sp = '\0';
+        char *file = img_store_path(c, line);
+        if (g_file_test(file, G_FILE_TEST_IS_REGULAR)) {
+            g_hash_table_replace(c->by_path, g_strdup(sp + 1), g_strdup(line));   // later lines win
+        }
+        g_free(file);
+    }
+    fclose(f);
+}
+
+// Caller holds the lock
+static void img_index_add(ImgCache *c, const char *path, const char *hash) {
+    g_hash_table_replace(c->by_path, g_strdup(path), g_strdup(hash));
+    char *index = g_build_filename(c->dir, "index", NULL);
+    FILE *f = fopen(index, "a");
+    g_free(index);
+    if (f) {
+        fprintf(f, "%s %s\n", hash, path);
+        fclose(f);
+    }
+}
+
+// Caller holds the lock. Takes a ref of `tex`.
+static void img_textures_add(ImgCache *c, const char *hash, GdkTexture *tex) {
+    if (g_hash_table_contains(c->textures, hash)) return;
+    char *key = g_strdup(hash);
+    g_hash_table_insert(c->textures, key, g_object_ref(tex));
+    g_queue_push_head(&c->lru, key);
+    while (g_queue_get_length(&c->lru) > IMG_CACHE_TEXTURES) {
+        char *old = g_queue_pop_tail(&c->lru);
+        g_hash_table_remove(c->textures, old);   // frees key and unrefs
+    }
+}
+
+// Caller holds the lock. Returns a new ref or NULL.
+static GdkTexture *img_textures_get(ImgCache *c, const char *hash) {
+    GdkTexture *tex = g_hash_table_lookup(c->textures, hash);
+    if (!tex) return NULL;
+    GList *l = g_queue_find_custom(&c->lru, hash, (GCompareFunc)strcmp);
+    if (l) {
+        g_queue_unlink(&c->lru, l);
+        g_queue_push_head_link(&c->lru, l);
+    }
+    return g_object_ref(tex);
+}
+
+// ==============================
+// Worker: fetch (if needed) → hash → decode
+// ==============================
+static void img_job(gpointer data, gpointer user) {
+    char *path = (char *)data;
+    ImgCache *c = (ImgCache *)user;
+    gint64 t0 = g_get_monotonic_time();
+
+    g_mutex_lock(&c->lock);
+    char *hash = g_strdup(g_hash_table_lookup(c->by_path, path));
+    guint seq = ++c->tmp_seq;
+    g_mutex_unlock(&c->lock);
+
+    char *file = hash ? img_store_path(c, hash) : NULL;
+    if (file && !g_file_test(file, G_FILE_TEST_IS_REGULAR)) {   // store pruned behind our back
+        g_clear_pointer(&file, g_free);
+        g_clear_pointer(&hash, g_free);
+    }
+
+    char *note = NULL;
+    if (!hash) {
+        char *tmp = g_strdup_printf("%s/.fetch-%d-%u", c->dir, (int)getpid(), seq);
+        size_t bytes = 0;
+        if (pacrf_fetch_file(path, tmp, &bytes) != 0) {
+            img_post(c, path, NULL, g_strdup("fetch failed"));
+            g_free(tmp);
+            goto done;
+        }
+        hash = img_hash_file(tmp);
+        if (!hash) {
+            unlink(tmp);
+            g_free(tmp);
+            img_post(c, path, NULL, g_strdup("cannot read the fetched file"));
+            goto done;
+        }
+        file = img_store_path(c, hash);
+        if (g_file_test(file, G_FILE_TEST_IS_REGULAR) || rename(tmp, file) != 0) unlink(tmp);
+        g_free(tmp);
+
+        g_mutex_lock(&c->lock);
+        img_index_add(c, path, hash);
+        g_mutex_unlock(&c->lock);
+        note = g_strdup_printf("fetched %.1f KiB in %lld ms", bytes / 1024.0,
+                               (long long)((g_get_monotonic_time() - t0) / 1000));
+    } else {
+        g_mutex_lock(&c->lock);
+        GdkTexture *tex = img_textures_get(c, hash);   // decoded while we queued
+        g_mutex_unlock(&c->lock);
+        if (tex) {
+            img_post(c, path, tex, g_strdup("memory"));
+            goto done;
+        }
+        note = g_strdup("disk");
+    }
+
+    GFile *gf = g_file_new_for_path(file);
+    GError *err = NULL;
+    GdkTexture *tex = gdk_texture_new_from_file(gf, &err);
+    g_object_unref(gf);
+    if (!tex) {
+        g_free(note);
+        img_post(c, path, NULL, g_strdup_printf("cannot decode: %s", err ? err->message : "?"));
+        g_clear_error(&err);
+        goto done;
+    }
+    g_mutex_lock(&c->lock);
+    img_textures_add(c, hash, tex);
+    g_mutex_unlock(&c->lock);
+    img_post(c, path, tex, note);
+
+done:
+    g_mutex_lock(&c->lock);
+    g_hash_table_remove(c->inflight, path);
+    g_mutex_unlock(&c->lock);
+    g_free(file);
+    g_free(hash);
+    g_free(path);
+}
+
+// ==============================
+// Public API
+// ==============================
+ImgCache *img_cache_new(const char *dir, ImgCacheReadyFn ready, gpointer user) {
+    ImgCache *c = g_new0(ImgCache, 1);
+    const char *env = g_getenv("PACRF_IMG_CACHE");
+    if (dir && *dir)        c->dir = g_strdup(dir);
+    else if (env && *env)   c->dir = g_strdup(env);
+    else                    c->dir = g_build_filename(g_get_user_cache_dir(), "pacrf", "img", NULL);
+    g_mkdir_with_parents(c->dir, 0700);
+
+    c->ready = ready;
+    c->user = user;
+    g_mutex_init(&c->lock);
+    c->by_path  = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
+    c->textures = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_object_unref);
+    c->inflight = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+    g_queue_init(&c->lru);
+    img_index_load(c);
+    c->pool = g_thread_pool_new(img_job, c, IMG_CACHE_THREADS, FALSE, NULL);
+    return c;
+}
+
+void img_cache_request(ImgCache *c, const char *remote_path) {
+    if (!c || !remote_path || !*remote_path) return;
+
+    g_mutex_lock(&c->lock);
+    const char *hash = g_hash_table_lookup(c->by_path, remote_path);
+    GdkTexture *tex = hash ? img_textures_get(c, hash) : NULL;
+    gboolean busy = !tex && g_hash_table_contains(c->inflight, remote_path);
+    if (!tex && !busy) g_hash_table_add(c->inflight, g_strdup(remote_path));
+    g_mutex_unlock(&c->lock);
+
+    if (tex) img_post(c, remote_path, tex, g_strdup("memory"));
+    else if (!busy) g_thread_pool_push(c->pool, g_strdup(remote_path), NULL);
+}
+
+void img_cache_free(ImgCache *c) {
+    if (!c) return;
+    g_thread_pool_free(c->pool, TRUE, TRUE);   // drops queued requests, waits for running ones
+    g_queue_clear(&c->lru);                     // keys are owned by `textures`
+    g_hash_table_destroy(c->textures);
+    g_hash_table_destroy(c->by_path);
+    g_hash_table_destroy(c->inflight);
+    g_mutex_clear(&c->lock);
+    g_free(c->dir);
+    g_free(c);
+}
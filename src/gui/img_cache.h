@@ -0,0 +1,49 @@
+// src/gui/img_cache.h
+//
+// Fetch-and-cache pipeline for IMG: outputs
+
+#ifndef IMG_CACHE_H
+#define IMG_CACHE_H
+
+#include <gtk/gtk.h>
+
+// ============================================================================
+// Image cache
+// ----------------------------------------------------------------------------
+// IMG: lines name a file on the device. A request is served from, in order:
+//   1. decoded textures in memory (the last IMG_CACHE_TEXTURES images)
+//   2. the local store: <dir>/<sha256 of the content>, found through
+//      <dir>/index ("<sha256> <remote path>" lines, kept across sessions)
+//   3. the device: pacrf_fetch_file() over the agent or SSH, then hashed
+//      and added to the store (identical images share one file)
+// Fetching, hashing and decoding run on a small worker pool; the GTK
+// thread only receives the finished GdkTexture. Concurrent requests for
+// the same path are merged into one fetch.
+// ============================================================================
+
+#define IMG_CACHE_TEXTURES  16
+#define IMG_CACHE_THREADS   2
+
+typedef struct ImgCache ImgCache;
+
+/**
+ * Main thread. `tex` is the image (borrowed: take a ref to keep it), or
+ * NULL on failure. `note` says where it came from ("memory", "disk",
+ * "fetched 120.5 KiB in 85 ms") or why it failed.
+ */
+typedef void (*ImgCacheReadyFn)(const char *remote_path, GdkTexture *tex, const char *note, gpointer user);
+
+// Opens (creating if needed) the store in `dir`; NULL means
+// $PACRF_IMG_CACHE or <user cache dir>/pacrf/img.
+ImgCache *img_cache_new(const char *dir, ImgCacheReadyFn ready, gpointer user);
+
+// Any thread. `ready` follows once; a request for a path that is already
+// being fetched is merged into that fetch.
+void img_cache_request(ImgCache *c, const char *remote_path);
+
+// Main thread. Waits for running fetches; requests still queued are
+// dropped. Results already posted are still delivered to `ready` later,
+// so its `user` must outlive them.
+void img_cache_free(ImgCache *c);
+
+#endif // IMG_CACHE_H
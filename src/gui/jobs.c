@@ -0,0 +1,126 @@
+// src/gui/jobs.c
+//
+// Fixed GThreadPool running PAC-RF commands as cancellable jobs (see jobs.h)
+
+#include "jobs.h"
+
+typedef struct {
+    char           *args;
+    char           *label;
+    pacrf_cancel_t *cancel;
+} Job;
+
+struct JobRunner {
+    GThreadPool   *pool;
+    pacrf_line_cb  on_line;
+    JobStatusFn    on_status;
+    gpointer       user;
+
+    GMutex         lock;
+    GHashTable    *inflight;   // args → Job (queued or running)
+};
+
+static void job_free(Job *j) {
+    pacrf_cancel_free(j->cancel);
+    g_free(j->args);
+    g_free(j->label);
+    g_free(j);
+}
+
+static void jobs_status(JobRunner *r, const char *label, const char *what) {
+    char msg[256];
+    g_snprintf(msg, sizeof(msg), "%s %s", label, what);
+    if (r->on_status) r->on_status(msg, r->user);
+}
+
+static void job_run(gpointer data, gpointer user) {
+    Job *j = (Job *)data;
+    JobRunner *r = (JobRunner *)user;
+
+    int status = PACRF_CMD_CANCELLED;
+    if (!pacrf_is_cancelled(j->cancel)) {
+        jobs_status(r, j->label, "running on PAC-RF…");
+        status = run_pacrf_cmd_cancellable(j->args, r->on_line, NULL, r->user, j->cancel);
+    }
+    jobs_status(r, j->label, status == PACRF_CMD_CANCELLED ? "cancelled." : "finished.");
+
+    g_mutex_lock(&r->lock);
+    g_hash_table_remove(r->inflight, j->args);
+    g_mutex_unlock(&r->lock);
+    job_free(j);
+}
+
+JobRunner *jobs_new(pacrf_line_cb on_line, JobStatusFn on_status, gpointer user) {
+    JobRunner *r = g_new0(JobRunner, 1);
+    r->on_line = on_line;
+    r->on_status = on_status;
+    r->user = user;
+    g_mutex_init(&r->lock);
+    r->inflight = g_hash_table_new(g_str_hash, g_str_equal);   // keys owned by the Job
+    r->pool = g_thread_pool_new(job_run, r, JOBS_THREADS, FALSE, NULL);
+    return r;
+}
+
+gboolean jobs_submit(JobRunner *r, const char *args, const char *label) {
+    g_mutex_lock(&r->lock);
+    if (g_hash_table_contains(r->inflight, args)) {
+        g_mutex_unlock(&r->lock);
+        jobs_status(r, label, "is already running.");
+        return FALSE;
+    }
+    Job *j = g_new0(Job, 1);
+    j->args = g_strdup(args);
+    j->label = g_strdup(label);
+    j->cancel = pacrf_cancel_new();
+    g_hash_table_insert(r->inflight, j->args, j);
+    g_mutex_unlock(&r->lock);
+
+    g_thread_pool_push(r->pool, j, NULL);
+    return TRUE;
+}
+
+gboolean jobs_active(JobRunner *r, const char *args) {
+    g_mutex_lock(&r->lock);
+    gboolean busy = g_hash_table_contains(r->inflight, args);
+    g_mutex_unlock(&r->lock);
+    return busy;
+}
+
+gboolean jobs_cancel(JobRunner *r, const char *args) {
+    g_mutex_lock(&r->lock);
+    Job *j = g_hash_table_lookup(r->inflight, args);
+    if (j) pacrf_cancel(j->cancel);   // the job frees itself once it returns
+    g_mutex_unlock(&r->lock);
+    return j != NULL;
+}
+
+guint jobs_cancel_all(JobRunner *r) {
+    g_mutex_lock(&r->lock);
+    GHashTableIter it;
+    gpointer key, value;
+    guint n = 0;
+    g_hash_table_iter_init(&it, r->inflight);
+    while (g_hash_table_iter_next(&it, &key, &value)) {
+        pacrf_cancel(((Job *)value)->cancel);
+        n++;
+    }
+    g_mutex_unlock(&r->lock);
+    return n;
+}
+
+void jobs_free(JobRunner *r) {
+    if (!r) return;
+    jobs_cancel_all(r);
+    g_thread_pool_free(r->pool, TRUE, TRUE);   // waits for running jobs; queued ones never start
+
+    GHashTableIter it;
+    gpointer key, value;
+    g_hash_table_iter_init(&it, r->inflight);
+    while (g_hash_table_iter_next(&it, &key, &value)) {
+        g_hash_table_iter_steal(&it);
+        job_free((Job *)value);
+    }
+    g_hash_table_destroy(r->inflight);
+    g_mutex_clear(&r->lock);
+    g_free(r);
+}
@@ -0,0 +1,55 @@
+// src/gui/jobs.h
+//
+// Bounded worker pool for GUI commands, with cancellation and dedup
+
+#ifndef JOBS_H
+#define JOBS_H
+
+#include <glib.h>
+#include "interface.h"
+
+// ============================================================================
+// Job runner
+// ----------------------------------------------------------------------------
+// Every button submits a job (one PAC-RF command line) to a fixed pool of
+// JOBS_THREADS threads instead of starting a thread of its own. Jobs that
+// do not fit wait in the pool's queue.
+//
+// A command that is already queued or running is not submitted again, so
+// repeated clicks cost nothing. Each job owns a pacrf_cancel_t token:
+// jobs_cancel() kills its ssh process group or closes its agent connection
+// if it runs, or makes it finish at once if it still waits.
+//
+// The pool is sized so long-running commands (--stream-start,
+// --spectrum-start) cannot starve the ones that stop them.
+// ============================================================================
+
+#define JOBS_THREADS  4
+
+typedef struct JobRunner JobRunner;
+
+// Any thread: a status text ("GPS running on PAC-RF…", "GPS finished.")
+typedef void (*JobStatusFn)(const char *msg, gpointer user);
+
+// `on_line` receives every output line of every job (any thread), like
+// run_pacrf_cmd_cb(); `user` is passed to both callbacks.
+JobRunner *jobs_new(pacrf_line_cb on_line, JobStatusFn on_status, gpointer user);
+
+// Queues `args` under a display `label`. Returns FALSE if the same command
+// is already queued or running.
+gboolean jobs_submit(JobRunner *r, const char *args, const char *label);
+
+// TRUE while `args` is queued or running
+gboolean jobs_active(JobRunner *r, const char *args);
+
+// Cancels the job running or queued for `args`. Returns FALSE if none.
+gboolean jobs_cancel(JobRunner *r, const char *args);
+
+// Cancels every job; returns how many were cancelled
+guint jobs_cancel_all(JobRunner *r);
+
+// GUI thread, at shutdown: cancels every job, waits for the running ones
+// and frees the runner
+void jobs_free(JobRunner *r);
+
+#endif // JOBS_H
@@ -10,6 +10,10 @@
 
 #include "interface.h"
 #include "logger.h"
+#include "pacrf_atomic.h"
+#include "waterfall.h"
+#include "img_cache.h"
+#include "jobs.h"
 
 // ---- Compatibility guard --------------------------------------------------
 // Some distros (older GLib/GIO) don't define G_APPLICATION_DEFAULT_FLAGS.
@@ -18,6 +22,24 @@
 #define G_APPLICATION_DEFAULT_FLAGS G_APPLICATION_FLAGS_NONE
 #endif
 
+// ==============================
+// Text panes (batched appends)
+// ==============================
+// Worker threads push output lines onto a pane's lock-free stack; a single
+// ~30 Hz timer on the main loop drains each pane into its GtkTextBuffer with
+// one insert and trims it to `max_lines`, so streaming output costs one
+// main-loop wakeup per frame instead of one per line.
+#define GUI_FLUSH_MS           33      // ~30 Hz
+#define GUI_DEFAULT_MAX_LINES  5000    // override: PACRF_GUI_MAX_LINES
+
+typedef struct PaneLine { struct PaneLine *next; gsize len; char text[]; } PaneLine;
+
+typedef struct {
+    GtkTextBuffer *buf;
+    PaneLine      *pending;     // newest first; pushed by any thread
+    guint          max_lines;
+} Pane;
+
 // ==============================
 // Application state
 // ==============================
@@ -30,6 +52,9 @@ typedef struct {
     GtkWidget     *btn_capture;
     GtkWidget     *btn_stream_start;
     GtkWidget     *btn_stream_stop;
+    GtkWidget     *btn_spectrum_start;
+    GtkWidget     *btn_spectrum_stop;
+    GtkWidget     *btn_cancel;
 
     // Displays
     GtkWidget     *term_view;
@@ -39,8 +64,17 @@ typedef struct {
     GtkTextBuffer *log_buf;
 
     GtkWidget     *img;
+    ImgCache      *imgs;
+    JobRunner     *jobs;
+    Waterfall     *wf;
 
     GtkWidget     *status_lbl;
+    GtkWidget     *metrics_lbl;    // latest METRICS: snapshot
+
+    Pane           term_pane;
+    Pane           log_pane;
+    guint          flush_id;
+    gint           closing;        // window destroyed: late deliveries are dropped
 } App;
 
 // ==============================
@@ -78,111 +112,229 @@ static char* sanitize_to_utf8_with_hex(const char *s) {
     return g_string_free(out, FALSE); // heap string
 }
 
-static void append_to_buffer(GtkTextBuffer *buf, const char *s) {
-    if (!buf || !s) return;
+// Any thread. One allocation per line; the newline is added here.
+static void pane_push(Pane *p, const char *s) {
+    gsize n = s ? strlen(s) : 0;
+    gboolean nl = n > 0 && s[n-1] == '\n';
+    PaneLine *l = g_malloc(sizeof(PaneLine) + n + 2);
+    memcpy(l->text, s ? s : "", n);
+    if (!nl) l->text[n++] = '\n';
+    l->text[n] = '\0';
+    l->len = n;
+
+    l->next = pacrf_load_relaxed(&p->pending);
+    while (!pacrf_cas_weak(&p->pending, &l->next, l)) { }
+}
 
-    char *safe = sanitize_to_utf8_with_hex(s);
+// Main thread: takes everything pending, oldest first
+static PaneLine* pane_take(Pane *p, guint *count, gsize *bytes) {
+    PaneLine *l = pacrf_exchange(&p->pending, NULL), *fifo = NULL;
+    *count = 0; *bytes = 0;
+    while (l) {
+        PaneLine *next = l->next;
+        l->next = fifo; fifo = l;
+        (*count)++; *bytes += l->len;
+        l = next;
+    }
+    return fifo;
+}
 
-    GtkTextIter end;
-    gtk_text_buffer_get_end_iter(buf, &end);
-    gtk_text_buffer_insert(buf, &end, safe, -1);
+static void pane_free(PaneLine *l) {
+    for (PaneLine *next; l; l = next) { next = l->next; g_free(l); }
+}
+
+static void pane_flush(Pane *p) {
+    guint n; gsize bytes;
+    PaneLine *l = pane_take(p, &n, &bytes);
+    if (!l) return;
+
+    // A batch bigger than the pane would be trimmed anyway: skip its head
+    guint skip = n > p->max_lines ? n - p->max_lines : 0;
+    GString *batch = g_string_sized_new(bytes + 64);
+    if (skip) g_string_append_printf(batch, "[... %u lines skipped]\n", skip);
+    for (PaneLine *next; l; l = next) {
+        next = l->next;
+        if (skip) skip--; else g_string_append_len(batch, l->text, (gssize)l->len);
+        g_free(l);
+    }
 
-    // Ensure newline for readability
-    size_t n = strlen(safe);
-    if (n == 0 || safe[n-1] != '\n') {
-        gtk_text_buffer_insert(buf, &end, "\n", -1);
+    GtkTextIter end;
+    gtk_text_buffer_get_end_iter(p->buf, &end);
+    if (g_utf8_validate(batch->str, (gssize)batch->len, NULL)) {
+        gtk_text_buffer_insert(p->buf, &end, batch->str, (gint)batch->len);
+    } else {
+        char *safe = sanitize_to_utf8_with_hex(batch->str);
+        gtk_text_buffer_insert(p->buf, &end, safe, -1);
+        g_free(safe);
+    }
+    g_string_free(batch, TRUE);
+
+    // Scrollback limit (the buffer always ends in '\n', so the last line is empty)
+    gint lines = gtk_text_buffer_get_line_count(p->buf) - 1;
+    if (lines > (gint)p->max_lines) {
+        GtkTextIter start, cut;
+        gtk_text_buffer_get_start_iter(p->buf, &start);
+        gtk_text_buffer_get_iter_at_line(p->buf, &cut, lines - (gint)p->max_lines);
+        gtk_text_buffer_delete(p->buf, &start, &cut);
     }
-    g_free(safe);
 }
-static void gui_append_term(App *app, const char *msg){ append_to_buffer(app->term_buf, msg); }
-static void gui_append_log (App *app, const char *msg){ append_to_buffer(app->log_buf,  msg); }
 
-static void gui_handle_image(App *app, const char *remote_path){
-    char line[512];
-    g_snprintf(line, sizeof(line),
-               "[IMG] Remote image on PAC-RF: %s\n[TODO] Fetch and render locally.\n",
-               remote_path ? remote_path : "(null)");
+static void pane_init(Pane *p, GtkTextBuffer *buf) {
+    const char *env = g_getenv("PACRF_GUI_MAX_LINES");
+    guint64 v = env ? g_ascii_strtoull(env, NULL, 10) : 0;
+    p->buf = buf;
+    p->pending = NULL;
+    p->max_lines = (v > 0 && v < G_MAXINT) ? (guint)v : GUI_DEFAULT_MAX_LINES;
+}
+
+static void pane_clear(Pane *p) {
+    guint n; gsize bytes;
+    pane_free(pane_take(p, &n, &bytes));
+    gtk_text_buffer_set_text(p->buf, "", -1);
+}
+
+static gboolean gui_flush_tick(gpointer u) {
+    App *app = (App*)u;
+    pane_flush(&app->term_pane);
+    pane_flush(&app->log_pane);
+    return G_SOURCE_CONTINUE;
+}
+
+static void gui_append_term(App *app, const char *msg){ pane_push(&app->term_pane, msg); }
+static void gui_append_log (App *app, const char *msg){ pane_push(&app->log_pane,  msg); }
+
+// Main thread (ImgCache delivery): only the decoded texture reaches GTK
+static void gui_image_ready(const char *remote_path, GdkTexture *tex, const char *note, gpointer u){
+    App *app=(App*)u; char line[512];
+    if(pacrf_load_acquire(&app->closing) || !app->img) return;
+    if(tex) gtk_image_set_from_paintable(GTK_IMAGE(app->img), GDK_PAINTABLE(tex));
+    g_snprintf(line, sizeof(line), "[IMG] %s: %s%s", remote_path, tex ? "" : "ERROR — ", note ? note : "");
     gui_append_log(app, line);
-    (void)app;
+}
+
+static void gui_handle_image(App *app, const char *remote_path){
+    img_cache_request(app->imgs, remote_path);
 }
 
 // ==============================
 // Main-thread marshaling
 // ==============================
-typedef enum { GUI_MSG_TERM, GUI_MSG_LOG, GUI_MSG_IMG, GUI_MSG_STATUS } GuiMsgKind;
+typedef enum { GUI_MSG_TERM, GUI_MSG_LOG, GUI_MSG_IMG, GUI_MSG_STATUS, GUI_MSG_METRICS } GuiMsgKind;
 typedef struct { App *app; GuiMsgKind kind; char *s; } GuiMsg;
 
 static gboolean gui_dispatch_to_main(gpointer data){
     GuiMsg *m = (GuiMsg*)data;
-    if(!m || !m->app){ if(m) g_free(m->s); g_free(m); return FALSE; }
+    if(!m || !m->app || pacrf_load_acquire(&m->app->closing)){ if(m) g_free(m->s); g_free(m); return FALSE; }
     switch(m->kind){
         case GUI_MSG_TERM:   gui_append_term(m->app, m->s); break;
         case GUI_MSG_LOG:    gui_append_log (m->app, m->s); break;
         case GUI_MSG_IMG:    gui_handle_image(m->app, m->s); break;
         case GUI_MSG_STATUS: if(m->app->status_lbl) gtk_label_set_text(GTK_LABEL(m->app->status_lbl), m->s?m->s:""); break;
+        case GUI_MSG_METRICS: if(m->app->metrics_lbl) gtk_label_set_text(GTK_LABEL(m->app->metrics_lbl), m->s?m->s:""); break;
     }
     g_free(m->s); g_free(m); return FALSE;
 }
 static void post_gui(App *app, GuiMsgKind kind, const char *s){
+    // Pane text is batched by gui_flush_tick; only rare messages wake the loop
+    if(pacrf_load_acquire(&app->closing)) return;
+    if(kind==GUI_MSG_TERM){ gui_append_term(app,s); return; }
+    if(kind==GUI_MSG_LOG) { gui_append_log (app,s); return; }
     GuiMsg *m=g_new0(GuiMsg,1); m->app=app; m->kind=kind; m->s=g_strdup(s?s:""); g_idle_add(gui_dispatch_to_main,m);
 }
 
 // ==============================
-// Output handler registry
+// Output handler table
 // ==============================
 typedef void (*OutputHandlerFn)(App*, const char*);
-typedef struct OutputHandlerEntry { const char *prefix; OutputHandlerFn fn; struct OutputHandlerEntry *next; } OutputHandlerEntry;
-static OutputHandlerEntry *g_handlers=NULL;
-
-static void register_output_handler(const char *prefix, OutputHandlerFn fn){
-    if(!prefix||!*prefix||!fn) return;
-    OutputHandlerEntry *e=g_new0(OutputHandlerEntry,1); e->prefix=prefix; e->fn=fn; e->next=g_handlers; g_handlers=e;
-}
+typedef struct { const char *prefix; size_t len; OutputHandlerFn fn; } OutputHandlerEntry;
 static void oh_term(App *app,const char *p){ post_gui(app,GUI_MSG_TERM,p); }
 static void oh_log (App *app,const char *p){ post_gui(app,GUI_MSG_LOG ,p); }
 static void oh_img (App *app,const char *p){ char *t=g_strdup(p?p:""); g_strstrip(t); post_gui(app,GUI_MSG_IMG,t); g_free(t); }
 static void oh_warn(App *app,const char *p){ char *t=g_strconcat("[WARN] ",p?p:"",NULL); post_gui(app,GUI_MSG_LOG,t); g_free(t); }
 static void oh_err (App *app,const char *p){ char *t=g_strconcat("[ERROR] ",p?p:"",NULL); post_gui(app,GUI_MSG_LOG,t); g_free(t); }
 static void oh_json(App *app,const char *p){ post_gui(app,GUI_MSG_LOG,p?p:""); }
-
-static void init_default_handlers(void){
-    register_output_handler("TERM: ", oh_term);
-    register_output_handler("LOG: ",  oh_log);
-    register_output_handler("IMG: ",  oh_img);
-    // forward-looking
-    register_output_handler("WARN: ", oh_warn);
-    register_output_handler("ERR: ",  oh_err);
-    register_output_handler("JSON: ", oh_json);
+// Snapshots replace each other in the metrics label instead of filling the log
+static void oh_metrics(App *app,const char *p){ post_gui(app,GUI_MSG_METRICS,p?p:""); }
+// Spectrum frames go straight to the waterfall (it is thread-safe), never to a pane
+static void oh_spec(App *app,const char *p){
+    gsize n=0; guchar *f=g_base64_decode(p?p:"",&n);
+    if(pacrf_load_acquire(&app->closing)){ g_free(f); return; }
+    if(!app->wf || !waterfall_push_frame(app->wf,f,n)) post_gui(app,GUI_MSG_LOG,"[WARN] Malformed SPEC frame");
+    g_free(f);
 }
 
-static void gui_route_line_registered(App *app, const char *line){
-    for(OutputHandlerEntry *e=g_handlers; e; e=e->next){
-        if(g_str_has_prefix(line, e->prefix)){
-            e->fn(app, line + strlen(e->prefix));
-            return;
-        }
+// Every prefix starts with a different byte, so routing a line is one
+// switch plus one compare (this runs for every line of every command)
+enum { OH_TERM, OH_LOG, OH_IMG, OH_SPEC, OH_METRICS, OH_WARN, OH_ERR, OH_JSON };
+static const OutputHandlerEntry k_handlers[] = {
+    [OH_TERM] = { "TERM: ", 6, oh_term },
+    [OH_LOG]  = { "LOG: ",  5, oh_log  },
+    [OH_IMG]  = { "IMG: ",  5, oh_img  },
+    [OH_SPEC] = { "SPEC: ", 6, oh_spec },
+    [OH_METRICS] = { "METRICS: ", 9, oh_metrics },
+    // forward-looking
+    [OH_WARN] = { "WARN: ", 6, oh_warn },
+    [OH_ERR]  = { "ERR: ",  5, oh_err  },
+    [OH_JSON] = { "JSON: ", 6, oh_json },
+};
+
+static void gui_route_line(App *app, const char *line){
+    int h;
+    switch(line[0]){
+        case 'T': h=OH_TERM; break;
+        case 'L': h=OH_LOG;  break;
+        case 'I': h=OH_IMG;  break;
+        case 'S': h=OH_SPEC; break;
+        case 'M': h=OH_METRICS; break;
+        case 'W': h=OH_WARN; break;
+        case 'E': h=OH_ERR;  break;
+        case 'J': h=OH_JSON; break;
+        default:  post_gui(app, GUI_MSG_LOG, line); return;
     }
-    post_gui(app, GUI_MSG_LOG, line);
+    const OutputHandlerEntry *e=&k_handlers[h];
+    if(strncmp(line, e->prefix, e->len)==0) e->fn(app, line + e->len);
+    else post_gui(app, GUI_MSG_LOG, line);
 }
 static void pacrf_on_line_cb(const char *line, void *user){
-    gui_route_line_registered((App*)user, line);
+    gui_route_line((App*)user, line);
 }
 
 // ==============================
 // Workers
 // ==============================
-static gpointer gps_worker(gpointer u){ App *a=(App*)u; post_gui(a,GUI_MSG_STATUS,"Running GPS on PAC-RF…"); run_pacrf_cmd_cb("--gps",pacrf_on_line_cb,a); post_gui(a,GUI_MSG_STATUS,"GPS finished."); return NULL; }
-static gpointer capture_worker(gpointer u){ App *a=(App*)u; post_gui(a,GUI_MSG_STATUS,"Running CAPTURE on PAC-RF…"); run_pacrf_cmd_cb("--capture",pacrf_on_line_cb,a); post_gui(a,GUI_MSG_STATUS,"Capture finished."); return NULL; }
-static gpointer stream_start_worker(gpointer u){ App *a=(App*)u; post_gui(a,GUI_MSG_STATUS,"Starting STREAM on PAC-RF…"); run_pacrf_cmd_cb("--stream-start",pacrf_on_line_cb,a); post_gui(a,GUI_MSG_STATUS,"Stream start issued."); return NULL; }
-static gpointer stream_stop_worker(gpointer u){ App *a=(App*)u; post_gui(a,GUI_MSG_STATUS,"Stopping STREAM on PAC-RF…"); run_pacrf_cmd_cb("--stream-stop",pacrf_on_line_cb,a); post_gui(a,GUI_MSG_STATUS,"Stream stop issued."); return NULL; }
+static gpointer ssh_connect_worker(gpointer u){
+    App *a=(App*)u; post_gui(a,GUI_MSG_STATUS,"Connecting to PAC-RF…");
+    int ms=pacrf_ssh_connect(); char msg[128];
+    if(ms>=0) g_snprintf(msg,sizeof(msg),"Connected to PAC-RF (SSH master, %d ms).",ms);
+    else      g_snprintf(msg,sizeof(msg),"No SSH master; each command connects on its own.");
+    post_gui(a,GUI_MSG_STATUS,msg); return NULL;
+}
+static void jobs_on_status(const char *msg, gpointer u){ post_gui((App*)u,GUI_MSG_STATUS,msg); }
 
 // ==============================
-// Button callbacks
+// Button callbacks (commands run as pooled jobs, see jobs.h)
 // ==============================
-static void on_btn_gps(GtkButton *b, gpointer u){ (void)b; App *a=(App*)u; gtk_text_buffer_set_text(a->term_buf,"", -1); gtk_text_buffer_set_text(a->log_buf,"", -1); g_thread_new("gps-worker",gps_worker,a); }
-static void on_btn_capture(GtkButton *b, gpointer u){ (void)b; g_thread_new("capture-worker",capture_worker,(App*)u); }
-static void on_btn_stream_start(GtkButton *b, gpointer u){ (void)b; g_thread_new("stream-start-worker",stream_start_worker,(App*)u); }
-static void on_btn_stream_stop(GtkButton *b, gpointer u){ (void)b; g_thread_new("stream-stop-worker",stream_stop_worker,(App*)u); }
+static void on_btn_gps(GtkButton *b, gpointer u){
+    (void)b; App *a=(App*)u;
+    if(jobs_active(a->jobs,"--gps")){ jobs_submit(a->jobs,"--gps","GPS"); return; }   // reports "already running"
+    pane_clear(&a->term_pane); pane_clear(&a->log_pane);
+    jobs_submit(a->jobs,"--gps","GPS");
+}
+static void on_btn_capture(GtkButton *b, gpointer u){ (void)b; jobs_submit(((App*)u)->jobs,"--capture","Capture"); }
+static void on_btn_stream_start(GtkButton *b, gpointer u){ (void)b; jobs_submit(((App*)u)->jobs,"--stream-start","Stream"); }
+static void on_btn_stream_stop(GtkButton *b, gpointer u){ (void)b; jobs_submit(((App*)u)->jobs,"--stream-stop","Stream stop"); }
+static void on_btn_spectrum_start(GtkButton *b, gpointer u){
+    (void)b; App *a=(App*)u;
+    if(!jobs_active(a->jobs,"--spectrum-start")) waterfall_clear(a->wf);
+    jobs_submit(a->jobs,"--spectrum-start","Spectrum");
+}
+static void on_btn_spectrum_stop(GtkButton *b, gpointer u){ (void)b; jobs_submit(((App*)u)->jobs,"--spectrum-stop","Spectrum stop"); }
+static void on_btn_cancel(GtkButton *b, gpointer u){
+    (void)b; App *a=(App*)u; char msg[64];
+    guint n=jobs_cancel_all(a->jobs);
+    g_snprintf(msg,sizeof(msg),n?"Cancelling %u job(s)…":"Nothing to cancel.",n);
+    post_gui(a,GUI_MSG_STATUS,msg);
+}
 
 // ==============================
 // UI helpers
@@ -219,9 +371,15 @@ static void build_ui(App *app){
     app->btn_capture      = gtk_button_new_with_label("Capture");
     app->btn_stream_start = gtk_button_new_with_label("Stream Start");
     app->btn_stream_stop  = gtk_button_new_with_label("Stream Stop");
+    app->btn_spectrum_start = gtk_button_new_with_label("Spectrum Start");
+    app->btn_spectrum_stop  = gtk_button_new_with_label("Spectrum Stop");
+    app->btn_cancel         = gtk_button_new_with_label("Cancel");
 
     gtk_header_bar_pack_start(GTK_HEADER_BAR(header), app->btn_gps);
     gtk_header_bar_pack_start(GTK_HEADER_BAR(header), app->btn_capture);
+    gtk_header_bar_pack_start(GTK_HEADER_BAR(header), app->btn_spectrum_start);
+    gtk_header_bar_pack_start(GTK_HEADER_BAR(header), app->btn_spectrum_stop);
+    gtk_header_bar_pack_end  (GTK_HEADER_BAR(header), app->btn_cancel);
     gtk_header_bar_pack_end  (GTK_HEADER_BAR(header), app->btn_stream_stop);
     gtk_header_bar_pack_end  (GTK_HEADER_BAR(header), app->btn_stream_start);
 
@@ -237,6 +395,14 @@ static void build_ui(App *app){
     app->status_lbl = gtk_label_new("Ready.");
     gtk_box_append(GTK_BOX(root), app->status_lbl);
 
+    // Metrics label: the last METRICS: line of any running command
+    app->metrics_lbl = gtk_label_new("");
+    gtk_label_set_wrap(GTK_LABEL(app->metrics_lbl), TRUE);
+    gtk_label_set_selectable(GTK_LABEL(app->metrics_lbl), TRUE);
+    gtk_label_set_xalign(GTK_LABEL(app->metrics_lbl), 0.0f);
+    gtk_widget_add_css_class(app->metrics_lbl, "monospace");
+    gtk_box_append(GTK_BOX(root), app->metrics_lbl);
+
     // Top-level horizontal paned: Left (text) | Right (image)
     GtkWidget *paned_h = gtk_paned_new(GTK_ORIENTATION_HORIZONTAL);
     gtk_widget_set_hexpand(paned_h, TRUE);
@@ -277,6 +443,7 @@ static void build_ui(App *app){
     gtk_widget_set_vexpand(app->img, TRUE);
     gtk_box_append(GTK_BOX(img_box), img_lbl);
     gtk_box_append(GTK_BOX(img_box), app->img);
+    gtk_box_append(GTK_BOX(img_box), waterfall_new(&app->wf, 512));  // 512 rows of history
 
     // Pack into horizontal paned (give text side more width initially)
     gtk_paned_set_start_child(GTK_PANED(paned_h), paned_v);
@@ -288,23 +455,50 @@ static void build_ui(App *app){
     g_signal_connect(app->btn_capture,      "clicked", G_CALLBACK(on_btn_capture),      app);
     g_signal_connect(app->btn_stream_start, "clicked", G_CALLBACK(on_btn_stream_start), app);
     g_signal_connect(app->btn_stream_stop,  "clicked", G_CALLBACK(on_btn_stream_stop),  app);
+    g_signal_connect(app->btn_spectrum_start, "clicked", G_CALLBACK(on_btn_spectrum_start), app);
+    g_signal_connect(app->btn_spectrum_stop,  "clicked", G_CALLBACK(on_btn_spectrum_stop),  app);
+    g_signal_connect(app->btn_cancel,         "clicked", G_CALLBACK(on_btn_cancel),         app);
 
     // Initial text
     gtk_text_buffer_set_text(app->term_buf, "Click GPS to run the real PAC-RF handler remotely.\n", -1);
     gtk_text_buffer_set_text(app->log_buf,  "Logs will stream here.\n", -1);
+
+    pane_init(&app->term_pane, app->term_buf);
+    pane_init(&app->log_pane,  app->log_buf);
+    app->flush_id = g_timeout_add(GUI_FLUSH_MS, gui_flush_tick, app);
 }
 
 // ==============================
 // GTK application wiring
 // ==============================
+// The children are already gone when the window emits "destroy". Stop
+// everything that touches them before waiting on the workers: jobs and
+// fetches still running keep posting until they return. `a` itself stays
+// allocated for the idle callbacks they leave queued.
+static void on_window_destroy(GtkWidget *w, gpointer u){
+    (void)w; App *a=(App*)u;
+    pacrf_store_release(&a->closing, 1);
+    if(a->flush_id){ g_source_remove(a->flush_id); a->flush_id=0; }
+    a->window=NULL; a->img=NULL; a->status_lbl=NULL; a->metrics_lbl=NULL;
+    a->term_pane.buf=NULL; a->log_pane.buf=NULL; a->term_buf=NULL; a->log_buf=NULL;
+    jobs_free(a->jobs); a->jobs=NULL;
+    img_cache_free(a->imgs); a->imgs=NULL;
+    guint n; gsize bytes;
+    pane_free(pane_take(&a->term_pane, &n, &bytes));
+    pane_free(pane_take(&a->log_pane,  &n, &bytes));
+}
 static void on_activate(GtkApplication *gtk_app, gpointer user){
     (void)user;
-    init_default_handlers();
-
     App *app = g_new0(App,1);
     app->gtk_app = gtk_app;
+    app->imgs = img_cache_new(NULL, gui_image_ready, app);
+    app->jobs = jobs_new(pacrf_on_line_cb, jobs_on_status, app);
     build_ui(app);
+    g_signal_connect(app->window, "destroy", G_CALLBACK(on_window_destroy), app);
     gtk_window_present(GTK_WINDOW(app->window));
+
+    // One SSH handshake per session, up front; buttons reuse it
+    g_thread_new("ssh-connect",ssh_connect_worker,app);
 }
 
 int main(int argc, char **argv){
@@ -312,5 +506,6 @@ int main(int argc, char **argv){
     g_signal_connect(gtk_app, "activate", G_CALLBACK(on_activate), NULL);
     int status = g_application_run(G_APPLICATION(gtk_app), argc, argv);
     g_object_unref(gtk_app);
+    pacrf_ssh_close();
     return status;
 }
\ No newline at end of file
@@ -0,0 +1,217 @@
+// src/gui/waterfall.c
+//
+// Spectrum trace + waterfall ring (see waterfall.h)
+
+#include "waterfall.h"
+#include "spectrum.h"
+#include <string.h>
+
+#define WF_PENDING_MAX   64     // frames buffered between two display ticks
+#define WF_TRACE_FRAC    0.25   // share of the height used by the trace
+
+struct Waterfall {
+    GtkWidget       *area;
+
+    // Ring (main thread only)
+    cairo_surface_t *ring;      // bins x rows, RGB24
+    int              bins;
+    int              rows;
+    int              head;      // row holding the newest frame
+    int              filled;    // rows written so far (<= rows)
+    uint8_t         *trace;     // newest frame's bins
+    SpectrumFrameHeader last;   // newest frame's header
+    uint32_t         palette[256];
+
+    // Producer side (any thread, under lock)
+    GMutex           lock;
+    uint8_t         *pending;   // WF_PENDING_MAX x pending_bins
+    SpectrumFrameHeader pending_hdr;
+    int              pending_bins;
+    int              pending_n;
+    guint64          frames;
+    guint64          dropped;   // overwritten before a tick took them
+};
+
+// black → blue → cyan → yellow → white
+static void wf_build_palette(uint32_t *pal) {
+    static const double stops[][3] = {
+        { 0.0, 0.0, 0.0 }, { 0.0, 0.0, 0.6 }, { 0.0, 0.8, 0.9 }, { 1.0, 0.9, 0.0 }, { 1.0, 1.0, 1.0 }
+    };
+    const int n = (int)(sizeof(stops) / sizeof(stops[0])) - 1;
+    for (int i = 0; i < 256; i++) {
+        double x = (double)i / 255.0 * n;
+        int s = (int)x;
+        if (s >= n) s = n - 1;
+        double f = x - s;
+        uint32_t c = 0;
+        for (int k = 0; k < 3; k++) {
+            double v = stops[s][k] + (stops[s + 1][k] - stops[s][k]) * f;
+            c = (c << 8) | (uint32_t)(v * 255.0 + 0.5);
+        }
+        pal[i] = c;
+    }
+}
+
+static void wf_reset_ring(Waterfall *wf, int bins) {
+    if (wf->ring) cairo_surface_destroy(wf->ring);
+    g_free(wf->trace);
+    wf->ring = cairo_image_surface_create(CAIRO_FORMAT_RGB24, bins, wf->rows);
+    wf->trace = g_malloc0((gsize)bins);
+    wf->bins = bins;
+    wf->head = 0;
+    wf->filled = 0;
+
+    // Start black
+    cairo_t *cr = cairo_create(wf->ring);
+    cairo_set_source_rgb(cr, 0, 0, 0);
+    cairo_paint(cr);
+    cairo_destroy(cr);
+}
+
+// Writes one row: the ring grows "upwards" so the newest row is at head
+// and older rows follow it (wrapping), which keeps drawing to two blits
+static void wf_write_row(Waterfall *wf, const uint8_t *bins) {
+    wf->head = (wf->head + wf->rows - 1) % wf->rows;
+    if (wf->filled < wf->rows) wf->filled++;
+
+    uint8_t *data = cairo_image_surface_get_data(wf->ring);
+    int stride = cairo_image_surface_get_stride(wf->ring);
+    uint32_t *px = (uint32_t *)(data + (size_t)wf->head * (size_t)stride);
+    for (int i = 0; i < wf->bins; i++) px[i] = wf->palette[bins[i]];
+    memcpy(wf->trace, bins, (size_t)wf->bins);
+}
+
+gboolean waterfall_push_frame(Waterfall *wf, const uint8_t *frame, size_t len) {
+    SpectrumFrameHeader h;
+    if (!wf || !frame || len < sizeof(h)) return FALSE;
+    memcpy(&h, frame, sizeof(h));
+    if (memcmp(h.magic, SPECTRUM_MAGIC, 4) != 0 || h.version != SPECTRUM_VERSION ||
+        h.bins == 0 || len != sizeof(h) + h.bins) {
+        return FALSE;
+    }
+
+    g_mutex_lock(&wf->lock);
+    if (h.bins != wf->pending_bins) {
+        g_free(wf->pending);
+        wf->pending = g_malloc((gsize)WF_PENDING_MAX * h.bins);
+        wf->pending_bins = h.bins;
+        wf->pending_n = 0;
+    }
+    if (wf->pending_n == WF_PENDING_MAX) {
+        // Display stalled: keep the newest frames
+        memmove(wf->pending, wf->pending + h.bins, (size_t)(WF_PENDING_MAX - 1) * h.bins);
+        wf->pending_n--;
+        wf->dropped++;
+    }
+    memcpy(wf->pending + (size_t)wf->pending_n * h.bins, frame + sizeof(h), h.bins);
+    wf->pending_n++;
+    wf->pending_hdr = h;
+    wf->frames++;
+    g_mutex_unlock(&wf->lock);
+    return TRUE;
+}
+
+// Frame clock: drain pending frames into the ring, redraw only if any came
+static gboolean wf_tick(GtkWidget *w, GdkFrameClock *clock, gpointer u) {
+    (void)clock;
+    Waterfall *wf = (Waterfall *)u;
+
+    g_mutex_lock(&wf->lock);
+    int n = wf->pending_n;
+    if (n > 0) {
+        if (wf->pending_bins != wf->bins) wf_reset_ring(wf, wf->pending_bins);
+        cairo_surface_flush(wf->ring);
+        for (int i = 0; i < n; i++) wf_write_row(wf, wf->pending + (size_t)i * wf->bins);
+        cairo_surface_mark_dirty(wf->ring);
+        wf->last = wf->pending_hdr;
+        wf->pending_n = 0;
+    }
+    g_mutex_unlock(&wf->lock);
+
+    if (n > 0) gtk_widget_queue_draw(w);
+    return G_SOURCE_CONTINUE;
+}
+
+static void wf_draw(GtkDrawingArea *area, cairo_t *cr, int width, int height, gpointer u) {
+    (void)area;
+    Waterfall *wf = (Waterfall *)u;
+    cairo_set_source_rgb(cr, 0, 0, 0);
+    cairo_paint(cr);
+    if (!wf->ring || width <= 0 || height <= 0) return;
+
+    double trace_h = height * WF_TRACE_FRAC;
+    double wf_h = height - trace_h;
+    double sx = (double)width / wf->bins;
+    double sy = wf_h / wf->rows;
+
+    // History: rows [head, rows) then [0, head), newest at the top
+    cairo_save(cr);
+    cairo_translate(cr, 0, trace_h);
+    cairo_scale(cr, sx, sy);
+    int first = wf->rows - wf->head;
+    cairo_set_source_surface(cr, wf->ring, 0, -wf->head);
+    cairo_pattern_set_filter(cairo_get_source(cr), CAIRO_FILTER_FAST);
+    cairo_rectangle(cr, 0, 0, wf->bins, first);
+    cairo_fill(cr);
+    if (wf->head > 0) {
+        cairo_set_source_surface(cr, wf->ring, 0, first);
+        cairo_pattern_set_filter(cairo_get_source(cr), CAIRO_FILTER_FAST);
+        cairo_rectangle(cr, 0, first, wf->bins, wf->head);
+        cairo_fill(cr);
+    }
+    cairo_restore(cr);
+
+    // Trace of the newest frame
+    cairo_set_source_rgb(cr, 0.05, 0.05, 0.08);
+    cairo_rectangle(cr, 0, 0, width, trace_h);
+    cairo_fill(cr);
+    cairo_set_source_rgb(cr, 0.3, 1.0, 0.4);
+    cairo_set_line_width(cr, 1.0);
+    for (int i = 0; i < wf->bins; i++) {
+        double x = (i + 0.5) * sx;
+        double y = trace_h - 1 - wf->trace[i] / 255.0 * (trace_h - 2);
+        if (i == 0) cairo_move_to(cr, x, y); else cairo_line_to(cr, x, y);
+    }
+    cairo_stroke(cr);
+
+    // Scale: full width is 0 .. rate/2
+    char info[160];
+    const SpectrumFrameHeader *h = &wf->last;
+    double span = h->sample_rate_hz ? h->sample_rate_hz / 2.0 : 0.0;
+    g_mutex_lock(&wf->lock);
+    guint64 dropped = wf->dropped;
+    g_mutex_unlock(&wf->lock);
+    g_snprintf(info, sizeof(info), "fft %u  %s%u  0-%.3f MHz  %.0f..%.0f dBFS  #%u%s",
+               h->fft_size, h->mode == SPECTRUM_MODE_MAX ? "max" : "avg", h->averaged, span / 1e6,
+               h->db_floor, h->db_floor + 255 * h->db_step, h->seq, dropped ? "  (dropping)" : "");
+    cairo_set_source_rgb(cr, 0.8, 0.8, 0.8);
+    cairo_set_font_size(cr, 11);
+    cairo_move_to(cr, 4, 12);
+    cairo_show_text(cr, info);
+}
+
+void waterfall_clear(Waterfall *wf) {
+    if (!wf || !wf->ring) return;
+    g_mutex_lock(&wf->lock);
+    wf->pending_n = 0;
+    g_mutex_unlock(&wf->lock);
+    wf_reset_ring(wf, wf->bins);
+    gtk_widget_queue_draw(wf->area);
+}
+
+GtkWidget *waterfall_new(Waterfall **out, int rows) {
+    Waterfall *wf = g_new0(Waterfall, 1);
+    wf->rows = rows > 0 ? rows : 256;
+    g_mutex_init(&wf->lock);
+    wf_build_palette(wf->palette);
+
+    wf->area = gtk_drawing_area_new();
+    gtk_widget_set_hexpand(wf->area, TRUE);
+    gtk_widget_set_vexpand(wf->area, TRUE);
+    gtk_drawing_area_set_content_height(GTK_DRAWING_AREA(wf->area), 240);
+    gtk_drawing_area_set_draw_func(GTK_DRAWING_AREA(wf->area), wf_draw, wf, NULL);
+    gtk_widget_add_tick_callback(wf->area, wf_tick, wf, NULL);
+
+    if (out) *out = wf;
+    return wf->area;
+}
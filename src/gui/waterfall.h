@@ -0,0 +1,39 @@
+// src/gui/waterfall.h
+//
+// Live spectrum + waterfall widget fed by SPEC: frames (include/spectrum.h)
+
+#ifndef WATERFALL_H
+#define WATERFALL_H
+
+#include <gtk/gtk.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// ============================================================================
+// Waterfall
+// ----------------------------------------------------------------------------
+// A GtkDrawingArea showing the newest spectrum as a trace on top and the
+// history below it, newest row first. History lives in one image surface
+// used as a ring of `rows` rows: each frame overwrites a single row and the
+// ring is drawn as two blits around the write position, so nothing is
+// reallocated or copied per frame (the surface is only rebuilt if the bin
+// count changes).
+//
+// Frames can be pushed from any thread; a frame-clock tick callback moves
+// them into the ring and redraws at most once per display refresh.
+// ============================================================================
+
+typedef struct Waterfall Waterfall;
+
+// Creates the widget; `*out` is its handle for waterfall_push_frame().
+// The handle stays valid for the life of the application.
+GtkWidget *waterfall_new(Waterfall **out, int rows);
+
+// Any thread. `frame` is one decoded SPEC: payload (header + bins).
+// Returns FALSE if it is not a valid spectrum frame.
+gboolean waterfall_push_frame(Waterfall *wf, const uint8_t *frame, size_t len);
+
+// Main thread. Forgets the history (e.g. when a new spectrum run starts).
+void waterfall_clear(Waterfall *wf);
+
+#endif // WATERFALL_H